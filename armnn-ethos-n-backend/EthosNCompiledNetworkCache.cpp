@@ -0,0 +1,470 @@
+//
+// Copyright © 2021 Arm Limited.
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "EthosNCompiledNetworkCache.hpp"
+
+#include "Layer.hpp"
+
+#include <Filesystem.hpp>
+#include <armnn/IStrategy.hpp>
+#include <armnn/Logging.hpp>
+#include <ethosn_utils/Hash.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <unordered_map>
+
+namespace armnn
+{
+
+namespace
+{
+
+/// Tag and version at the start of each file in the cache directory. The version must be increased whenever
+/// the file format or the key changes.
+constexpr char g_CacheFileTag[4]      = { 'E', 'N', 'C', 'C' };
+constexpr uint32_t g_CacheFileVersion = 2;
+constexpr char g_CacheFileExtension[] = ".encc";
+constexpr uint64_t g_KeySeed2         = 0x4E4554574F524B32ULL;
+
+void Write(std::vector<uint8_t>& out, const uint32_t data)
+{
+    // Write in little-endian order, regardless of host endianness
+    out.push_back(static_cast<uint8_t>(data & 0xFF));
+    out.push_back(static_cast<uint8_t>((data >> 8) & 0xFF));
+    out.push_back(static_cast<uint8_t>((data >> 16) & 0xFF));
+    out.push_back(static_cast<uint8_t>((data >> 24) & 0xFF));
+}
+
+void Write(std::vector<uint8_t>& out, const uint64_t data)
+{
+    Write(out, static_cast<uint32_t>(data));
+    Write(out, static_cast<uint32_t>(data >> 32));
+}
+
+void Write(std::vector<uint8_t>& out, const float data)
+{
+    uint32_t bits;
+    static_assert(sizeof(bits) == sizeof(data), "Unexpected float size");
+    std::memcpy(&bits, &data, sizeof(bits));
+    Write(out, bits);
+}
+
+void Write(std::vector<uint8_t>& out, const std::string& data)
+{
+    Write(out, static_cast<uint32_t>(data.size()));
+    out.insert(out.end(), data.begin(), data.end());
+}
+
+void Write(std::vector<uint8_t>& out, const std::unordered_map<uint32_t, uint32_t>& data)
+{
+    // Sort the pairs, so that the same map is always saved the same way
+    std::vector<std::pair<uint32_t, uint32_t>> sorted(data.begin(), data.end());
+    std::sort(sorted.begin(), sorted.end());
+    Write(out, static_cast<uint32_t>(sorted.size()));
+    for (const std::pair<uint32_t, uint32_t>& p : sorted)
+    {
+        Write(out, p.first);
+        Write(out, p.second);
+    }
+}
+
+void Write(std::vector<uint8_t>& out, const TensorInfo& info)
+{
+    const TensorShape& shape = info.GetShape();
+    Write(out, shape.GetNumDimensions());
+    for (unsigned int i = 0; i < shape.GetNumDimensions(); ++i)
+    {
+        Write(out, shape[i]);
+    }
+    Write(out, static_cast<uint32_t>(info.GetDataType()));
+    const std::vector<float> scales = info.GetQuantizationScales();
+    Write(out, static_cast<uint32_t>(scales.size()));
+    for (float scale : scales)
+    {
+        Write(out, scale);
+    }
+    Write(out, static_cast<uint32_t>(info.GetQuantizationOffset()));
+    const Optional<unsigned int> quantizationDim = info.GetQuantizationDim();
+    Write(out, quantizationDim.has_value() ? quantizationDim.value() + 1 : 0u);
+}
+
+void Write(std::vector<uint8_t>& out, const bool data)
+{
+    out.push_back(data);
+}
+
+/// Every option is included, rather than only the ones which are expected to affect the compiled network, so that
+/// an option which turns out to affect it (e.g. the debug options, which change how memory is allocated) can't
+/// cause a stale network to be loaded.
+void Write(std::vector<uint8_t>& out, const ethosn::support_library::CompilationOptions& options)
+{
+    const bool flags[] = { options.m_Strategy0,
+                           options.m_Strategy1,
+                           options.m_Strategy3,
+                           options.m_Strategy4,
+                           options.m_Strategy6,
+                           options.m_Strategy7,
+                           options.m_BlockConfig16x16,
+                           options.m_BlockConfig32x8,
+                           options.m_BlockConfig8x32,
+                           options.m_BlockConfig16x8,
+                           options.m_BlockConfig8x16,
+                           options.m_BlockConfig8x8,
+                           options.m_EnableIntermediateCompression,
+                           options.m_DisableWinograd,
+                           options.m_StrictPrecision,
+                           options.m_PackIntermediateBuffers };
+    for (bool flag : flags)
+    {
+        Write(out, flag);
+    }
+    Write(out, static_cast<uint32_t>(options.m_DebugInfo.m_DumpDebugFiles));
+    Write(out, options.m_DebugInfo.m_DebugDir);
+    Write(out, options.m_DebugInfo.m_DumpRam);
+    Write(out, options.m_DebugInfo.m_InitialSramDump);
+    Write(out, static_cast<uint32_t>(options.m_CompilerAlgorithm));
+    Write(out, options.m_NumThreads);
+    Write(out, options.m_WeightEncoderCacheDir);
+}
+
+bool Read(std::istream& in, uint32_t& data)
+{
+    uint8_t bytes[4];
+    if (!in.read(reinterpret_cast<char*>(bytes), sizeof(bytes)))
+    {
+        return false;
+    }
+    data = static_cast<uint32_t>(bytes[0]) | (static_cast<uint32_t>(bytes[1]) << 8) |
+           (static_cast<uint32_t>(bytes[2]) << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+    return true;
+}
+
+bool Read(std::istream& in, uint64_t& data)
+{
+    uint32_t low;
+    uint32_t high;
+    if (!Read(in, low) || !Read(in, high))
+    {
+        return false;
+    }
+    data = static_cast<uint64_t>(low) | (static_cast<uint64_t>(high) << 32);
+    return true;
+}
+
+bool Read(std::istream& in, std::unordered_map<uint32_t, uint32_t>& data)
+{
+    uint32_t size;
+    if (!Read(in, size))
+    {
+        return false;
+    }
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        uint32_t key;
+        uint32_t value;
+        if (!Read(in, key) || !Read(in, value))
+        {
+            return false;
+        }
+        data[key] = value;
+    }
+    return true;
+}
+
+/// Serializes everything in a subgraph which affects its compilation, in the order the subgraph is converted
+/// by EthosNSubgraphViewConverter. Large constant data is replaced by a digest.
+/// Each output slot is identified by the order in which it is reached, so that the result doesn't depend on
+/// the layers' names or GUIDs, or on the order of the subgraph's list of layers.
+class SubgraphSerializer : public IStrategy
+{
+public:
+    explicit SubgraphSerializer(std::vector<uint8_t>& out)
+        : m_Out(out)
+        , m_NextSlotId(0)
+    {}
+
+    void Serialize(const SubgraphView& subgraph)
+    {
+        Write(m_Out, subgraph.GetNumInputSlots());
+        for (uint32_t i = 0; i < subgraph.GetNumInputSlots(); ++i)
+        {
+            const OutputSlot* connectedSlot = subgraph.GetInputSlot(i)->GetConnectedOutputSlot();
+            Write(m_Out, connectedSlot->GetTensorInfo());
+            m_SlotIds[connectedSlot] = m_NextSlotId++;
+        }
+
+        Write(m_Out, subgraph.GetNumOutputSlots());
+        for (uint32_t i = 0; i < subgraph.GetNumOutputSlots(); ++i)
+        {
+            Write(m_Out, GetSlotId(subgraph.GetOutputSlot(i)));
+        }
+    }
+
+    void ExecuteStrategy(const IConnectableLayer*,
+                         const BaseDescriptor&,
+                         const std::vector<ConstTensor>& constants,
+                         const char*,
+                         const LayerBindingId) override
+    {
+        Write(m_Out, static_cast<uint32_t>(constants.size()));
+        for (const ConstTensor& constant : constants)
+        {
+            Write(m_Out, constant.GetInfo());
+            Write(m_Out, static_cast<uint64_t>(constant.GetNumBytes()));
+            Write(m_Out, ethosn::utils::Xxh64(constant.GetMemoryArea(), constant.GetNumBytes()));
+            Write(m_Out, ethosn::utils::Xxh64(constant.GetMemoryArea(), constant.GetNumBytes(), g_KeySeed2));
+        }
+    }
+
+private:
+    /// Serializes the layer which owns the given output slot, if it hasn't been already, after the layers it
+    /// depends on.
+    uint32_t GetSlotId(const OutputSlot* outputSlot)
+    {
+        auto it = m_SlotIds.find(outputSlot);
+        if (it != m_SlotIds.end())
+        {
+            return it->second;
+        }
+
+        const Layer& layer = outputSlot->GetOwningLayer();
+        std::vector<uint32_t> inputSlotIds;
+        for (uint32_t i = 0; i < layer.GetNumInputSlots(); ++i)
+        {
+            inputSlotIds.push_back(GetSlotId(layer.GetInputSlot(i).GetConnectedOutputSlot()));
+        }
+
+        Write(m_Out, static_cast<uint32_t>(layer.GetType()));
+        Write(m_Out, static_cast<uint32_t>(inputSlotIds.size()));
+        for (uint32_t inputSlotId : inputSlotIds)
+        {
+            Write(m_Out, inputSlotId);
+        }
+
+        ParameterStringifyFunction writeParameter = [this](const std::string& name, const std::string& value) {
+            // These identify the layer rather than describe it
+            if (name != "Guid" && name != "LayerName" && name != "BackendID")
+            {
+                Write(m_Out, name);
+                Write(m_Out, value);
+            }
+        };
+        layer.SerializeLayerParameters(writeParameter);
+        layer.ExecuteStrategy(*this);
+
+        Write(m_Out, layer.GetNumOutputSlots());
+        for (uint32_t i = 0; i < layer.GetNumOutputSlots(); ++i)
+        {
+            Write(m_Out, layer.GetOutputSlot(i).GetTensorInfo());
+            m_SlotIds[&layer.GetOutputSlot(i)] = m_NextSlotId++;
+        }
+
+        return m_SlotIds.at(outputSlot);
+    }
+
+    std::vector<uint8_t>& m_Out;
+    std::unordered_map<const OutputSlot*, uint32_t> m_SlotIds;
+    uint32_t m_NextSlotId;
+};
+
+}    // namespace
+
+EthosNCompiledNetworkCache::EthosNCompiledNetworkCache(std::string cacheDir, uint64_t sizeLimitBytes)
+    : m_CacheDir(std::move(cacheDir))
+    , m_SizeLimitBytes(sizeLimitBytes)
+{}
+
+std::string EthosNCompiledNetworkCache::GetEntryPath(const Key& key) const
+{
+    char name[64];
+    snprintf(name, sizeof(name), "%016llx%016llx%s", static_cast<unsigned long long>(key[0]),
+             static_cast<unsigned long long>(key[1]), g_CacheFileExtension);
+    return m_CacheDir + "/" + name;
+}
+
+bool EthosNCompiledNetworkCache::Load(const Key& key, std::vector<EthosNPreCompiledObject::Network>& outNetworks) const
+{
+    // Anything unexpected in the file is treated as a miss, and the file will be overwritten
+    const std::string path = GetEntryPath(key);
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+    {
+        return false;
+    }
+
+    std::error_code error;
+    const uintmax_t fileSize = fs::file_size(path, error);
+    if (error)
+    {
+        return false;
+    }
+
+    char tag[sizeof(g_CacheFileTag)];
+    uint32_t version;
+    Key fileKey;
+    if (!in.read(tag, sizeof(tag)) || std::memcmp(tag, g_CacheFileTag, sizeof(tag)) != 0 || !Read(in, version) ||
+        version != g_CacheFileVersion || !Read(in, fileKey[0]) || !Read(in, fileKey[1]) || fileKey != key)
+    {
+        return false;
+    }
+
+    uint32_t numNetworks;
+    if (!Read(in, numNetworks))
+    {
+        return false;
+    }
+    std::vector<EthosNPreCompiledObject::Network> networks;
+    for (uint32_t i = 0; i < numNetworks; ++i)
+    {
+        std::unordered_map<uint32_t, uint32_t> inputSlotsToEthosNInputs;
+        std::unordered_map<uint32_t, uint32_t> outputSlotsToEthosNOutputs;
+        uint64_t dataSize;
+        if (!Read(in, inputSlotsToEthosNInputs) || !Read(in, outputSlotsToEthosNOutputs) || !Read(in, dataSize) ||
+            dataSize > fileSize)
+        {
+            return false;
+        }
+        std::vector<char> data(dataSize);
+        if (!in.read(data.data(), static_cast<std::streamsize>(dataSize)))
+        {
+            return false;
+        }
+        networks.emplace_back(std::move(data), std::move(inputSlotsToEthosNInputs),
+                              std::move(outputSlotsToEthosNOutputs));
+    }
+    if (in.peek() != std::ifstream::traits_type::eof())
+    {
+        return false;
+    }
+
+    // Mark the entry as recently used, so that it is one of the last to be evicted
+    fs::last_write_time(path, fs::file_time_type::clock::now(), error);
+
+    outNetworks = std::move(networks);
+    return true;
+}
+
+void EthosNCompiledNetworkCache::Save(const Key& key,
+                                      const std::vector<EthosNPreCompiledObject::Network>& networks) const
+{
+    std::vector<uint8_t> contents;
+    contents.insert(contents.end(), std::begin(g_CacheFileTag), std::end(g_CacheFileTag));
+    Write(contents, g_CacheFileVersion);
+    Write(contents, key[0]);
+    Write(contents, key[1]);
+    Write(contents, static_cast<uint32_t>(networks.size()));
+    for (const EthosNPreCompiledObject::Network& network : networks)
+    {
+        Write(contents, network.m_InputSlotsToEthosNInputs);
+        Write(contents, network.m_OutputSlotsToEthosNOutputs);
+        Write(contents, static_cast<uint64_t>(network.m_SerializedCompiledNetwork.size()));
+        contents.insert(contents.end(), network.m_SerializedCompiledNetwork.begin(),
+                        network.m_SerializedCompiledNetwork.end());
+    }
+
+    std::error_code error;
+    fs::create_directories(m_CacheDir, error);
+    if (error)
+    {
+        ARMNN_LOG(warning) << "Failed to create compiled network cache directory " << m_CacheDir << ": "
+                           << error.message();
+        return;
+    }
+
+    // Write to a temporary file and rename it into place, so that other processes sharing the directory
+    // never see a partially written file
+    const std::string path    = GetEntryPath(key);
+    const std::string tmpPath = path + "." + std::to_string(std::random_device()()) + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary);
+        if (!out.write(reinterpret_cast<const char*>(contents.data()), static_cast<std::streamsize>(contents.size())))
+        {
+            out.close();
+            std::remove(tmpPath.c_str());
+            ARMNN_LOG(warning) << "Failed to write compiled network cache entry " << path;
+            return;
+        }
+    }
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0)
+    {
+        std::remove(tmpPath.c_str());
+        return;
+    }
+
+    Evict();
+}
+
+void EthosNCompiledNetworkCache::Evict() const
+{
+    if (m_SizeLimitBytes == 0)
+    {
+        return;
+    }
+
+    struct Entry
+    {
+        fs::path m_Path;
+        uintmax_t m_Size;
+        fs::file_time_type m_LastUsed;
+    };
+    std::vector<Entry> entries;
+    uintmax_t totalSize = 0;
+
+    std::error_code error;
+    for (fs::directory_iterator it(m_CacheDir, error), end; !error && it != end; it.increment(error))
+    {
+        if (it->path().extension() != g_CacheFileExtension)
+        {
+            continue;
+        }
+        // Entries may be deleted by other processes at any time, so skip any which can't be queried
+        std::error_code entryError;
+        Entry entry{ it->path(), fs::file_size(it->path(), entryError), {} };
+        entry.m_LastUsed = fs::last_write_time(it->path(), entryError);
+        if (!entryError)
+        {
+            totalSize += entry.m_Size;
+            entries.push_back(entry);
+        }
+    }
+
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry& a, const Entry& b) { return a.m_LastUsed < b.m_LastUsed; });
+    for (auto it = entries.begin(); it != entries.end() && totalSize > m_SizeLimitBytes; ++it)
+    {
+        fs::remove(it->m_Path, error);
+        totalSize -= it->m_Size;
+    }
+}
+
+EthosNCompiledNetworkCache::Key
+    CalculateCompiledNetworkCacheKey(const SubgraphView& subgraph,
+                                     const std::vector<char>& capabilities,
+                                     const ethosn::support_library::CompilationOptions& options)
+{
+    std::vector<uint8_t> data;
+
+    const ethosn::support_library::Version version = ethosn::support_library::GetLibraryVersion();
+    Write(data, version.Major);
+    Write(data, version.Minor);
+    Write(data, version.Patch);
+
+    Write(data, static_cast<uint32_t>(capabilities.size()));
+    data.insert(data.end(), capabilities.begin(), capabilities.end());
+
+    Write(data, options);
+
+    SubgraphSerializer(data).Serialize(subgraph);
+
+    return { ethosn::utils::Xxh64(data.data(), data.size()),
+             ethosn::utils::Xxh64(data.data(), data.size(), g_KeySeed2) };
+}
+
+}    // namespace armnn
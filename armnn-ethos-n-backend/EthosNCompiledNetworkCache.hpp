@@ -0,0 +1,62 @@
+//
+// Copyright © 2021 Arm Limited.
+// SPDX-License-Identifier: Apache-2.0
+//
+#pragma once
+
+#include "SubgraphView.hpp"
+#include "workloads/EthosNPreCompiledWorkload.hpp"
+
+#include <ethosn_support_library/Support.hpp>
+
+#include <array>
+#include <string>
+#include <vector>
+
+namespace armnn
+{
+
+/// Persistent cache of compiled networks, so that the same subgraph doesn't need to be compiled again each time
+/// an application starts.
+/// Each entry holds the serialized compiled networks for one subgraph, along with the mapping of their inputs and
+/// outputs to the subgraph's slots, in a file in the cache directory. The directory can be shared between processes.
+/// When the files in the directory add up to more than the size limit, the least recently used ones are deleted.
+class EthosNCompiledNetworkCache
+{
+public:
+    /// 128-bit digest of everything which affects the compilation of a subgraph.
+    /// See CalculateCompiledNetworkCacheKey.
+    using Key = std::array<uint64_t, 2>;
+
+    /// @param cacheDir Directory to save entries to and load them from, which is created if it doesn't exist.
+    /// @param sizeLimitBytes Total size of the entries to keep in the directory, or zero for no limit.
+    EthosNCompiledNetworkCache(std::string cacheDir, uint64_t sizeLimitBytes);
+
+    /// Loads the compiled networks saved with the given key into outNetworks.
+    /// Returns false, and leaves outNetworks unchanged, if there is no such entry or it can't be read.
+    bool Load(const Key& key, std::vector<EthosNPreCompiledObject::Network>& outNetworks) const;
+
+    /// Saves the compiled networks with the given key, replacing any existing entry, and then deletes the least
+    /// recently used entries until the directory is within the size limit.
+    /// Failing to save isn't an error, as the cache is only an optimisation.
+    void Save(const Key& key, const std::vector<EthosNPreCompiledObject::Network>& networks) const;
+
+    /// The file which holds the entry with the given key (which may not exist).
+    std::string GetEntryPath(const Key& key) const;
+
+private:
+    void Evict() const;
+
+    const std::string m_CacheDir;
+    const uint64_t m_SizeLimitBytes;
+};
+
+/// Calculates the key identifying the compilation of the given subgraph. This is a digest of its layers (including
+/// their parameters, tensor infos and constant data, but not their names), the capabilities it is compiled for,
+/// all of the compilation options and the support library version.
+EthosNCompiledNetworkCache::Key
+    CalculateCompiledNetworkCacheKey(const SubgraphView& subgraph,
+                                     const std::vector<char>& capabilities,
+                                     const ethosn::support_library::CompilationOptions& options);
+
+}    // namespace armnn
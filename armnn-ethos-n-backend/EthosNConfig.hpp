@@ -21,18 +21,21 @@ struct EthosNConfig
 
     // Variables that may be configured inside the config file
     // clang-format off
-    static constexpr char PERF_ONLY_VAR[]                       = "PERFORMANCE_ONLY";                             // boolean
-    static constexpr char PERF_VARIANT_VAR[]                    = "PERFORMANCE_VARIANT";                          // enum
-    static constexpr char PERF_SRAM_SIZE_BYTES_OVERRIDE_VAR[]   = "PERFORMANCE_SRAM_SIZE_BYTES_OVERRIDE";         // string
-    static constexpr char PERF_OUT_DIR_VAR[]                    = "PERFORMANCE_OUTPUT_DIR";                       // string
-    static constexpr char PERF_MAPPING_FILE_VAR[]               = "PERFORMANCE_MAPPING_FILE";                     // string
-    static constexpr char DUMP_DEBUG_FILES_VAR[]                = "DUMP_DEBUG_FILES";                             // boolean
-    static constexpr char DUMP_RAM_VAR[]                        = "DUMP_RAM";                                     // boolean
-    static constexpr char PERF_WEIGHT_COMPRESSION_SAVING[]      = "PERFORMANCE_WEIGHT_COMPRESSION_SAVING";        // float
-    static constexpr char PERF_ACTIVATION_COMPRESSION_SAVING[]  = "PERFORMANCE_ACTIVATION_COMPRESSION_SAVING";    // float
-    static constexpr char PERF_CURRENT[]                        = "PERFORMANCE_CURRENT";                          // boolean
-    static constexpr char COMPILER_ALGORITHM[]                  = "COMPILER_ALGORITHM";                           // enum
-    static constexpr char INTERMEDIATE_COMPRESSION[]            = "INTERMEDIATE_COMPRESSION";                     // boolean
+    static constexpr char PERF_ONLY_VAR[]                      = "PERFORMANCE_ONLY";                          // boolean
+    static constexpr char PERF_VARIANT_VAR[]                   = "PERFORMANCE_VARIANT";                       // enum
+    static constexpr char PERF_SRAM_SIZE_BYTES_OVERRIDE_VAR[]  = "PERFORMANCE_SRAM_SIZE_BYTES_OVERRIDE";      // string
+    static constexpr char PERF_OUT_DIR_VAR[]                   = "PERFORMANCE_OUTPUT_DIR";                    // string
+    static constexpr char PERF_MAPPING_FILE_VAR[]              = "PERFORMANCE_MAPPING_FILE";                  // string
+    static constexpr char DUMP_DEBUG_FILES_VAR[]               = "DUMP_DEBUG_FILES";                          // boolean
+    static constexpr char DUMP_RAM_VAR[]                       = "DUMP_RAM";                                  // boolean
+    static constexpr char PERF_WEIGHT_COMPRESSION_SAVING[]     = "PERFORMANCE_WEIGHT_COMPRESSION_SAVING";     // float
+    static constexpr char PERF_ACTIVATION_COMPRESSION_SAVING[] = "PERFORMANCE_ACTIVATION_COMPRESSION_SAVING"; // float
+    static constexpr char PERF_CURRENT[]                       = "PERFORMANCE_CURRENT";                       // boolean
+    static constexpr char COMPILER_ALGORITHM[]                 = "COMPILER_ALGORITHM";                        // enum
+    static constexpr char INTERMEDIATE_COMPRESSION[]           = "INTERMEDIATE_COMPRESSION";                  // boolean
+    static constexpr char COMPILED_NETWORK_CACHE_DIR[]         = "COMPILED_NETWORK_CACHE_DIR";                // string
+    static constexpr char COMPILED_NETWORK_CACHE_SIZE[]        = "COMPILED_NETWORK_CACHE_SIZE_LIMIT_MB";      // uint32
+    static constexpr char COMPILATION_THREADS[]                = "COMPILATION_THREADS";                       // uint32
     // clang-format on
 
     bool m_PerfOnly = false;
@@ -51,6 +54,21 @@ struct EthosNConfig
         ethosn::support_library::CompilerAlgorithm::NonCascadingOnly;
     bool m_IntermediateCompression = true;
 
+    /// Directory to save compiled networks to and load them from, so that the same subgraphs aren't compiled again
+    /// by later runs. Empty to always compile. The least recently used networks are deleted when the directory
+    /// grows beyond the size limit (zero for no limit).
+    std::string m_CompiledNetworkCacheDir      = "";
+    uint32_t m_CompiledNetworkCacheSizeLimitMb = 256;
+
+    /// Number of threads to compile subgraphs on in the background (zero for one per hardware thread), so that
+    /// several subgraphs are compiled at once. Each subgraph is still converted and validated when it is optimized,
+    /// but the workload waits for its compilation to finish when it is created, and a failure to compile is only
+    /// reported then. Subgraphs are therefore only compiled in the background when the "BackendPreferences" model
+    /// option says the network has no other backend, as otherwise a subgraph which fails to compile may need to be
+    /// assigned to another backend instead.
+    /// 1 means compiling each subgraph synchronously when it is optimized.
+    uint32_t m_CompilationThreads = 1;
+
     std::vector<char> GetCapabilities()
     {
         if (m_PerfOnly)
@@ -4,6 +4,7 @@
 //
 
 #include "EthosNBackend.hpp"
+#include "EthosNCompiledNetworkCache.hpp"
 #include "EthosNConfig.hpp"
 #include "EthosNSubgraphViewConverter.hpp"
 #include "EthosNTensorUtils.hpp"
@@ -16,9 +17,14 @@
 #include <armnn/utility/Assert.hpp>
 #include <armnnUtils/Permute.hpp>
 #include <backendsCommon/TensorHandle.hpp>
+#include <ethosn_utils/ThreadPool.hpp>
 #include <ethosn_utils/VectorStream.hpp>
 
 #include <algorithm>
+#include <future>
+#include <mutex>
+#include <sstream>
+#include <string>
 #include <utility>
 
 namespace armnn
@@ -35,6 +41,7 @@ EthosNSubgraphViewConverter::EthosNSubgraphViewConverter(const SubgraphView& sub
     : m_InstanceId(ms_NextInstanceId++)
     , m_Subgraph(subgraph)
     , m_EthosNConfig(GetEthosNConfig())
+    , m_ModelOptions(modelOptions)
 {
     try
     {
@@ -697,8 +704,9 @@ void EthosNSubgraphViewConverter::CreateUncompiledNetwork()
     }
 
     // Initialize a new network
-    m_Network = m_EthosNConfig.m_PerfOnly ? ethosn_lib::CreateEstimationNetwork(m_EthosNConfig.GetCapabilities())
-                                          : ethosn_lib::CreateNetwork(m_EthosNConfig.GetCapabilities());
+    m_Capabilities = m_EthosNConfig.GetCapabilities();
+    m_Network      = m_EthosNConfig.m_PerfOnly ? ethosn_lib::CreateEstimationNetwork(m_Capabilities)
+                                               : ethosn_lib::CreateNetwork(m_Capabilities);
 
     // Add inputs
     for (uint32_t inputSlotIdx = 0; inputSlotIdx < m_Subgraph.GetNumInputSlots(); ++inputSlotIdx)
@@ -776,14 +784,21 @@ std::vector<CompiledBlobPtr> EthosNSubgraphViewConverter::CompileNetwork()
     return compiledBlobs;
 }
 
-std::vector<CompiledBlobPtr> EthosNSubgraphViewConverter::Compile()
+namespace
 {
-    std::vector<CompiledBlobPtr> compiledBlobs;
 
-    std::vector<EthosNCompiledNetworkPtr> compiledNetworks =
-        g_EthosNSupportLibraryInterface->Compile(*m_Network, m_CompilationOptions);
+/// Compiles the given Ethos-N network with the support library, and serializes the resulting compiled networks
+/// along with the mapping of their inputs and outputs to the subgraph's slots.
+std::vector<EthosNPreCompiledObject::Network>
+    CompileWithSupportLibrary(const ethosn_lib::Network& network,
+                              const ethosn_lib::CompilationOptions& options,
+                              const std::map<EthosNInputOutputId, uint32_t>& ethosnInputIdToInputSlot,
+                              const std::map<EthosNInputOutputId, uint32_t>& ethosnOutputIdToOutputSlot)
+{
+    std::vector<EthosNPreCompiledObject::Network> networks;
+
+    std::vector<EthosNCompiledNetworkPtr> compiledNetworks = g_EthosNSupportLibraryInterface->Compile(network, options);
 
-    // Create a list of generic type-agnostic compiled "blobs"
     for (EthosNCompiledNetworkPtr& compiledNetwork : compiledNetworks)
     {
         // Map Arm NN input slots to Ethos-N input indices, based on the data we gathered while adding the Ethos-N operations.
@@ -792,7 +807,7 @@ std::vector<CompiledBlobPtr> EthosNSubgraphViewConverter::Compile()
              ++ethosnInputIdx)
         {
             const ethosn_lib::InputBufferInfo& inputBufferInfo = compiledNetwork->GetInputBufferInfos()[ethosnInputIdx];
-            uint32_t inputSlotIdx                              = m_EthosNInputIdToInputSlot.at(
+            uint32_t inputSlotIdx                              = ethosnInputIdToInputSlot.at(
                 { inputBufferInfo.m_SourceOperationId, inputBufferInfo.m_SourceOperationOutputIndex });
             inputSlotsToEthosNInputs[inputSlotIdx] = ethosnInputIdx;
         }
@@ -804,13 +819,12 @@ std::vector<CompiledBlobPtr> EthosNSubgraphViewConverter::Compile()
         {
             const ethosn_lib::OutputBufferInfo& outputBufferInfo =
                 compiledNetwork->GetOutputBufferInfos()[ethosnOutputIdx];
-            uint32_t outputSlotIdx = m_EthosNOutputIdToOutputSlot.at(
+            uint32_t outputSlotIdx = ethosnOutputIdToOutputSlot.at(
                 { outputBufferInfo.m_SourceOperationId, outputBufferInfo.m_SourceOperationOutputIndex });
             outputSlotsToEthosNOutputs[outputSlotIdx] = ethosnOutputIdx;
         }
 
-        // Construct a EthosNPreCompiledObject containing the serialized ethosn_lib::CompiledNetwork along with
-        // other data needed by the workload.
+        // Serialize the ethosn_lib::CompiledNetwork, to be stored along with the other data needed by the workload.
         std::vector<char> compiledNetworkData;
         {
             ethosn::utils::VectorStream compiledNetworkStream(compiledNetworkData);
@@ -818,10 +832,117 @@ std::vector<CompiledBlobPtr> EthosNSubgraphViewConverter::Compile()
         }
         compiledNetwork.release();    // No longer need this, so save the memory
 
-        auto preCompiledObject = std::make_unique<EthosNPreCompiledObject>(
-            EthosNPreCompiledObject::Network(std::move(compiledNetworkData), inputSlotsToEthosNInputs,
-                                             outputSlotsToEthosNOutputs),
-            m_EthosNOperationNameMapping);
+        networks.emplace_back(std::move(compiledNetworkData), std::move(inputSlotsToEthosNInputs),
+                              std::move(outputSlotsToEthosNOutputs));
+    }
+
+    return networks;
+}
+
+/// Returns the pool which subgraphs are compiled on in the background. This is shared by all subgraphs, and only
+/// re-created if the number of threads in the config changes.
+std::shared_ptr<ethosn::utils::ThreadPool> GetCompilationThreadPool(uint32_t numThreads)
+{
+    static std::mutex s_Mutex;
+    static std::shared_ptr<ethosn::utils::ThreadPool> s_Pool;
+    static uint32_t s_NumThreads = 0;
+
+    std::lock_guard<std::mutex> lock(s_Mutex);
+    if (!s_Pool || s_NumThreads != numThreads)
+    {
+        // The pool counts the thread which hands it work as one of its threads, but here that thread carries on
+        // optimizing the rest of the network, so ask for one more to get numThreads workers.
+        s_Pool       = std::make_shared<ethosn::utils::ThreadPool>(numThreads == 0 ? 0 : numThreads + 1);
+        s_NumThreads = numThreads;
+    }
+    return s_Pool;
+}
+
+}    // namespace
+
+std::vector<CompiledBlobPtr> EthosNSubgraphViewConverter::Compile()
+{
+    // Re-use the compiled networks from an earlier run, if there are any. The cache isn't used when dumping debug
+    // files, as these are written by the compiler.
+    const bool useCache = !m_EthosNConfig.m_CompiledNetworkCacheDir.empty() && !m_EthosNConfig.m_DumpDebugFiles;
+    const EthosNCompiledNetworkCache cache(m_EthosNConfig.m_CompiledNetworkCacheDir,
+                                           uint64_t{ m_EthosNConfig.m_CompiledNetworkCacheSizeLimitMb } * 1024 * 1024);
+    EthosNCompiledNetworkCache::Key key = {};
+    std::vector<EthosNPreCompiledObject::Network> networks;
+    if (useCache)
+    {
+        key = CalculateCompiledNetworkCacheKey(m_Subgraph, m_Capabilities, m_CompilationOptions);
+        if (cache.Load(key, networks))
+        {
+            ARMNN_LOG(debug) << "Loaded compiled network for subgraph " << m_InstanceId << " from "
+                             << cache.GetEntryPath(key);
+            return CreateCompiledBlobs(std::move(networks));
+        }
+    }
+
+    if (m_EthosNConfig.m_CompilationThreads != 1 && !IsFallbackPossible(m_ModelOptions))
+    {
+        // Compile in the background, so that the following subgraphs can be converted and compiled at the same
+        // time. Everything needed is copied, as neither the subgraph nor this converter will exist by then.
+        // Each subgraph is compiled independently, so the results don't depend on the order the tasks run in.
+        // The subgraphs are already compiled in parallel, so each compilation is kept to a single thread rather than
+        // the default of one per hardware thread, which would oversubscribe the CPU.
+        ethosn_lib::CompilationOptions options = m_CompilationOptions;
+        options.m_NumThreads                   = 1;
+        auto compile = [network = m_Network, options, inputIds = m_EthosNInputIdToInputSlot,
+                        outputIds = m_EthosNOutputIdToOutputSlot, useCache, cache, key, instanceId = m_InstanceId]() {
+            const std::string error = "Failed to compile subgraph " + std::to_string(instanceId);
+            std::vector<EthosNPreCompiledObject::Network> compiled;
+            try
+            {
+                compiled = CompileWithSupportLibrary(*network, options, inputIds, outputIds);
+            }
+            catch (const std::exception& e)
+            {
+                throw RuntimeException(error + ": " + e.what());
+            }
+            if (compiled.empty())
+            {
+                throw RuntimeException(error);
+            }
+            if (useCache)
+            {
+                cache.Save(key, compiled);
+            }
+            // Only a single compiled network is currently supported (see CreatePreCompiledLayerInGraph)
+            return std::move(compiled.front());
+        };
+
+        auto task = std::make_shared<std::packaged_task<EthosNPreCompiledObject::Network()>>(std::move(compile));
+        EthosNPreCompiledObject::PendingNetwork network = task->get_future().share();
+        GetCompilationThreadPool(m_EthosNConfig.m_CompilationThreads)->Post([task]() { (*task)(); });
+
+        auto preCompiledObject =
+            std::make_unique<EthosNPreCompiledObject>(std::move(network), m_EthosNOperationNameMapping);
+
+        std::vector<CompiledBlobPtr> compiledBlobs;
+        compiledBlobs.emplace_back(preCompiledObject.release(), DeleteAsType<EthosNPreCompiledObject>);
+        return compiledBlobs;
+    }
+
+    networks = CompileWithSupportLibrary(*m_Network, m_CompilationOptions, m_EthosNInputIdToInputSlot,
+                                         m_EthosNOutputIdToOutputSlot);
+    if (useCache && !networks.empty())
+    {
+        cache.Save(key, networks);
+    }
+    return CreateCompiledBlobs(std::move(networks));
+}
+
+std::vector<CompiledBlobPtr>
+    EthosNSubgraphViewConverter::CreateCompiledBlobs(std::vector<EthosNPreCompiledObject::Network> networks) const
+{
+    // Create a list of generic type-agnostic compiled "blobs"
+    std::vector<CompiledBlobPtr> compiledBlobs;
+    for (EthosNPreCompiledObject::Network& network : networks)
+    {
+        auto preCompiledObject =
+            std::make_unique<EthosNPreCompiledObject>(std::move(network), m_EthosNOperationNameMapping);
 
         // Convert the EthosNPreCompiledObject into a "blob" (void) object and attach the custom blob deleter
         compiledBlobs.emplace_back(preCompiledObject.release(), DeleteAsType<EthosNPreCompiledObject>);
@@ -861,6 +982,15 @@ ethosn_lib::CompilationOptions
                             "Invalid option type for DisableWinograd - must be bool.");
                     }
                 }
+                else if (option.GetName() == "BackendPreferences")
+                {
+                    // Not a compilation option, see IsFallbackPossible()
+                    if (!option.GetValue().IsString())
+                    {
+                        throw armnn::InvalidArgumentException(
+                            "Invalid option type for BackendPreferences - must be string.");
+                    }
+                }
                 else
                 {
                     throw armnn::InvalidArgumentException("Invalid option - " + option.GetName());
@@ -872,4 +1002,40 @@ ethosn_lib::CompilationOptions
     return result;
 }
 
+bool IsFallbackPossible(const ModelOptions& modelOptions)
+{
+    for (const auto& optionsGroup : modelOptions)
+    {
+        if (optionsGroup.GetBackendId() != EthosNBackend::GetIdStatic())
+        {
+            continue;
+        }
+        for (size_t i = 0; i < optionsGroup.GetOptionCount(); i++)
+        {
+            const BackendOptions::BackendOption& option = optionsGroup.GetOption(i);
+            if (option.GetName() != "BackendPreferences" || !option.GetValue().IsString())
+            {
+                continue;
+            }
+
+            // Arm NN retries a subgraph which fails to optimize on the other preferred backends
+            std::stringstream backends(option.GetValue().AsString());
+            std::string backend;
+            while (std::getline(backends, backend, ','))
+            {
+                backend.erase(0, backend.find_first_not_of(" \t"));
+                backend.erase(backend.find_last_not_of(" \t") + 1);
+                if (!backend.empty() && BackendId(backend) != EthosNBackend::GetIdStatic())
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+    }
+
+    // Without the network's preferences, any other backend may be one of them
+    return true;
+}
+
 }    // namespace armnn
@@ -7,6 +7,7 @@
 #include "EthosNConfig.hpp"
 #include "ISubgraphViewConverter.hpp"
 #include "SubgraphView.hpp"
+#include "workloads/EthosNPreCompiledWorkload.hpp"
 
 #include <ethosn_support_library/Support.hpp>
 
@@ -74,6 +75,7 @@ protected:
 private:
     std::vector<CompiledBlobPtr> Estimate();
     std::vector<CompiledBlobPtr> Compile();
+    std::vector<CompiledBlobPtr> CreateCompiledBlobs(std::vector<EthosNPreCompiledObject::Network> networks) const;
 
     /// Adds operation(s) to the Ethos-N network that correspond to the given Arm NN layer.
     /// This will update m_ConvertedOutputSlots.
@@ -151,15 +153,27 @@ private:
 
     EthosNConfig m_EthosNConfig;
 
+    /// The capabilities that the Ethos-N network is created with.
+    std::vector<char> m_Capabilities;
+
     /// Map from Ethos-N operation ID to the corresponding Arm NN layer name.
     std::map<uint32_t, std::string> m_EthosNOperationNameMapping;
 
     /// Options that are passed to the support library.
     ethosn_lib::CompilationOptions m_CompilationOptions;
+
+    /// Options given to Arm NN when optimizing the network.
+    ModelOptions m_ModelOptions;
 };
 
 /// Gets the compilation options to use based on the given EthosNConfig and ModelOptions.
 ethosn_lib::CompilationOptions
     GetCompilationOptions(const EthosNConfig& config, const ModelOptions& modelOptions, uint32_t instanceId);
 
+/// Returns true if a subgraph which fails to compile could be assigned to a backend other than this one instead.
+/// Arm NN only does that for the failures reported while the subgraph is being optimized, and the backend isn't told
+/// the network's backend preferences, so these are given as a comma-separated list of backend ids in the
+/// "BackendPreferences" option. Without that option, this assumes another backend may be used.
+bool IsFallbackPossible(const ModelOptions& modelOptions);
+
 }    // namespace armnn
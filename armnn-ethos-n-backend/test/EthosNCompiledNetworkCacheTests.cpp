@@ -0,0 +1,168 @@
+//
+// Copyright © 2021 Arm Limited.
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "EthosNTestUtils.hpp"
+
+#include <EthosNCompiledNetworkCache.hpp>
+#include <Graph.hpp>
+#include <backendsCommon/TensorHandle.hpp>
+#include <backendsCommon/test/CommonTestUtils.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <fstream>
+
+using namespace armnn;
+using namespace testing_utils;
+
+namespace
+{
+
+EthosNPreCompiledObject::Network CreateNetwork(char value, size_t size)
+{
+    return EthosNPreCompiledObject::Network(std::vector<char>(size, value), { { 0, 1 }, { 1, 0 } }, { { 0, 0 } });
+}
+
+// Creates a subgraph with a single convolution, whose weights are all the given value
+SubgraphView::SubgraphViewPtr BuildConvolutionSubgraph(Graph& graph, uint8_t weightValue)
+{
+    const TensorInfo inputInfo({ 1, 16, 16, 16 }, DataType::QAsymmU8, 1.0f, 0);
+    const TensorInfo outputInfo({ 1, 16, 16, 16 }, DataType::QAsymmU8, 1.0f, 0);
+    const TensorInfo weightInfo({ 16, 1, 1, 16 }, DataType::QAsymmU8, 0.9f, 0);
+    const TensorInfo biasInfo({ 1, 1, 1, 16 }, DataType::Signed32, 0.9f, 0);
+
+    Convolution2dDescriptor convolutionDescriptor;
+    convolutionDescriptor.m_StrideX     = 1;
+    convolutionDescriptor.m_StrideY     = 1;
+    convolutionDescriptor.m_BiasEnabled = true;
+    convolutionDescriptor.m_DataLayout  = DataLayout::NHWC;
+
+    Layer* const inputLayer = graph.AddLayer<InputLayer>(0, "input layer");
+    inputLayer->GetOutputSlot(0).SetTensorInfo(inputInfo);
+
+    // Use a unique name each time, which shouldn't affect the key
+    Convolution2dLayer* const convLayer = graph.AddLayer<Convolution2dLayer>(
+        convolutionDescriptor, ("conv layer " + std::to_string(graph.GetNumLayers())).c_str());
+    const std::vector<uint8_t> weights(weightInfo.GetNumElements(), weightValue);
+    const std::vector<int32_t> biases(biasInfo.GetNumElements(), 0);
+    convLayer->m_Weight = std::make_unique<ScopedTensorHandle>(ConstTensor(weightInfo, weights.data()));
+    convLayer->m_Bias   = std::make_unique<ScopedTensorHandle>(ConstTensor(biasInfo, biases.data()));
+    convLayer->GetOutputSlot(0).SetTensorInfo(outputInfo);
+
+    Layer* const outputLayer = graph.AddLayer<OutputLayer>(0, "output layer");
+
+    inputLayer->GetOutputSlot(0).Connect(convLayer->GetInputSlot(0));
+    convLayer->GetOutputSlot(0).Connect(outputLayer->GetInputSlot(0));
+
+    return CreateSubgraphViewFrom(CreateInputsFrom({ convLayer }), CreateOutputsFrom({ convLayer }), { convLayer });
+}
+
+}    // namespace
+
+BOOST_AUTO_TEST_SUITE(EthosNCaching)
+
+BOOST_AUTO_TEST_CASE(SaveAndLoad)
+{
+    TempDir tmpDir;
+    const EthosNCompiledNetworkCache cache(tmpDir.Str() + "/cache", 0);
+    const EthosNCompiledNetworkCache::Key key   = { 1, 2 };
+    const EthosNCompiledNetworkCache::Key other = { 1, 3 };
+
+    std::vector<EthosNPreCompiledObject::Network> loaded;
+    BOOST_TEST(!cache.Load(key, loaded));
+
+    std::vector<EthosNPreCompiledObject::Network> networks;
+    networks.push_back(CreateNetwork('a', 100));
+    networks.push_back(CreateNetwork('b', 10));
+    cache.Save(key, networks);
+
+    BOOST_TEST(cache.Load(key, loaded));
+    BOOST_TEST(loaded.size() == 2);
+    BOOST_TEST(loaded[0].m_SerializedCompiledNetwork == networks[0].m_SerializedCompiledNetwork);
+    BOOST_TEST((loaded[0].m_InputSlotsToEthosNInputs == networks[0].m_InputSlotsToEthosNInputs));
+    BOOST_TEST((loaded[0].m_OutputSlotsToEthosNOutputs == networks[0].m_OutputSlotsToEthosNOutputs));
+    BOOST_TEST(loaded[1].m_SerializedCompiledNetwork == networks[1].m_SerializedCompiledNetwork);
+
+    // Only the entry with the same key is loaded
+    BOOST_TEST(!cache.Load(other, loaded));
+    BOOST_TEST(loaded.size() == 2);
+
+    // A truncated entry is ignored
+    {
+        const std::string contents = ReadFile(cache.GetEntryPath(key));
+        std::ofstream file(cache.GetEntryPath(key), std::ios::binary);
+        file << contents.substr(0, contents.size() - 1);
+    }
+    loaded.clear();
+    BOOST_TEST(!cache.Load(key, loaded));
+    BOOST_TEST(loaded.empty());
+}
+
+BOOST_AUTO_TEST_CASE(EvictsLeastRecentlyUsed)
+{
+    TempDir tmpDir;
+    // Room for two entries
+    const EthosNCompiledNetworkCache cache(tmpDir.Str(), 2500);
+    const EthosNCompiledNetworkCache::Key keys[] = { { 0, 1 }, { 0, 2 }, { 0, 3 } };
+    std::vector<EthosNPreCompiledObject::Network> networks;
+    networks.push_back(CreateNetwork('a', 1000));
+
+    // Set the times explicitly, as the file system may not record them precisely enough
+    const fs::file_time_type now = fs::file_time_type::clock::now();
+    cache.Save(keys[0], networks);
+    fs::last_write_time(cache.GetEntryPath(keys[0]), now - std::chrono::hours(2));
+    cache.Save(keys[1], networks);
+    fs::last_write_time(cache.GetEntryPath(keys[1]), now - std::chrono::hours(1));
+
+    // Loading the first entry makes it the most recently used, so the second one is evicted instead
+    std::vector<EthosNPreCompiledObject::Network> loaded;
+    BOOST_TEST(cache.Load(keys[0], loaded));
+    cache.Save(keys[2], networks);
+
+    BOOST_TEST(fs::exists(cache.GetEntryPath(keys[0])));
+    BOOST_TEST(!fs::exists(cache.GetEntryPath(keys[1])));
+    BOOST_TEST(fs::exists(cache.GetEntryPath(keys[2])));
+}
+
+BOOST_AUTO_TEST_CASE(Key)
+{
+    Graph graph;
+    const std::vector<char> capabilities =
+        ethosn::support_library::GetFwAndHwCapabilities(ethosn::support_library::EthosNVariant::ETHOS_N77);
+    const ethosn::support_library::CompilationOptions options;
+    const EthosNCompiledNetworkCache::Key key =
+        CalculateCompiledNetworkCacheKey(*BuildConvolutionSubgraph(graph, 1), capabilities, options);
+
+    // The same subgraph (but with different layer names)
+    BOOST_TEST((CalculateCompiledNetworkCacheKey(*BuildConvolutionSubgraph(graph, 1), capabilities, options) == key));
+
+    // Different weights
+    BOOST_TEST((CalculateCompiledNetworkCacheKey(*BuildConvolutionSubgraph(graph, 2), capabilities, options) != key));
+
+    // Different hardware
+    const std::vector<char> otherCapabilities =
+        ethosn::support_library::GetFwAndHwCapabilities(ethosn::support_library::EthosNVariant::ETHOS_N57);
+    BOOST_TEST(
+        (CalculateCompiledNetworkCacheKey(*BuildConvolutionSubgraph(graph, 1), otherCapabilities, options) != key));
+
+    // Different options
+    ethosn::support_library::CompilationOptions otherOptions;
+    otherOptions.m_DisableWinograd = true;
+    BOOST_TEST(
+        (CalculateCompiledNetworkCacheKey(*BuildConvolutionSubgraph(graph, 1), capabilities, otherOptions) != key));
+
+    otherOptions                           = options;
+    otherOptions.m_PackIntermediateBuffers = false;
+    BOOST_TEST(
+        (CalculateCompiledNetworkCacheKey(*BuildConvolutionSubgraph(graph, 1), capabilities, otherOptions) != key));
+
+    // Debug options, which can affect the compiled network too
+    otherOptions                              = options;
+    otherOptions.m_DebugInfo.m_DumpDebugFiles = ethosn::support_library::CompilationOptions::DebugLevel::High;
+    BOOST_TEST(
+        (CalculateCompiledNetworkCacheKey(*BuildConvolutionSubgraph(graph, 1), capabilities, otherOptions) != key));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -3,6 +3,8 @@
 // SPDX-License-Identifier: Apache-2.0
 //
 
+#include "EthosNTestUtils.hpp"
+
 #include <EthosNBackend.hpp>
 #include <EthosNBackendId.hpp>
 #include <EthosNSubgraphViewConverter.hpp>
@@ -12,6 +14,8 @@
 #include <backendsCommon/test/CommonTestUtils.hpp>
 #include <boost/test/unit_test.hpp>
 
+#include <fstream>
+
 using namespace armnn;
 
 namespace
@@ -558,4 +562,96 @@ BOOST_AUTO_TEST_CASE(TestDisableWinograd)
     BOOST_TEST(mockSupportLibrary.m_RecordedDisableWinograd.back() == true);
 }
 
+/// Checks that the BackendPreferences option decides whether a subgraph could be assigned to another backend.
+BOOST_AUTO_TEST_CASE(TestIsFallbackPossible)
+{
+    auto prefs = [](const char* backends) {
+        return ModelOptions{ BackendOptions(EthosNBackend::GetIdStatic(), { { "BackendPreferences", backends } }) };
+    };
+
+    // Without the preferences, another backend may be used
+    BOOST_TEST(IsFallbackPossible({}) == true);
+    BOOST_TEST(IsFallbackPossible({ BackendOptions("OtherBackend", { { "BackendPreferences", "EthosNAcc" } }) }) ==
+               true);
+
+    BOOST_TEST(IsFallbackPossible(prefs("EthosNAcc")) == false);
+    BOOST_TEST(IsFallbackPossible(prefs(" EthosNAcc ,")) == false);
+    BOOST_TEST(IsFallbackPossible(prefs("EthosNAcc, CpuRef")) == true);
+    BOOST_TEST(IsFallbackPossible(prefs("CpuAcc,EthosNAcc")) == true);
+
+    // The option is accepted, but isn't a compilation option
+    EthosNConfig config;
+    BOOST_CHECK_NO_THROW(GetCompilationOptions(config, prefs("EthosNAcc"), 0));
+    BackendOptions optInvalidType(EthosNBackend::GetIdStatic(), { { "BackendPreferences", true } });
+    BOOST_CHECK_THROW(GetCompilationOptions(config, { optInvalidType }, 0), armnn::InvalidArgumentException);
+}
+
+/// Checks that when compiling on background threads, the compilation of each subgraph is only waited for
+/// when its network is needed, and a failure is reported for that subgraph then. This is only done when the
+/// network's backend preferences have no other backend which a subgraph that fails to compile could be assigned to
+/// instead.
+BOOST_AUTO_TEST_CASE(TestCompilationThreads)
+{
+    // Set up mock support library, which fails to compile anything
+    class MockSupportLibrary : public EthosNSupportLibraryInterface
+    {
+    public:
+        std::vector<std::unique_ptr<ethosn_lib::CompiledNetwork>>
+            Compile(const ethosn_lib::Network&, const ethosn_lib::CompilationOptions& options) final
+        {
+            ++m_NumCompilations;
+            m_NumThreads = options.m_NumThreads;
+            return {};
+        }
+
+        std::atomic<uint32_t> m_NumCompilations{ 0 };
+        std::atomic<uint32_t> m_NumThreads{ 0 };
+    };
+    g_EthosNSupportLibraryInterface        = std::make_unique<MockSupportLibrary>();
+    MockSupportLibrary& mockSupportLibrary = static_cast<MockSupportLibrary&>(*g_EthosNSupportLibraryInterface);
+
+    testing_utils::TempDir tmpDir;
+    const std::string configFile = tmpDir.Str() + "/config.txt";
+    {
+        std::ofstream os(configFile);
+        os << EthosNConfig::COMPILATION_THREADS << " = 2\n";
+    }
+    testing_utils::SetEnv(EthosNConfig::CONFIG_FILE_ENV, configFile.c_str());
+
+    Graph graph1;
+    Graph graph2;
+    SubgraphView::SubgraphViewPtr subgraph1 = BuildFullyOptimizableSubgraph1(graph1);
+    SubgraphView::SubgraphViewPtr subgraph2 = BuildFullyOptimizableSubgraph2(graph2);
+
+    // When the network may use another backend, or doesn't say, the subgraphs are compiled straight away, so that
+    // the failures are reported in time for the subgraphs to be assigned to another backend instead
+    const ModelOptions withFallback = { BackendOptions(EthosNBackend::GetIdStatic(),
+                                                       { { "BackendPreferences", "EthosNAcc,CpuRef" } }) };
+    BOOST_TEST(EthosNSubgraphViewConverter(*subgraph1, withFallback).CompileNetwork().empty());
+    BOOST_TEST(EthosNSubgraphViewConverter(*subgraph2, {}).CompileNetwork().empty());
+    BOOST_TEST(mockSupportLibrary.m_NumCompilations == 2);
+
+    // Both subgraphs are converted (and appear to succeed), with their compilation left running
+    const ModelOptions noFallback = { BackendOptions(EthosNBackend::GetIdStatic(),
+                                                     { { "BackendPreferences", "EthosNAcc" } }) };
+    std::vector<CompiledBlobPtr> blobs1 = EthosNSubgraphViewConverter(*subgraph1, noFallback).CompileNetwork();
+    std::vector<CompiledBlobPtr> blobs2 = EthosNSubgraphViewConverter(*subgraph2, noFallback).CompileNetwork();
+
+    BOOST_TEST(blobs1.size() == 1);
+    BOOST_TEST(blobs2.size() == 1);
+
+    // The failure is reported when the network is needed
+    for (const CompiledBlobPtr* blob : { &blobs1.at(0), &blobs2.at(0) })
+    {
+        const EthosNPreCompiledObject& preCompiledObject = *static_cast<const EthosNPreCompiledObject*>(blob->get());
+        BOOST_CHECK_THROW(preCompiledObject.GetNetwork(), RuntimeException);
+    }
+    BOOST_TEST(mockSupportLibrary.m_NumCompilations == 4);
+    // Each subgraph is compiled on a single thread, as they are already compiled in parallel
+    BOOST_TEST(mockSupportLibrary.m_NumThreads == 1);
+
+    testing_utils::SetEnv(EthosNConfig::CONFIG_FILE_ENV, "");
+    g_EthosNSupportLibraryInterface = std::make_unique<EthosNSupportLibraryInterface>();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
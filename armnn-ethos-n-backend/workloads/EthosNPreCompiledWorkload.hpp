@@ -15,6 +15,7 @@
 #include <ethosn_driver_library/Network.hpp>
 #include <ethosn_support_library/Support.hpp>
 
+#include <future>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -62,7 +63,14 @@ public:
         ethosn::support_library::EstimationOptions m_EstimationOptions;
     };
 
+    /// A network which may still be being compiled in the background (see EthosNConfig::m_CompilationThreads).
+    using PendingNetwork = std::shared_future<Network>;
+
     EthosNPreCompiledObject(Network network, std::map<uint32_t, std::string> ethosnOperationNameMapping)
+        : EthosNPreCompiledObject(MakeReady(std::move(network)), std::move(ethosnOperationNameMapping))
+    {}
+
+    EthosNPreCompiledObject(PendingNetwork network, std::map<uint32_t, std::string> ethosnOperationNameMapping)
         : m_IsPerfEstimationOnly(false)
         , m_Network(std::move(network))
         , m_EthosNOperationNameMapping(ethosnOperationNameMapping)
@@ -82,7 +90,7 @@ public:
         }
         else
         {
-            m_Network.~Network();
+            m_Network.~PendingNetwork();
         }
     }
 
@@ -91,9 +99,11 @@ public:
         return m_IsPerfEstimationOnly;
     }
 
+    /// Waits for the network to be compiled, if it is still being compiled in the background.
+    /// This rethrows the exception if the compilation failed.
     const Network* GetNetwork() const
     {
-        return !m_IsPerfEstimationOnly ? &m_Network : nullptr;
+        return !m_IsPerfEstimationOnly ? &m_Network.get() : nullptr;
     }
 
     const PerfData* GetPerfData() const
@@ -107,11 +117,18 @@ public:
     }
 
 private:
+    static PendingNetwork MakeReady(Network network)
+    {
+        std::promise<Network> promise;
+        promise.set_value(std::move(network));
+        return promise.get_future().share();
+    }
+
     const bool m_IsPerfEstimationOnly;
 
     union
     {
-        Network m_Network;
+        PendingNetwork m_Network;
         PerfData m_PerfData;
     };
 
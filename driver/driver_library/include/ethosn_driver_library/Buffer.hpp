@@ -21,11 +21,18 @@ enum class DataFormat
     NHWCB
 };
 
+// How a Buffer constructed from caller-owned memory uses that memory.
+enum class ImportMode
+{
+    // Data is copied into a buffer allocated by Ethos-N.
+    Copy,
+    // The caller's memory is used in place by inferences, without any copy.
+    ZeroCopy
+};
+
 class Buffer
 {
 public:
-    // FIXME: Need an API where an external buffer is provided, without any copy. (Jira NNXSW-605)
-
     // Ethos-N allocates the buffer.
     Buffer(uint32_t size, DataFormat format);
 
@@ -40,6 +47,16 @@ public:
     // FIXME: Fix as part of Jira NNXSW-610 - Refactor Driver Library
     Buffer(uint8_t* src, uint32_t size, DataFormat format);
 
+    // Same as above when mode is ImportMode::Copy.
+    // With ImportMode::ZeroCopy, inferences read and write src directly and GetMappedBuffer() returns src, so src
+    // must outlive the Buffer. The kernel module backend also requires src to be page-aligned and keeps it pinned
+    // until the Buffer is destroyed.
+    Buffer(uint8_t* src, uint32_t size, DataFormat format, ImportMode mode);
+
+    // Wraps the first size bytes of an existing dma-buf, without any copy.
+    // The Buffer holds its own reference to the dma-buf, so dmaBufFd may be closed once this returns.
+    static std::unique_ptr<Buffer> FromDmaBuf(int dmaBufFd, uint32_t size, DataFormat format);
+
     ~Buffer();
 
     // Returns the size of the buffer.
@@ -56,6 +73,9 @@ public:
 
 private:
     class BufferImpl;
+
+    explicit Buffer(std::unique_ptr<BufferImpl> bufferImpl);
+
     std::unique_ptr<BufferImpl> bufferImpl;
 };
 }    // namespace driver_library
@@ -1,5 +1,5 @@
 //
-// Copyright © 2018-2020 Arm Limited. All rights reserved.
+// Copyright © 2018-2021 Arm Limited. All rights reserved.
 // SPDX-License-Identifier: Apache-2.0
 //
 
@@ -7,6 +7,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <vector>
 
 namespace ethosn
 {
@@ -23,6 +24,15 @@ enum class InferenceResult
     Error     = 3,
 };
 
+/// Scheduling class of inferences, see Network::SetPriority().
+/// Note this must be kept in-sync with the kernel driver's definitions.
+enum class Priority
+{
+    Low    = 0,
+    Medium = 1,
+    High   = 2,
+};
+
 class Inference
 {
 public:
@@ -41,5 +51,52 @@ private:
     class InferenceImpl;
     std::unique_ptr<InferenceImpl> inferenceImpl;
 };
+
+/// A group of inferences scheduled together with Network::ScheduleInferenceBatch().
+/// The inferences of a batch share a single file descriptor and are identified by their index in the batch.
+class InferenceBatch
+{
+public:
+    InferenceBatch(int fileDescriptor, uint32_t numInferences);
+    ~InferenceBatch();
+
+    uint32_t GetNumInferences() const;
+
+    /// Get a file descriptor which can be used to interact with the whole batch. The file descriptor supports the
+    /// following operations:
+    ///    * poll - Can be used to wait until every inference of the batch is complete
+    ///    * release - Can be used to abort all the inferences which are not complete yet.
+    int GetFileDescriptor();
+
+    /// Retrieves the status of every inference of the batch, in scheduling order, with a single read.
+    std::vector<InferenceResult> GetResults();
+
+private:
+    class InferenceBatchImpl;
+    std::unique_ptr<InferenceBatchImpl> inferenceBatchImpl;
+};
+
+class BoundInferenceImpl;
+
+/// An inference whose input and output buffers are registered with the kernel once, by Network::BindInference(),
+/// and which can then be run any number of times with Trigger().
+/// This avoids looking up and re-binding every buffer for each inference when the same buffers are reused.
+class BoundInference
+{
+public:
+    BoundInference(std::unique_ptr<BoundInferenceImpl> impl);
+    ~BoundInference();
+
+    /// Schedules the inference to run again with the bound buffers.
+    /// @throws std::runtime_error if the inference is still scheduled or running.
+    void Trigger();
+
+    /// Get a file descriptor which can be used to interact with this inference. The file descriptor supports the
+    /// same operations as Inference::GetFileDescriptor(), which apply to the most recent Trigger().
+    int GetFileDescriptor();
+
+private:
+    std::unique_ptr<BoundInferenceImpl> boundInferenceImpl;
+};
 }    // namespace driver_library
 }    // namespace ethosn
@@ -7,13 +7,15 @@
 
 #include "Buffer.hpp"
 #include "Inference.hpp"
+#include "Profiling.hpp"
 
+#include <memory>
 #include <string>
 #include <vector>
 
 // Version information
 #define ETHOSN_DRIVER_LIBRARY_VERSION_MAJOR 1
-#define ETHOSN_DRIVER_LIBRARY_VERSION_MINOR 1
+#define ETHOSN_DRIVER_LIBRARY_VERSION_MINOR 7
 #define ETHOSN_DRIVER_LIBRARY_VERSION_PATCH 0
 
 namespace ethosn
@@ -67,6 +69,69 @@ private:
     std::string m_Reason;
 };
 
+/// Distribution of one kind of inference latency, see InferenceLatencyStats.
+struct LatencyHistogram
+{
+    /// The number of elements of m_Buckets.
+    static constexpr uint32_t NumBuckets = 24;
+
+    /// The number of latencies recorded.
+    uint64_t m_Count = 0;
+    /// The sum of the latencies recorded, in nanoseconds.
+    uint64_t m_SumNs = 0;
+    /// The largest latency recorded, in nanoseconds.
+    uint64_t m_MaxNs = 0;
+    /// The number of latencies in each power of two range of microseconds: m_Buckets[0] counts latencies below 2us,
+    /// m_Buckets[i] those from 2^i us up to 2^(i+1) us, and the last bucket everything above.
+    uint64_t m_Buckets[NumBuckets] = {};
+};
+
+/// Latencies of all the inferences of a network since it was loaded, measured by the kernel.
+struct InferenceLatencyStats
+{
+    /// From being scheduled to being sent to a core.
+    LatencyHistogram m_QueueWait;
+    /// From being sent to a core to the core reporting that it has finished.
+    LatencyHistogram m_Execution;
+    /// From finishing to its status first being read, i.e. the time taken to wake up the waiting thread.
+    LatencyHistogram m_CompletionToWake;
+};
+
+/// Hardware counters of the sampled inferences of a network since it was loaded, see Network::GetCounterSummary().
+struct HardwareCounterSummary
+{
+    struct Counter
+    {
+        /// The number of samples of the counter, which is 0 if the counter was not enabled.
+        uint64_t m_NumSamples = 0;
+        /// The sum over the inferences of the increase of the counter, see SampledInference::m_Values.
+        uint64_t m_Total = 0;
+        /// The largest increase of the counter in a single inference.
+        uint64_t m_MaxPerInference = 0;
+    };
+
+    /// Hardware counters of one sampled inference.
+    struct SampledInference
+    {
+        /// The time the inference completed, in nanoseconds from the kernel's monotonic clock.
+        uint64_t m_CompletedNs = 0;
+        /// The increase of each counter while the inference ran, indexed by profiling::HardwareCounters.
+        /// This is the last sample of the counter minus the first one, so events before the first sample are not
+        /// counted and counters with fewer than two samples are 0.
+        uint64_t m_Values[static_cast<size_t>(profiling::HardwareCounters::NumValues)] = {};
+    };
+
+    /// The number of inferences whose samples were added.
+    uint64_t m_NumInferences = 0;
+    /// The number of sampled inferences which were skipped because the firmware overwrote their samples before they
+    /// could be added. Increasing profiling::Configuration::m_FirmwareBufferSize avoids this.
+    uint64_t m_NumLostInferences = 0;
+    /// Indexed by profiling::HardwareCounters.
+    Counter m_Counters[static_cast<size_t>(profiling::HardwareCounters::NumValues)];
+    /// The most recent of the m_NumInferences inferences (up to 16), oldest first.
+    std::vector<SampledInference> m_RecentInferences;
+};
+
 // A single network, loaded and ready to execute inferences.
 class Network
 {
@@ -78,6 +143,14 @@ public:
     /// @throws CompiledNetworkException if the given Compiled Network data is not valid.
     Network(const char* compiledNetworkData, size_t compiledNetworkSize);
 
+    /// Loads a Network from a file containing a serialized Compiled Network, as above.
+    /// The file is mapped into memory rather than read, so only the small header is parsed and the constant data
+    /// is passed to the kernel straight from the file. This makes loading a network much faster than reading the file
+    /// into memory and using the constructor.
+    /// @throws CompiledNetworkException if the file does not contain a valid Compiled Network.
+    /// @throws std::runtime_error if the file can't be read.
+    static std::unique_ptr<Network> FromFile(const char* path);
+
     ~Network();
 
     // Schedule an inference with the network and the input & output buffers supplied.
@@ -88,9 +161,52 @@ public:
                                  Buffer* const outputBuffers[],
                                  uint32_t numOutputBuffers) const;
 
+    // Schedule several inferences with the network in a single call to the kernel.
+    // inputBuffers and outputBuffers hold numInferences sets of numInputBuffers and numOutputBuffers buffers
+    // respectively, one set after the other. Each set is ordered as for ScheduleInference.
+    // If eventFd is not -1 it must be an eventfd, which is incremented once for every inference of the batch
+    // that finishes. This allows a single eventfd to be shared by several batches and networks.
+    // Returns an InferenceBatch object.
+    InferenceBatch* ScheduleInferenceBatch(Buffer* const inputBuffers[],
+                                           uint32_t numInputBuffers,
+                                           Buffer* const outputBuffers[],
+                                           uint32_t numOutputBuffers,
+                                           uint32_t numInferences,
+                                           int eventFd = -1) const;
+
+    // Register the input & output buffers supplied with the network once, without running it.
+    // The returned BoundInference is run with BoundInference::Trigger(), as many times as needed, which is
+    // cheaper than scheduling a new inference with the same buffers each time.
+    // The buffers must stay alive as long as the BoundInference.
+    BoundInference* BindInference(Buffer* const inputBuffers[],
+                                  uint32_t numInputBuffers,
+                                  Buffer* const outputBuffers[],
+                                  uint32_t numOutputBuffers) const;
+
+    // Set the priority of the inferences of this network scheduled from now on, by default Priority::Medium.
+    // Queued inferences of a higher priority start before those of a lower priority.
+    // If deadlineUs is not 0, the inferences should start within deadlineUs microseconds of being scheduled:
+    // inferences of the same priority with the earliest deadline start first.
+    // @throws std::runtime_error if the kernel rejects the priority.
+    void SetPriority(Priority priority, uint32_t deadlineUs = 0);
+
+    // Get the latencies of the inferences of this network which have finished so far, see InferenceLatencyStats.
+    // These are always recorded, whether or not profiling is enabled.
+    // @throws std::runtime_error if the statistics can't be retrieved from the kernel.
+    InferenceLatencyStats GetInferenceLatencyStats() const;
+
+    // Get the hardware counters of the inferences of this network which have been sampled so far.
+    // Inferences are only sampled while profiling is enabled with some hardware counters and a non-zero interval,
+    // see profiling::SetHwCounterSamplingInterval(). Only one in that many inferences of the network is sampled, so
+    // divide the totals by m_NumInferences for the average of an inference.
+    // @throws std::runtime_error if the summary can't be retrieved from the kernel.
+    HardwareCounterSummary GetCounterSummary() const;
+
     void SetDebugName(const char* name);
 
 private:
+    explicit Network(std::unique_ptr<NetworkImpl> networkImpl);
+
     std::unique_ptr<NetworkImpl> m_NetworkImpl;
 };
 
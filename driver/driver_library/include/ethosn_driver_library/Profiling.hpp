@@ -50,6 +50,11 @@ struct Configuration
 /// Re-configures the profiling options for the ethosn driver stack based on the given Configuration object.
 bool Configure(Configuration config);
 
+/// If interval is not 0, the hardware counters of one in this many inferences of each network are added up by the
+/// kernel and can be retrieved with Network::GetCounterSummary(), without having to process the profiling entries.
+/// This only happens while profiling is enabled with some hardware counters, and is not changed by Configure(...).
+bool SetHwCounterSamplingInterval(uint32_t interval);
+
 /// All the counters that can be requested using Configure(...) and ScheduleInference(...)
 /// and collected using ReportNewProfilingData(...).
 /// These counters cannot be polled using GetCounterValue().
@@ -188,6 +193,8 @@ public:
     /// @}
 };
 
+/// Returns the entries recorded since the last call.
+/// If this isn't called often enough, only the most recent entries are kept (at least half a million).
 std::vector<ProfilingEntry> ReportNewProfilingData();
 
 const char* MetadataCategoryToCString(ProfilingEntry::MetadataCategory category);
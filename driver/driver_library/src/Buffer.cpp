@@ -1,5 +1,5 @@
 //
-// Copyright © 2018-2020 Arm Limited. All rights reserved.
+// Copyright © 2018-2021 Arm Limited. All rights reserved.
 // SPDX-License-Identifier: Apache-2.0
 //
 
@@ -9,7 +9,7 @@
 #ifdef TARGET_KMOD
 #include "KmodBuffer.hpp"
 #else
-#include "ModelBuffer.hpp"
+#include "HostBuffer.hpp"
 #endif
 
 #include <chrono>
@@ -24,7 +24,7 @@ Buffer::Buffer(uint32_t size, DataFormat format)
 {
     if (profiling::g_CurrentConfiguration.m_EnableProfiling)
     {
-        RecordLifetimeEvent(this, profiling::g_BufferToLifetimeEventId,
+        RecordLifetimeEvent(bufferImpl->GetLifetimeEventId(), profiling::g_NumLiveBuffers,
                             profiling::ProfilingEntry::Type::TimelineEventStart,
                             profiling::ProfilingEntry::MetadataCategory::BufferLifetime);
     }
@@ -35,12 +35,32 @@ Buffer::Buffer(uint8_t* src, uint32_t size, DataFormat format)
 {
     if (profiling::g_CurrentConfiguration.m_EnableProfiling)
     {
-        RecordLifetimeEvent(this, profiling::g_BufferToLifetimeEventId,
+        RecordLifetimeEvent(bufferImpl->GetLifetimeEventId(), profiling::g_NumLiveBuffers,
                             profiling::ProfilingEntry::Type::TimelineEventStart,
                             profiling::ProfilingEntry::MetadataCategory::BufferLifetime);
     }
 }
 
+Buffer::Buffer(uint8_t* src, uint32_t size, DataFormat format, ImportMode mode)
+    : Buffer(std::make_unique<BufferImpl>(src, size, format, mode))
+{}
+
+Buffer::Buffer(std::unique_ptr<BufferImpl> impl)
+    : bufferImpl{ std::move(impl) }
+{
+    if (profiling::g_CurrentConfiguration.m_EnableProfiling)
+    {
+        RecordLifetimeEvent(bufferImpl->GetLifetimeEventId(), profiling::g_NumLiveBuffers,
+                            profiling::ProfilingEntry::Type::TimelineEventStart,
+                            profiling::ProfilingEntry::MetadataCategory::BufferLifetime);
+    }
+}
+
+std::unique_ptr<Buffer> Buffer::FromDmaBuf(int dmaBufFd, uint32_t size, DataFormat format)
+{
+    return std::unique_ptr<Buffer>(new Buffer(std::make_unique<BufferImpl>(dmaBufFd, size, format)));
+}
+
 uint32_t Buffer::GetSize()
 {
     return bufferImpl->GetSize();
@@ -55,7 +75,7 @@ Buffer::~Buffer()
 {
     if (profiling::g_CurrentConfiguration.m_EnableProfiling)
     {
-        RecordLifetimeEvent(this, profiling::g_BufferToLifetimeEventId,
+        RecordLifetimeEvent(bufferImpl->GetLifetimeEventId(), profiling::g_NumLiveBuffers,
                             profiling::ProfilingEntry::Type::TimelineEventEnd,
                             profiling::ProfilingEntry::MetadataCategory::BufferLifetime);
     }
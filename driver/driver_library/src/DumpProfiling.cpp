@@ -1,5 +1,5 @@
 //
-// Copyright © 2018-2020 Arm Limited. All rights reserved.
+// Copyright © 2018-2021 Arm Limited. All rights reserved.
 // SPDX-License-Identifier: Apache-2.0
 //
 
@@ -8,6 +8,10 @@
 #include "ProfilingInternal.hpp"
 #include "Utils.hpp"
 
+#include <cassert>
+#include <chrono>
+#include <memory>
+#include <mutex>
 #include <ostream>
 #include <string>
 #include <vector>
@@ -19,10 +23,146 @@ namespace driver_library
 namespace profiling
 {
 
-void DumpAllProfilingData(std::ostream& outStream)
+namespace
+{
+
+void DumpEntry(const ProfilingEntry& entry, std::ostream& o)
+{
+    o << "\t{\n";
+    o << "\t\t"
+      << R"("time_stamp": )" << std::to_string(entry.m_Timestamp.time_since_epoch().count()) << ",\n";
+    o << "\t\t"
+      << R"("type": )" << std::to_string(static_cast<uint64_t>(entry.m_Type)) << ",\n";
+    o << "\t\t"
+      << R"("id": )" << std::to_string(entry.m_Id) << ",\n";
+    o << "\t\t"
+      << R"("metadata_category": )" << std::to_string(static_cast<uint64_t>(entry.m_MetadataCategory)) << ",\n";
+    o << "\t\t"
+      << R"("metadata_value":)"
+      << "\n";
+    o << "\t\t{\n";
+    switch (entry.m_MetadataCategory)
+    {
+        case ProfilingEntry::MetadataCategory::FirmwareWfeSleeping:
+        {
+            o << "\t\t\t"
+              << R"("firmware_wfe_sleeping_value": )" << std::to_string(entry.m_MetadataValue) << "\n";
+            break;
+        }
+        case ProfilingEntry::MetadataCategory::FirmwareInference:
+        {
+            o << "\t\t\t"
+              << R"("firmware_inference_value": )" << std::to_string(entry.m_MetadataValue) << "\n";
+            break;
+        }
+        case ProfilingEntry::MetadataCategory::FirmwareCommand:
+        {
+            o << "\t\t\t"
+              << R"("firmware_command_value": )" << std::to_string(entry.m_MetadataValue) << "\n";
+            break;
+        }
+        case ProfilingEntry::MetadataCategory::FirmwareDma:
+        {
+            o << "\t\t\t"
+              << R"("firmware_dma_value": )" << std::to_string(entry.m_MetadataValue) << "\n";
+            break;
+        }
+        case ProfilingEntry::MetadataCategory::FirmwareTsu:
+        {
+            o << "\t\t\t"
+              << R"("firmware_tsu_value": )" << std::to_string(entry.m_MetadataValue) << "\n";
+            break;
+        }
+        case ProfilingEntry::MetadataCategory::FirmwareMceStripeSetup:
+        {
+            o << "\t\t\t"
+              << R"("firmware_mce_stripe_setup_value": )" << std::to_string(entry.m_MetadataValue) << "\n";
+            break;
+        }
+        case ProfilingEntry::MetadataCategory::FirmwarePleStripeSetup:
+        {
+            o << "\t\t\t"
+              << R"("firmware_ple_stripe_setup_value": )" << std::to_string(entry.m_MetadataValue) << "\n";
+            break;
+        }
+        case ProfilingEntry::MetadataCategory::FirmwareLabel:
+        {
+            o << "\t\t\t"
+              << R"("firmware_label_value": )" << std::to_string(entry.m_MetadataValue) << "\n";
+            break;
+        }
+        case ProfilingEntry::MetadataCategory::FirmwareDmaSetup:
+        {
+            o << "\t\t\t"
+              << R"("firmware_dma_setup_value": )" << std::to_string(entry.m_MetadataValue) << "\n";
+            break;
+        }
+        case ProfilingEntry::MetadataCategory::FirmwareGetCompleteCommand:
+        {
+            o << "\t\t\t"
+              << R"("firmware_get_complete_command_value": )" << std::to_string(entry.m_MetadataValue) << "\n";
+            break;
+        }
+        case ProfilingEntry::MetadataCategory::FirmwareScheduleNextCommand:
+        {
+            o << "\t\t\t"
+              << R"("firmware_schedule_next_command_value": )" << std::to_string(entry.m_MetadataValue) << "\n";
+            break;
+        }
+        case ProfilingEntry::MetadataCategory::FirmwareWfeChecking:
+        {
+            o << "\t\t\t"
+              << R"("firmware_wfe_checking_value": )" << std::to_string(entry.m_MetadataValue) << "\n";
+            break;
+        }
+        case ProfilingEntry::MetadataCategory::FirmwareTimeSync:
+        {
+            o << "\t\t\t"
+              << R"("firmware_time_sync_value": )" << std::to_string(entry.m_MetadataValue) << "\n";
+            break;
+        }
+        case ProfilingEntry::MetadataCategory::FirmwareAgent:
+        {
+            o << "\t\t\t"
+              << R"("firmware_agent_value": )" << std::to_string(entry.m_MetadataValue) << "\n";
+            break;
+        }
+        case ProfilingEntry::MetadataCategory::FirmwareAgentStripe:
+        {
+            o << "\t\t\t"
+              << R"("firmware_agent_stripe_value": )" << std::to_string(entry.m_MetadataValue) << "\n";
+            break;
+        }
+        case ProfilingEntry::MetadataCategory::InferenceLifetime:
+        {
+            o << "\t\t\t"
+              << R"("inference_value": )" << std::to_string(entry.m_MetadataValue) << "\n";
+            break;
+        }
+        case ProfilingEntry::MetadataCategory::BufferLifetime:
+        {
+            o << "\t\t\t"
+              << R"("buffer_value": )" << std::to_string(entry.m_MetadataValue) << "\n";
+            break;
+        }
+        case ProfilingEntry::MetadataCategory::CounterValue:
+        {
+            o << "\t\t\t"
+              << R"("counter_value": )" << std::to_string(entry.GetCounterValue()) << "\n";
+            break;
+        }
+        default:
+        {
+            // Some Metadata categories don't have metadata
+        }
+    }
+    o << "\t\t}\n";
+    o << "\t}";
+}
+
+/// Appends a sample of every pollable counter to entries.
+void AppendCounterSamples(std::vector<ProfilingEntry>& entries)
 {
-    std::vector<ProfilingEntry> entries = profiling::g_ProfilingEntries;
-    // As well as dumping the currently queued profiling events, include a sample of every pollable counter.
     for (PollCounterName counter = static_cast<PollCounterName>(PollCounterName::DriverLibraryNumLiveBuffers);
          counter < PollCounterName::NumValues; counter = NextEnumValue(counter))
     {
@@ -35,152 +175,265 @@ void DumpAllProfilingData(std::ostream& outStream)
 
         entries.push_back(entry);
     }
-    DumpProfilingData(entries, outStream);
 }
 
-void DumpProfilingData(const std::vector<ProfilingEntry>& profilingData, std::ostream& outStream)
+void DumpChromeTraceEvent(const ProfilingEntry& entry, std::ostream& o)
 {
-    if (!outStream.good())
+    const char* category = MetadataCategoryToCString(entry.m_MetadataCategory);
+    std::string name     = category ? category : "Unknown";
+    if (entry.m_Type == ProfilingEntry::Type::CounterSample)
+    {
+        name = "Counter" + std::to_string(entry.m_Id);
+    }
+    // Timestamps are in microseconds
+    const uint64_t timestampNs = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(entry.m_Timestamp.time_since_epoch()).count());
+    const std::string fraction = std::to_string(timestampNs % 1000);
+    o << R"({"name": ")" << name << R"(", "cat": "ethosn", "pid": 0, "tid": 0, "ts": )" << timestampNs / 1000 << "."
+      << std::string(3 - fraction.size(), '0') << fraction;
+    switch (entry.m_Type)
+    {
+        case ProfilingEntry::Type::TimelineEventStart:
+            // Events of different categories overlap arbitrarily, so use async events which don't need to nest
+            o << R"(, "ph": "b", "id": )" << entry.m_Id << R"(, "args": {"metadata_value": )" << entry.m_MetadataValue
+              << "}";
+            break;
+        case ProfilingEntry::Type::TimelineEventEnd:
+            o << R"(, "ph": "e", "id": )" << entry.m_Id;
+            break;
+        case ProfilingEntry::Type::TimelineEventInstant:
+            o << R"(, "ph": "i", "s": "g", "args": {"id": )" << entry.m_Id << R"(, "metadata_value": )"
+              << entry.m_MetadataValue << "}";
+            break;
+        case ProfilingEntry::Type::CounterSample:
+            o << R"(, "ph": "C", "args": {"value": )" << entry.GetCounterValue() << "}";
+            break;
+        default:
+            break;
+    }
+    o << "}";
+}
+
+/// Layout of each entry in the binary dump format.
+struct BinaryDumpRecord
+{
+    int64_t m_Timestamp;
+    uint64_t m_Id;
+    uint64_t m_MetadataValue;
+    uint8_t m_Type;
+    uint8_t m_MetadataCategory;
+    uint8_t m_Reserved[6];
+};
+static_assert(sizeof(BinaryDumpRecord) == 32, "Binary dump records must be packed");
+
+constexpr char g_BinaryDumpMagic[4]   = { 'E', 'N', 'P', 'D' };
+constexpr uint32_t g_BinaryDumpVersion = 1;
+
+/// How often the background thread writes the entries it has been given, and how many entries can build up before
+/// it writes them early.
+constexpr std::chrono::milliseconds g_DumpWritePeriod(1000);
+constexpr size_t g_DumpWriteThreshold = 4096;
+
+/// Closes the array of entries in the JSON formats. This is the same as the end of DumpProfilingData's output.
+constexpr char g_JsonTrailer[] = "\n]\n";
+
+/// The writer for g_DumpFile, while profiling is enabled (see StreamNewProfilingData and CloseProfilingDump).
+std::mutex g_DumpWriterMutex;
+std::unique_ptr<ProfilingDumpWriter> g_DumpWriter;
+
+}    // namespace
+
+ProfilingDumpWriter::ProfilingDumpWriter(const std::string& fileName, DumpFormat format)
+    : m_File(fileName, std::ios_base::out | std::ios_base::trunc | std::ios_base::binary)
+    , m_Format(format)
+    , m_NumEntriesWritten(0)
+    , m_NumEntriesSubmitted(0)
+    , m_FlushRequested(false)
+    , m_Stop(false)
+{
+    switch (m_Format)
+    {
+        case DumpFormat::Json:    // Deliberate fallthrough
+        case DumpFormat::Chrome:
+            m_File << "[\n";
+            break;
+        case DumpFormat::Binary:
+        {
+            const uint32_t recordSize = sizeof(BinaryDumpRecord);
+            m_File.write(g_BinaryDumpMagic, sizeof(g_BinaryDumpMagic));
+            m_File.write(reinterpret_cast<const char*>(&g_BinaryDumpVersion), sizeof(g_BinaryDumpVersion));
+            m_File.write(reinterpret_cast<const char*>(&recordSize), sizeof(recordSize));
+            break;
+        }
+        default:
+            assert(false);
+            break;
+    }
+    WriteTrailer();
+    m_File.flush();
+    m_Thread = std::thread(&ProfilingDumpWriter::Run, this);
+}
+
+ProfilingDumpWriter::~ProfilingDumpWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_WakeUp.notify_one();
+    m_Thread.join();
+}
+
+void ProfilingDumpWriter::Write(const std::vector<ProfilingEntry>& entries)
+{
+    bool wakeUp;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_PendingEntries.insert(m_PendingEntries.end(), entries.begin(), entries.end());
+        m_NumEntriesSubmitted += entries.size();
+        wakeUp = m_PendingEntries.size() >= g_DumpWriteThreshold;
+    }
+    if (wakeUp)
+    {
+        m_WakeUp.notify_one();
+    }
+}
+
+void ProfilingDumpWriter::Flush()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    const uint64_t target = m_NumEntriesSubmitted;
+    m_FlushRequested      = true;
+    m_WakeUp.notify_one();
+    m_Written.wait(lock, [&] { return m_NumEntriesWritten >= target; });
+}
+
+void ProfilingDumpWriter::Run()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (true)
+    {
+        m_WakeUp.wait_for(lock, g_DumpWritePeriod, [&] {
+            return m_Stop || m_FlushRequested || m_PendingEntries.size() >= g_DumpWriteThreshold;
+        });
+
+        std::vector<ProfilingEntry> entries;
+        entries.swap(m_PendingEntries);
+        m_FlushRequested = false;
+        const bool stop  = m_Stop;
+
+        // Write without holding the lock, so that threads submitting entries don't wait for the file
+        lock.unlock();
+        WriteEntries(entries);
+        lock.lock();
+
+        m_NumEntriesWritten += entries.size();
+        m_Written.notify_all();
+        if (stop && m_PendingEntries.empty())
+        {
+            return;
+        }
+    }
+}
+
+void ProfilingDumpWriter::WriteEntries(const std::vector<ProfilingEntry>& entries)
+{
+    if (entries.empty())
     {
         return;
     }
-    outStream << "[\n";
-    auto DumpEntry = [& o = outStream](const ProfilingEntry& entry) {
-        o << "\t{\n";
-        o << "\t\t"
-          << R"("time_stamp": )" << std::to_string(entry.m_Timestamp.time_since_epoch().count()) << ",\n";
-        o << "\t\t"
-          << R"("type": )" << std::to_string(static_cast<uint64_t>(entry.m_Type)) << ",\n";
-        o << "\t\t"
-          << R"("id": )" << std::to_string(entry.m_Id) << ",\n";
-        o << "\t\t"
-          << R"("metadata_category": )" << std::to_string(static_cast<uint64_t>(entry.m_MetadataCategory)) << ",\n";
-        o << "\t\t"
-          << R"("metadata_value":)"
-          << "\n";
-        o << "\t\t{\n";
-        switch (entry.m_MetadataCategory)
-        {
-            case ProfilingEntry::MetadataCategory::FirmwareWfeSleeping:
-            {
-                o << "\t\t\t"
-                  << R"("firmware_wfe_sleeping_value": )" << std::to_string(entry.m_MetadataValue) << "\n";
-                break;
-            }
-            case ProfilingEntry::MetadataCategory::FirmwareInference:
-            {
-                o << "\t\t\t"
-                  << R"("firmware_inference_value": )" << std::to_string(entry.m_MetadataValue) << "\n";
-                break;
-            }
-            case ProfilingEntry::MetadataCategory::FirmwareCommand:
-            {
-                o << "\t\t\t"
-                  << R"("firmware_command_value": )" << std::to_string(entry.m_MetadataValue) << "\n";
-                break;
-            }
-            case ProfilingEntry::MetadataCategory::FirmwareDma:
-            {
-                o << "\t\t\t"
-                  << R"("firmware_dma_value": )" << std::to_string(entry.m_MetadataValue) << "\n";
-                break;
-            }
-            case ProfilingEntry::MetadataCategory::FirmwareTsu:
-            {
-                o << "\t\t\t"
-                  << R"("firmware_tsu_value": )" << std::to_string(entry.m_MetadataValue) << "\n";
-                break;
-            }
-            case ProfilingEntry::MetadataCategory::FirmwareMceStripeSetup:
-            {
-                o << "\t\t\t"
-                  << R"("firmware_mce_stripe_setup_value": )" << std::to_string(entry.m_MetadataValue) << "\n";
-                break;
-            }
-            case ProfilingEntry::MetadataCategory::FirmwarePleStripeSetup:
-            {
-                o << "\t\t\t"
-                  << R"("firmware_ple_stripe_setup_value": )" << std::to_string(entry.m_MetadataValue) << "\n";
-                break;
-            }
-            case ProfilingEntry::MetadataCategory::FirmwareLabel:
-            {
-                o << "\t\t\t"
-                  << R"("firmware_label_value": )" << std::to_string(entry.m_MetadataValue) << "\n";
-                break;
-            }
-            case ProfilingEntry::MetadataCategory::FirmwareDmaSetup:
-            {
-                o << "\t\t\t"
-                  << R"("firmware_dma_setup_value": )" << std::to_string(entry.m_MetadataValue) << "\n";
-                break;
-            }
-            case ProfilingEntry::MetadataCategory::FirmwareGetCompleteCommand:
-            {
-                o << "\t\t\t"
-                  << R"("firmware_get_complete_command_value": )" << std::to_string(entry.m_MetadataValue) << "\n";
-                break;
-            }
-            case ProfilingEntry::MetadataCategory::FirmwareScheduleNextCommand:
-            {
-                o << "\t\t\t"
-                  << R"("firmware_schedule_next_command_value": )" << std::to_string(entry.m_MetadataValue) << "\n";
-                break;
-            }
-            case ProfilingEntry::MetadataCategory::FirmwareWfeChecking:
-            {
-                o << "\t\t\t"
-                  << R"("firmware_wfe_checking_value": )" << std::to_string(entry.m_MetadataValue) << "\n";
-                break;
-            }
-            case ProfilingEntry::MetadataCategory::FirmwareTimeSync:
-            {
-                o << "\t\t\t"
-                  << R"("firmware_time_sync_value": )" << std::to_string(entry.m_MetadataValue) << "\n";
-                break;
-            }
-            case ProfilingEntry::MetadataCategory::FirmwareAgent:
-            {
-                o << "\t\t\t"
-                  << R"("firmware_agent_value": )" << std::to_string(entry.m_MetadataValue) << "\n";
-                break;
-            }
-            case ProfilingEntry::MetadataCategory::FirmwareAgentStripe:
-            {
-                o << "\t\t\t"
-                  << R"("firmware_agent_stripe_value": )" << std::to_string(entry.m_MetadataValue) << "\n";
-                break;
-            }
-            case ProfilingEntry::MetadataCategory::InferenceLifetime:
-            {
-                o << "\t\t\t"
-                  << R"("inference_value": )" << std::to_string(entry.m_MetadataValue) << "\n";
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        const ProfilingEntry& entry = entries[i];
+        // The JSON entries are separated by commas, so there is one before every entry except the very first
+        const bool isFirstEntry = m_NumEntriesWritten == 0 && i == 0;
+        switch (m_Format)
+        {
+            case DumpFormat::Json:
+                m_File << (isFirstEntry ? "" : ",\n");
+                DumpEntry(entry, m_File);
                 break;
-            }
-            case ProfilingEntry::MetadataCategory::BufferLifetime:
-            {
-                o << "\t\t\t"
-                  << R"("buffer_value": )" << std::to_string(entry.m_MetadataValue) << "\n";
+            case DumpFormat::Chrome:
+                m_File << (isFirstEntry ? "" : ",\n");
+                DumpChromeTraceEvent(entry, m_File);
                 break;
-            }
-            case ProfilingEntry::MetadataCategory::CounterValue:
+            case DumpFormat::Binary:
             {
-                o << "\t\t\t"
-                  << R"("counter_value": )" << std::to_string(entry.GetCounterValue()) << "\n";
+                BinaryDumpRecord record = {};
+                record.m_Timestamp      = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                         entry.m_Timestamp.time_since_epoch())
+                                         .count();
+                record.m_Id               = entry.m_Id;
+                record.m_MetadataValue    = entry.m_MetadataValue;
+                record.m_Type             = static_cast<uint8_t>(entry.m_Type);
+                record.m_MetadataCategory = static_cast<uint8_t>(entry.m_MetadataCategory);
+                m_File.write(reinterpret_cast<const char*>(&record), sizeof(record));
                 break;
             }
             default:
-            {
-                // Some Metadata categories don't have metadata
-            }
+                assert(false);
+                break;
         }
-        o << "\t\t}\n";
-        o << "\t}";
-    };
+    }
+    WriteTrailer();
+    m_File.flush();
+}
+
+void ProfilingDumpWriter::WriteTrailer()
+{
+    if (m_Format == DumpFormat::Binary)
+    {
+        return;
+    }
+    // Leave the file positioned at the start of the trailer, so that the next entries are written over it
+    const std::ofstream::pos_type end = m_File.tellp();
+    m_File << g_JsonTrailer;
+    m_File.seekp(end);
+}
+
+void StreamNewProfilingData()
+{
+    // The entries are taken while holding the lock, so that they are written in the order they were recorded
+    std::lock_guard<std::mutex> lock(g_DumpWriterMutex);
+    if (!g_DumpWriter)
+    {
+        g_DumpWriter = std::make_unique<ProfilingDumpWriter>(g_DumpFile, g_DumpFormat);
+    }
+    std::vector<ProfilingEntry> entries = TakeProfilingEntriesToDump();
+    AppendCounterSamples(entries);
+    g_DumpWriter->Write(entries);
+}
+
+void CloseProfilingDump()
+{
+    std::lock_guard<std::mutex> lock(g_DumpWriterMutex);
+    if (g_DumpWriter)
+    {
+        g_DumpWriter->Write(TakeProfilingEntriesToDump());
+        // The destructor writes everything which is still queued
+        g_DumpWriter.reset();
+    }
+}
+
+void DumpAllProfilingData(std::ostream& outStream)
+{
+    std::vector<ProfilingEntry> entries = PeekProfilingEntries();
+    // As well as dumping the currently queued profiling events, include a sample of every pollable counter.
+    AppendCounterSamples(entries);
+    DumpProfilingData(entries, outStream);
+}
+
+void DumpProfilingData(const std::vector<ProfilingEntry>& profilingData, std::ostream& outStream)
+{
+    if (!outStream.good())
+    {
+        return;
+    }
+    outStream << "[\n";
     for (size_t i = 0; i < profilingData.size(); ++i)
     {
         const ProfilingEntry& entry = profilingData[i];
-        DumpEntry(entry);
+        DumpEntry(entry, outStream);
         if (i != profilingData.size() - 1)
         {
             outStream << ",\n";
@@ -1,13 +1,19 @@
 //
-// Copyright © 2018-2020 Arm Limited. All rights reserved.
+// Copyright © 2018-2021 Arm Limited. All rights reserved.
 // SPDX-License-Identifier: Apache-2.0
 //
 
 #pragma once
 
 #include "../include/ethosn_driver_library/Profiling.hpp"
+#include "ProfilingInternal.hpp"
 
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
 #include <ostream>
+#include <string>
+#include <thread>
 #include <vector>
 
 namespace ethosn
@@ -20,6 +26,54 @@ namespace profiling
 void DumpAllProfilingData(std::ostream& outStream);
 void DumpProfilingData(const std::vector<ProfilingEntry>& profilingData, std::ostream& outStream);
 
+/// Writes profiling entries to a file as they are recorded, rather than rewriting the whole history each time.
+/// Entries are queued by Write and written by a background thread, every second or as soon as enough have built up,
+/// so the threads running inferences don't wait for the file.
+/// In the binary format the file starts with the characters "ENPD", a uint32 version and a uint32 record size,
+/// followed by one record per entry: int64 timestamp (ns), uint64 id, uint64 metadata value, uint8 type,
+/// uint8 metadata category and 6 bytes of padding, all in the host's byte order.
+/// In the JSON formats the closing ']' is written after every batch of entries and overwritten by the next one,
+/// so the file is always a complete JSON array, even if the process doesn't exit cleanly.
+class ProfilingDumpWriter
+{
+public:
+    ProfilingDumpWriter(const std::string& fileName, DumpFormat format);
+    ~ProfilingDumpWriter();
+
+    void Write(const std::vector<ProfilingEntry>& entries);
+
+    /// Waits until all the entries given to Write so far are in the file.
+    void Flush();
+
+private:
+    void Run();
+    void WriteEntries(const std::vector<ProfilingEntry>& entries);
+    void WriteTrailer();
+
+    std::ofstream m_File;
+    const DumpFormat m_Format;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_WakeUp;
+    std::condition_variable m_Written;
+    std::vector<ProfilingEntry> m_PendingEntries;
+    uint64_t m_NumEntriesWritten;
+    uint64_t m_NumEntriesSubmitted;
+    bool m_FlushRequested;
+    bool m_Stop;
+
+    std::thread m_Thread;
+};
+
+/// Passes the entries recorded since the last call, along with a sample of every pollable counter, to the writer
+/// for g_DumpFile. The writer is created by the first call after profiling is enabled, truncating the file.
+void StreamNewProfilingData();
+
+/// Writes any entries which haven't been passed to the writer for g_DumpFile yet and destroys it, closing the file.
+/// This is called when profiling is disabled, as the entries recorded until then are discarded and the timeline
+/// event ids start again from a new base, so a new file is started if profiling is enabled again.
+void CloseProfilingDump();
+
 }    // namespace profiling
 }    // namespace driver_library
 }    // namespace ethosn
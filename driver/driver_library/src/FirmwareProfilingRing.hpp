@@ -0,0 +1,117 @@
+//
+// Copyright © 2021 Arm Limited.
+// SPDX-License-Identifier: Apache-2.0
+//
+#pragma once
+
+#include <uapi/ethosn.h>
+#include <uapi/ethosn_shared.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace ethosn
+{
+namespace driver_library
+{
+namespace profiling
+{
+
+/// Consumes the entries which the firmware writes into its circular profiling buffer, in place, from a read-only
+/// mapping of the buffer (see ETHOSN_PROFILING_BUFFER_ENTRIES_OFFSET for the layout).
+/// The firmware never waits for the entries to be consumed, so it can overwrite entries before they are read.
+/// These overruns are detected using the entries' timestamps, which increase in the order they are written:
+/// the slot which the firmware will write next holds the oldest entry in the buffer, so if that is newer than the
+/// last entry read then everything in between has been lost.
+/// Entries which the firmware wrote before the first read have not been lost, even if it had already wrapped around,
+/// so the first read starts from the oldest entry in the buffer instead.
+class FirmwareProfilingRing
+{
+public:
+    FirmwareProfilingRing(const void* buffer, size_t bufferSize)
+        : m_WriteIndex(static_cast<const uint32_t*>(buffer))
+        , m_Entries(reinterpret_cast<const ethosn_profiling_entry*>(static_cast<const uint8_t*>(buffer) +
+                                                                     ETHOSN_PROFILING_BUFFER_ENTRIES_OFFSET))
+        , m_NumEntries(bufferSize > ETHOSN_PROFILING_BUFFER_ENTRIES_OFFSET
+                           ? static_cast<uint32_t>((bufferSize - ETHOSN_PROFILING_BUFFER_ENTRIES_OFFSET) /
+                                                   sizeof(ethosn_profiling_entry))
+                           : 0)
+        , m_ReadIndex(0)
+        , m_LastTimestamp(0)
+        , m_IsFirstRead(true)
+    {}
+
+    /// Appends the entries written since the last call to out, in the order they were written.
+    /// Returns false if the firmware overwrote some of them before they could be read, in which case only the
+    /// entries which are still intact are appended.
+    bool ReadNewEntries(std::vector<ethosn_profiling_entry>& out)
+    {
+        const uint32_t writeIndex = LoadWriteIndex();
+        if (writeIndex >= m_NumEntries)
+        {
+            return true;
+        }
+
+        bool isIntact = true;
+        uint32_t numAvailable;
+        if (m_Entries[writeIndex].timestamp > m_LastTimestamp)
+        {
+            // The firmware has written a whole buffer's worth since the last read (or before the first one), so only
+            // the oldest entry onwards is still there.
+            m_ReadIndex  = writeIndex;
+            numAvailable = m_NumEntries;
+            isIntact     = m_IsFirstRead;
+        }
+        else
+        {
+            numAvailable = (writeIndex + m_NumEntries - m_ReadIndex) % m_NumEntries;
+        }
+
+        const size_t firstNewEntry = out.size();
+        for (uint32_t i = 0; i < numAvailable; ++i)
+        {
+            out.push_back(m_Entries[(m_ReadIndex + i) % m_NumEntries]);
+        }
+
+        // The firmware may have carried on writing while the entries were being copied. Any which it reached
+        // could be torn, so drop them.
+        const uint32_t numWrittenSince = (LoadWriteIndex() + m_NumEntries - writeIndex) % m_NumEntries;
+        const uint32_t numFree         = m_NumEntries - numAvailable;
+        if (numWrittenSince > numFree)
+        {
+            const uint32_t numOverwritten = numWrittenSince - numFree;
+            out.erase(out.begin() + static_cast<ptrdiff_t>(firstNewEntry),
+                      out.begin() + static_cast<ptrdiff_t>(firstNewEntry + numOverwritten));
+            isIntact = false;
+        }
+
+        if (out.size() > firstNewEntry)
+        {
+            m_LastTimestamp = out.back().timestamp;
+        }
+        m_ReadIndex   = writeIndex;
+        m_IsFirstRead = false;
+        return isIntact;
+    }
+
+private:
+    uint32_t LoadWriteIndex() const
+    {
+        // The entries before the index are written by the firmware before the index is updated
+        return __atomic_load_n(m_WriteIndex, __ATOMIC_ACQUIRE);
+    }
+
+    const uint32_t* m_WriteIndex;
+    const ethosn_profiling_entry* m_Entries;
+    const uint32_t m_NumEntries;
+
+    uint32_t m_ReadIndex;
+    uint64_t m_LastTimestamp;
+    bool m_IsFirstRead;
+};
+
+}    // namespace profiling
+}    // namespace driver_library
+}    // namespace ethosn
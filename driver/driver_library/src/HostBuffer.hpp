@@ -0,0 +1,130 @@
+//
+// Copyright © 2021 Arm Limited. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include "../include/ethosn_driver_library/Buffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <errno.h>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace ethosn
+{
+namespace driver_library
+{
+
+// Buffer backed by host memory, for the backends which run inferences on the CPU side (model and dump-only).
+// Imported memory is used in place, so these backends alias it the same way the kernel module backend does.
+class Buffer::BufferImpl
+{
+public:
+    BufferImpl(uint32_t size, DataFormat format)
+        : m_Storage(new uint8_t[size]())
+        , m_Data(m_Storage.get())
+        , m_Size(size)
+        , m_Format(format)
+        , m_BufferFd(-1)
+    {}
+
+    BufferImpl(uint8_t* src, uint32_t size, DataFormat format)
+        : BufferImpl(size, format)
+    {
+        std::copy_n(src, size, m_Data);
+    }
+
+    BufferImpl(uint8_t* src, uint32_t size, DataFormat format, ImportMode mode)
+        : m_Storage(mode == ImportMode::Copy ? new uint8_t[size] : nullptr)
+        , m_Data(mode == ImportMode::Copy ? m_Storage.get() : src)
+        , m_Size(size)
+        , m_Format(format)
+        , m_BufferFd(-1)
+    {
+        if (src == nullptr)
+        {
+            throw std::runtime_error("Failed to import buffer: no memory given");
+        }
+        if (mode == ImportMode::Copy)
+        {
+            std::copy_n(src, size, m_Data);
+        }
+    }
+
+    BufferImpl(int dmaBufFd, uint32_t size, DataFormat format)
+        : m_Data(nullptr)
+        , m_Size(size)
+        , m_Format(format)
+        , m_BufferFd(-1)
+    {
+        // Hold our own reference to the dma-buf so that the caller may close theirs
+        m_BufferFd = dup(dmaBufFd);
+        if (m_BufferFd < 0)
+        {
+            throw std::runtime_error(std::string("Failed to import buffer: ") + strerror(errno));
+        }
+
+        void* data = mmap(nullptr, m_Size, PROT_READ | PROT_WRITE, MAP_SHARED, m_BufferFd, 0);
+        if (data == MAP_FAILED)
+        {
+            int err = errno;
+            close(m_BufferFd);
+            throw std::runtime_error(std::string("Failed to map memory: ") + strerror(err));
+        }
+        m_Data = static_cast<uint8_t*>(data);
+    }
+
+    ~BufferImpl()
+    {
+        if (m_BufferFd >= 0)
+        {
+            munmap(m_Data, m_Size);
+            close(m_BufferFd);
+        }
+    }
+
+    uint32_t GetSize()
+    {
+        return m_Size;
+    }
+
+    DataFormat GetDataFormat()
+    {
+        return m_Format;
+    }
+
+    const int& GetBufferHandle() const
+    {
+        return m_BufferFd;
+    }
+
+    uint8_t* GetMappedBuffer()
+    {
+        return m_Data;
+    }
+
+    uint64_t& GetLifetimeEventId()
+    {
+        return m_LifetimeEventId;
+    }
+
+private:
+    // Memory allocated by this buffer, or null when m_Data points to imported memory.
+    std::unique_ptr<uint8_t[]> m_Storage;
+    uint8_t* m_Data;
+    uint32_t m_Size;
+    DataFormat m_Format;
+    // The imported dma-buf, or -1 when the buffer is in process memory.
+    int m_BufferFd;
+    // Id of the profiling event for the lifetime of this buffer, or zero if profiling was disabled when it was created.
+    uint64_t m_LifetimeEventId = 0;
+};
+
+}    // namespace driver_library
+}    // namespace ethosn
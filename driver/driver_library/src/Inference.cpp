@@ -1,15 +1,19 @@
 //
-// Copyright © 2018-2020 Arm Limited. All rights reserved.
+// Copyright © 2018-2021 Arm Limited. All rights reserved.
 // SPDX-License-Identifier: Apache-2.0
 //
 
 #include "../include/ethosn_driver_library/Inference.hpp"
 
 #include "DumpProfiling.hpp"
+#include "NetworkImpl.hpp"
 #include "ProfilingInternal.hpp"
 
+#include <cerrno>
 #include <cstdint>
-#include <fstream>
+#include <cstring>
+#include <stdexcept>
+#include <string>
 #if defined(__unix__)
 #include <unistd.h>
 #endif
@@ -38,8 +42,16 @@ public:
         return m_fileDescriptor;
     }
 
+    uint64_t& GetLifetimeEventId()
+    {
+        return m_LifetimeEventId;
+    }
+
 private:
     int m_fileDescriptor;
+    // Id of the profiling event for the lifetime of this inference, or zero if profiling was disabled when it was
+    // created.
+    uint64_t m_LifetimeEventId = 0;
 };
 
 Inference::Inference(int fileDescriptor)
@@ -47,30 +59,40 @@ Inference::Inference(int fileDescriptor)
 {
     if (profiling::g_CurrentConfiguration.m_EnableProfiling)
     {
-        RecordLifetimeEvent(this, profiling::g_InferenceToLifetimeEventId,
+        RecordLifetimeEvent(inferenceImpl->GetLifetimeEventId(), profiling::g_NumLiveInferences,
                             profiling::ProfilingEntry::Type::TimelineEventStart,
                             profiling::ProfilingEntry::MetadataCategory::InferenceLifetime);
     }
 }
 
+namespace
+{
+
+void DumpProfilingData()
+{
+    // Include profiling entries from the firmware if any.
+    profiling::AppendKernelDriverEntries();
+    // Dumping profiling data at inference destruction is convenient because
+    // this is called frequently enough such that there is a good amount of data dumped
+    // but not frequently enough to cause performance regressions.
+    // Only the new entries are passed on, and they are written to the file in the background.
+    if (profiling::g_DumpFile.size() > 0)
+    {
+        profiling::StreamNewProfilingData();
+    }
+}
+
+}    // namespace
+
 Inference::~Inference()
 {
     if (profiling::g_CurrentConfiguration.m_EnableProfiling)
     {
-        RecordLifetimeEvent(this, profiling::g_InferenceToLifetimeEventId,
+        RecordLifetimeEvent(inferenceImpl->GetLifetimeEventId(), profiling::g_NumLiveInferences,
                             profiling::ProfilingEntry::Type::TimelineEventEnd,
                             profiling::ProfilingEntry::MetadataCategory::InferenceLifetime);
 
-        // Include profiling entries from the firmware if any.
-        profiling::AppendKernelDriverEntries();
-        // Dumping profiling data at inference destruction is convenient because
-        // this is called frequently enough such that there is a good amount of data dumped
-        // but not frequently enough to cause performance regressions.
-        if (profiling::g_DumpFile.size() > 0)
-        {
-            std::ofstream file(profiling::g_DumpFile.c_str(), std::ios_base::out | std::ofstream::binary);
-            profiling::DumpAllProfilingData(file);
-        }
+        DumpProfilingData();
     }
 }
 
@@ -79,5 +101,105 @@ int Inference::GetFileDescriptor()
     return inferenceImpl->GetFileDescriptor();
 }
 
+class InferenceBatch::InferenceBatchImpl
+{
+public:
+    InferenceBatchImpl(int fileDescriptor, uint32_t numInferences)
+        : m_FileDescriptor(fileDescriptor)
+        , m_NumInferences(numInferences)
+    {}
+
+    ~InferenceBatchImpl()
+    {
+#if defined(__unix__)
+        close(m_FileDescriptor);
+#endif
+    }
+
+    int GetFileDescriptor()
+    {
+        return m_FileDescriptor;
+    }
+
+    uint32_t GetNumInferences() const
+    {
+        return m_NumInferences;
+    }
+
+    std::vector<InferenceResult> GetResults()
+    {
+        std::vector<int32_t> statuses(m_NumInferences);
+#if defined(__unix__)
+        const size_t size = statuses.size() * sizeof(int32_t);
+        // The statuses are always read from the start, so rewind in case the descriptor is a regular file.
+        lseek(m_FileDescriptor, 0, SEEK_SET);
+        ssize_t result = read(m_FileDescriptor, statuses.data(), size);
+        if (result < 0 || static_cast<size_t>(result) != size)
+        {
+            throw std::runtime_error(std::string("Failed to read inference batch results: ") + strerror(errno));
+        }
+#endif
+        std::vector<InferenceResult> results(m_NumInferences);
+        for (uint32_t i = 0; i < m_NumInferences; ++i)
+        {
+            results[i] = static_cast<InferenceResult>(statuses[i]);
+        }
+        return results;
+    }
+
+private:
+    int m_FileDescriptor;
+    uint32_t m_NumInferences;
+};
+
+InferenceBatch::InferenceBatch(int fileDescriptor, uint32_t numInferences)
+    : inferenceBatchImpl{ std::make_unique<InferenceBatchImpl>(fileDescriptor, numInferences) }
+{}
+
+InferenceBatch::~InferenceBatch()
+{
+    if (profiling::g_CurrentConfiguration.m_EnableProfiling)
+    {
+        DumpProfilingData();
+    }
+}
+
+uint32_t InferenceBatch::GetNumInferences() const
+{
+    return inferenceBatchImpl->GetNumInferences();
+}
+
+int InferenceBatch::GetFileDescriptor()
+{
+    return inferenceBatchImpl->GetFileDescriptor();
+}
+
+std::vector<InferenceResult> InferenceBatch::GetResults()
+{
+    return inferenceBatchImpl->GetResults();
+}
+
+BoundInference::BoundInference(std::unique_ptr<BoundInferenceImpl> impl)
+    : boundInferenceImpl{ std::move(impl) }
+{}
+
+BoundInference::~BoundInference()
+{
+    if (profiling::g_CurrentConfiguration.m_EnableProfiling)
+    {
+        DumpProfilingData();
+    }
+}
+
+void BoundInference::Trigger()
+{
+    boundInferenceImpl->Trigger();
+}
+
+int BoundInference::GetFileDescriptor()
+{
+    return boundInferenceImpl->GetFileDescriptor();
+}
+
 }    // namespace driver_library
 }    // namespace ethosn
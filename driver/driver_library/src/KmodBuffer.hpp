@@ -1,5 +1,5 @@
 //
-// Copyright © 2018-2020 Arm Limited. All rights reserved.
+// Copyright © 2018-2021 Arm Limited. All rights reserved.
 // SPDX-License-Identifier: Apache-2.0
 //
 
@@ -35,46 +35,70 @@ public:
         : m_Data(nullptr)
         , m_Size(size)
         , m_Format(format)
+        , m_IsUserMemory(false)
     {
-        const ethosn_buffer_req outputBufReq = {
-            size,
-            MB_RDWR,
-        };
+        CreateBuffer();
+    }
 
-        int ethosnFd = open(ETHOSN_STRINGIZE_VALUE_OF(DEVICE_NODE), O_RDONLY);
-        if (ethosnFd < 0)
-        {
-            throw std::runtime_error(std::string("Unable to open ") +
-                                     std::string(ETHOSN_STRINGIZE_VALUE_OF(DEVICE_NODE)) + std::string(": ") +
-                                     strerror(errno));
-        }
+    BufferImpl(uint8_t* src, uint32_t size, DataFormat format)
+        : BufferImpl(size, format)
+    {
+        std::copy_n(src, size, m_Data);
+    }
 
-        m_BufferFd = ioctl(ethosnFd, ETHOSN_IOCTL_CREATE_BUFFER, &outputBufReq);
-        int err    = errno;
-        close(ethosnFd);
-        if (m_BufferFd < 0)
+    BufferImpl(uint8_t* src, uint32_t size, DataFormat format, ImportMode mode)
+        : m_Data(nullptr)
+        , m_Size(size)
+        , m_Format(format)
+        , m_IsUserMemory(mode == ImportMode::ZeroCopy)
+    {
+        if (!m_IsUserMemory)
         {
-            throw std::runtime_error(std::string("Failed to create buffer: ") + strerror(err));
+            CreateBuffer();
+            std::copy_n(src, size, m_Data);
+            return;
         }
 
-        m_Data = reinterpret_cast<uint8_t*>(mmap(nullptr, size, PROT_WRITE, MAP_SHARED, m_BufferFd, 0));
-        if (m_Data == MAP_FAILED)
+        const uintptr_t pageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+        if (src == nullptr || (reinterpret_cast<uintptr_t>(src) % pageSize) != 0)
         {
-            err = errno;
-            close(m_BufferFd);
-            throw std::runtime_error(std::string("Failed to map memory: ") + strerror(err));
+            throw std::runtime_error("Failed to import buffer: memory must be page-aligned");
         }
+
+        ethosn_buffer_import_req importReq = {};
+        importReq.type                     = ETHOSN_BUFFER_IMPORT_USER_PTR;
+        importReq.fd                       = -1;
+        importReq.user_ptr                 = reinterpret_cast<uintptr_t>(src);
+        importReq.size                     = size;
+        importReq.flags                    = MB_RDWR;
+
+        m_BufferFd = DeviceIoctl(ETHOSN_IOCTL_IMPORT_BUFFER, &importReq, "Failed to import buffer: ");
+        // The kernel reads and writes the pinned pages directly, so the caller's mapping is the buffer's mapping.
+        m_Data = src;
     }
 
-    BufferImpl(uint8_t* src, uint32_t size, DataFormat format)
-        : BufferImpl(size, format)
+    BufferImpl(int dmaBufFd, uint32_t size, DataFormat format)
+        : m_Data(nullptr)
+        , m_Size(size)
+        , m_Format(format)
+        , m_IsUserMemory(false)
     {
-        std::copy_n(src, size, m_Data);
+        ethosn_buffer_import_req importReq = {};
+        importReq.type                     = ETHOSN_BUFFER_IMPORT_DMA_BUF;
+        importReq.fd                       = dmaBufFd;
+        importReq.size                     = size;
+        importReq.flags                    = MB_RDWR;
+
+        m_BufferFd = DeviceIoctl(ETHOSN_IOCTL_IMPORT_BUFFER, &importReq, "Failed to import buffer: ");
+        MapBuffer();
     }
 
     ~BufferImpl()
     {
-        munmap(m_Data, m_Size);
+        if (!m_IsUserMemory)
+        {
+            munmap(m_Data, m_Size);
+        }
         close(m_BufferFd);
     }
 
@@ -98,11 +122,64 @@ public:
         return m_Data;
     }
 
+    uint64_t& GetLifetimeEventId()
+    {
+        return m_LifetimeEventId;
+    }
+
 private:
+    // Issues a buffer creation or import ioctl on the device node and returns the new buffer file descriptor.
+    template <typename T>
+    static int DeviceIoctl(unsigned long request, const T* arg, const char* errorMessage)
+    {
+        int ethosnFd = open(ETHOSN_STRINGIZE_VALUE_OF(DEVICE_NODE), O_RDONLY);
+        if (ethosnFd < 0)
+        {
+            throw std::runtime_error(std::string("Unable to open ") +
+                                     std::string(ETHOSN_STRINGIZE_VALUE_OF(DEVICE_NODE)) + std::string(": ") +
+                                     strerror(errno));
+        }
+
+        int bufferFd = ioctl(ethosnFd, request, arg);
+        int err      = errno;
+        close(ethosnFd);
+        if (bufferFd < 0)
+        {
+            throw std::runtime_error(std::string(errorMessage) + strerror(err));
+        }
+        return bufferFd;
+    }
+
+    void CreateBuffer()
+    {
+        const ethosn_buffer_req outputBufReq = {
+            m_Size,
+            MB_RDWR,
+        };
+
+        m_BufferFd = DeviceIoctl(ETHOSN_IOCTL_CREATE_BUFFER, &outputBufReq, "Failed to create buffer: ");
+        MapBuffer();
+    }
+
+    void MapBuffer()
+    {
+        m_Data = reinterpret_cast<uint8_t*>(mmap(nullptr, m_Size, PROT_WRITE, MAP_SHARED, m_BufferFd, 0));
+        if (m_Data == MAP_FAILED)
+        {
+            int err = errno;
+            close(m_BufferFd);
+            throw std::runtime_error(std::string("Failed to map memory: ") + strerror(err));
+        }
+    }
+
     int m_BufferFd;
     uint8_t* m_Data;
     uint32_t m_Size;
     DataFormat m_Format;
+    // True when m_Data points to caller memory imported in place rather than to an mmap of m_BufferFd.
+    bool m_IsUserMemory;
+    // Id of the profiling event for the lifetime of this buffer, or zero if profiling was disabled when it was created.
+    uint64_t m_LifetimeEventId = 0;
 };
 
 }    // namespace driver_library
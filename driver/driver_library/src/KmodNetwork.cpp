@@ -12,11 +12,13 @@
 #include <ethosn_utils/Strings.hpp>
 #include <uapi/ethosn.h>
 
+#include <algorithm>
 #include <cstring>
 #include <fcntl.h>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <numeric>
 #include <sstream>
 #include <sys/ioctl.h>
@@ -34,6 +36,9 @@ static_assert(ETHOSN_INFERENCE_RUNNING == static_cast<int>(InferenceResult::Runn
 static_assert(ETHOSN_INFERENCE_COMPLETED == static_cast<int>(InferenceResult::Completed),
               "ethosn.h != InferenceResult");
 static_assert(ETHOSN_INFERENCE_ERROR == static_cast<int>(InferenceResult::Error), "ethosn.h != InferenceResult");
+static_assert(ETHOSN_PRIORITY_LOW == static_cast<int>(Priority::Low), "ethosn.h != Priority");
+static_assert(ETHOSN_PRIORITY_MEDIUM == static_cast<int>(Priority::Medium), "ethosn.h != Priority");
+static_assert(ETHOSN_PRIORITY_HIGH == static_cast<int>(Priority::High), "ethosn.h != Priority");
 
 namespace
 {
@@ -50,6 +55,17 @@ std::vector<ethosn_buffer_info> ToKmodBufInfos(const std::vector<BufferInfo>& in
     return kmodInfos;
 }
 
+/// Digests let the kernel module share one copy of constant data between all the networks which have the same data
+/// (e.g. the same network registered by several processes). They are calculated by the Support Library when compiling
+/// the network, so networks compiled before they were added have none and their data is never shared.
+ethosn_constant_digest ToKmodDigest(const std::array<uint64_t, 2>& digest)
+{
+    ethosn_constant_digest kmodDigest = {};
+    kmodDigest.hash[0]                = digest[0];
+    kmodDigest.hash[1]                = digest[1];
+    return kmodDigest;
+}
+
 }    // namespace
 
 namespace ethosn
@@ -147,6 +163,17 @@ bool VerifyKernel()
 
 KmodNetworkImpl::KmodNetworkImpl(const char* compiledNetworkData, size_t compiledNetworkSize)
     : NetworkImpl(compiledNetworkData, compiledNetworkSize, false)
+{
+    Register(compiledNetworkData, compiledNetworkSize);
+}
+
+KmodNetworkImpl::KmodNetworkImpl(std::shared_ptr<const MappedFile> compiledNetworkFile)
+    : NetworkImpl(compiledNetworkFile)
+{
+    Register(compiledNetworkFile->GetData(), compiledNetworkFile->GetSize());
+}
+
+void KmodNetworkImpl::Register(const char* compiledNetworkData, size_t compiledNetworkSize)
 {
     CompiledNetworkInfo compiledNetwork = DeserializeCompiledNetwork(compiledNetworkData, compiledNetworkSize);
 
@@ -157,12 +184,14 @@ KmodNetworkImpl::KmodNetworkImpl(const char* compiledNetworkData, size_t compile
     std::vector<ethosn_buffer_info> outputInfos       = ToKmodBufInfos(compiledNetwork.m_OutputBufferInfos);
     std::vector<ethosn_buffer_info> intermediateInfos = ToKmodBufInfos(compiledNetwork.m_IntermediateDataBufferInfos);
 
-    ethosn_network_req netReq = {};
+    ethosn_network_req2 netReq2 = {};
+    ethosn_network_req& netReq  = netReq2.req;
 
     netReq.dma_buffers.num  = static_cast<uint32_t>(constantDmaInfos.size());
     netReq.dma_buffers.info = constantDmaInfos.data();
     netReq.dma_data.size    = static_cast<uint32_t>(compiledNetwork.m_ConstantDmaDataSize);
     netReq.dma_data.data    = compiledNetwork.CalculateConstantDmaDataPtr(compiledNetworkData);
+    netReq2.dma_digest      = ToKmodDigest(compiledNetwork.m_ConstantDmaDataDigest);
 
     netReq.intermediate_buffers.num  = static_cast<uint32_t>(intermediateInfos.size());
     netReq.intermediate_buffers.info = intermediateInfos.data();
@@ -179,6 +208,9 @@ KmodNetworkImpl::KmodNetworkImpl(const char* compiledNetworkData, size_t compile
     netReq.cu_buffers.info = constantCuInfos.data();
     netReq.cu_data.size    = static_cast<uint32_t>(compiledNetwork.m_ConstantControlUnitDataSize);
     netReq.cu_data.data    = compiledNetwork.CalculateConstantControlUnitDataPtr(compiledNetworkData);
+    netReq2.cu_digest      = ToKmodDigest(compiledNetwork.m_ConstantControlUnitDataDigest);
+
+    netReq2.priority.priority = ETHOSN_PRIORITY_MEDIUM;
 
     int ethosnFd = open(ETHOSN_STRINGIZE_VALUE_OF(DEVICE_NODE), O_RDONLY);
     if (ethosnFd < 0)
@@ -193,7 +225,7 @@ KmodNetworkImpl::KmodNetworkImpl(const char* compiledNetworkData, size_t compile
         throw std::runtime_error(std::string("Wrong kernel module version\n"));
     }
 
-    m_NetworkFd = ioctl(ethosnFd, ETHOSN_IOCTL_REGISTER_NETWORK, &netReq);
+    m_NetworkFd = ioctl(ethosnFd, ETHOSN_IOCTL_REGISTER_NETWORK2, &netReq2);
     int err     = errno;
     close(ethosnFd);
 
@@ -254,6 +286,190 @@ Inference* KmodNetworkImpl::ScheduleInference(Buffer* const inputBuffers[],
     return new Inference(inference_fd);
 }
 
+InferenceBatch* KmodNetworkImpl::ScheduleInferenceBatch(Buffer* const inputBuffers[],
+                                                        uint32_t numInputBuffers,
+                                                        Buffer* const outputBuffers[],
+                                                        uint32_t numOutputBuffers,
+                                                        uint32_t numInferences,
+                                                        int eventFd) const
+{
+    DumpCmmBasedOnEnvVar(inputBuffers, numInputBuffers);
+
+    ethosn_inference_batch_req batchReq = {};
+    std::vector<int> inputFds(numInferences * numInputBuffers, -1);
+    std::vector<int> outputFds(numInferences * numOutputBuffers, -1);
+
+    for (size_t i = 0; i < inputFds.size(); ++i)
+    {
+        inputFds[i] = inputBuffers[i]->GetBufferHandle();
+    }
+
+    for (size_t i = 0; i < outputFds.size(); ++i)
+    {
+        outputFds[i] = outputBuffers[i]->GetBufferHandle();
+    }
+
+    batchReq.num_inferences = numInferences;
+
+    batchReq.num_inputs = numInputBuffers;
+    batchReq.input_fds  = inputFds.data();
+
+    batchReq.num_outputs = numOutputBuffers;
+    batchReq.output_fds  = outputFds.data();
+
+    batchReq.eventfd = eventFd;
+
+    int batchFd = ioctl(m_NetworkFd, ETHOSN_IOCTL_SCHEDULE_INFERENCE_BATCH, &batchReq);
+    if (batchFd < 0)
+    {
+        throw std::runtime_error(std::string("Failed to create inference batch: ") + strerror(errno));
+    }
+
+    return new InferenceBatch(batchFd, numInferences);
+}
+
+namespace
+{
+
+class KmodBoundInferenceImpl : public BoundInferenceImpl
+{
+public:
+    using BoundInferenceImpl::BoundInferenceImpl;
+
+    void Trigger() override
+    {
+        if (ioctl(m_FileDescriptor, ETHOSN_IOCTL_TRIGGER_INFERENCE) < 0)
+        {
+            throw std::runtime_error(std::string("Failed to trigger inference: ") + strerror(errno));
+        }
+    }
+};
+
+}    // namespace
+
+BoundInference* KmodNetworkImpl::BindInference(Buffer* const inputBuffers[],
+                                               uint32_t numInputBuffers,
+                                               Buffer* const outputBuffers[],
+                                               uint32_t numOutputBuffers) const
+{
+    DumpCmmBasedOnEnvVar(inputBuffers, numInputBuffers);
+
+    ethosn_inference_req ifrReq = {};
+    std::vector<int> inputFds(numInputBuffers, -1);
+    std::vector<int> outputFds(numOutputBuffers, -1);
+
+    for (size_t i = 0; i < numInputBuffers; ++i)
+    {
+        inputFds[i] = inputBuffers[i]->GetBufferHandle();
+    }
+
+    for (size_t i = 0; i < numOutputBuffers; ++i)
+    {
+        outputFds[i] = outputBuffers[i]->GetBufferHandle();
+    }
+
+    ifrReq.num_inputs = numInputBuffers;
+    ifrReq.input_fds  = inputFds.data();
+
+    ifrReq.num_outputs = numOutputBuffers;
+    ifrReq.output_fds  = outputFds.data();
+
+    int inferenceFd = ioctl(m_NetworkFd, ETHOSN_IOCTL_BIND_INFERENCE, &ifrReq);
+    if (inferenceFd < 0)
+    {
+        throw std::runtime_error(std::string("Failed to bind inference: ") + strerror(errno));
+    }
+
+    return new BoundInference(std::make_unique<KmodBoundInferenceImpl>(inferenceFd));
+}
+
+void KmodNetworkImpl::SetPriority(Priority priority, uint32_t deadlineUs)
+{
+    ethosn_network_priority prio = {};
+    prio.priority                = static_cast<uint32_t>(priority);
+    prio.deadline_us             = deadlineUs;
+
+    if (ioctl(m_NetworkFd, ETHOSN_IOCTL_SET_NETWORK_PRIORITY, &prio) < 0)
+    {
+        throw std::runtime_error(std::string("Failed to set network priority: ") + strerror(errno));
+    }
+}
+
+namespace
+{
+
+LatencyHistogram ConvertLatencyHistogram(const ethosn_latency_histogram& kernelHistogram)
+{
+    static_assert(LatencyHistogram::NumBuckets == ETHOSN_LATENCY_HISTOGRAM_BUCKETS, "Bucket count mismatch");
+
+    LatencyHistogram histogram;
+    histogram.m_Count = kernelHistogram.count;
+    histogram.m_SumNs = kernelHistogram.sum_ns;
+    histogram.m_MaxNs = kernelHistogram.max_ns;
+    std::copy(std::begin(kernelHistogram.buckets), std::end(kernelHistogram.buckets), std::begin(histogram.m_Buckets));
+    return histogram;
+}
+
+}    // namespace
+
+InferenceLatencyStats KmodNetworkImpl::GetInferenceLatencyStats() const
+{
+    ethosn_inference_latency_stats kernelStats = {};
+    if (ioctl(m_NetworkFd, ETHOSN_IOCTL_GET_INFERENCE_LATENCY_STATS, &kernelStats) < 0)
+    {
+        throw std::runtime_error(std::string("Failed to get inference latency stats: ") + strerror(errno));
+    }
+
+    InferenceLatencyStats stats;
+    stats.m_QueueWait        = ConvertLatencyHistogram(kernelStats.queue_wait);
+    stats.m_Execution        = ConvertLatencyHistogram(kernelStats.execution);
+    stats.m_CompletionToWake = ConvertLatencyHistogram(kernelStats.completion_to_wake);
+    return stats;
+}
+
+HardwareCounterSummary KmodNetworkImpl::GetCounterSummary() const
+{
+    ethosn_hw_counter_summary kernelSummary = {};
+    if (ioctl(m_NetworkFd, ETHOSN_IOCTL_GET_HW_COUNTER_SUMMARY, &kernelSummary) < 0)
+    {
+        throw std::runtime_error(std::string("Failed to get hardware counter summary: ") + strerror(errno));
+    }
+    return ConvertHwCounterSummary(kernelSummary);
+}
+
+HardwareCounterSummary ConvertHwCounterSummary(const ethosn_hw_counter_summary& kernelSummary)
+{
+    static_assert(static_cast<uint32_t>(profiling::HardwareCounters::NumValues) == ETHOSN_NUM_HW_COUNTER_TYPES,
+                  "Hardware counter count mismatch");
+
+    HardwareCounterSummary summary;
+    summary.m_NumInferences     = kernelSummary.num_inferences;
+    summary.m_NumLostInferences = kernelSummary.num_lost_inferences;
+    // The kernel indexes the counters by ethosn_profiling_hw_counter_types, which is in the same order as
+    // HardwareCounters.
+    for (uint32_t i = 0; i < ETHOSN_NUM_HW_COUNTER_TYPES; ++i)
+    {
+        summary.m_Counters[i].m_NumSamples      = kernelSummary.num_samples[i];
+        summary.m_Counters[i].m_Total           = kernelSummary.totals[i];
+        summary.m_Counters[i].m_MaxPerInference = kernelSummary.max_per_inference[i];
+    }
+
+    // The kernel keeps the i-th inference in recent[i % ETHOSN_HW_COUNTER_RECENT_INFERENCES]
+    const uint64_t numRecent =
+        std::min<uint64_t>(kernelSummary.num_inferences, ETHOSN_HW_COUNTER_RECENT_INFERENCES);
+    for (uint64_t i = kernelSummary.num_inferences - numRecent; i < kernelSummary.num_inferences; ++i)
+    {
+        const ethosn_hw_counter_inference& kernelInference =
+            kernelSummary.recent[i % ETHOSN_HW_COUNTER_RECENT_INFERENCES];
+
+        HardwareCounterSummary::SampledInference inference;
+        inference.m_CompletedNs = kernelInference.completed_ns;
+        std::copy(std::begin(kernelInference.values), std::end(kernelInference.values), std::begin(inference.m_Values));
+        summary.m_RecentInferences.push_back(inference);
+    }
+    return summary;
+}
+
 void KmodNetworkImpl::DumpIntermediateBuffers()
 {
     if (!m_CompiledNetwork)
@@ -302,7 +518,7 @@ void KmodNetworkImpl::DumpIntermediateBuffers()
         // Parse the command stream to find the DUMP_DRAM commands
         BufferInfo cmdStreamInfo = m_CompiledNetwork->m_ConstantControlUnitDataBufferInfos[0];
         const uint8_t* rawCmdStreamData =
-            m_CompiledNetwork->CalculateConstantControlUnitDataPtr(m_CompiledNetworkData.data());
+            m_CompiledNetwork->CalculateConstantControlUnitDataPtr(GetCompiledNetworkData());
         command_stream::CommandStream cmdStream(rawCmdStreamData + cmdStreamInfo.m_Offset,
                                                 rawCmdStreamData + cmdStreamInfo.m_Offset + cmdStreamInfo.m_Size);
         for (auto it = cmdStream.begin(); it != cmdStream.end(); ++it)
@@ -7,6 +7,8 @@
 
 #include "NetworkImpl.hpp"
 
+struct ethosn_hw_counter_summary;
+
 namespace ethosn
 {
 namespace driver_library
@@ -19,6 +21,7 @@ class KmodNetworkImpl : public NetworkImpl
 {
 public:
     KmodNetworkImpl(const char* compiledNetworkData, size_t compiledNetworkSize);
+    KmodNetworkImpl(std::shared_ptr<const MappedFile> compiledNetworkFile);
 
     ~KmodNetworkImpl() override;
 
@@ -27,7 +30,29 @@ public:
                                  Buffer* const outputBuffers[],
                                  uint32_t numOutputBuffers) const override;
 
+    InferenceBatch* ScheduleInferenceBatch(Buffer* const inputBuffers[],
+                                           uint32_t numInputBuffers,
+                                           Buffer* const outputBuffers[],
+                                           uint32_t numOutputBuffers,
+                                           uint32_t numInferences,
+                                           int eventFd) const override;
+
+    BoundInference* BindInference(Buffer* const inputBuffers[],
+                                  uint32_t numInputBuffers,
+                                  Buffer* const outputBuffers[],
+                                  uint32_t numOutputBuffers) const override;
+
+    void SetPriority(Priority priority, uint32_t deadlineUs) override;
+
+    InferenceLatencyStats GetInferenceLatencyStats() const override;
+
+    HardwareCounterSummary GetCounterSummary() const override;
+
 private:
+    /// Registers the network with the kernel. The constant data is passed straight from the given compiled network,
+    /// so if that is a mapped file, it is only read by the kernel.
+    void Register(const char* compiledNetworkData, size_t compiledNetworkSize);
+
     void DumpIntermediateBuffers();
 
     int m_NetworkFd;
@@ -36,5 +61,8 @@ private:
 bool IsKernelVersionMatching(const struct Version& ver);
 constexpr bool IsKernelVersionSupported(const uint32_t& majorVersion);
 
+/// Converts the summary returned by ETHOSN_IOCTL_GET_HW_COUNTER_SUMMARY, putting its recent inferences in order.
+HardwareCounterSummary ConvertHwCounterSummary(const ethosn_hw_counter_summary& kernelSummary);
+
 }    // namespace driver_library
 }    // namespace ethosn
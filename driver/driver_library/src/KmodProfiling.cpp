@@ -1,11 +1,12 @@
 //
-// Copyright © 2018-2020 Arm Limited. All rights reserved.
+// Copyright © 2018-2021 Arm Limited. All rights reserved.
 // SPDX-License-Identifier: Apache-2.0
 //
 
 // This file implements some of internal profiling functions by forwarding requests to the kernel module.
 // These functions are declared in ProfilingInternal.hpp.
 
+#include "FirmwareProfilingRing.hpp"
 #include "ProfilingInternal.hpp"
 #include "Utils.hpp"
 
@@ -13,8 +14,11 @@
 
 #include <fcntl.h>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <string.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <unistd.h>
 
 namespace ethosn
@@ -41,12 +45,50 @@ struct TimeSync
     int64_t m_Delta;
 };
 
+/// Read-only mapping of the firmware's profiling buffer, which avoids copying the entries through read().
+class FirmwareBufferMapping
+{
+public:
+    FirmwareBufferMapping(void* address, size_t mappingSize, size_t bufferSize)
+        : m_Address(address)
+        , m_MappingSize(mappingSize)
+        , m_Ring(address, bufferSize)
+    {}
+
+    ~FirmwareBufferMapping()
+    {
+        munmap(m_Address, m_MappingSize);
+    }
+
+    FirmwareProfilingRing& GetRing()
+    {
+        return m_Ring;
+    }
+
+private:
+    void* m_Address;
+    size_t m_MappingSize;
+    FirmwareProfilingRing m_Ring;
+};
+
 }    // namespace
 
 int g_FirmwareBufferFd = 0;
 // Clock frequency expressed in MHz (it is provided by the kernel module).
 int g_ClockFrequencyMhz = 0;
 
+namespace
+{
+
+// Size of the firmware's profiling buffer, as configured in the kernel module.
+size_t g_FirmwareBufferSize = 0;
+std::unique_ptr<FirmwareBufferMapping> g_FirmwareBufferMapping;
+// Set once mapping the buffer has been attempted and failed, or once entries have been read from it with read()
+// (which keeps its own read position, so switching to the mapping afterwards would report them again).
+bool g_UseFirmwareBufferRead = false;
+
+}    // namespace
+
 bool ConfigureKernelDriver(Configuration config)
 {
     if (config.m_NumHardwareCounters > 6)
@@ -84,7 +126,11 @@ bool ConfigureKernelDriver(Configuration config)
         return false;
     }
 
-    // Close firmware profiling buffer file if it was open before
+    // Close firmware profiling buffer file if it was open before. The kernel module allocates a new buffer for the
+    // new configuration, so any mapping of the old one is stale.
+    g_FirmwareBufferMapping.reset();
+    g_UseFirmwareBufferRead = false;
+    g_FirmwareBufferSize    = config.m_FirmwareBufferSize;
     if (g_FirmwareBufferFd > 0)
     {
         close(g_FirmwareBufferFd);
@@ -102,6 +148,21 @@ bool ConfigureKernelDriver(Configuration config)
     return true;
 }
 
+bool SetKernelDriverHwCounterSamplingInterval(uint32_t interval)
+{
+    int ethosnFd = open(ETHOSN_STRINGIZE_VALUE_OF(DEVICE_NODE), O_RDONLY);
+    if (ethosnFd < 0)
+    {
+        throw std::runtime_error(std::string("Unable to open ") + std::string(ETHOSN_STRINGIZE_VALUE_OF(DEVICE_NODE)) +
+                                 std::string(": ") + strerror(errno));
+    }
+
+    int result = ioctl(ethosnFd, ETHOSN_IOCTL_SET_HW_COUNTER_SAMPLING_INTERVAL, &interval);
+    close(ethosnFd);
+
+    return result == 0;
+}
+
 uint64_t GetKernelDriverCounterValue(PollCounterName counter)
 {
     int ethosnFd = open(ETHOSN_STRINGIZE_VALUE_OF(DEVICE_NODE), O_RDONLY);
@@ -224,18 +285,52 @@ TimeSync GetTimeDelta(const std::vector<ProfilingEntry>& entries)
     return retVal;
 }
 
-}    // namespace
+// Maps the firmware's profiling buffer, if the kernel module supports it. Returns false if the entries need to be
+// read with read() instead.
+bool MapFirmwareBuffer()
+{
+    if (g_FirmwareBufferMapping)
+    {
+        return true;
+    }
+    if (g_UseFirmwareBufferRead)
+    {
+        return false;
+    }
 
-int64_t g_ProfilingDelta = 0;
+    const size_t pageSize    = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t mappingSize = (g_FirmwareBufferSize + pageSize - 1) / pageSize * pageSize;
+    void* address            = mmap(nullptr, mappingSize, PROT_READ, MAP_SHARED, g_FirmwareBufferFd, 0);
+    if (address == MAP_FAILED)
+    {
+        // The kernel module returns EAGAIN until the firmware has switched to the newly configured buffer
+        if (errno != EAGAIN)
+        {
+            g_UseFirmwareBufferRead = true;
+        }
+        return false;
+    }
+    g_FirmwareBufferMapping.reset(new FirmwareBufferMapping(address, mappingSize, g_FirmwareBufferSize));
+    return true;
+}
 
-// Append all firmware profiling entry to the global profiling.
-bool AppendKernelDriverEntries()
+// Reads the firmware entries written since the last call into firmwareEntries, from the mapping if possible.
+bool ReadFirmwareEntries(std::vector<ethosn_profiling_entry>& firmwareEntries)
 {
-    if (g_FirmwareBufferFd <= 0)
+    if (MapFirmwareBuffer())
     {
-        return false;
+        if (!g_FirmwareBufferMapping->GetRing().ReadNewEntries(firmwareEntries))
+        {
+            static bool s_HasWarned = false;
+            if (!s_HasWarned)
+            {
+                std::cerr << "Warning: some firmware profiling entries were overwritten before they could be read. "
+                             "Consider increasing the firmware buffer size.\n";
+                s_HasWarned = true;
+            }
+        }
+        return true;
     }
-    std::vector<ProfilingEntry> entries;
 
     // Read entries from the buffer until we catch up
     std::array<ethosn_profiling_entry, 64> readBuffer;
@@ -253,12 +348,40 @@ bool AppendKernelDriverEntries()
         else
         {
             size_t numEntriesRead = static_cast<size_t>(result) / sizeof(ethosn_profiling_entry);
-            for (size_t i = 0; i < numEntriesRead; ++i)
-            {
-                entries.push_back(ConvertProfilingEntry(readBuffer[i]));
-            }
+            firmwareEntries.insert(firmwareEntries.end(), readBuffer.begin(), readBuffer.begin() + numEntriesRead);
+            g_UseFirmwareBufferRead = true;
         }
     }
+    return true;
+}
+
+}    // namespace
+
+int64_t g_ProfilingDelta = 0;
+
+// Append all firmware profiling entry to the global profiling.
+bool AppendKernelDriverEntries()
+{
+    if (g_FirmwareBufferFd <= 0)
+    {
+        return false;
+    }
+    // This can be called by several inference threads at once. Only one of them should read the firmware buffer and
+    // update g_ProfilingDelta at a time, so that the entries stay in order.
+    static std::mutex s_Mutex;
+    std::lock_guard<std::mutex> lock(s_Mutex);
+
+    std::vector<ethosn_profiling_entry> firmwareEntries;
+    if (!ReadFirmwareEntries(firmwareEntries))
+    {
+        return false;
+    }
+    std::vector<ProfilingEntry> entries;
+    entries.reserve(firmwareEntries.size());
+    for (const ethosn_profiling_entry& firmwareEntry : firmwareEntries)
+    {
+        entries.push_back(ConvertProfilingEntry(firmwareEntry));
+    }
 
     TimeSync timeDelta = GetTimeDelta(entries);
     if (timeDelta.m_Valid)
@@ -275,9 +398,8 @@ bool AppendKernelDriverEntries()
         // before calculating the difference with the host CPU (also measured in nanoseconds).
         entry.m_Timestamp = std::chrono::time_point<std::chrono::high_resolution_clock>(std::chrono::nanoseconds(
             (1000 / g_ClockFrequencyMhz) * entry.m_Timestamp.time_since_epoch().count() + g_ProfilingDelta));
-
-        g_ProfilingEntries.push_back(entry);
     }
+    AppendProfilingEntries(entries);
 
     return true;
 }
@@ -45,6 +45,25 @@ Network::Network(const char* compiledNetworkData, size_t compiledNetworkSize)
       )
 {}
 
+Network::Network(std::unique_ptr<NetworkImpl> networkImpl)
+    : m_NetworkImpl(std::move(networkImpl))
+{}
+
+std::unique_ptr<Network> Network::FromFile(const char* path)
+{
+    std::shared_ptr<const MappedFile> file = std::make_shared<const MappedFile>(path);
+#if defined(TARGET_MODEL)
+    // The model always keeps its own copy of the compiled network
+    return std::unique_ptr<Network>(new Network(file->GetData(), file->GetSize()));
+#elif defined(TARGET_KMOD)
+    return std::unique_ptr<Network>(new Network(std::make_unique<KmodNetworkImpl>(file)));
+#elif defined(TARGET_DUMPONLY)
+    return std::unique_ptr<Network>(new Network(std::make_unique<NetworkImpl>(file)));
+#else
+#error "Unknown target backend."
+#endif
+}
+
 Network::~Network() = default;
 
 Inference* Network::ScheduleInference(Buffer* const inputBuffers[],
@@ -55,6 +74,40 @@ Inference* Network::ScheduleInference(Buffer* const inputBuffers[],
     return m_NetworkImpl->ScheduleInference(inputBuffers, numInputBuffers, outputBuffers, numOutputBuffers);
 }
 
+InferenceBatch* Network::ScheduleInferenceBatch(Buffer* const inputBuffers[],
+                                                uint32_t numInputBuffers,
+                                                Buffer* const outputBuffers[],
+                                                uint32_t numOutputBuffers,
+                                                uint32_t numInferences,
+                                                int eventFd) const
+{
+    return m_NetworkImpl->ScheduleInferenceBatch(inputBuffers, numInputBuffers, outputBuffers, numOutputBuffers,
+                                                 numInferences, eventFd);
+}
+
+BoundInference* Network::BindInference(Buffer* const inputBuffers[],
+                                       uint32_t numInputBuffers,
+                                       Buffer* const outputBuffers[],
+                                       uint32_t numOutputBuffers) const
+{
+    return m_NetworkImpl->BindInference(inputBuffers, numInputBuffers, outputBuffers, numOutputBuffers);
+}
+
+void Network::SetPriority(Priority priority, uint32_t deadlineUs)
+{
+    m_NetworkImpl->SetPriority(priority, deadlineUs);
+}
+
+InferenceLatencyStats Network::GetInferenceLatencyStats() const
+{
+    return m_NetworkImpl->GetInferenceLatencyStats();
+}
+
+HardwareCounterSummary Network::GetCounterSummary() const
+{
+    return m_NetworkImpl->GetCounterSummary();
+}
+
 void Network::SetDebugName(const char* name)
 {
     m_NetworkImpl->SetDebugName(name);
@@ -21,12 +21,18 @@
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <map>
 #include <numeric>
 #include <sstream>
 #include <string>
 #include <sys/stat.h>
 #include <sys/types.h>
+#if defined(__unix__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 using namespace ethosn;
 using namespace ethosn::driver_library;
@@ -197,6 +203,21 @@ bool ReadByteArray(Reader& reader, size_t& outOffset, size_t& outSize)
     return true;
 }
 
+bool ReadDigest(Reader& reader, std::array<uint64_t, 2>& outDigest)
+{
+    for (uint64_t& hash : outDigest)
+    {
+        uint32_t low;
+        uint32_t high;
+        if (!reader.ReadUint32(low) || !reader.ReadUint32(high))
+        {
+            return false;
+        }
+        hash = static_cast<uint64_t>(high) << 32 | low;
+    }
+    return true;
+}
+
 bool ReadBufferInfoArray(Reader& reader, std::vector<BufferInfo>& outData)
 {
     uint32_t size;
@@ -268,6 +289,12 @@ CompiledNetworkInfo DeserializeCompiledNetwork(const char* data, size_t size)
     success = success && ReadBufferInfoArray(reader, result.m_ConstantControlUnitDataBufferInfos);
     success = success && ReadBufferInfoArray(reader, result.m_ConstantDmaDataBufferInfos);
     success = success && ReadBufferInfoArray(reader, result.m_IntermediateDataBufferInfos);
+    // Added in version 1.1
+    if (minor >= 1)
+    {
+        success = success && ReadDigest(reader, result.m_ConstantDmaDataDigest);
+        success = success && ReadDigest(reader, result.m_ConstantControlUnitDataDigest);
+    }
 
     if (!success)
     {
@@ -303,6 +330,98 @@ NetworkImpl::NetworkImpl(const char* compiledNetworkData,
     }
 }
 
+NetworkImpl::NetworkImpl(std::shared_ptr<const MappedFile> compiledNetworkFile)
+{
+    // As above, but the file can be kept instead of a copy
+    if (std::getenv("ETHOSN_DRIVER_LIBRARY_DEBUG"))
+    {
+        m_CompiledNetworkFile = std::move(compiledNetworkFile);
+        m_CompiledNetwork     = std::make_unique<CompiledNetworkInfo>(
+            DeserializeCompiledNetwork(m_CompiledNetworkFile->GetData(), m_CompiledNetworkFile->GetSize()));
+    }
+}
+
+const char* NetworkImpl::GetCompiledNetworkData() const
+{
+    return m_CompiledNetworkFile ? m_CompiledNetworkFile->GetData() : m_CompiledNetworkData.data();
+}
+
+MappedFile::MappedFile(const char* path)
+    : m_Data(nullptr)
+    , m_Size(0)
+{
+#if defined(__unix__)
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        throw std::runtime_error(std::string("Unable to open ") + path + ": " + strerror(errno));
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0)
+    {
+        int err = errno;
+        close(fd);
+        throw std::runtime_error(std::string("Unable to stat ") + path + ": " + strerror(err));
+    }
+    m_Size = static_cast<size_t>(fileStat.st_size);
+
+    // An empty file can't be mapped, but there is nothing to map anyway
+    if (m_Size > 0)
+    {
+        void* data = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            int err = errno;
+            close(fd);
+            throw std::runtime_error(std::string("Unable to map ") + path + ": " + strerror(err));
+        }
+        m_Data = static_cast<const char*>(data);
+    }
+
+    // The mapping stays valid after the file is closed
+    close(fd);
+#else
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        throw std::runtime_error(std::string("Unable to open ") + path);
+    }
+    m_Contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    m_Data = m_Contents.data();
+    m_Size = m_Contents.size();
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#if defined(__unix__)
+    if (m_Data != nullptr)
+    {
+        munmap(const_cast<char*>(m_Data), m_Size);
+    }
+#endif
+}
+
+BoundInferenceImpl::BoundInferenceImpl(int fileDescriptor)
+    : m_FileDescriptor(fileDescriptor)
+{}
+
+BoundInferenceImpl::~BoundInferenceImpl()
+{
+#if defined(__unix__)
+    close(m_FileDescriptor);
+#endif
+}
+
+void BoundInferenceImpl::Trigger()
+{
+#if defined(__unix__)
+    // The simulated status is always completed, just rewind so that it can be read again.
+    lseek(m_FileDescriptor, 0, SEEK_SET);
+#endif
+}
+
 Inference* NetworkImpl::ScheduleInference(Buffer* const inputBuffers[],
                                           uint32_t numInputBuffers,
                                           Buffer* const[],
@@ -322,6 +441,75 @@ Inference* NetworkImpl::ScheduleInference(Buffer* const inputBuffers[],
     return new Inference(fileno(tempFile));
 }
 
+InferenceBatch* NetworkImpl::ScheduleInferenceBatch(Buffer* const inputBuffers[],
+                                                    uint32_t numInputBuffers,
+                                                    Buffer* const[],
+                                                    uint32_t,
+                                                    uint32_t numInferences,
+                                                    int eventFd) const
+{
+    DumpCmmBasedOnEnvVar(inputBuffers, numInputBuffers);
+
+    // Simulate the inference results for the user by creating a memory stream containing the result statuses.
+    FILE* tempFile = std::tmpfile();
+    std::vector<int32_t> statuses(numInferences, static_cast<int32_t>(InferenceResult::Completed));
+    if (fwrite(statuses.data(), sizeof(int32_t), statuses.size(), tempFile) != statuses.size())
+    {
+        return nullptr;
+    }
+    fflush(tempFile);
+    fseek(tempFile, 0, SEEK_SET);
+
+#if defined(__unix__)
+    // Every inference of the batch is already complete.
+    if (eventFd >= 0)
+    {
+        uint64_t numCompleted = numInferences;
+        if (write(eventFd, &numCompleted, sizeof(numCompleted)) != sizeof(numCompleted))
+        {
+            return nullptr;
+        }
+    }
+#else
+    ETHOSN_UNUSED(eventFd);
+#endif
+
+    return new InferenceBatch(fileno(tempFile), numInferences);
+}
+
+BoundInference* NetworkImpl::BindInference(Buffer* const inputBuffers[],
+                                           uint32_t numInputBuffers,
+                                           Buffer* const[],
+                                           uint32_t) const
+{
+    DumpCmmBasedOnEnvVar(inputBuffers, numInputBuffers);
+
+    // Simulate an inference result for the user by creating a memory stream containing the result status.
+    FILE* tempFile         = std::tmpfile();
+    InferenceResult status = InferenceResult::Completed;
+    if (fwrite(&status, sizeof(status), 1, tempFile) != 1)
+    {
+        return nullptr;
+    }
+    fflush(tempFile);
+    fseek(tempFile, 0, SEEK_SET);
+
+    return new BoundInference(std::make_unique<BoundInferenceImpl>(fileno(tempFile)));
+}
+
+void NetworkImpl::SetPriority(Priority, uint32_t)
+{}
+
+InferenceLatencyStats NetworkImpl::GetInferenceLatencyStats() const
+{
+    return InferenceLatencyStats();
+}
+
+HardwareCounterSummary NetworkImpl::GetCounterSummary() const
+{
+    return HardwareCounterSummary();
+}
+
 void NetworkImpl::SetDebugName(const char* name)
 {
     m_DebugName = name;
@@ -396,13 +584,13 @@ void NetworkImpl::DumpCmm(Buffer* const inputBuffers[],
     if (sections & Cmm_ConstantDma)
     {
         AddToMemoryMap(cmm, static_cast<uint32_t>(constantDmaDataBaseAddress),
-                       m_CompiledNetwork->CalculateConstantDmaDataPtr(m_CompiledNetworkData.data()),
+                       m_CompiledNetwork->CalculateConstantDmaDataPtr(GetCompiledNetworkData()),
                        m_CompiledNetwork->m_ConstantDmaDataSize);
     }
     if (sections & Cmm_ConstantControlUnit)
     {
         AddToMemoryMap(cmm, static_cast<uint32_t>(cmmConstantControlUnitDataBaseAddress),
-                       m_CompiledNetwork->CalculateConstantControlUnitDataPtr(m_CompiledNetworkData.data()),
+                       m_CompiledNetwork->CalculateConstantControlUnitDataPtr(GetCompiledNetworkData()),
                        m_CompiledNetwork->m_ConstantControlUnitDataSize);
     }
 
@@ -510,7 +698,7 @@ void NetworkImpl::DumpCommandStream(const char* cmdStreamFilename) const
 #if defined(ETHOSN_ALLOW_COMMAND_STREAM_DUMP)
     BufferInfo cmdStreamInfo = m_CompiledNetwork->m_ConstantControlUnitDataBufferInfos[0];
     const uint8_t* rawCmdStreamData =
-        m_CompiledNetwork->CalculateConstantControlUnitDataPtr(m_CompiledNetworkData.data());
+        m_CompiledNetwork->CalculateConstantControlUnitDataPtr(GetCompiledNetworkData());
     std::stringstream binaryIn;
     binaryIn.write(reinterpret_cast<const char*>(rawCmdStreamData) + cmdStreamInfo.m_Offset, cmdStreamInfo.m_Size);
     std::ofstream xmlOut(cmdStreamFilename);
@@ -7,8 +7,11 @@
 
 #include "../include/ethosn_driver_library/Buffer.hpp"
 #include "../include/ethosn_driver_library/Inference.hpp"
+#include "../include/ethosn_driver_library/Network.hpp"
 
+#include <array>
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -64,6 +67,13 @@ struct CompiledNetworkInfo
 
     uint32_t m_IntermediateDataSize = 0;
 
+    /// Digests of the constant data calculated by the Support Library, or all zeros if the Compiled Network doesn't
+    /// have them (before version 1.1).
+    /// @{
+    std::array<uint64_t, 2> m_ConstantDmaDataDigest         = {};
+    std::array<uint64_t, 2> m_ConstantControlUnitDataDigest = {};
+    /// @}
+
     const uint8_t* CalculateConstantDmaDataPtr(const char* compiledNetworkData)
     {
         return reinterpret_cast<const uint8_t*>(compiledNetworkData) + m_ConstantDmaDataOffset;
@@ -78,6 +88,55 @@ struct CompiledNetworkInfo
 /// @throws CompiledNetworkException if the given Compiled Network data is not valid.
 CompiledNetworkInfo DeserializeCompiledNetwork(const char* data, size_t size);
 
+/// The whole of a file, mapped read-only into memory where possible so that it doesn't need to be read up front.
+class MappedFile
+{
+public:
+    /// @throws std::runtime_error if the file can't be opened or mapped.
+    explicit MappedFile(const char* path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* GetData() const
+    {
+        return m_Data;
+    }
+
+    size_t GetSize() const
+    {
+        return m_Size;
+    }
+
+private:
+    const char* m_Data;
+    size_t m_Size;
+    /// Holds the contents of the file on platforms which can't map it.
+    std::vector<char> m_Contents;
+};
+
+/// Base class for the backend specific part of a BoundInference.
+/// This simple base implementation does not run anything: the file descriptor is expected to simulate the status of
+/// a completed inference.
+class BoundInferenceImpl
+{
+public:
+    BoundInferenceImpl(int fileDescriptor);
+
+    virtual ~BoundInferenceImpl();
+
+    virtual void Trigger();
+
+    int GetFileDescriptor() const
+    {
+        return m_FileDescriptor;
+    }
+
+protected:
+    int m_FileDescriptor;
+};
+
 /// Base class for all NetworkImpls.
 /// This provides the functionality to dump a combined memory map.
 class NetworkImpl
@@ -85,6 +144,10 @@ class NetworkImpl
 public:
     NetworkImpl(const char* compiledNetworkData, size_t compiledNetworkSizeData, bool alwaysCopyCompiledNetwork);
 
+    /// As above, for a compiled network which is the whole of the given file. When the compiled network is needed
+    /// later, the file is kept mapped instead of being copied.
+    NetworkImpl(std::shared_ptr<const MappedFile> compiledNetworkFile);
+
     virtual ~NetworkImpl()
     {}
 
@@ -94,6 +157,30 @@ public:
                                          Buffer* const outputBuffers[],
                                          uint32_t numOutputBuffers) const;
 
+    /// This simple base implementation only dumps the CMM file for the first set of inputs, rather than scheduling
+    /// inferences.
+    virtual InferenceBatch* ScheduleInferenceBatch(Buffer* const inputBuffers[],
+                                                   uint32_t numInputBuffers,
+                                                   Buffer* const outputBuffers[],
+                                                   uint32_t numOutputBuffers,
+                                                   uint32_t numInferences,
+                                                   int eventFd) const;
+
+    /// This simple base implementation only dumps the CMM file, rather than binding the buffers.
+    virtual BoundInference* BindInference(Buffer* const inputBuffers[],
+                                          uint32_t numInputBuffers,
+                                          Buffer* const outputBuffers[],
+                                          uint32_t numOutputBuffers) const;
+
+    /// This simple base implementation has no scheduler, so ignores the priority.
+    virtual void SetPriority(Priority priority, uint32_t deadlineUs);
+
+    /// This simple base implementation doesn't run inferences, so reports no latencies.
+    virtual InferenceLatencyStats GetInferenceLatencyStats() const;
+
+    /// This simple base implementation doesn't run inferences, so reports no counters.
+    virtual HardwareCounterSummary GetCounterSummary() const;
+
     void SetDebugName(const char* name);
 
 protected:
@@ -120,10 +207,15 @@ protected:
                                              uint64_t outputBuffersBaseAddress,
                                              uint64_t intermediateDataBaseAddress) const;
 
+    /// The compiled network which m_CompiledNetwork refers to, either m_CompiledNetworkData or the mapped file.
+    const char* GetCompiledNetworkData() const;
+
     /// Some debugging operations and some backends require keeping around a copy of the compiled network,
     /// but we don't want to incur this memory cost for the standard case, so these fields may be left empty.
+    /// If the network was loaded from a file, the mapping of the file is kept instead of a copy.
     /// @{
     std::vector<char> m_CompiledNetworkData;
+    std::shared_ptr<const MappedFile> m_CompiledNetworkFile;
     std::unique_ptr<CompiledNetworkInfo> m_CompiledNetwork;
     /// @}
 
@@ -26,6 +26,11 @@ bool ConfigureKernelDriver(Configuration)
     return true;
 }
 
+bool SetKernelDriverHwCounterSamplingInterval(uint32_t)
+{
+    return true;
+}
+
 uint64_t GetKernelDriverCounterValue(PollCounterName)
 {
     return 0;
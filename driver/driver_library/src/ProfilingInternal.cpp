@@ -1,14 +1,19 @@
 //
-// Copyright © 2019-2020 Arm Limited. All rights reserved.
+// Copyright © 2019-2021 Arm Limited. All rights reserved.
 // SPDX-License-Identifier: Apache-2.0
 //
 
 #include "ProfilingInternal.hpp"
 
+#include "DumpProfiling.hpp"
+
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstdint>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <vector>
 
@@ -19,10 +24,160 @@ namespace driver_library
 namespace profiling
 {
 
+namespace
+{
+
+/// Ids below this were allocated before profiling was last disabled.
+std::atomic<uint64_t> g_FirstCurrentTimelineEventId{ g_DriverLibraryEventIdBase };
+std::atomic<uint64_t> g_NextTimelineEventId{ g_DriverLibraryEventIdBase };
+
+/// Number of entries each thread can record between calls to ReportNewProfilingData before they overflow into a
+/// (locked) vector.
+constexpr size_t g_ThreadEntryRingSize = 1024;
+
+/// The profiling entries recorded by a single thread, which are collected by CollectEntries.
+/// This is a single-producer single-consumer ring buffer: the owning thread pushes entries without taking any locks,
+/// and they are only ever popped while holding g_CollectedEntriesMutex.
+class ThreadEntryRing
+{
+public:
+    void Push(const ProfilingEntry& entry)
+    {
+        const size_t head = m_Head.load(std::memory_order_relaxed);
+        if (head - m_Tail.load(std::memory_order_acquire) == m_Entries.size())
+        {
+            // Full, so keep the entry until the next collection. Entries are only added to the ring once it has
+            // been emptied, which also empties this, so the order of the entries is preserved.
+            std::lock_guard<std::mutex> lock(m_OverflowMutex);
+            m_Overflow.push_back(entry);
+            return;
+        }
+        m_Entries[head % m_Entries.size()] = entry;
+        m_Head.store(head + 1, std::memory_order_release);
+    }
+
+    /// Moves all the entries pushed so far to the end of out, in the order they were pushed.
+    void PopAll(std::vector<ProfilingEntry>& out)
+    {
+        const size_t tail = m_Tail.load(std::memory_order_relaxed);
+        const size_t head = m_Head.load(std::memory_order_acquire);
+        for (size_t i = tail; i != head; ++i)
+        {
+            out.push_back(m_Entries[i % m_Entries.size()]);
+        }
+        m_Tail.store(head, std::memory_order_release);
+
+        std::lock_guard<std::mutex> lock(m_OverflowMutex);
+        out.insert(out.end(), m_Overflow.begin(), m_Overflow.end());
+        m_Overflow.clear();
+    }
+
+private:
+    std::array<ProfilingEntry, g_ThreadEntryRingSize> m_Entries;
+    /// Total number of entries pushed to/popped from the ring.
+    std::atomic<size_t> m_Head{ 0 };
+    std::atomic<size_t> m_Tail{ 0 };
+
+    std::mutex m_OverflowMutex;
+    std::vector<ProfilingEntry> m_Overflow;
+};
+
+/// Guards g_ThreadEntryRings and g_CollectedEntries. This is only taken when collecting the entries, and when a
+/// thread records its first entry.
+std::mutex g_CollectedEntriesMutex;
+/// The ring of every thread which has recorded an entry. Rings are removed once their thread has exited and they
+/// have been emptied.
+std::vector<std::shared_ptr<ThreadEntryRing>> g_ThreadEntryRings;
+/// Entries collected from the rings (and added by AppendProfilingEntries) but not yet reported. Limited to
+/// g_MaxCollectedEntries, in case ReportNewProfilingData is never called (e.g. when only dumping to g_DumpFile).
+std::vector<ProfilingEntry> g_CollectedEntries;
+/// Entries collected but not yet taken by TakeProfilingEntriesToDump. Only used if g_DumpFile is set.
+std::vector<ProfilingEntry> g_EntriesToDump;
+
+/// Adds newly collected entries to g_CollectedEntries (and g_EntriesToDump). g_CollectedEntriesMutex must be held.
+void AddCollectedEntries(const std::vector<ProfilingEntry>& entries)
+{
+    g_CollectedEntries.insert(g_CollectedEntries.end(), entries.begin(), entries.end());
+    if (g_CollectedEntries.size() > g_MaxCollectedEntries)
+    {
+        // Discard the oldest entries, down to half the limit so that the rest aren't moved on every collection
+        g_CollectedEntries.erase(g_CollectedEntries.begin(),
+                                 g_CollectedEntries.end() - static_cast<ptrdiff_t>(g_MaxCollectedEntries / 2));
+    }
+    if (!g_DumpFile.empty())
+    {
+        g_EntriesToDump.insert(g_EntriesToDump.end(), entries.begin(), entries.end());
+    }
+}
+
+ThreadEntryRing& GetThreadEntryRing()
+{
+    thread_local std::shared_ptr<ThreadEntryRing> ring = [] {
+        auto newRing = std::make_shared<ThreadEntryRing>();
+        std::lock_guard<std::mutex> lock(g_CollectedEntriesMutex);
+        g_ThreadEntryRings.push_back(newRing);
+        return newRing;
+    }();
+    return *ring;
+}
+
+/// Moves the entries recorded by all threads into g_CollectedEntries. The entries from different threads are merged
+/// by timestamp. g_CollectedEntriesMutex must be held.
+void CollectEntries()
+{
+    std::vector<ProfilingEntry> entries;
+    for (auto it = g_ThreadEntryRings.begin(); it != g_ThreadEntryRings.end();)
+    {
+        // Check this first, so that any entries the thread recorded before exiting are still collected.
+        const bool hasThreadExited = it->use_count() == 1;
+        (*it)->PopAll(entries);
+        it = hasThreadExited ? g_ThreadEntryRings.erase(it) : it + 1;
+    }
+    std::stable_sort(entries.begin(), entries.end(), [](const ProfilingEntry& a, const ProfilingEntry& b) {
+        return a.m_Timestamp < b.m_Timestamp;
+    });
+    AddCollectedEntries(entries);
+}
+
+}    // namespace
+
 uint64_t GetNextTimeLineEventId()
 {
-    g_NextTimelineEventId = std::max(g_DriverLibraryEventIdBase, g_NextTimelineEventId + 1);
-    return g_NextTimelineEventId;
+    return g_NextTimelineEventId.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool IsCurrentTimeLineEventId(uint64_t id)
+{
+    return id >= g_FirstCurrentTimelineEventId.load(std::memory_order_relaxed);
+}
+
+void RecordProfilingEntry(const ProfilingEntry& entry)
+{
+    GetThreadEntryRing().Push(entry);
+}
+
+void AppendProfilingEntries(const std::vector<ProfilingEntry>& entries)
+{
+    std::lock_guard<std::mutex> lock(g_CollectedEntriesMutex);
+    CollectEntries();
+    AddCollectedEntries(entries);
+}
+
+std::vector<ProfilingEntry> PeekProfilingEntries()
+{
+    std::lock_guard<std::mutex> lock(g_CollectedEntriesMutex);
+    CollectEntries();
+    return g_CollectedEntries;
+}
+
+std::vector<ProfilingEntry> TakeProfilingEntriesToDump()
+{
+    std::lock_guard<std::mutex> lock(g_CollectedEntriesMutex);
+    CollectEntries();
+    std::vector<ProfilingEntry> res(std::move(g_EntriesToDump));
+
+    g_EntriesToDump.clear();
+    return res;
 }
 
 bool ApplyConfiguration(Configuration config)
@@ -31,10 +186,17 @@ bool ApplyConfiguration(Configuration config)
 
     if (hasKernelConfigureSucceeded && g_CurrentConfiguration.m_EnableProfiling && !config.m_EnableProfiling)
     {
-        g_ProfilingEntries.clear();
-        g_BufferToLifetimeEventId.clear();
-        g_InferenceToLifetimeEventId.clear();
-        g_NextTimelineEventId = g_DriverLibraryEventIdBase;
+        CloseProfilingDump();
+
+        std::lock_guard<std::mutex> lock(g_CollectedEntriesMutex);
+        CollectEntries();
+        g_CollectedEntries.clear();
+        g_EntriesToDump.clear();
+        // Objects which are still alive won't record their end events, as their start events have been discarded
+        g_FirstCurrentTimelineEventId.store(g_NextTimelineEventId.load(std::memory_order_relaxed),
+                                            std::memory_order_relaxed);
+        g_NumLiveBuffers.store(0, std::memory_order_relaxed);
+        g_NumLiveInferences.store(0, std::memory_order_relaxed);
     }
 
     return hasKernelConfigureSucceeded;
@@ -72,10 +234,33 @@ Configuration GetConfigFromString(const char* str)
         {
             g_DumpFile = optionValue;
         }
+        else if (optionName == "dumpFormat")
+        {
+            if (optionValue == "json")
+            {
+                g_DumpFormat = DumpFormat::Json;
+            }
+            else if (optionValue == "chrome")
+            {
+                g_DumpFormat = DumpFormat::Chrome;
+            }
+            else if (optionValue == "binary")
+            {
+                g_DumpFormat = DumpFormat::Binary;
+            }
+            else
+            {
+                std::cerr << "Unknown profiling dump format " << optionValue << "\n";
+            }
+        }
         else if (optionName == "firmwareBufferSize")
         {
             config.m_FirmwareBufferSize = static_cast<uint32_t>(std::stoul(optionValue));
         }
+        else if (optionName == "hwCounterSamplingInterval")
+        {
+            g_HwCounterSamplingInterval = static_cast<uint32_t>(std::stoul(optionValue));
+        }
         else if (optionName == "hwCounters")
         {
             auto hwCounters = Split(optionValue, ',');
@@ -172,16 +357,20 @@ Configuration GetDefaultConfiguration()
     {
         return Configuration();
     }
+    if (g_HwCounterSamplingInterval != 0 && !SetKernelDriverHwCounterSamplingInterval(g_HwCounterSamplingInterval))
+    {
+        g_HwCounterSamplingInterval = 0;
+    }
     return config;
 }
 
 std::string g_DumpFile               = "";
+DumpFormat g_DumpFormat              = DumpFormat::Json;
+uint32_t g_HwCounterSamplingInterval = 0;
 Configuration g_CurrentConfiguration = GetDefaultConfiguration();
 
-std::vector<ProfilingEntry> g_ProfilingEntries              = {};
-std::map<Buffer*, uint64_t> g_BufferToLifetimeEventId       = {};
-std::map<Inference*, uint64_t> g_InferenceToLifetimeEventId = {};
-uint64_t g_NextTimelineEventId                              = g_DriverLibraryEventIdBase;
+std::atomic<uint64_t> g_NumLiveBuffers{ 0 };
+std::atomic<uint64_t> g_NumLiveInferences{ 0 };
 
 bool Configure(Configuration config)
 {
@@ -193,11 +382,23 @@ bool Configure(Configuration config)
     return isConfigurationApplied;
 }
 
+bool SetHwCounterSamplingInterval(uint32_t interval)
+{
+    if (!SetKernelDriverHwCounterSamplingInterval(interval))
+    {
+        return false;
+    }
+    g_HwCounterSamplingInterval = interval;
+    return true;
+}
+
 std::vector<ProfilingEntry> ReportNewProfilingData()
 {
-    std::vector<ProfilingEntry> res(std::move(g_ProfilingEntries));
+    std::lock_guard<std::mutex> lock(g_CollectedEntriesMutex);
+    CollectEntries();
+    std::vector<ProfilingEntry> res(std::move(g_CollectedEntries));
 
-    g_ProfilingEntries.clear();
+    g_CollectedEntries.clear();
     return res;
 }
 
@@ -211,9 +412,9 @@ uint64_t GetCounterValue(PollCounterName counter)
     switch (counter)
     {
         case PollCounterName::DriverLibraryNumLiveBuffers:
-            return g_BufferToLifetimeEventId.size();
+            return g_NumLiveBuffers.load(std::memory_order_relaxed);
         case PollCounterName::DriverLibraryNumLiveInferences:
-            return g_InferenceToLifetimeEventId.size();
+            return g_NumLiveInferences.load(std::memory_order_relaxed);
         case PollCounterName::KernelDriverNumMailboxMessagesSent:    // Deliberate fallthrough
         case PollCounterName::KernelDriverNumMailboxMessagesReceived:
             return GetKernelDriverCounterValue(counter);
@@ -1,5 +1,5 @@
 //
-// Copyright © 2019-2020 Arm Limited. All rights reserved.
+// Copyright © 2019-2021 Arm Limited. All rights reserved.
 // SPDX-License-Identifier: Apache-2.0
 //
 #pragma once
@@ -8,7 +8,10 @@
 
 #include <uapi/ethosn_shared.h>
 
-#include <map>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
 #include <string>
 #include <vector>
 
@@ -16,10 +19,6 @@ namespace ethosn
 {
 namespace driver_library
 {
-
-class Buffer;
-class Inference;
-
 namespace profiling
 {
 
@@ -42,24 +41,64 @@ inline uint64_t CreateCounterValue(uint64_t counterValue)
 Configuration GetConfigFromString(const char* str);
 
 extern Configuration g_CurrentConfiguration;
-extern std::vector<ProfilingEntry> g_ProfilingEntries;
-extern uint64_t g_NextTimelineEventId;
 
-extern std::map<Buffer*, uint64_t> g_BufferToLifetimeEventId;
-extern std::map<Inference*, uint64_t> g_InferenceToLifetimeEventId;
+/// Number of Buffer and Inference objects whose lifetime start event has been recorded, but not their end event.
+extern std::atomic<uint64_t> g_NumLiveBuffers;
+extern std::atomic<uint64_t> g_NumLiveInferences;
 
 /// If set, automatically dump profiling entries and counters to this file after each inference.
 /// Set by the environment variable parsed in GetDefaultConfiguration().
 extern std::string g_DumpFile;
 
+/// Hardware counter sampling interval given to SetHwCounterSamplingInterval(), or set by the environment variable
+/// parsed in GetDefaultConfiguration().
+extern uint32_t g_HwCounterSamplingInterval;
+
+/// Format of g_DumpFile.
+enum class DumpFormat
+{
+    /// JSON array of the ProfilingEntry fields, as written by DumpProfilingData.
+    Json,
+    /// Chrome trace event format, which can be opened by chrome://tracing and Perfetto.
+    Chrome,
+    /// Compact fixed-size records (see ProfilingDumpWriter).
+    Binary,
+};
+extern DumpFormat g_DumpFormat;
+
 /// ProfilingInternal functions
 /// @{
 uint64_t GetNextTimeLineEventId();
-template <typename T>
-void RecordLifetimeEvent(T* object,
-                         std::map<T*, uint64_t>& objectToLifetimeEventId,
-                         profiling::ProfilingEntry::Type type,
-                         profiling::ProfilingEntry::MetadataCategory category)
+
+/// Returns true if the given id was allocated since profiling was last disabled.
+/// Ids allocated before then belong to entries which have since been discarded.
+bool IsCurrentTimeLineEventId(uint64_t id);
+
+/// Appends an entry to the calling thread's profiling buffer.
+/// This doesn't take any locks, unless the buffer has filled up since the entries were last collected.
+void RecordProfilingEntry(const ProfilingEntry& entry);
+
+/// Appends entries which didn't come from the driver library itself (e.g. from the firmware) to the collected
+/// entries, after any recorded so far.
+void AppendProfilingEntries(const std::vector<ProfilingEntry>& entries);
+
+/// Maximum number of entries kept for ReportNewProfilingData. Once there are more than this, the oldest are
+/// discarded (down to half this many), so that memory doesn't grow without bound if it is never called.
+constexpr size_t g_MaxCollectedEntries = 1 << 20;
+
+/// Returns all the entries recorded since the last call to ReportNewProfilingData, without removing them.
+std::vector<ProfilingEntry> PeekProfilingEntries();
+
+/// Returns the entries recorded since the last call, if g_DumpFile is set.
+/// This is independent of ReportNewProfilingData, so each entry is returned by both.
+std::vector<ProfilingEntry> TakeProfilingEntriesToDump();
+
+/// Records the start or end of the lifetime of an object (e.g. a Buffer) which holds the id of its lifetime event
+/// in lifetimeEventId. This is zero for objects created while profiling was disabled, which don't get an end event.
+inline void RecordLifetimeEvent(uint64_t& lifetimeEventId,
+                                std::atomic<uint64_t>& numLiveObjects,
+                                profiling::ProfilingEntry::Type type,
+                                profiling::ProfilingEntry::MetadataCategory category)
 {
     using namespace std::chrono;
     using namespace profiling;
@@ -67,29 +106,25 @@ void RecordLifetimeEvent(T* object,
     ProfilingEntry entry;
     entry.m_Timestamp = timestamp;
     entry.m_Type      = type;
-    uint64_t id;
     if (type == ProfilingEntry::Type::TimelineEventStart)
     {
-        id                              = g_NextTimelineEventId;
-        objectToLifetimeEventId[object] = id;
-        GetNextTimeLineEventId();
+        lifetimeEventId = GetNextTimeLineEventId();
+        numLiveObjects.fetch_add(1, std::memory_order_relaxed);
     }
     else
     {
         assert(type == ProfilingEntry::Type::TimelineEventEnd);
-        auto it = objectToLifetimeEventId.find(object);
-        if (it == objectToLifetimeEventId.end())
+        if (lifetimeEventId == 0 || !IsCurrentTimeLineEventId(lifetimeEventId))
         {
             // If the profiling was enabled after creating this object then no event should be registered.
             return;
         }
-        id = it->second;
-        objectToLifetimeEventId.erase(it);
+        numLiveObjects.fetch_sub(1, std::memory_order_relaxed);
     }
-    entry.m_Id               = id;
+    entry.m_Id               = lifetimeEventId;
     entry.m_MetadataCategory = category;
     entry.m_MetadataValue    = 0;
-    g_ProfilingEntries.push_back(entry);
+    RecordProfilingEntry(entry);
 }
 /// @}
 
@@ -97,6 +132,7 @@ void RecordLifetimeEvent(T* object,
 /// in either KmodProfiling.cpp or NullKmodProfiling.cpp.
 /// @{
 bool ConfigureKernelDriver(Configuration config);
+bool SetKernelDriverHwCounterSamplingInterval(uint32_t interval);
 uint64_t GetKernelDriverCounterValue(PollCounterName counter);
 /// Append all entries reported by the kernel driver to the given vector.
 bool AppendKernelDriverEntries();
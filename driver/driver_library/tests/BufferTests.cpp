@@ -8,8 +8,13 @@
 #include "../src/Utils.hpp"
 #include <catch.hpp>
 
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
 
 using namespace ethosn::driver_library;
 
@@ -51,3 +56,84 @@ TEST_CASE("BufferDescriptor")
     REQUIRE(test_buffer.GetDataFormat() == DataFormat::NHWC);
     REQUIRE(std::memcmp(test_buffer.GetMappedBuffer(), test_src, buf_size) == 0);
 }
+
+TEST_CASE("BufferImportCopy")
+{
+    uint8_t test_src[] = "This is a test source data";
+
+    // Copy mode behaves like the plain source constructor
+    Buffer test_buffer(test_src, sizeof(test_src), DataFormat::NHWC, ImportMode::Copy);
+
+    REQUIRE(test_buffer.GetSize() == sizeof(test_src));
+    REQUIRE(test_buffer.GetMappedBuffer() != test_src);
+    REQUIRE(std::memcmp(test_buffer.GetMappedBuffer(), test_src, sizeof(test_src)) == 0);
+}
+
+TEST_CASE("BufferImportUserMemory")
+{
+    const uint32_t pageSize = static_cast<uint32_t>(sysconf(_SC_PAGESIZE));
+    const uint32_t bufSize  = 2 * pageSize;
+    std::unique_ptr<uint8_t, decltype(&std::free)> src(static_cast<uint8_t*>(aligned_alloc(pageSize, bufSize)),
+                                                         &std::free);
+    REQUIRE(src != nullptr);
+    std::memset(src.get(), 0xA5, bufSize);
+
+    // Create a buffer which wraps the caller's memory in place
+    Buffer test_buffer(src.get(), bufSize, DataFormat::NHWCB, ImportMode::ZeroCopy);
+
+    REQUIRE(test_buffer.GetSize() == bufSize);
+    REQUIRE(test_buffer.GetDataFormat() == DataFormat::NHWCB);
+    REQUIRE(test_buffer.GetMappedBuffer() == src.get());
+
+    // Writes through the original pointer are visible through the buffer, as there is no copy
+    src.get()[bufSize - 1] = 0x5A;
+    REQUIRE(test_buffer.GetMappedBuffer()[bufSize - 1] == 0x5A);
+}
+
+#if defined(TARGET_KMOD)
+
+TEST_CASE("BufferImportUnalignedUserMemory")
+{
+    const uint32_t pageSize = static_cast<uint32_t>(sysconf(_SC_PAGESIZE));
+    std::unique_ptr<uint8_t, decltype(&std::free)> src(static_cast<uint8_t*>(aligned_alloc(pageSize, 2 * pageSize)),
+                                                         &std::free);
+    REQUIRE(src != nullptr);
+
+    // Only whole pages can be imported
+    REQUIRE_THROWS_AS(Buffer(src.get() + 1, pageSize, DataFormat::NHWC, ImportMode::ZeroCopy), std::runtime_error);
+}
+
+TEST_CASE("BufferImportInvalidDmaBuf")
+{
+    REQUIRE_THROWS_AS(Buffer::FromDmaBuf(-1, 1024, DataFormat::NHWC), std::runtime_error);
+}
+
+#else
+
+TEST_CASE("BufferImportDmaBuf")
+{
+    const uint32_t pageSize = static_cast<uint32_t>(sysconf(_SC_PAGESIZE));
+
+    // Any mappable file stands in for a dma-buf on the host backends
+    int fd = memfd_create("BufferImportDmaBuf", 0);
+    REQUIRE(fd >= 0);
+    REQUIRE(ftruncate(fd, pageSize) == 0);
+    uint8_t* shared = static_cast<uint8_t*>(mmap(nullptr, pageSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+    REQUIRE(shared != MAP_FAILED);
+
+    std::unique_ptr<Buffer> test_buffer = Buffer::FromDmaBuf(fd, pageSize, DataFormat::NHWC);
+    // The buffer holds its own reference
+    close(fd);
+
+    REQUIRE(test_buffer->GetSize() == pageSize);
+
+    // Writes through either mapping are visible through the other, as there is no copy
+    shared[0] = 0x5A;
+    REQUIRE(test_buffer->GetMappedBuffer()[0] == 0x5A);
+    test_buffer->GetMappedBuffer()[pageSize - 1] = 0xA5;
+    REQUIRE(shared[pageSize - 1] == 0xA5);
+
+    munmap(shared, pageSize);
+}
+
+#endif
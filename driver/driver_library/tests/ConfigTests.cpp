@@ -1,5 +1,5 @@
 //
-// Copyright © 2018-2020 Arm Limited. All rights reserved.
+// Copyright © 2018-2021 Arm Limited. All rights reserved.
 // SPDX-License-Identifier: Apache-2.0
 //
 
@@ -21,6 +21,20 @@ TEST_CASE("GetConfigFromString hardware counters")
     REQUIRE(config.m_NumHardwareCounters == 2);
     REQUIRE(config.m_HardwareCounters[0] == HardwareCounters::FirmwareBusAccessRdTransfers);
     REQUIRE(config.m_HardwareCounters[1] == HardwareCounters::FirmwareBusReadBeats);
+    REQUIRE(g_HwCounterSamplingInterval == 0);
+}
+
+TEST_CASE("GetConfigFromString hardware counter sampling")
+{
+    using namespace profiling;
+    auto configString = "hwCounters=busReadBeats,busWriteBeats hwCounterSamplingInterval=16";
+
+    auto config = GetConfigFromString(configString);
+
+    // The interval isn't part of the Configuration, it is applied separately
+    REQUIRE(config.m_NumHardwareCounters == 2);
+    REQUIRE(g_HwCounterSamplingInterval == 16);
+    g_HwCounterSamplingInterval = 0;
 }
 
 TEST_CASE("GetConfigFromString hardware counters > 6")
@@ -34,3 +48,18 @@ TEST_CASE("GetConfigFromString hardware counters > 6")
     REQUIRE(config.m_EnableProfiling == true);
     REQUIRE(config.m_NumHardwareCounters == 0);
 }
+
+TEST_CASE("GetConfigFromString dump file")
+{
+    using namespace profiling;
+    auto configString = "dumpFile=trace.json dumpFormat=chrome";
+
+    auto config = GetConfigFromString(configString);
+
+    REQUIRE(config.m_EnableProfiling == true);
+    REQUIRE(g_DumpFile == "trace.json");
+    REQUIRE(g_DumpFormat == DumpFormat::Chrome);
+
+    g_DumpFile   = "";
+    g_DumpFormat = DumpFormat::Json;
+}
@@ -4,12 +4,29 @@
 //
 
 #include "../include/ethosn_driver_library/Network.hpp"
+#include "../src/FirmwareProfilingRing.hpp"
 #include "../src/KmodNetwork.hpp"
+#include "../src/ProfilingInternal.hpp"
+#include "../src/Utils.hpp"
 
 #include <uapi/ethosn.h>
 
 #include <catch.hpp>
 
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <poll.h>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
 using namespace ethosn::driver_library;
 
 TEST_CASE("TestVersionMismatch")
@@ -48,3 +65,171 @@ TEST_CASE("TestVersionMatch")
         }
     }
 }
+
+TEST_CASE("ConvertHwCounterSummary orders the recent inferences")
+{
+    ethosn_hw_counter_summary kernelSummary = {};
+    kernelSummary.num_inferences            = ETHOSN_HW_COUNTER_RECENT_INFERENCES + 3;
+    kernelSummary.totals[BUS_READ_BEATS]    = 1000;
+    for (uint64_t i = 0; i < kernelSummary.num_inferences; ++i)
+    {
+        // Later inferences overwrite the oldest ones, as the kernel does
+        ethosn_hw_counter_inference& inference = kernelSummary.recent[i % ETHOSN_HW_COUNTER_RECENT_INFERENCES];
+        inference.completed_ns                 = i;
+        inference.values[BUS_READ_BEATS]       = 10 * i;
+    }
+
+    const HardwareCounterSummary summary = ConvertHwCounterSummary(kernelSummary);
+
+    const size_t readBeats = static_cast<size_t>(profiling::HardwareCounters::FirmwareBusReadBeats);
+    REQUIRE(summary.m_NumInferences == ETHOSN_HW_COUNTER_RECENT_INFERENCES + 3);
+    REQUIRE(summary.m_Counters[readBeats].m_Total == 1000);
+    REQUIRE(summary.m_RecentInferences.size() == ETHOSN_HW_COUNTER_RECENT_INFERENCES);
+    for (size_t i = 0; i < summary.m_RecentInferences.size(); ++i)
+    {
+        REQUIRE(summary.m_RecentInferences[i].m_CompletedNs == i + 3);
+        REQUIRE(summary.m_RecentInferences[i].m_Values[readBeats] == 10 * (i + 3));
+    }
+
+    // Before the kernel has gone round its entries, only those filled in are returned
+    ethosn_hw_counter_summary fewSummary = {};
+    fewSummary.num_inferences            = 2;
+    fewSummary.recent[1].completed_ns    = 5;
+    const HardwareCounterSummary few     = ConvertHwCounterSummary(fewSummary);
+    REQUIRE(few.m_RecentInferences.size() == 2);
+    REQUIRE(few.m_RecentInferences[1].m_CompletedNs == 5);
+}
+
+TEST_CASE("The firmware profiling buffer can be mapped")
+{
+    profiling::Configuration config;
+    config.m_EnableProfiling    = true;
+    config.m_FirmwareBufferSize = 64 * 1024;
+    REQUIRE(profiling::ConfigureKernelDriver(config));
+
+    int fd = open(ETHOSN_STRINGIZE_VALUE_OF(FIRMWARE_PROFILING_NODE), O_RDONLY);
+    REQUIRE(fd >= 0);
+
+    // The kernel module returns EAGAIN until the firmware has switched to the new buffer. Any other error means that
+    // the driver library would silently fall back to read().
+    const size_t pageSize    = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t mappingSize = (config.m_FirmwareBufferSize + pageSize - 1) / pageSize * pageSize;
+    void* address            = MAP_FAILED;
+    for (int attempt = 0; attempt < 100 && address == MAP_FAILED; ++attempt)
+    {
+        address = mmap(nullptr, mappingSize, PROT_READ, MAP_SHARED, fd, 0);
+        if (address == MAP_FAILED)
+        {
+            REQUIRE(errno == EAGAIN);
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    REQUIRE(address != MAP_FAILED);
+
+    // The mapping is of the live buffer, which can be read in place
+    profiling::FirmwareProfilingRing ring(address, config.m_FirmwareBufferSize);
+    std::vector<ethosn_profiling_entry> entries;
+    REQUIRE(ring.ReadNewEntries(entries));
+
+    munmap(address, mappingSize);
+    close(fd);
+
+    config.m_EnableProfiling = false;
+    REQUIRE(profiling::ConfigureKernelDriver(config));
+}
+
+namespace
+{
+
+void WaitForInference(int fd)
+{
+    struct pollfd fds = {};
+    fds.fd            = fd;
+    fds.events        = POLLIN;
+    REQUIRE(poll(&fds, 1, 60 * 1000) == 1);
+
+    int32_t status = -1;
+    REQUIRE(read(fd, &status, sizeof(status)) == sizeof(status));
+    REQUIRE(status == static_cast<int32_t>(InferenceResult::Completed));
+}
+
+}    // namespace
+
+// Compares the time it takes to hand a network to the kernel repeatedly on the same buffers with ScheduleInference and
+// with a BoundInference. The compiled network to run is read from the file given by ETHOSN_BENCHMARK_NETWORK, and a
+// small network keeps the runs between the timed calls short.
+TEST_CASE("BoundInference trigger overhead", "[.benchmark]")
+{
+    const char* const networkPath = std::getenv("ETHOSN_BENCHMARK_NETWORK");
+    if (networkPath == nullptr)
+    {
+        WARN("ETHOSN_BENCHMARK_NETWORK is not set, skipping");
+        return;
+    }
+
+    std::ifstream file(networkPath, std::ios::binary);
+    REQUIRE(file.good());
+    const std::vector<char> compiledNetwork((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    const CompiledNetworkInfo info = DeserializeCompiledNetwork(compiledNetwork.data(), compiledNetwork.size());
+
+    std::vector<std::unique_ptr<Buffer>> buffers;
+    std::vector<Buffer*> inputs;
+    std::vector<Buffer*> outputs;
+    for (const BufferInfo& bufferInfo : info.m_InputBufferInfos)
+    {
+        buffers.push_back(std::make_unique<Buffer>(bufferInfo.m_Size, DataFormat::NHWC));
+        inputs.push_back(buffers.back().get());
+    }
+    for (const BufferInfo& bufferInfo : info.m_OutputBufferInfos)
+    {
+        buffers.push_back(std::make_unique<Buffer>(bufferInfo.m_Size, DataFormat::NHWC));
+        outputs.push_back(buffers.back().get());
+    }
+
+    Network network(compiledNetwork.data(), compiledNetwork.size());
+
+    constexpr uint32_t numIterations = 1000;
+    using Clock                      = std::chrono::steady_clock;
+
+    // Only the calls which hand the inference to the kernel are timed, up to their ioctl returning. Waiting for the
+    // inference and closing it are left out, as they cost the same for both and would hide the difference.
+    Clock::duration scheduleTime = Clock::duration::zero();
+    for (uint32_t i = 0; i < numIterations; ++i)
+    {
+        const Clock::time_point start = Clock::now();
+        std::unique_ptr<Inference> inference(network.ScheduleInference(inputs.data(),
+                                                                       static_cast<uint32_t>(inputs.size()),
+                                                                       outputs.data(),
+                                                                       static_cast<uint32_t>(outputs.size())));
+        scheduleTime += Clock::now() - start;
+        WaitForInference(inference->GetFileDescriptor());
+    }
+
+    std::unique_ptr<BoundInference> bound(network.BindInference(
+        inputs.data(), static_cast<uint32_t>(inputs.size()), outputs.data(), static_cast<uint32_t>(outputs.size())));
+
+    Clock::duration triggerTime = Clock::duration::zero();
+    for (uint32_t i = 0; i < numIterations; ++i)
+    {
+        const Clock::time_point start = Clock::now();
+        bound->Trigger();
+        triggerTime += Clock::now() - start;
+        WaitForInference(bound->GetFileDescriptor());
+    }
+
+    using Micros = std::chrono::duration<double, std::micro>;
+    std::cout << "ScheduleInference: " << Micros(scheduleTime).count() / numIterations << " us/call" << std::endl;
+    std::cout << "BoundInference::Trigger: " << Micros(triggerTime).count() / numIterations << " us/call" << std::endl;
+
+    // Every inference run above has been recorded by the kernel
+    const InferenceLatencyStats stats = network.GetInferenceLatencyStats();
+    REQUIRE(stats.m_QueueWait.m_Count == 2 * numIterations);
+    REQUIRE(stats.m_Execution.m_Count == 2 * numIterations);
+    REQUIRE(stats.m_CompletionToWake.m_Count == 2 * numIterations);
+    auto meanUs = [](const LatencyHistogram& histogram) {
+        return static_cast<double>(histogram.m_SumNs) / 1000.0 / static_cast<double>(histogram.m_Count);
+    };
+    std::cout << "Queue wait: " << meanUs(stats.m_QueueWait) << " us/inference, execution: "
+              << meanUs(stats.m_Execution) << " us/inference, completion to wake: " << meanUs(stats.m_CompletionToWake)
+              << " us/inference" << std::endl;
+}
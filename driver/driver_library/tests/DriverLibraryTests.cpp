@@ -7,6 +7,12 @@
 #include "../src/NetworkImpl.hpp"
 
 #include <catch.hpp>
+#include <ethosn_support_library/Support.hpp>
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <unistd.h>
 
 using namespace ethosn::driver_library;
 
@@ -252,3 +258,134 @@ TEST_CASE("DeserializeCompiledNetwork Errors")
         }
     }
 }
+
+TEST_CASE("DeserializeCompiledNetwork of a network serialized by the Support Library")
+{
+    namespace sl = ethosn::support_library;
+
+    GIVEN("A compiled network serialized by the Support Library")
+    {
+        std::shared_ptr<sl::Network> network =
+            sl::CreateNetwork(sl::GetFwAndHwCapabilities(sl::EthosNVariant::ETHOS_N77));
+        std::shared_ptr<sl::Operand> input =
+            sl::AddInput(network, sl::TensorInfo({ 1, 16, 16, 16 }, sl::DataType::UINT8_QUANTIZED,
+                                                 sl::DataFormat::NHWC, sl::QuantizationInfo(0, 1.0f)))
+                .tensor;
+        std::shared_ptr<sl::Operand> leakyRelu =
+            sl::AddLeakyRelu(network, *input, sl::LeakyReluInfo(0.1f, sl::QuantizationInfo(0, 1.0f))).tensor;
+        sl::AddOutput(network, *leakyRelu);
+
+        std::vector<std::unique_ptr<sl::CompiledNetwork>> compiledNetworks =
+            sl::Compile(*network, sl::CompilationOptions());
+        REQUIRE(compiledNetworks.size() == 1);
+        std::stringstream stream;
+        compiledNetworks[0]->Serialize(stream);
+        REQUIRE(stream.good());
+        const std::string serialized = stream.str();
+
+        WHEN("Calling DeserializeCompiledNetwork")
+        {
+            const CompiledNetworkInfo compiledNetwork =
+                DeserializeCompiledNetwork(serialized.data(), serialized.size());
+
+            THEN("The result describes the same network")
+            {
+                // Any Driver Library must be able to read what the Support Library writes
+                REQUIRE(serialized.compare(4, 4, std::string("\x01\x00\x00\x00", 4)) == 0);
+
+                const std::vector<sl::InputBufferInfo>& inputs   = compiledNetworks[0]->GetInputBufferInfos();
+                const std::vector<sl::OutputBufferInfo>& outputs = compiledNetworks[0]->GetOutputBufferInfos();
+                REQUIRE(compiledNetwork.m_InputBufferInfos.size() == inputs.size());
+                REQUIRE(compiledNetwork.m_InputBufferInfos[0].m_Size == inputs[0].m_Size);
+                REQUIRE(compiledNetwork.m_OutputBufferInfos.size() == outputs.size());
+                REQUIRE(compiledNetwork.m_OutputBufferInfos[0].m_Size == outputs[0].m_Size);
+
+                // The command stream is the first constant control unit data buffer, and must lie within the data
+                REQUIRE(!compiledNetwork.m_ConstantControlUnitDataBufferInfos.empty());
+                const BufferInfo& commandStream = compiledNetwork.m_ConstantControlUnitDataBufferInfos[0];
+                REQUIRE(commandStream.m_Offset + commandStream.m_Size <= compiledNetwork.m_ConstantControlUnitDataSize);
+                REQUIRE(compiledNetwork.m_ConstantControlUnitDataOffset +
+                            compiledNetwork.m_ConstantControlUnitDataSize <=
+                        serialized.size());
+                for (const BufferInfo& buffer : compiledNetwork.m_ConstantDmaDataBufferInfos)
+                {
+                    REQUIRE(buffer.m_Offset + buffer.m_Size <= compiledNetwork.m_ConstantDmaDataSize);
+                }
+
+                // The digests which let the kernel share constant data are calculated when compiling
+                const std::array<uint64_t, 2> noDigest = {};
+                REQUIRE(compiledNetwork.m_ConstantDmaDataDigest != noDigest);
+                REQUIRE(compiledNetwork.m_ConstantControlUnitDataDigest != noDigest);
+                REQUIRE(compiledNetwork.m_ConstantDmaDataDigest != compiledNetwork.m_ConstantControlUnitDataDigest);
+            }
+        }
+    }
+}
+
+TEST_CASE("MappedFile")
+{
+    const std::string path = "MappedFileTest" + std::to_string(getpid()) + ".bin";
+    const std::string contents(10000, 'x');
+    {
+        FILE* file = fopen(path.c_str(), "wb");
+        REQUIRE(file != nullptr);
+        REQUIRE(fwrite(contents.data(), 1, contents.size(), file) == contents.size());
+        fclose(file);
+    }
+
+    {
+        MappedFile mappedFile(path.c_str());
+        REQUIRE(std::string(mappedFile.GetData(), mappedFile.GetSize()) == contents);
+    }
+    remove(path.c_str());
+
+    REQUIRE_THROWS_AS(MappedFile(path.c_str()), std::runtime_error);
+}
+
+TEST_CASE("InferenceBatch GetResults")
+{
+    // Simulate the statuses the kernel reports for a batch of three inferences
+    const int32_t statuses[] = { static_cast<int32_t>(InferenceResult::Completed),
+                                 static_cast<int32_t>(InferenceResult::Running),
+                                 static_cast<int32_t>(InferenceResult::Error) };
+    FILE* tempFile           = std::tmpfile();
+    REQUIRE(tempFile != nullptr);
+    REQUIRE(fwrite(statuses, sizeof(statuses[0]), 3, tempFile) == 3);
+    fflush(tempFile);
+
+    InferenceBatch batch(dup(fileno(tempFile)), 3);
+    fclose(tempFile);
+
+    REQUIRE(batch.GetNumInferences() == 3);
+
+    // Reading the results twice returns the same statuses
+    for (int i = 0; i < 2; ++i)
+    {
+        std::vector<InferenceResult> results = batch.GetResults();
+        REQUIRE(results == std::vector<InferenceResult>{ InferenceResult::Completed, InferenceResult::Running,
+                                                         InferenceResult::Error });
+    }
+}
+
+TEST_CASE("BoundInference Trigger")
+{
+    // Simulate the status the kernel reports for a bound inference which has completed
+    const int32_t completed = static_cast<int32_t>(InferenceResult::Completed);
+    FILE* tempFile          = std::tmpfile();
+    REQUIRE(tempFile != nullptr);
+    REQUIRE(fwrite(&completed, sizeof(completed), 1, tempFile) == 1);
+    fflush(tempFile);
+
+    BoundInference inference(std::make_unique<BoundInferenceImpl>(dup(fileno(tempFile))));
+    fclose(tempFile);
+
+    // The status can be read again after each trigger
+    for (int i = 0; i < 2; ++i)
+    {
+        inference.Trigger();
+
+        int32_t status = -1;
+        REQUIRE(read(inference.GetFileDescriptor(), &status, sizeof(status)) == sizeof(status));
+        REQUIRE(status == completed);
+    }
+}
@@ -0,0 +1,329 @@
+//
+// Copyright © 2021 Arm Limited.
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "../include/ethosn_driver_library/Profiling.hpp"
+#include "../src/DumpProfiling.hpp"
+#include "../src/FirmwareProfilingRing.hpp"
+#include "../src/ProfilingInternal.hpp"
+
+#include <catch.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+
+using namespace ethosn::driver_library;
+using namespace ethosn::driver_library::profiling;
+
+namespace
+{
+
+ProfilingEntry CreateEntry(ProfilingEntry::Type type, uint64_t id, uint64_t timestampNs)
+{
+    ProfilingEntry entry;
+    entry.m_Timestamp = std::chrono::time_point<std::chrono::high_resolution_clock>(
+        std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(
+            std::chrono::nanoseconds(timestampNs)));
+    entry.m_Type             = type;
+    entry.m_Id               = id;
+    entry.m_MetadataCategory = ProfilingEntry::MetadataCategory::InferenceLifetime;
+    entry.m_MetadataValue    = 0;
+    return entry;
+}
+
+std::string ReadFile(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream ss;
+    ss << file.rdbuf();
+    return ss.str();
+}
+
+/// Stands in for the firmware, writing entries into a buffer laid out like its profiling buffer.
+class FakeFirmwareBuffer
+{
+public:
+    explicit FakeFirmwareBuffer(uint32_t numEntries)
+        : m_NumEntries(numEntries)
+        , m_Data(ETHOSN_PROFILING_BUFFER_ENTRIES_OFFSET + numEntries * sizeof(ethosn_profiling_entry))
+        , m_NextTimestamp(1)
+    {}
+
+    void Write(uint32_t numEntries)
+    {
+        for (uint32_t i = 0; i < numEntries; ++i)
+        {
+            uint32_t writeIndex;
+            memcpy(&writeIndex, m_Data.data(), sizeof(writeIndex));
+            ethosn_profiling_entry entry = {};
+            entry.timestamp              = m_NextTimestamp++;
+            memcpy(&m_Data[ETHOSN_PROFILING_BUFFER_ENTRIES_OFFSET + writeIndex * sizeof(entry)], &entry,
+                   sizeof(entry));
+            writeIndex = (writeIndex + 1) % m_NumEntries;
+            memcpy(m_Data.data(), &writeIndex, sizeof(writeIndex));
+        }
+    }
+
+    const void* GetData() const
+    {
+        return m_Data.data();
+    }
+
+    size_t GetSize() const
+    {
+        return m_Data.size();
+    }
+
+private:
+    uint32_t m_NumEntries;
+    std::vector<uint8_t> m_Data;
+    uint64_t m_NextTimestamp;
+};
+
+std::vector<uint64_t> GetTimestamps(const std::vector<ethosn_profiling_entry>& entries)
+{
+    std::vector<uint64_t> timestamps;
+    for (const ethosn_profiling_entry& entry : entries)
+    {
+        timestamps.push_back(entry.timestamp);
+    }
+    return timestamps;
+}
+
+}    // namespace
+
+TEST_CASE("FirmwareProfilingRing")
+{
+    FakeFirmwareBuffer firmware(8);
+    FirmwareProfilingRing ring(firmware.GetData(), firmware.GetSize());
+    std::vector<ethosn_profiling_entry> entries;
+
+    REQUIRE(ring.ReadNewEntries(entries));
+    REQUIRE(entries.empty());
+
+    firmware.Write(3);
+    REQUIRE(ring.ReadNewEntries(entries));
+    REQUIRE(GetTimestamps(entries) == std::vector<uint64_t>{ 1, 2, 3 });
+
+    SECTION("Wraparound")
+    {
+        firmware.Write(7);
+        REQUIRE(ring.ReadNewEntries(entries));
+        REQUIRE(GetTimestamps(entries) == std::vector<uint64_t>{ 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 });
+        REQUIRE(ring.ReadNewEntries(entries));
+        REQUIRE(entries.size() == 10);
+    }
+
+    SECTION("Overrun")
+    {
+        // The firmware laps the reader, so only the most recent buffer's worth of entries are left
+        firmware.Write(10);
+        REQUIRE_FALSE(ring.ReadNewEntries(entries));
+        REQUIRE(GetTimestamps(entries) == std::vector<uint64_t>{ 1, 2, 3, 6, 7, 8, 9, 10, 11, 12, 13 });
+
+        // Reading carries on normally afterwards
+        firmware.Write(2);
+        REQUIRE(ring.ReadNewEntries(entries));
+        REQUIRE(GetTimestamps(entries).back() == 15);
+        REQUIRE(entries.size() == 13);
+    }
+}
+
+TEST_CASE("FirmwareProfilingRing created after the firmware has wrapped around")
+{
+    // Nothing had been read yet, so nothing has been lost
+    FakeFirmwareBuffer firmware(8);
+    firmware.Write(10);
+    FirmwareProfilingRing ring(firmware.GetData(), firmware.GetSize());
+    std::vector<ethosn_profiling_entry> entries;
+
+    REQUIRE(ring.ReadNewEntries(entries));
+    REQUIRE(GetTimestamps(entries) == std::vector<uint64_t>{ 3, 4, 5, 6, 7, 8, 9, 10 });
+
+    // Later overruns are still detected
+    firmware.Write(9);
+    REQUIRE_FALSE(ring.ReadNewEntries(entries));
+    REQUIRE(GetTimestamps(entries).back() == 19);
+}
+
+TEST_CASE("Profiling entries recorded by several threads")
+{
+    // Discard anything recorded by previous tests
+    ReportNewProfilingData();
+
+    // More than fit in each thread's ring, so that some of them overflow
+    constexpr uint64_t numThreads          = 4;
+    constexpr uint64_t numEntriesPerThread = 3000;
+
+    std::vector<std::thread> threads;
+    for (uint64_t t = 0; t < numThreads; ++t)
+    {
+        threads.emplace_back([t]() {
+            for (uint64_t i = 0; i < numEntriesPerThread; ++i)
+            {
+                ProfilingEntry entry;
+                entry.m_Timestamp        = std::chrono::high_resolution_clock::now();
+                entry.m_Type             = ProfilingEntry::Type::TimelineEventInstant;
+                entry.m_Id               = t * numEntriesPerThread + i;
+                entry.m_MetadataCategory = ProfilingEntry::MetadataCategory::BufferLifetime;
+                entry.m_MetadataValue    = 0;
+                RecordProfilingEntry(entry);
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    // The entries of threads which have exited are still reported, merged in timestamp order.
+    std::vector<ProfilingEntry> entries = ReportNewProfilingData();
+    REQUIRE(entries.size() == numThreads * numEntriesPerThread);
+    REQUIRE(std::is_sorted(entries.begin(), entries.end(), [](const ProfilingEntry& a, const ProfilingEntry& b) {
+        return a.m_Timestamp < b.m_Timestamp;
+    }));
+
+    // Each thread's entries are in the order they were recorded
+    std::vector<uint64_t> nextIds(numThreads);
+    for (uint64_t t = 0; t < numThreads; ++t)
+    {
+        nextIds[t] = t * numEntriesPerThread;
+    }
+    for (const ProfilingEntry& entry : entries)
+    {
+        uint64_t& nextId = nextIds[entry.m_Id / numEntriesPerThread];
+        REQUIRE(entry.m_Id == nextId);
+        ++nextId;
+    }
+
+    REQUIRE(ReportNewProfilingData().empty());
+}
+
+TEST_CASE("Profiling lifetime events")
+{
+    ReportNewProfilingData();
+
+    std::atomic<uint64_t> numLiveObjects{ 0 };
+    uint64_t lifetimeEventId = 0;
+    RecordLifetimeEvent(lifetimeEventId, numLiveObjects, ProfilingEntry::Type::TimelineEventStart,
+                        ProfilingEntry::MetadataCategory::BufferLifetime);
+    REQUIRE(lifetimeEventId >= g_DriverLibraryEventIdBase);
+    REQUIRE(numLiveObjects == 1);
+
+    // An object created while profiling was disabled doesn't get an end event
+    uint64_t otherLifetimeEventId = 0;
+    RecordLifetimeEvent(otherLifetimeEventId, numLiveObjects, ProfilingEntry::Type::TimelineEventEnd,
+                        ProfilingEntry::MetadataCategory::BufferLifetime);
+    REQUIRE(numLiveObjects == 1);
+
+    RecordLifetimeEvent(lifetimeEventId, numLiveObjects, ProfilingEntry::Type::TimelineEventEnd,
+                        ProfilingEntry::MetadataCategory::BufferLifetime);
+    REQUIRE(numLiveObjects == 0);
+
+    std::vector<ProfilingEntry> entries = ReportNewProfilingData();
+    REQUIRE(entries.size() == 2);
+    REQUIRE(entries[0].m_Type == ProfilingEntry::Type::TimelineEventStart);
+    REQUIRE(entries[0].m_Id == lifetimeEventId);
+    REQUIRE(entries[1].m_Type == ProfilingEntry::Type::TimelineEventEnd);
+    REQUIRE(entries[1].m_Id == lifetimeEventId);
+}
+
+TEST_CASE("Profiling entries are limited if they aren't reported")
+{
+    ReportNewProfilingData();
+
+    std::vector<ProfilingEntry> entries(g_MaxCollectedEntries);
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        entries[i] = CreateEntry(ProfilingEntry::Type::TimelineEventInstant, i, 0);
+    }
+    AppendProfilingEntries(entries);
+    REQUIRE(PeekProfilingEntries().size() == g_MaxCollectedEntries);
+
+    // Going over the limit discards the oldest entries
+    AppendProfilingEntries({ CreateEntry(ProfilingEntry::Type::TimelineEventInstant, g_MaxCollectedEntries, 0) });
+    std::vector<ProfilingEntry> reported = ReportNewProfilingData();
+    REQUIRE(reported.size() == g_MaxCollectedEntries / 2);
+    REQUIRE(reported.front().m_Id == g_MaxCollectedEntries / 2 + 1);
+    REQUIRE(reported.back().m_Id == g_MaxCollectedEntries);
+}
+
+TEST_CASE("ProfilingDumpWriter")
+{
+    const std::string path = "ProfilingDumpWriterTest" + std::to_string(getpid());
+    const std::vector<ProfilingEntry> first  = { CreateEntry(ProfilingEntry::Type::TimelineEventStart, 70000, 1234567),
+                                                CreateEntry(ProfilingEntry::Type::TimelineEventEnd, 70000, 2000000) };
+    const std::vector<ProfilingEntry> second = { CreateEntry(ProfilingEntry::Type::TimelineEventInstant, 3, 3000000) };
+
+    SECTION("Json")
+    {
+        {
+            ProfilingDumpWriter writer(path, DumpFormat::Json);
+            writer.Write(first);
+            writer.Write(second);
+        }
+        // The streamed file is the same as dumping all the entries at once
+        std::vector<ProfilingEntry> all = first;
+        all.insert(all.end(), second.begin(), second.end());
+        std::stringstream expected;
+        DumpProfilingData(all, expected);
+        REQUIRE(ReadFile(path) == expected.str());
+    }
+
+    SECTION("Chrome")
+    {
+        ProfilingDumpWriter writer(path, DumpFormat::Chrome);
+        // The file is a complete (empty) array before anything is written
+        writer.Flush();
+        REQUIRE(ReadFile(path) == "[\n\n]\n");
+
+        writer.Write(first);
+        // Entries are appended as they are written, without waiting for the writer to be destroyed, and the array
+        // is closed after them
+        writer.Flush();
+        const std::string entries = "[\n"
+                                    R"({"name": "InferenceLifetime", "cat": "ethosn", "pid": 0, "tid": 0, )"
+                                    R"("ts": 1234.567, "ph": "b", "id": 70000, "args": {"metadata_value": 0}},)"
+                                    "\n"
+                                    R"({"name": "InferenceLifetime", "cat": "ethosn", "pid": 0, "tid": 0, )"
+                                    R"("ts": 2000.000, "ph": "e", "id": 70000})";
+        REQUIRE(ReadFile(path) == entries + "\n]\n");
+
+        // The next entries are written over the end of the array
+        writer.Write(second);
+        writer.Flush();
+        const std::string contents = ReadFile(path);
+        REQUIRE(contents.substr(0, entries.size() + 2) == entries + ",\n");
+        REQUIRE(contents.substr(contents.size() - 3) == "\n]\n");
+        REQUIRE(std::count(contents.begin(), contents.end(), ']') == 1);
+    }
+
+    SECTION("Binary")
+    {
+        {
+            ProfilingDumpWriter writer(path, DumpFormat::Binary);
+            writer.Write(first);
+            writer.Write(second);
+        }
+        const std::string contents = ReadFile(path);
+        REQUIRE(contents.size() == 12 + 3 * 32);
+        REQUIRE(contents.substr(0, 4) == "ENPD");
+
+        int64_t timestamp;
+        uint64_t id;
+        memcpy(&timestamp, &contents[12], sizeof(timestamp));
+        memcpy(&id, &contents[12 + 8], sizeof(id));
+        REQUIRE(timestamp == 1234567);
+        REQUIRE(id == 70000);
+        REQUIRE(static_cast<ProfilingEntry::Type>(contents[12 + 32 + 24]) == ProfilingEntry::Type::TimelineEventEnd);
+        REQUIRE(static_cast<ProfilingEntry::Type>(contents[12 + 64 + 24]) ==
+                ProfilingEntry::Type::TimelineEventInstant);
+    }
+
+    remove(path.c_str());
+}
@@ -24,7 +24,7 @@
 
 // Version information
 #define ETHOSN_SUPPORT_LIBRARY_VERSION_MAJOR 1
-#define ETHOSN_SUPPORT_LIBRARY_VERSION_MINOR 0
+#define ETHOSN_SUPPORT_LIBRARY_VERSION_MINOR 3
 #define ETHOSN_SUPPORT_LIBRARY_VERSION_PATCH 0
 
 namespace ethosn
@@ -54,7 +54,8 @@ struct Version
 #define COMPILER_ALGORITHM_MODE                                                                                        \
     X(Auto)                                                                                                            \
     X(CascadingOnly)                                                                                                   \
-    X(NonCascadingOnly)
+    X(NonCascadingOnly)                                                                                                \
+    X(CascadingBeamSearchOnly)
 
 #define X(value) value,
 enum class CompilerAlgorithm
@@ -107,11 +108,31 @@ struct CompilationOptions
     /// The m_CompilerAlgorithm can be used to force one approach over another as cascaded vs non cascaded.
     /// "CascadingOnly" means that the cascaded approach will be used
     /// "NonCascadingOnly" means that the non cascaded approach will be used
+    /// "CascadingBeamSearchOnly" means that the cascaded approach will be used, choosing between plans with a
+    ///                           beam search rather than by growing and pruning combinations. This scales better
+    ///                           to deep networks but is not always faster, so it is never chosen automatically.
     /// "Auto" means the compiler decides to do what is best which is
     /// - for compilation: using non cascaded approach
     /// - for estimation: executing cascaded and non cascaded approach and returning
     ///                   the one which is the more performant
     CompilerAlgorithm m_CompilerAlgorithm = CompilerAlgorithm::NonCascadingOnly;
+    /// The number of threads the compiler may use for the parts of compilation which run in parallel
+    /// (currently weight encoding, and plan generation in the cascaded approach). 0 (the default) means one thread
+    /// per hardware thread, 1 means everything runs on the calling thread. The threads are created once per
+    /// compilation and shared, so this bounds the total number of threads.
+    /// The result of compilation is the same whatever this is set to.
+    uint32_t m_NumThreads = 0;
+    /// If not empty, weights encoded by the cascaded approach are saved to this directory and loaded back by later
+    /// compilations with the same weights and hardware, so that recompiling a network (or compiling networks which
+    /// share layers) doesn't need to encode those weights again. The directory may be shared between processes.
+    /// It is created if it doesn't exist, but its parent must. Nothing is ever removed from it.
+    std::string m_WeightEncoderCacheDir;
+    /// If enabled, intermediate DRAM buffers which are never needed at the same time share memory, which reduces
+    /// the memory needed by the compiled network. The firmware then has to finish with one buffer before it starts
+    /// the section which reuses its memory, so it can overlap fewer sections. Disable this to give every intermediate
+    /// buffer its own memory, e.g. so that the driver library can dump the contents of all of them after an inference
+    /// ("dump-intermediate" in ETHOSN_DRIVER_LIBRARY_DEBUG). It is always disabled when m_DebugInfo dumps anything.
+    bool m_PackIntermediateBuffers = true;
 };
 
 /// Contains options for performance estimation
@@ -0,0 +1,182 @@
+//
+// Copyright © 2018-2021 Arm Limited.
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ethosn
+{
+namespace support_library
+{
+
+/// Writes packed bitfields into a byte vector, least significant bit first.
+/// Bits are gathered in a 64-bit accumulator and stored a whole word at a time, so appending a field costs a
+/// shift and an OR rather than a loop over its bits or bytes.
+class BitstreamWriter
+{
+public:
+    explicit BitstreamWriter(uint32_t capacityBits)
+        : m_NumCommittedBytes(0)
+        , m_Pending(0)
+        , m_NumPendingBits(0)
+    {
+        m_Bitstream.reserve((capacityBits + 63) / 64 * 8);
+    }
+
+    /// Returns the current write position in the bitstream (in bits).
+    size_t GetOffset() const
+    {
+        return m_NumCommittedBytes * 8 + m_NumPendingBits;
+    }
+
+    /// Writes the low numBits bits of value (up to 64) to the end of the stream.
+    void Write(uint64_t value, uint32_t numBits)
+    {
+        assert(numBits <= 64);
+        if (numBits == 0)
+        {
+            return;
+        }
+        if (numBits < 64)
+        {
+            value &= (uint64_t{ 1 } << numBits) - 1;
+        }
+
+        // m_NumPendingBits is always less than 64, so this shift is well defined
+        m_Pending |= value << m_NumPendingBits;
+        const uint32_t total = m_NumPendingBits + numBits;
+        if (total < 64)
+        {
+            m_NumPendingBits = total;
+            return;
+        }
+
+        // The accumulator is full, so store it and keep whatever part of value didn't fit
+        CommitWord(m_Pending);
+        const uint32_t numBitsUsed = 64 - m_NumPendingBits;
+        m_Pending                  = numBitsUsed < 64 ? value >> numBitsUsed : 0;
+        m_NumPendingBits           = total - 64;
+    }
+
+    /// Writes numBits bits (up to 8) of elem into the stream, starting at the given bit offset.
+    /// The bits are ORed in, so this is intended to fill in space which was previously reserved with Reserve.
+    void Write(uint8_t elem, int numBits, size_t offset)
+    {
+        assert(numBits >= 0 && numBits <= 8);
+        if (offset + static_cast<size_t>(numBits) > GetOffset())
+        {
+            Reserve(offset + static_cast<size_t>(numBits) - GetOffset());
+        }
+
+        uint32_t bits      = elem & ((1u << numBits) - 1u);
+        uint32_t remaining = static_cast<uint32_t>(numBits);
+        // The field covers at most two bytes, each of which is either committed or still in the accumulator
+        while (remaining > 0)
+        {
+            const size_t byteIdx     = offset / 8;
+            const uint32_t bitIdx    = static_cast<uint32_t>(offset % 8);
+            const uint32_t numInByte = std::min(8 - bitIdx, remaining);
+            const uint32_t part      = bits & ((1u << numInByte) - 1u);
+            if (byteIdx < m_NumCommittedBytes)
+            {
+                m_Bitstream[byteIdx] = static_cast<uint8_t>(m_Bitstream[byteIdx] | (part << bitIdx));
+            }
+            else
+            {
+                m_Pending |= static_cast<uint64_t>(part) << (offset - m_NumCommittedBytes * 8);
+            }
+            bits >>= numInByte;
+            remaining -= numInByte;
+            offset += numInByte;
+        }
+    }
+
+    /// Writes the first numBits bits of the object pointed to by elem, as it is laid out in memory
+    /// (i.e. the bytes are taken in address order).
+    template <class T>
+    void Write(const T* elem, int numBits)
+    {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(elem);
+        while (numBits > 0)
+        {
+            const uint32_t numBitsInWord = static_cast<uint32_t>(std::min(numBits, 64));
+            uint64_t word                = 0;
+            for (uint32_t i = 0; i < (numBitsInWord + 7) / 8; ++i)
+            {
+                word |= static_cast<uint64_t>(p[i]) << (8 * i);
+            }
+            Write(word, numBitsInWord);
+            numBits -= 64;
+            p += 8;
+        }
+    }
+
+    /// Reserves space in the stream by writing 0 bits.
+    void Reserve(size_t numBits)
+    {
+        while (numBits > 0)
+        {
+            const uint32_t n = static_cast<uint32_t>(std::min<size_t>(numBits, 64));
+            Write(uint64_t{ 0 }, n);
+            numBits -= n;
+        }
+    }
+
+    /// Returns the stream as a uint8_t vector, with any unused bits of the last byte set to 0.
+    const std::vector<uint8_t>& GetBitstream()
+    {
+        // Copy out the bits which are still in the accumulator, without committing them, so that writing can continue.
+        // Calling this again without writing anything in between doesn't reallocate, so iterators stay valid.
+        const uint32_t numPendingBytes = (m_NumPendingBits + 7) / 8;
+        m_Bitstream.resize(m_NumCommittedBytes + numPendingBytes);
+        for (uint32_t i = 0; i < numPendingBytes; ++i)
+        {
+            m_Bitstream[m_NumCommittedBytes + i] = static_cast<uint8_t>(m_Pending >> (8 * i));
+        }
+        return m_Bitstream;
+    }
+
+    /// Clears the content of the stream and resets the write position.
+    void Clear()
+    {
+        m_Bitstream.clear();
+        m_NumCommittedBytes = 0;
+        m_Pending           = 0;
+        m_NumPendingBits    = 0;
+    }
+
+private:
+    void CommitWord(uint64_t word)
+    {
+        // The vector is grown ahead of the committed bytes (and trimmed by GetBitstream), so that most words
+        // are just stored. Any bytes after the committed ones are unused.
+        if (m_Bitstream.size() < m_NumCommittedBytes + 8)
+        {
+            m_Bitstream.resize(std::max<size_t>(m_Bitstream.size() * 2, m_NumCommittedBytes + 64));
+        }
+        uint8_t* dst = &m_Bitstream[m_NumCommittedBytes];
+        // Little-endian regardless of the host, which compilers turn into a single store
+        for (uint32_t i = 0; i < 8; ++i)
+        {
+            dst[i] = static_cast<uint8_t>(word >> (8 * i));
+        }
+        m_NumCommittedBytes += 8;
+    }
+
+    /// Bytes [0, m_NumCommittedBytes) hold the start of the stream. The rest of it is in the low
+    /// m_NumPendingBits bits of m_Pending (the other bits of which are always 0).
+    std::vector<uint8_t> m_Bitstream;
+    size_t m_NumCommittedBytes;
+    uint64_t m_Pending;
+    uint32_t m_NumPendingBits;
+};
+
+}    // namespace support_library
+}    // namespace ethosn
@@ -19,6 +19,8 @@
 #include "nonCascading/SpaceToDepthPass.hpp"
 #include "nonCascading/Strategies.hpp"
 
+#include <ethosn_utils/Hash.hpp>
+
 #include <fstream>
 #include <numeric>
 #include <sstream>
@@ -127,6 +129,7 @@ Compiler::Compiler(const Network& network,
     , m_Capabilities(fwAndHwCapabilities)
     , m_CompilationOptions(compilationOptions)
     , m_EnableCascading(false)
+    , m_ThreadPool(compilationOptions.m_NumThreads)
     , m_EstimationOptions(estimationOptions)
     , m_PerfEstimate(false)
 {
@@ -189,7 +192,8 @@ NetworkPerformanceData Compiler::EstimatePerformance()
     }
     // An engineer can force to use cascaded estimation only by setting
     // 'COMPILER_ALGORITHM = CascadingOnly' into the configuration file
-    if (compilerAlgorithm == CompilerAlgorithm::Auto || compilerAlgorithm == CompilerAlgorithm::CascadingOnly)
+    if (compilerAlgorithm == CompilerAlgorithm::Auto || compilerAlgorithm == CompilerAlgorithm::CascadingOnly ||
+        compilerAlgorithm == CompilerAlgorithm::CascadingBeamSearchOnly)
     {
         if (m_EstimationOptions.m_Current == false)
         {
@@ -408,7 +412,8 @@ void Compiler::CreatePasses()
             {
                 p = McePlePass::CreateGreedily(m_Capabilities, passId, strategies, m_AllowedBlockConfigs,
                                                m_CompilationOptions.m_EnableIntermediateCompression,
-                                               !m_CompilationOptions.m_DisableWinograd, n, sramAllocator, forwardEst);
+                                               !m_CompilationOptions.m_DisableWinograd, n, sramAllocator, forwardEst,
+                                               m_ThreadPool);
             }
             if (!p)
             {
@@ -477,7 +482,12 @@ void Compiler::Generate()
 
     m_BufferManager.AddCommandStream(m_CommandStream);
 
-    m_BufferManager.Allocate();
+    // Anything dumped for debugging is easier to make sense of if every intermediate buffer has its own memory
+    const CompilationOptions::DebugInfo& debugInfo = *debuggingContext.m_DebugInfo;
+    const bool packIntermediates                   = m_CompilationOptions.m_PackIntermediateBuffers &&
+                                   debugInfo.m_DumpDebugFiles == CompilationOptions::DebugLevel::None &&
+                                   !debugInfo.m_DumpRam;
+    m_BufferManager.Allocate(packIntermediates);
 }
 
 void Compiler::DumpGraph(const std::string& filename)
@@ -497,6 +507,26 @@ void Compiler::DumpGraph(const std::string& filename)
     debuggingContext.DumpGraph(CompilationOptions::DebugLevel::Medium, m_Graph, finalFileName);
 }
 
+namespace
+{
+
+/// The kernel compares the data itself before sharing it, so this doesn't need to be cryptographic, but two
+/// differently seeded hashes make it very unlikely that different data has the same digest (which would stop it
+/// being shared). An all-zero digest means there is no digest, so is never returned.
+std::array<uint64_t, 2> CalculateConstantDataDigest(const std::vector<uint8_t>& data)
+{
+    constexpr uint64_t seed2 = 0x434f4e5354414e54ULL;
+    std::array<uint64_t, 2> digest{ { ethosn::utils::Xxh64(data.data(), data.size()),
+                                      ethosn::utils::Xxh64(data.data(), data.size(), seed2) } };
+    if (digest[0] == 0 && digest[1] == 0)
+    {
+        digest[0] = 1;
+    }
+    return digest;
+}
+
+}    // namespace
+
 CompiledNetworkImpl::CompiledNetworkImpl(const std::vector<uint8_t>& constantDmaData,
                                          const std::vector<uint8_t>& constantControlUnitData,
                                          const std::map<uint32_t, CompilerBufferInfo>& buffers,
@@ -504,6 +534,8 @@ CompiledNetworkImpl::CompiledNetworkImpl(const std::vector<uint8_t>& constantDma
     : m_OperationIds(operationIds)
     , m_ConstantDmaData(constantDmaData)
     , m_ConstantControlUnitData(constantControlUnitData)
+    , m_ConstantDmaDataDigest(CalculateConstantDataDigest(constantDmaData))
+    , m_ConstantControlUnitDataDigest(CalculateConstantDataDigest(constantControlUnitData))
 {
     // Convert the set of buffers from the BufferManager into the format that CompiledNetwork exposes.
     for (auto internalBufferIt : buffers)
@@ -590,6 +622,15 @@ void Write(std::ostream& out, const uint32_t data)
     out.put(static_cast<char>((data >> 24) & 0xFF));
 }
 
+void WriteDigest(std::ostream& out, const std::array<uint64_t, 2>& digest)
+{
+    for (uint64_t hash : digest)
+    {
+        Write(out, static_cast<uint32_t>(hash));
+        Write(out, static_cast<uint32_t>(hash >> 32));
+    }
+}
+
 void WriteByteArray(std::ostream& out, const std::vector<uint8_t>& data)
 {
     Write(out, static_cast<uint32_t>(data.size()));
@@ -614,9 +655,13 @@ void CompiledNetworkImpl::Serialize(std::ostream& out) const
     // Tag to identify the compiled network data structure using "FourCC" style
     out.write("ENCN", 4);
 
-    // Version of data structure
+    // Version of data structure.
+    // Driver Libraries reject major versions they don't know about (see the Driver Library's
+    // MAX_ETHOSN_COMPILED_NETWORK_MAJOR_VERSION_SUPPORTED) and all of them accept major version 1, so new data
+    // should be added after the existing data, which they ignore, with a new minor version, rather than by changing
+    // the layout.
     constexpr uint32_t major = 1;
-    constexpr uint32_t minor = 0;
+    constexpr uint32_t minor = 1;
     constexpr uint32_t patch = 0;
 
     Write(out, major);
@@ -631,6 +676,10 @@ void CompiledNetworkImpl::Serialize(std::ostream& out) const
     WriteBufferInfoArray(out, m_ConstantControlUnitDataBufferInfos);
     WriteBufferInfoArray(out, m_ConstantDmaDataBufferInfos);
     WriteBufferInfoArray(out, m_IntermediateDataBufferInfos);
+
+    // Added in version 1.1
+    WriteDigest(out, m_ConstantDmaDataDigest);
+    WriteDigest(out, m_ConstantControlUnitDataDigest);
 }
 
 }    // namespace support_library
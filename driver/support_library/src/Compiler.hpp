@@ -7,11 +7,13 @@
 
 #include "DebuggingContext.hpp"
 #include "Graph.hpp"
+#include "ThreadPool.hpp"
 #include "Utils.hpp"
 #include "nonCascading/BufferManager.hpp"
 
 #include <ethosn_command_stream/CommandStreamBuffer.hpp>
 
+#include <array>
 #include <cstdint>
 #include <cstring>
 #include <memory>
@@ -81,6 +83,9 @@ private:
     HardwareCapabilities m_Capabilities;
     const CompilationOptions& m_CompilationOptions;
     bool m_EnableCascading;
+    /// Threads shared by the parts of compilation which run in parallel (currently weight encoding), sized by
+    /// CompilationOptions::m_NumThreads.
+    ThreadPool m_ThreadPool;
     /// @}
 
     /// Performance estimation
@@ -166,6 +171,8 @@ public:
     };
 
     CompiledNetworkImpl()
+        : m_ConstantDmaDataDigest{}
+        , m_ConstantControlUnitDataDigest{}
     {}
 
     CompiledNetworkImpl(const std::vector<uint8_t>& constantDmaData,
@@ -227,6 +234,21 @@ public:
         return m_IntermediateDataBufferInfos;
     }
 
+    /// Digests of the constant data, which the kernel uses to share one copy of identical constant data between all
+    /// the networks registered with it. These are calculated once, when compiling, so that registering a network
+    /// doesn't need to read all of its constant data to calculate them.
+    /// @{
+    const std::array<uint64_t, 2>& GetConstantDmaDataDigest() const
+    {
+        return m_ConstantDmaDataDigest;
+    }
+
+    const std::array<uint64_t, 2>& GetConstantControlUnitDataDigest() const
+    {
+        return m_ConstantControlUnitDataDigest;
+    }
+    /// @}
+
 private:
     /// Data exposed via public API.
     /// @{
@@ -246,6 +268,9 @@ private:
     std::vector<BufferInfoInternal> m_ConstantControlUnitDataBufferInfos;
     std::vector<BufferInfoInternal> m_ConstantDmaDataBufferInfos;
     std::vector<BufferInfoInternal> m_IntermediateDataBufferInfos;
+
+    std::array<uint64_t, 2> m_ConstantDmaDataDigest;
+    std::array<uint64_t, 2> m_ConstantControlUnitDataDigest;
     /// @}
 };
 
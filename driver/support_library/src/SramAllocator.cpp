@@ -5,38 +5,81 @@
 
 #include "SramAllocator.hpp"
 
+#include <ethosn_utils/Macros.hpp>
+
 #include <algorithm>
 #include <cassert>
+#include <tuple>
 
 namespace ethosn
 {
 namespace support_library
 {
 
+namespace
+{
+
+template <typename T>
+typename std::vector<T>::iterator FindFirstAtOrAfter(std::vector<T>& v, uint32_t offset)
+{
+    return std::lower_bound(v.begin(), v.end(), offset,
+                            [](const T& x, uint32_t o) { return x.m_Begin < o; });
+}
+
+}    // namespace
+
+SramAllocator::SramAllocator(const SramAllocator& s)
+    : m_Capacity(s.m_Capacity)
+    , m_FreeMemory(s.m_FreeMemory)
+    , m_UsedMemory(s.m_UsedMemory)
+    , m_Users(s.m_Users)
+    , m_DebugNames(s.m_DebugNames)
+    , m_EmptyChunks(s.m_EmptyChunks)
+    , m_NumCheckpoints(0)
+{}
+
 SramAllocator& SramAllocator::operator=(const SramAllocator& s)
 {
+    assert(m_NumCheckpoints == 0);
     this->m_Capacity   = s.m_Capacity;
     this->m_FreeMemory = s.m_FreeMemory;
     this->m_UsedMemory = s.m_UsedMemory;
+    this->m_Users      = s.m_Users;
+    this->m_DebugNames  = s.m_DebugNames;
+    this->m_EmptyChunks = s.m_EmptyChunks;
     return *this;
 }
 
 std::pair<bool, uint32_t>
     SramAllocator::Allocate(UserId userId, uint32_t size, AllocationPreference pref, std::string debugName)
 {
+    if (size == 0)
+    {
+        if (m_FreeMemory.empty())
+        {
+            return { false, 0 };
+        }
+        const uint32_t offset =
+            pref == AllocationPreference::End ? m_FreeMemory.back().m_End : m_FreeMemory.front().m_Begin;
+        AddEmptyChunk(offset, userId);
+        Record(Change::Type::AddEmptyChunk, Range{ offset, offset }, userId);
+        return { true, offset };
+    }
+
     if (pref == AllocationPreference::Start)
     {
         for (auto range = m_FreeMemory.begin(); range != m_FreeMemory.end(); ++range)
         {
             if (size <= range->m_End - range->m_Begin)
             {
-                MemoryChunk chunk = { range->m_Begin, range->m_Begin + size, { userId }, debugName };
-                m_UsedMemory.emplace_back(chunk);
+                const Range chunk = { range->m_Begin, range->m_Begin + size };
                 range->m_Begin += size;
                 if (range->m_Begin == range->m_End)
                 {
                     m_FreeMemory.erase(range);
                 }
+                AddUsedChunk(chunk, userId, std::move(debugName));
+                Record(Change::Type::Allocate, chunk, userId);
                 return { true, chunk.m_Begin };
             }
         }
@@ -49,13 +92,14 @@ std::pair<bool, uint32_t>
         {
             if (size <= range->m_End - range->m_Begin)
             {
-                MemoryChunk chunk = { range->m_End - size, range->m_End, { userId }, debugName };
-                m_UsedMemory.emplace_back(chunk);
+                const Range chunk = { range->m_End - size, range->m_End };
                 range->m_End -= size;
                 if (range->m_Begin == range->m_End)
                 {
                     m_FreeMemory.erase(std::next(range).base());
                 }
+                AddUsedChunk(chunk, userId, std::move(debugName));
+                Record(Change::Type::Allocate, chunk, userId);
                 return { true, chunk.m_Begin };
             }
         }
@@ -66,35 +110,64 @@ std::pair<bool, uint32_t>
 
 void SramAllocator::IncrementReferenceCount(UserId userId, uint32_t offset)
 {
-    auto MatchChunk    = [offset](const auto& chunk) { return (offset == chunk.m_Begin); };
-    auto memoryChunkIt = std::find_if(m_UsedMemory.begin(), m_UsedMemory.end(), MatchChunk);
-    assert(memoryChunkIt != m_UsedMemory.end());
-    memoryChunkIt->m_ListOfUsers.emplace(userId);
+    auto memoryChunkIt = FindFirstAtOrAfter(m_UsedMemory, offset);
+    if (memoryChunkIt == m_UsedMemory.end() || memoryChunkIt->m_Begin != offset)
+    {
+        auto emptyChunkIt = FindFirstAtOrAfter(m_EmptyChunks, offset);
+        assert(emptyChunkIt != m_EmptyChunks.end() && emptyChunkIt->m_Begin == offset);
+        ETHOSN_UNUSED(emptyChunkIt);
+        AddEmptyChunk(offset, userId);
+        Record(Change::Type::AddEmptyChunk, Range{ offset, offset }, userId);
+        return;
+    }
+    if (AddUser(offset, userId))
+    {
+        Record(Change::Type::AddUser, *memoryChunkIt, userId);
+    }
 }
 
 bool SramAllocator::Free(UserId userId, uint32_t offset)
 {
-    auto MatchChunk = [offset](const auto& chunk) { return (offset == chunk.m_Begin); };
-    // Remove the chunk from used memory and add it to the free memory.
-    auto memoryChunkIt = std::find_if(m_UsedMemory.begin(), m_UsedMemory.end(), MatchChunk);
+    // An empty chunk of the user takes precedence over a chunk in use at the same offset
+    if (RemoveEmptyChunk(offset, userId))
+    {
+        Record(Change::Type::RemoveEmptyChunk, Range{ offset, offset }, userId);
+        return true;
+    }
 
-    if (memoryChunkIt == m_UsedMemory.end())
+    auto memoryChunkIt = FindFirstAtOrAfter(m_UsedMemory, offset);
+    if (memoryChunkIt == m_UsedMemory.end() || memoryChunkIt->m_Begin != offset)
     {
         return false;
     }
+    const Range chunk = *memoryChunkIt;
 
-    std::unordered_set<SramAllocator::UserId>& listOfUser = memoryChunkIt->m_ListOfUsers;
-    assert(listOfUser.find(userId) != listOfUser.end());
-    listOfUser.erase(userId);
-    if (listOfUser.size() == 0)
+    auto usersBegin = FindFirstAtOrAfter(m_Users, offset);
+    auto usersEnd   = std::find_if(usersBegin, m_Users.end(), [offset](const User& u) { return u.m_Begin != offset; });
+    auto userIt     = std::find_if(usersBegin, usersEnd, [userId](const User& u) { return u.m_UserId == userId; });
+    assert(userIt != usersEnd);
+    if (userIt == usersEnd)
     {
-        MemoryChunk memoryChunk = *memoryChunkIt;
-        m_UsedMemory.erase(memoryChunkIt);
-        m_FreeMemory.push_back(memoryChunk);
-        auto SortMemoryChunks = [](const auto& lhs, const auto& rhs) { return lhs.m_Begin < rhs.m_Begin; };
-        std::sort(m_FreeMemory.begin(), m_FreeMemory.end(), SortMemoryChunks);
-        CollapseRegions();
+        return true;
     }
+
+    if (usersEnd - usersBegin > 1)
+    {
+        m_Users.erase(userIt);
+        Record(Change::Type::RemoveUser, chunk, userId);
+        return true;
+    }
+
+    // This was the last user, so the chunk becomes free memory
+    std::string debugName;
+    auto debugNameIt = FindFirstAtOrAfter(m_DebugNames, offset);
+    if (debugNameIt != m_DebugNames.end() && debugNameIt->m_Begin == offset)
+    {
+        debugName = std::move(debugNameIt->m_Name);
+    }
+    RemoveUsedChunk(offset);
+    AddFreeRange(chunk);
+    Record(Change::Type::FreeChunk, chunk, userId, std::move(debugName));
     return true;
 }
 
@@ -102,10 +175,16 @@ std::string SramAllocator::DumpUsage() const
 {
     std::string ret;
     ret += std::string("Sram Used Memory: \n");
+    auto debugName = m_DebugNames.begin();
     for (const auto& x : m_UsedMemory)
     {
+        while (debugName != m_DebugNames.end() && debugName->m_Begin < x.m_Begin)
+        {
+            ++debugName;
+        }
+        const bool hasDebugName = debugName != m_DebugNames.end() && debugName->m_Begin == x.m_Begin;
         ret += std::string("range=") + std::to_string(x.m_Begin) + std::string("---") + std::to_string(x.m_End) + " " +
-               x.m_Debug + std::string("\n");
+               (hasDebugName ? debugName->m_Name : std::string()) + std::string("\n");
     }
     ret += std::string("Sram Free Memory: \n");
     for (const auto& x : m_FreeMemory)
@@ -116,34 +195,219 @@ std::string SramAllocator::DumpUsage() const
     return ret;
 }
 
-void SramAllocator::CollapseRegions()
+void SramAllocator::Reset()
+{
+    assert(m_NumCheckpoints == 0);
+    m_FreeMemory = { { 0, m_Capacity } };
+    m_UsedMemory.clear();
+    m_Users.clear();
+    m_DebugNames.clear();
+    m_EmptyChunks.clear();
+}
+
+bool SramAllocator::IsFull()
+{
+    return m_FreeMemory.empty();
+}
+
+bool SramAllocator::IsEmpty()
+{
+    return m_UsedMemory.empty() && m_EmptyChunks.empty();
+}
+
+SramAllocator::Checkpoint SramAllocator::GetCheckpoint()
+{
+    ++m_NumCheckpoints;
+    return m_Changes.size();
+}
+
+void SramAllocator::Rollback(Checkpoint checkpoint)
 {
-    for (size_t i = m_FreeMemory.size() - 1; i >= 1; --i)
+    assert(m_NumCheckpoints > 0 && checkpoint <= m_Changes.size());
+    while (m_Changes.size() > checkpoint)
     {
-        // Regions should never overlap otherwise something has gone horribly wrong
-        assert(m_FreeMemory[i - 1].m_End <= m_FreeMemory[i].m_Begin);
-        if (m_FreeMemory[i - 1].m_End == m_FreeMemory[i].m_Begin)
+        Change& change = m_Changes.back();
+        switch (change.m_Type)
         {
-            m_FreeMemory[i - 1].m_End = m_FreeMemory[i].m_End;
-            m_FreeMemory.erase(m_FreeMemory.begin() + i);
+            case Change::Type::Allocate:
+                RemoveUsedChunk(change.m_Chunk.m_Begin);
+                AddFreeRange(change.m_Chunk);
+                break;
+            case Change::Type::AddUser:
+                RemoveUser(change.m_Chunk.m_Begin, change.m_UserId);
+                break;
+            case Change::Type::RemoveUser:
+                AddUser(change.m_Chunk.m_Begin, change.m_UserId);
+                break;
+            case Change::Type::FreeChunk:
+                RemoveFreeRange(change.m_Chunk);
+                AddUsedChunk(change.m_Chunk, change.m_UserId, std::move(change.m_DebugName));
+                break;
+            case Change::Type::AddEmptyChunk:
+                RemoveEmptyChunk(change.m_Chunk.m_Begin, change.m_UserId);
+                break;
+            case Change::Type::RemoveEmptyChunk:
+                AddEmptyChunk(change.m_Chunk.m_Begin, change.m_UserId);
+                break;
+            default:
+                assert(false);
+                break;
         }
+        m_Changes.pop_back();
     }
+    Release(checkpoint);
 }
 
-void SramAllocator::Reset()
+void SramAllocator::Release(Checkpoint checkpoint)
 {
-    m_FreeMemory = { { 0, m_Capacity, {}, "" } };
-    m_UsedMemory = {};
+    assert(m_NumCheckpoints > 0 && checkpoint <= m_Changes.size());
+    ETHOSN_UNUSED(checkpoint);
+    --m_NumCheckpoints;
+    if (m_NumCheckpoints == 0)
+    {
+        m_Changes.clear();
+    }
 }
 
-bool SramAllocator::IsFull()
+void SramAllocator::AddUsedChunk(Range chunk, UserId userId, std::string debugName)
 {
-    return m_FreeMemory.empty();
+    m_UsedMemory.insert(FindFirstAtOrAfter(m_UsedMemory, chunk.m_Begin), chunk);
+    AddUser(chunk.m_Begin, userId);
+    if (!debugName.empty())
+    {
+        m_DebugNames.insert(FindFirstAtOrAfter(m_DebugNames, chunk.m_Begin),
+                            DebugName{ chunk.m_Begin, std::move(debugName) });
+    }
 }
 
-bool SramAllocator::IsEmpty()
+void SramAllocator::RemoveUsedChunk(uint32_t offset)
+{
+    auto memoryChunkIt = FindFirstAtOrAfter(m_UsedMemory, offset);
+    assert(memoryChunkIt != m_UsedMemory.end() && memoryChunkIt->m_Begin == offset);
+    m_UsedMemory.erase(memoryChunkIt);
+
+    auto usersBegin = FindFirstAtOrAfter(m_Users, offset);
+    auto usersEnd   = std::find_if(usersBegin, m_Users.end(), [offset](const User& u) { return u.m_Begin != offset; });
+    m_Users.erase(usersBegin, usersEnd);
+
+    auto debugNameIt = FindFirstAtOrAfter(m_DebugNames, offset);
+    if (debugNameIt != m_DebugNames.end() && debugNameIt->m_Begin == offset)
+    {
+        m_DebugNames.erase(debugNameIt);
+    }
+}
+
+bool SramAllocator::AddUser(uint32_t offset, UserId userId)
+{
+    const User user = { offset, userId };
+    auto userIt     = std::lower_bound(m_Users.begin(), m_Users.end(), user, [](const User& l, const User& r) {
+        return std::tie(l.m_Begin, l.m_UserId) < std::tie(r.m_Begin, r.m_UserId);
+    });
+    if (userIt != m_Users.end() && userIt->m_Begin == offset && userIt->m_UserId == userId)
+    {
+        return false;
+    }
+    m_Users.insert(userIt, user);
+    return true;
+}
+
+void SramAllocator::RemoveUser(uint32_t offset, UserId userId)
+{
+    auto userIt = std::find_if(m_Users.begin(), m_Users.end(), [offset, userId](const User& u) {
+        return u.m_Begin == offset && u.m_UserId == userId;
+    });
+    assert(userIt != m_Users.end());
+    m_Users.erase(userIt);
+}
+
+void SramAllocator::AddEmptyChunk(uint32_t offset, UserId userId)
+{
+    const User user = { offset, userId };
+    m_EmptyChunks.insert(std::upper_bound(m_EmptyChunks.begin(), m_EmptyChunks.end(), user,
+                                          [](const User& l, const User& r) {
+                                              return std::tie(l.m_Begin, l.m_UserId) < std::tie(r.m_Begin, r.m_UserId);
+                                          }),
+                         user);
+}
+
+bool SramAllocator::RemoveEmptyChunk(uint32_t offset, UserId userId)
+{
+    auto chunksBegin = FindFirstAtOrAfter(m_EmptyChunks, offset);
+    auto chunkIt     = std::find_if(chunksBegin, m_EmptyChunks.end(), [offset, userId](const User& u) {
+        return u.m_Begin != offset || u.m_UserId == userId;
+    });
+    if (chunkIt == m_EmptyChunks.end() || chunkIt->m_Begin != offset)
+    {
+        return false;
+    }
+    m_EmptyChunks.erase(chunkIt);
+    return true;
+}
+
+void SramAllocator::AddFreeRange(Range range)
 {
-    return m_UsedMemory.empty();
+    auto next = FindFirstAtOrAfter(m_FreeMemory, range.m_Begin);
+    // Regions should never overlap otherwise something has gone horribly wrong
+    assert(next == m_FreeMemory.end() || range.m_End <= next->m_Begin);
+    assert(next == m_FreeMemory.begin() || std::prev(next)->m_End <= range.m_Begin);
+
+    const bool mergeWithPrev = next != m_FreeMemory.begin() && std::prev(next)->m_End == range.m_Begin;
+    const bool mergeWithNext = next != m_FreeMemory.end() && next->m_Begin == range.m_End;
+    if (mergeWithPrev && mergeWithNext)
+    {
+        std::prev(next)->m_End = next->m_End;
+        m_FreeMemory.erase(next);
+    }
+    else if (mergeWithPrev)
+    {
+        std::prev(next)->m_End = range.m_End;
+    }
+    else if (mergeWithNext)
+    {
+        next->m_Begin = range.m_Begin;
+    }
+    else
+    {
+        m_FreeMemory.insert(next, range);
+    }
+}
+
+void SramAllocator::RemoveFreeRange(Range range)
+{
+    // Find the free range containing the given range, which is the last one starting at or before it
+    auto containing = std::upper_bound(m_FreeMemory.begin(), m_FreeMemory.end(), range.m_Begin,
+                                       [](uint32_t o, const Range& r) { return o < r.m_Begin; });
+    assert(containing != m_FreeMemory.begin());
+    --containing;
+    assert(containing->m_Begin <= range.m_Begin && range.m_End <= containing->m_End);
+
+    const Range before = { containing->m_Begin, range.m_Begin };
+    const Range after  = { range.m_End, containing->m_End };
+    if (before.m_Begin == before.m_End && after.m_Begin == after.m_End)
+    {
+        m_FreeMemory.erase(containing);
+    }
+    else if (before.m_Begin == before.m_End)
+    {
+        *containing = after;
+    }
+    else if (after.m_Begin == after.m_End)
+    {
+        *containing = before;
+    }
+    else
+    {
+        *containing = before;
+        m_FreeMemory.insert(std::next(containing), after);
+    }
+}
+
+void SramAllocator::Record(Change::Type type, Range chunk, UserId userId, std::string debugName)
+{
+    if (m_NumCheckpoints > 0)
+    {
+        m_Changes.push_back(Change{ type, chunk, userId, std::move(debugName) });
+    }
 }
 
 }    // namespace support_library
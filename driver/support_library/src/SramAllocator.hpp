@@ -6,7 +6,6 @@
 #pragma once
 
 #include <string>
-#include <unordered_set>
 #include <vector>
 
 #include "Graph.hpp"
@@ -23,29 +22,30 @@ enum class AllocationPreference
 };
 
 // A simple allocator to be used to allocate data in SRAM.
-// Assumes a small number of chunks allocated at once,
-// thus iterating over the internal vectors is fast, and minimal fragmentation
+// Chunks are kept as small records in arrays sorted by offset, so that a chunk can be found with a binary search and
+// copying an allocator doesn't need an allocation per chunk. Allocation is first fit, which is fast because there are
+// only ever a few chunks allocated at once and fragmentation is minimal.
+// Trying some allocations and then undoing them is cheaper with a checkpoint (see GetCheckpoint) than with a copy.
 class SramAllocator
 {
 public:
     using UserId = size_t;
+    /// Identifies the state of the allocator when GetCheckpoint was called.
+    using Checkpoint = size_t;
+
     SramAllocator()
-        : m_Capacity(0)
-        , m_FreeMemory()
-        , m_UsedMemory()
-    {
-        Reset();
-    }
+        : SramAllocator(0)
+    {}
 
     SramAllocator(uint32_t capacity)
         : m_Capacity(capacity)
-        , m_FreeMemory()
-        , m_UsedMemory()
+        , m_NumCheckpoints(0)
     {
         Reset();
     }
 
-    SramAllocator(const SramAllocator& s) = default;
+    // Copies the allocations, but not any checkpoints.
+    SramAllocator(const SramAllocator& s);
 
     SramAllocator& operator=(const SramAllocator& s);
 
@@ -67,23 +67,82 @@ public:
 
     bool IsEmpty();
 
+    // Start recording changes so that they can be undone with Rollback. Each checkpoint must be passed to either
+    // Rollback or Release, most recent first. Copies of the allocator don't share checkpoints.
+    Checkpoint GetCheckpoint();
+
+    // Undo all the changes made since the checkpoint was created, and release it.
+    void Rollback(Checkpoint checkpoint);
+
+    // Keep all the changes made since the checkpoint was created, and release it.
+    void Release(Checkpoint checkpoint);
+
 private:
-    struct MemoryChunk
+    struct Range
     {
         uint32_t m_Begin;
         uint32_t m_End;
-        std::unordered_set<UserId> m_ListOfUsers;
-        std::string m_Debug;
     };
 
-    // Collapse regions of contiguous free memory into one chunk
-    void CollapseRegions();
+    struct User
+    {
+        uint32_t m_Begin;
+        UserId m_UserId;
+    };
+
+    struct DebugName
+    {
+        uint32_t m_Begin;
+        std::string m_Name;
+    };
+
+    // A change which may need to be undone by Rollback
+    struct Change
+    {
+        enum class Type
+        {
+            Allocate,
+            AddUser,
+            RemoveUser,
+            FreeChunk,
+            AddEmptyChunk,
+            RemoveEmptyChunk,
+        };
+        Type m_Type;
+        Range m_Chunk;
+        UserId m_UserId;
+        std::string m_DebugName;
+    };
+
+    void AddUsedChunk(Range chunk, UserId userId, std::string debugName);
+    void RemoveUsedChunk(uint32_t offset);
+    // Return false if the chunk already had the user
+    bool AddUser(uint32_t offset, UserId userId);
+    void RemoveUser(uint32_t offset, UserId userId);
+    void AddEmptyChunk(uint32_t offset, UserId userId);
+    // Return false if there is no such empty chunk
+    bool RemoveEmptyChunk(uint32_t offset, UserId userId);
+    // Add the range to the free memory, merging it with any neighbouring free ranges
+    void AddFreeRange(Range range);
+    // Remove the range (which must be free) from the free memory, splitting the free range containing it if needed
+    void RemoveFreeRange(Range range);
+    void Record(Change::Type type, Range chunk, UserId userId, std::string debugName = "");
 
     uint32_t m_Capacity;
 
-    // Pairs of numbers to represent the range of free contiguous memory left to allocate and the memory in use
-    std::vector<MemoryChunk> m_FreeMemory;
-    std::vector<MemoryChunk> m_UsedMemory;
+    // Ranges of free contiguous memory left to allocate and the memory in use, sorted by offset
+    std::vector<Range> m_FreeMemory;
+    std::vector<Range> m_UsedMemory;
+    // The users of each chunk in use (identified by its offset), sorted by offset then user
+    std::vector<User> m_Users;
+    // Only chunks which were allocated with a debug name have an entry, sorted by offset
+    std::vector<DebugName> m_DebugNames;
+    // Chunks of size zero, which can share their offset with a chunk in use, so they are kept apart from it.
+    // There is one entry per user of each, sorted by offset then user.
+    std::vector<User> m_EmptyChunks;
+
+    uint32_t m_NumCheckpoints;
+    std::vector<Change> m_Changes;
 };
 
 }    // namespace support_library
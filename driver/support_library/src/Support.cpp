@@ -320,7 +320,8 @@ std::vector<std::unique_ptr<CompiledNetwork>> Compile(const Network& network, co
     }
 
     // Cascading not supported while compilation
-    if (options.m_CompilerAlgorithm == CompilerAlgorithm::CascadingOnly)
+    if (options.m_CompilerAlgorithm == CompilerAlgorithm::CascadingOnly ||
+        options.m_CompilerAlgorithm == CompilerAlgorithm::CascadingBeamSearchOnly)
     {
         throw NotSupportedException("Cascading only supported for performance estimation");
     }
@@ -354,7 +355,8 @@ NetworkPerformanceData EstimatePerformance(const Network& network,
 
     // Until full implementation of cascading in support library,
     // available  only as future optimistic estimate. i.e m_Current = false.
-    if (compilationOptions.m_CompilerAlgorithm == CompilerAlgorithm::CascadingOnly &&
+    if ((compilationOptions.m_CompilerAlgorithm == CompilerAlgorithm::CascadingOnly ||
+         compilationOptions.m_CompilerAlgorithm == CompilerAlgorithm::CascadingBeamSearchOnly) &&
         estimationOptions.m_Current == true)
     {
         throw NotSupportedException(
@@ -0,0 +1,18 @@
+//
+// Copyright © 2021 Arm Limited.
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <ethosn_utils/ThreadPool.hpp>
+
+namespace ethosn
+{
+namespace support_library
+{
+
+using ethosn::utils::ThreadPool;
+
+}    // namespace support_library
+}    // namespace ethosn
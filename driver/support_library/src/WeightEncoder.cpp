@@ -5,15 +5,16 @@
 
 #include "WeightEncoder.hpp"
 
+#include "BitstreamWriter.hpp"
 #include "Compiler.hpp"
 #include "GraphNodes.hpp"
 #include "SubmapFilter.hpp"
+#include "ThreadPool.hpp"
 #include "Utils.hpp"
 #include "WeightEncoderV2.hpp"
 
 #include <algorithm>
 #include <exception>
-#include <future>
 #include <iterator>
 #include <map>
 #include <utility>
@@ -40,157 +41,30 @@ std::vector<Weight>
 
     return uncompressedWeights;
 }
-}    // namespace
-
-// BitstreamWriter is a helper class that supports writing packed bitfields into a vector.
 
-class BitstreamWriter
+/// Writes each of the values to the bitstream using numBits bits, packing as many of them as will fit into each
+/// write rather than writing them one at a time.
+void WritePacked(BitstreamWriter& writer, const std::vector<int32_t>& values, uint32_t numBits)
 {
-public:
-    BitstreamWriter(uint32_t capacityBits);
-
-    // Returns the current write position in the bitstream (in bits)
-    size_t GetOffset();
-
-    // Write an element to the stream. Offset specifies where to start writing in the stream.
-    void Write(uint8_t elem, int numBits, size_t offset);
-
-    // Write an element to end of the stream.
-    void Write(uint8_t elem, int numBits);
-
-    // Write an element to the stream. Offset specifies where to start writing in the stream.
-    template <class T>
-    void Write(const T* elem, int numBits);
-
-    // Reserve space in the stream by writing 0 bits
-    void Reserve(size_t numBits);
-
-    // Returns the stream as a uint8_t vector
-    const std::vector<uint8_t>& GetBitstream();
-
-    // Clears the content of the stream and resets the write position
-    void Clear();
-
-private:
-    std::vector<uint8_t> m_Bitstream;
-    size_t m_EndPos;
-};
-
-BitstreamWriter::BitstreamWriter(uint32_t capacityBits)
-    : m_EndPos(0)
-{
-    m_Bitstream.reserve(utils::DivRoundUp(capacityBits, 8));
-}
-
-size_t BitstreamWriter::GetOffset()
-{
-    return m_EndPos;
-}
-
-void BitstreamWriter::Write(uint8_t elem, int numBits, size_t offset)
-{
-    for (int i = 0; i < numBits; ++i)
+    assert(numBits <= 32);
+    const uint64_t mask    = (uint64_t{ 1 } << numBits) - 1;
+    uint64_t packed        = 0;
+    uint32_t numPackedBits = 0;
+    for (int32_t value : values)
     {
-        size_t idx = offset / 8;
-        int bit    = offset % 8;
-
-        if (idx >= m_Bitstream.size())
+        if (numPackedBits + numBits > 64)
         {
-            m_Bitstream.push_back(static_cast<uint8_t>((elem >> i) & 1));
+            writer.Write(packed, numPackedBits);
+            packed        = 0;
+            numPackedBits = 0;
         }
-        else
-        {
-            m_Bitstream[idx] = static_cast<uint8_t>(m_Bitstream[idx] | (((elem >> i) & 1) << bit));
-        }
-
-        ++offset;
-    }
-
-    if (static_cast<size_t>(offset) > m_EndPos)
-    {
-        m_EndPos = offset;
-    }
-}
-
-void BitstreamWriter::Write(uint8_t elem, int numBits)
-{
-    if (numBits == 0)
-    {
-        return;
-    }
-    assert(numBits <= 8);
-
-    // Make sure there is enough space in the vector for the new bits, so we can index into it later
-    const size_t requiredSize = utils::DivRoundUp(static_cast<uint32_t>(m_EndPos) + numBits, 8);
-    if (requiredSize > m_Bitstream.size())
-    {
-        m_Bitstream.push_back(0);
+        packed |= (static_cast<uint64_t>(static_cast<uint32_t>(value)) & mask) << numPackedBits;
+        numPackedBits += numBits;
     }
-
-    // The operation is split into two parts - "a" and "b". a is the part which is appended to the partially-complete
-    // byte at the end of m_Bitstream, and b is the part which is appended as a new byte to m_Bitstream.
-    // There is always an "a", but not always a "b" (if the number of bits we are appending doesn't overflow into the
-    // next byte)
-
-    const uint32_t destBitIdxA = m_EndPos % 8;
-    const uint32_t numBitsA    = std::min<uint32_t>(8 - destBitIdxA, numBits);
-    const uint8_t bitsA        = static_cast<uint8_t>(elem & ((1u << numBitsA) - 1u));
-    uint8_t& destA             = m_Bitstream[m_EndPos / 8];
-    destA                      = static_cast<uint8_t>(destA | (bitsA << destBitIdxA));
-
-    const uint32_t numBitsB = numBits - numBitsA;
-    if (numBitsB > 0)
-    {
-        const uint8_t bitsB = static_cast<uint8_t>((elem >> numBitsA) & ((1u << numBitsB) - 1u));
-        uint8_t& destB      = m_Bitstream.back();
-        destB               = bitsB;
-    }
-
-    m_EndPos += numBits;
+    writer.Write(packed, numPackedBits);
 }
 
-template <class T>
-void BitstreamWriter::Write(const T* elem, int numBits)
-{
-    const uint8_t* p = reinterpret_cast<const uint8_t*>(elem);
-
-    while (numBits > 0)
-    {
-        Write(*p, std::min(numBits, 8));
-
-        numBits -= 8;
-        ++p;
-    }
-}
-
-void BitstreamWriter::Reserve(size_t numBits)
-{
-    size_t i = 0;
-
-    while (i < numBits)
-    {
-        size_t idx = (m_EndPos + i) / 8;
-        if (idx >= static_cast<size_t>(m_Bitstream.size()))
-        {
-            m_Bitstream.push_back(0);
-        }
-
-        i += 8 - ((m_EndPos + i) % 8);
-    }
-
-    m_EndPos += numBits;
-}
-
-const std::vector<uint8_t>& BitstreamWriter::GetBitstream()
-{
-    return m_Bitstream;
-}
-
-void BitstreamWriter::Clear()
-{
-    m_Bitstream.clear();
-    m_EndPos = 0;
-}
+}    // namespace
 
 /**
  * This is the base class for the different weight compression implementations. Please refer to the MCE specification
@@ -1525,41 +1399,30 @@ void WeightEncoderV2::GRCCompressPackChunk(const std::vector<WeightSymbol>& weig
 
         if (wEnable && !unCompressed)
         {
-            writer.Write(reinterpret_cast<const uint8_t*>(&wUnary0), maxNumWunary0Bits);
+            writer.Write(static_cast<uint32_t>(wUnary0), static_cast<uint32_t>(maxNumWunary0Bits));
         }
 
         if (zEnable)
         {
-            writer.Write(reinterpret_cast<const uint8_t*>(&zUnary), zUnaryLen);
+            writer.Write(static_cast<uint32_t>(zUnary), static_cast<uint32_t>(zUnaryLen));
         }
 
         if (wEnable && !unCompressed)
         {
-            writer.Write(reinterpret_cast<const uint8_t*>(&wUnary1), wUnary1Len);
+            writer.Write(static_cast<uint32_t>(wUnary1), static_cast<uint32_t>(wUnary1Len));
         }
 
         if (!wRemain[rmdPrevIdx].empty())
         {
-            std::vector<int32_t>::iterator it;
-            for (it = wRemain[rmdPrevIdx].begin(); it != wRemain[rmdPrevIdx].end(); ++it)
-            {
-                assert(*it <= 31 || unCompressed);
-                int32_t value = *it;
-                writer.Write(reinterpret_cast<const uint8_t*>(&value), wDivisor);
-            }
-
+            assert(unCompressed || *std::max_element(wRemain[rmdPrevIdx].begin(), wRemain[rmdPrevIdx].end()) <= 31);
+            WritePacked(writer, wRemain[rmdPrevIdx], static_cast<uint32_t>(wDivisor));
             wRemain[rmdPrevIdx].clear();
         }
 
         if (!zRemain[rmdPrevIdx].empty())
         {
-            std::vector<int32_t>::iterator it;
-            for (it = zRemain[rmdPrevIdx].begin(); it != zRemain[rmdPrevIdx].end(); ++it)
-            {
-                assert(*it <= 7);
-                writer.Write(static_cast<uint8_t>(*it), zDivisor);
-            }
-
+            assert(*std::max_element(zRemain[rmdPrevIdx].begin(), zRemain[rmdPrevIdx].end()) <= 7);
+            WritePacked(writer, zRemain[rmdPrevIdx], static_cast<uint32_t>(zDivisor));
             zRemain[rmdPrevIdx].clear();
         }
 
@@ -1626,30 +1489,45 @@ void WeightEncoderV2::WritePayloadHeader(BitstreamWriter& writer,
     }
 }
 
+EncodedWeightsSizes GetSizes(const EncodedWeights& encodedWeights)
+{
+    EncodedWeightsSizes sizes;
+    sizes.m_NumStripes      = static_cast<uint32_t>(encodedWeights.m_Metadata.size());
+    sizes.m_FirstStripeSize = encodedWeights.m_Metadata.empty() ? 0 : encodedWeights.m_Metadata[0].m_Size;
+    sizes.m_MaxStripeSize   = encodedWeights.m_MaxSize;
+    sizes.m_TotalSize       = static_cast<uint32_t>(encodedWeights.m_Data.size());
+    return sizes;
+}
+
 /*
  * Weight encoder base class
  */
-std::unique_ptr<WeightEncoder> WeightEncoder::CreateWeightEncoder(const HardwareCapabilities& capabilities)
+std::unique_ptr<WeightEncoder> WeightEncoder::CreateWeightEncoder(const HardwareCapabilities& capabilities,
+                                                                  ThreadPool* threadPool)
 {
     const uint32_t version = capabilities.GetWeightCompressionVersion();
 
+    std::unique_ptr<WeightEncoder> encoder;
     if (version == 0)
     {
-        return std::make_unique<WeightEncoderV1>(capabilities);
+        encoder = std::make_unique<WeightEncoderV1>(capabilities);
     }
     else if (version == 1)
     {
-        return std::make_unique<WeightEncoderV2>(capabilities);
+        encoder = std::make_unique<WeightEncoderV2>(capabilities);
     }
     else
     {
         throw VersionMismatchException(std::string("Unsupported weight compressor version: ") +
                                        std::to_string(version));
     }
+    encoder->m_ThreadPool = threadPool;
+    return encoder;
 }
 
 WeightEncoder::WeightEncoder(const HardwareCapabilities& capabilities)
     : m_Capabilities(capabilities)
+    , m_ThreadPool(nullptr)
 {}
 
 EncodedWeights WeightEncoder::Encode(const MceOperationNode& mceOperation,
@@ -1774,45 +1652,48 @@ EncodedWeights WeightEncoder::Encode(const TensorInfo& weightsTensorInfo,
     encodedStreams.resize(numOfms * numIterationsOfm);
     const auto numWeightScales = weightsTensorInfo.m_QuantizationInfo.GetScales().size();
 
-    // Process each OG independently
-    std::vector<std::future<void>> waitHandles(numOfmInParallel);
-    for (size_t og = 0; og < numOfmInParallel; ++og)
+    // Process each OG independently (in parallel, if there is a thread pool).
+    // The compression parameters chosen for each OFM depend on those of the previous OFM in the same OG, so the OFMs
+    // of an OG are always encoded in order by a single task. This keeps the result independent of the thread count.
+    const auto encodeOg = [&](size_t og) {
+        for (uint32_t ofm : perOgOfms[og])
+        {
+            const uint32_t iteration = ofm % numIterationsOfm;
+            const uint32_t ofmIdx    = ofm / numIterationsOfm;
+
+            // Calculate encoding parameters from the various quantization infos
+            EncodingParams params;
+            double overallScale =
+                (inputQuantizationInfo.GetScale() *
+                 weightsTensorInfo.m_QuantizationInfo.GetScale(numWeightScales > 1 ? ofmIdx : 0)) /
+                outputQuantizationInfo.GetScale();
+            utils::CalculateQuantizedMultiplierSmallerThanOne(overallScale, params.m_OfmScaleFactor,
+                                                              params.m_OfmShift);
+
+            params.m_OfmShift += GetOfmShiftOffset();
+
+            params.m_OfmBias         = biasData[ofmIdx];
+            params.m_OfmZeroPoint    = outputQuantizationInfo.GetZeroPoint();
+            params.m_FilterZeroPoint = weightsTensorInfo.m_QuantizationInfo.GetZeroPoint();
+
+            EncodedOfm encodedOfm =
+                EncodeOfm(weightsData, ofmIdx, numOfmInParallel, numIterationsOfm, stripeDepth, iteration,
+                          weightsTensorInfo, strideY, strideX, paddingTop, paddingLeft, iterationSize,
+                          operation, algorithm, params, compressionParams);
+
+            encodedStreams[ofm] = std::move(encodedOfm);
+        }
+    };
+    if (m_ThreadPool != nullptr)
     {
-        waitHandles[og] = std::async(
-            [&](size_t og) {
-                for (uint32_t ofm : perOgOfms[og])
-                {
-                    const uint32_t iteration = ofm % numIterationsOfm;
-                    const uint32_t ofmIdx    = ofm / numIterationsOfm;
-
-                    // Calculate encoding parameters from the various quantization infos
-                    EncodingParams params;
-                    double overallScale =
-                        (inputQuantizationInfo.GetScale() *
-                         weightsTensorInfo.m_QuantizationInfo.GetScale(numWeightScales > 1 ? ofmIdx : 0)) /
-                        outputQuantizationInfo.GetScale();
-                    utils::CalculateQuantizedMultiplierSmallerThanOne(overallScale, params.m_OfmScaleFactor,
-                                                                      params.m_OfmShift);
-
-                    params.m_OfmShift += GetOfmShiftOffset();
-
-                    params.m_OfmBias         = biasData[ofmIdx];
-                    params.m_OfmZeroPoint    = outputQuantizationInfo.GetZeroPoint();
-                    params.m_FilterZeroPoint = weightsTensorInfo.m_QuantizationInfo.GetZeroPoint();
-
-                    EncodedOfm encodedOfm =
-                        EncodeOfm(weightsData, ofmIdx, numOfmInParallel, numIterationsOfm, stripeDepth, iteration,
-                                  weightsTensorInfo, strideY, strideX, paddingTop, paddingLeft, iterationSize,
-                                  operation, algorithm, params, compressionParams);
-
-                    encodedStreams[ofm] = std::move(encodedOfm);
-                }
-            },
-            og);
+        m_ThreadPool->ParallelFor(numOfmInParallel, encodeOg);
     }
-    for (const auto& h : waitHandles)
+    else
     {
-        h.wait();
+        for (size_t og = 0; og < numOfmInParallel; ++og)
+        {
+            encodeOg(og);
+        }
     }
 
     constexpr uint32_t dmaEngineAlignment = 16;
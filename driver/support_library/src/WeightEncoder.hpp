@@ -1,5 +1,5 @@
 //
-// Copyright © 2018-2020 Arm Limited. All rights reserved.
+// Copyright © 2018-2021 Arm Limited. All rights reserved.
 // SPDX-License-Identifier: Apache-2.0
 //
 
@@ -7,6 +7,7 @@
 
 #include "GraphNodes.hpp"
 #include "Network.hpp"
+#include "ThreadPool.hpp"
 
 #include <cstdint>
 #include <memory>
@@ -37,13 +38,28 @@ struct EncodedWeights
     std::vector<uint8_t> m_Data;
 };
 
+/// The sizes of some encoded weights, which is all that is needed to allocate and estimate them.
+/// Unlike the weights themselves, these can be estimated cheaply (see WeightEncoderCache::EncodeLazily).
+struct EncodedWeightsSizes
+{
+    uint32_t m_NumStripes;
+    uint32_t m_FirstStripeSize;
+    uint32_t m_MaxStripeSize;
+    uint32_t m_TotalSize;
+};
+
+EncodedWeightsSizes GetSizes(const EncodedWeights& encodedWeights);
+
 class WeightEncoder
 {
 public:
     /**
      * Factory function that selects which weight encoder to use based on the hardware capabilities.
+     * If a thread pool is given, the OGs of each call to Encode are encoded in parallel on it, otherwise they are
+     * encoded one after another on the calling thread. The encoded weights are the same either way.
      */
-    static std::unique_ptr<WeightEncoder> CreateWeightEncoder(const HardwareCapabilities& capabilities);
+    static std::unique_ptr<WeightEncoder> CreateWeightEncoder(const HardwareCapabilities& capabilities,
+                                                              ThreadPool* threadPool = nullptr);
 
     WeightEncoder(const HardwareCapabilities& capabilities);
 
@@ -191,6 +207,9 @@ protected:
 
     /// Hardware capabilities.
     const HardwareCapabilities& m_Capabilities;
+
+    /// Pool to encode OGs in parallel on, or nullptr to encode them serially. Not owned.
+    ThreadPool* m_ThreadPool;
 };
 
 }    // namespace support_library
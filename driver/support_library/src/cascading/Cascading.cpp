@@ -12,11 +12,15 @@
 #include "Estimation.hpp"
 #include "EstimationUtils.hpp"
 #include "Part.hpp"
+#include "WeightEncoderCache.hpp"
+#include "../ThreadPool.hpp"
 
 #include "../include/ethosn_support_library/Optional.hpp"
 #include <ethosn_utils/Filesystem.hpp>
 
+#include <algorithm>
 #include <fstream>
+#include <functional>
 #include <iostream>
 
 using namespace std;
@@ -149,14 +153,69 @@ GraphOfParts CreateGraphOfParts(const Graph& graph,
     return graphOfParts;
 }
 
-void CreatePlans(Parts& parts)
+namespace
+{
+
+void CreatePlansImpl(Parts& parts, ThreadPool& threadPool, const std::function<void(Part&)>& createPlans)
 {
-    for (auto& part : parts)
+    if (threadPool.GetNumThreads() == 1 || parts.size() < 2)
+    {
+        for (auto& part : parts)
+        {
+            createPlans(*part);
+        }
+        return;
+    }
+
+    // Each Part's plans are generated independently, so the Parts can be processed in parallel.
+    // To keep the debug ids (and therefore the debug output) identical to the serial case, each Part numbers its
+    // objects from zero using a thread-local counter and they are shifted into place afterwards, in Part order.
+    std::vector<int> numDebugIds(parts.size(), 0);
+    threadPool.ParallelFor(parts.size(), [&](size_t i) {
+        struct ScopedCounter
+        {
+            ScopedCounter(int* counter)
+            {
+                DebuggableObject::ms_ThreadIdCounter = counter;
+            }
+            ~ScopedCounter()
+            {
+                DebuggableObject::ms_ThreadIdCounter = nullptr;
+            }
+        } scopedCounter(&numDebugIds[i]);
+        createPlans(*parts[i]);
+    });
+
+    for (size_t i = 0; i < parts.size(); ++i)
     {
-        part->CreatePlans();
+        const int offset = DebuggableObject::ms_IdCounter;
+        for (auto& plan : parts[i]->m_Plans)
+        {
+            plan->OffsetDebugId(offset);
+            for (Op* op : plan->m_OpGraph.GetOps())
+            {
+                op->OffsetDebugId(offset);
+            }
+            for (Buffer* buffer : plan->m_OpGraph.GetBuffers())
+            {
+                buffer->OffsetDebugId(offset);
+            }
+        }
+        DebuggableObject::ms_IdCounter += numDebugIds[i];
     }
+}
+
+}    // namespace
+
+void CreatePlans(Parts& parts, uint32_t numThreads)
+{
+    ThreadPool threadPool(numThreads);
+    CreatePlansImpl(parts, threadPool, [](Part& part) { part.CreatePlans(); });
+}
 
-    return;
+void CreatePlans(Parts& parts, ThreadPool& threadPool, WeightEncoderCache& weightEncoderCache)
+{
+    CreatePlansImpl(parts, threadPool, [&weightEncoderCache](Part& part) { part.CreatePlans(weightEncoderCache); });
 }
 
 Cascading::Cascading(const EstimationOptions& estOpt,
@@ -173,6 +232,7 @@ Cascading::~Cascading()
 
 NetworkPerformanceData Cascading::Estimate(Graph& graph)
 {
+    DebuggableObject::ms_IdCounter = 0;
     m_GraphOfParts = CreateGraphOfParts(graph, m_EstimationOptions, m_CompilationOptions, m_Capabilities);
 
     m_DebuggingContext.SaveGraphToDot(CompilationOptions::DebugLevel::Medium, graph, &m_GraphOfParts,
@@ -180,7 +240,13 @@ NetworkPerformanceData Cascading::Estimate(Graph& graph)
     m_DebuggingContext.SaveGraphToDot(CompilationOptions::DebugLevel::Medium, graph, &m_GraphOfParts,
                                       "Cascaded_GraphOfPartsDetailed.dot", DetailLevel::High);
 
-    CreatePlans(m_GraphOfParts.m_Parts);
+    // Identical layers in different Parts share their encoded weights. Parts and the weight encodings within
+    // them share one pool of threads, so that the number of threads is bounded however much is run in parallel.
+    // Plans only estimate the size of their weights, which are encoded once a combination has been chosen.
+    m_ThreadPool         = std::make_unique<ThreadPool>(m_CompilationOptions.m_NumThreads);
+    m_WeightEncoderCache = std::make_shared<WeightEncoderCache>(
+        m_Capabilities, m_CompilationOptions.m_WeightEncoderCacheDir, m_ThreadPool.get());
+    CreatePlans(m_GraphOfParts.m_Parts, *m_ThreadPool, *m_WeightEncoderCache);
 
     if (m_DebuggingContext.m_DebugInfo->m_DumpDebugFiles >= CompilationOptions::DebugLevel::Medium)
     {
@@ -203,7 +269,9 @@ NetworkPerformanceData Cascading::Estimate(Graph& graph)
         }
     }
 
-    m_ValidCombinations = Combine(m_GraphOfParts);
+    m_ValidCombinations = m_CompilationOptions.m_CompilerAlgorithm == CompilerAlgorithm::CascadingBeamSearchOnly
+                              ? CombineBeamSearch(m_GraphOfParts)
+                              : Combine(m_GraphOfParts);
 
     if (m_DebuggingContext.m_DebugInfo->m_DumpDebugFiles >= CompilationOptions::DebugLevel::High)
     {
@@ -237,52 +305,108 @@ const ethosn::support_library::Combination* Cascading::GetBestCombination()
     return m_BestCombination;
 }
 
+void Cascading::EncodeWeights(const OpGraph& opGraph)
+{
+    std::vector<LazyEncodedWeights*> weights;
+    for (Buffer* buffer : opGraph.GetBuffers())
+    {
+        if (buffer->m_EncodedWeights)
+        {
+            weights.push_back(buffer->m_EncodedWeights.get());
+        }
+    }
+    m_ThreadPool->ParallelFor(weights.size(), [&weights](size_t i) { weights[i]->Encode(); });
+}
+
 void Cascading::EstimatePerformance()
 {
+    assert(m_EstimationCache);
+
     std::ofstream debugPerformanceDumpFile;
     if (m_DebuggingContext.m_DebugInfo->m_DumpDebugFiles >= CompilationOptions::DebugLevel::Medium)
     {
         debugPerformanceDumpFile.open(m_DebuggingContext.GetAbsolutePathOutputFileName("Cascaded_Performance.txt"));
     }
+
+    // Rank the combinations using the per-Part estimates, most of which were already made while combining.
+    // Only the best one then needs its whole OpGraph estimating to get the full performance data.
+    std::vector<std::pair<DataMetrics, uint32_t>> rankedCombinations;
     uint32_t combinationIdx = 0;
-    utils::Optional<uint32_t> bestCombinationIdx;
     for (const Combination& combination : m_ValidCombinations)
     {
-        try
+        utils::Optional<DataMetrics> metrics = m_EstimationCache->EstimateCombination(combination);
+        if (metrics.has_value())
         {
-            OpGraph combiOpGraph = GetOpGraphForCombination(combination, m_GraphOfParts);
-            EstimatedOpGraph curNetPerfData =
-                ethosn::support_library::EstimateOpGraph(combiOpGraph, m_Capabilities, GetEstimationOptions());
+            rankedCombinations.push_back({ metrics.value(), combinationIdx });
+        }
 
-            if (m_DebuggingContext.m_DebugInfo->m_DumpDebugFiles >= CompilationOptions::DebugLevel::Medium)
+        if (m_DebuggingContext.m_DebugInfo->m_DumpDebugFiles >= CompilationOptions::DebugLevel::Medium)
+        {
+            if (metrics.has_value())
+            {
+                debugPerformanceDumpFile << combinationIdx << ": " << metrics.value().m_Total << std::endl;
+            }
+            else
+            {
+                debugPerformanceDumpFile << combinationIdx << ": Error: Not all Parts could be estimated" << std::endl;
+            }
+            if (m_DebuggingContext.m_DebugInfo->m_DumpDebugFiles >= CompilationOptions::DebugLevel::High)
             {
-                debugPerformanceDumpFile << combinationIdx << ": "
-                                         << GetPerformanceTotalDataMetric(curNetPerfData.m_PerfData) << std::endl;
-                if (m_DebuggingContext.m_DebugInfo->m_DumpDebugFiles >= CompilationOptions::DebugLevel::High)
+                try
                 {
+                    OpGraph combiOpGraph = GetOpGraphForCombination(combination, m_GraphOfParts);
+                    EstimatedOpGraph curNetPerfData =
+                        ethosn::support_library::EstimateOpGraph(combiOpGraph, m_Capabilities, GetEstimationOptions());
                     std::string folder = "Combinations/" + std::to_string(combinationIdx);
                     SaveDebugFilesForEstimatedCombination(folder, m_DebuggingContext, combiOpGraph, curNetPerfData);
                 }
+                catch (const NotSupportedException&)
+                {}
             }
+        }
 
-            if (!bestCombinationIdx.has_value() ||
-                IsLeftMoreDataPerformantThanRight(curNetPerfData.m_PerfData, m_PerformanceStream))
-            {
-                m_PerformanceStream = curNetPerfData.m_PerfData;
-                m_BestCombination   = &combination;
-                bestCombinationIdx  = combinationIdx;
-            }
+        ++combinationIdx;
+    }
+    std::stable_sort(rankedCombinations.begin(), rankedCombinations.end(),
+                     [](const std::pair<DataMetrics, uint32_t>& l, const std::pair<DataMetrics, uint32_t>& r) {
+                         return l.first < r.first;
+                     });
+
+    utils::Optional<uint32_t> bestCombinationIdx;
+    for (const auto& ranked : rankedCombinations)
+    {
+        const Combination& combination = m_ValidCombinations[ranked.second];
+        try
+        {
+            OpGraph combiOpGraph = GetOpGraphForCombination(combination, m_GraphOfParts);
+            EncodeWeights(combiOpGraph);
+            m_PerformanceStream =
+                ethosn::support_library::EstimateOpGraph(combiOpGraph, m_Capabilities, GetEstimationOptions())
+                    .m_PerfData;
+            m_BestCombination  = &combination;
+            bestCombinationIdx = ranked.second;
+            break;
         }
         catch (const NotSupportedException& e)
         {
-            // Ignore this combination - others may still be valid
+            // Try the next best combination
             if (m_DebuggingContext.m_DebugInfo->m_DumpDebugFiles >= CompilationOptions::DebugLevel::Medium)
             {
-                debugPerformanceDumpFile << combinationIdx << ": Error: " << e.what() << std::endl;
+                debugPerformanceDumpFile << ranked.second << ": Error: " << e.what() << std::endl;
             }
         }
+    }
 
-        ++combinationIdx;
+    if (m_DebuggingContext.m_DebugInfo->m_DumpDebugFiles >= CompilationOptions::DebugLevel::Medium)
+    {
+        const uint64_t numLookups = m_EstimationCache->GetNumHits() + m_EstimationCache->GetNumMisses();
+        std::ofstream debugCacheDumpFile(
+            m_DebuggingContext.GetAbsolutePathOutputFileName("Cascaded_EstimationCache.txt"));
+        debugCacheDumpFile << "Hits: " << m_EstimationCache->GetNumHits() << std::endl;
+        debugCacheDumpFile << "Misses: " << m_EstimationCache->GetNumMisses() << std::endl;
+        debugCacheDumpFile << "Hit rate: "
+                           << (numLookups > 0 ? 100 * m_EstimationCache->GetNumHits() / numLookups : 0) << "%"
+                           << std::endl;
     }
 
     if (m_DebuggingContext.m_DebugInfo->m_DumpDebugFiles >= CompilationOptions::DebugLevel::Medium)
@@ -1,14 +1,17 @@
 //
-// Copyright © 2018-2020 Arm Limited. All rights reserved.
+// Copyright © 2018-2021 Arm Limited. All rights reserved.
 // SPDX-License-Identifier: Apache-2.0
 //
 
 #pragma once
 
+#include "../ThreadPool.hpp"
 #include "Combiner.hpp"
 #include "IEstimationStrategy.hpp"
 #include "Part.hpp"
 
+#include <memory>
+
 namespace ethosn
 {
 namespace support_library
@@ -18,6 +21,7 @@ class Graph;
 class HardwareCapabilities;
 struct EstimationOptions;
 struct DebuggingContext;
+class WeightEncoderCache;
 
 class Cascading : public IEstimationStrategy
 {
@@ -28,18 +32,26 @@ public:
     const GraphOfParts& GetGraphOfParts() const;
 
     Combinations Combine(const GraphOfParts&);
+    Combinations CombineBeamSearch(const GraphOfParts&);
     NetworkPerformanceData Estimate(Graph& graph) override;
 
     const Combination* GetBestCombination();
 
 private:
     void EstimatePerformance();
+    void EncodeWeights(const OpGraph& opGraph);
 
     NetworkPerformanceData m_PerformanceStream;
     const Combination* m_BestCombination;
     Metadata m_Metadata;
     Combinations m_ValidCombinations;
+    /// Declared before m_GraphOfParts, as the plans' weights are encoded on it (through m_WeightEncoderCache) and so
+    /// it must outlive them.
+    std::unique_ptr<ThreadPool> m_ThreadPool;
     GraphOfParts m_GraphOfParts;
+    std::shared_ptr<WeightEncoderCache> m_WeightEncoderCache;
+    /// Shared by Combine and EstimatePerformance, so that estimates made while combining are reused.
+    std::unique_ptr<EstimationCache> m_EstimationCache;
 };
 
 GraphOfParts CreateGraphOfParts(const Graph& graph,
@@ -47,5 +59,11 @@ GraphOfParts CreateGraphOfParts(const Graph& graph,
                                 const CompilationOptions& compOpt,
                                 const HardwareCapabilities& capabilities);
 
+/// Generates the plans for each of the given Parts, using up to numThreads threads (0 means one per hardware thread).
+/// The result does not depend on the number of threads used.
+void CreatePlans(Parts& parts, uint32_t numThreads);
+/// As above, but running on the given thread pool, with all the Parts encoding weights through the given cache.
+void CreatePlans(Parts& parts, ThreadPool& threadPool, WeightEncoderCache& weightEncoderCache);
+
 }    // namespace support_library
 }    // namespace ethosn
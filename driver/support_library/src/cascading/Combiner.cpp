@@ -51,12 +51,12 @@ AddedSeed AddSeed(const PlanId fPlId,
                   const bool canMerge)
 {
     Allocated allocated;
-    Combination result            = comb;
-    Scratch::Indexes::iterator it = result.m_Scratch.m_Idx.find(fPaId);
+    Combination result = comb;
 
     alloc.Reset();
 
-    const bool update = (it != result.m_Scratch.m_Idx.end());
+    // Parts are added in topological order, so if the first Part is already in the combination it is the last one
+    const bool update = !result.m_Elems.empty() && result.m_Elems.back().m_PartId == fPaId;
 
     const Plan& sPl            = part.GetPlan(sPlId);
     const SizeInBytes sTotSize = GetTotSizeInBytes(sPl);
@@ -78,7 +78,7 @@ AddedSeed AddSeed(const PlanId fPlId,
 
     if (update)
     {
-        Elem& el = result.m_Elems.at(it->second);
+        Elem& el = result.m_Elems.back();
         el.m_Glues.insert(std::make_pair(sEdge, Elem::Link{ sPlId, glue }));
     }
     else
@@ -99,13 +99,6 @@ AddedSeed AddSeed(const PlanId fPlId,
 
     result.m_Scratch.m_AllocatedSram = allocatedSram - (canMerge ? sInSize.m_TotAtomic : 0U);
 
-    if (!update)
-    {
-        // Update the current combination indexes
-        result.m_Scratch.m_Idx.insert(
-            std::make_pair(fPaId, (result.GetNumElems() > 0) ? (result.GetNumElems() - 1U) : 0));
-    }
-
     if (canMerge)
     {
         ++result.m_Scratch.m_Score;
@@ -133,12 +126,13 @@ NxtPa GetNxtPart(const PartId id, const size_t max, const Combination& comb, con
     }
 
     const MetadataOfPart& mOfPa = metadata.at(id);
+    Scratch::Dst& done          = result.m_Comb.m_Scratch.m_Edges;
 
     if (mOfPa.m_Destination.size() == 0)
     {
         result.m_Dst   = nullptr;
         result.m_Found = false;
-        result.m_Comb.m_Scratch.m_Edges.insert(std::make_pair(id, Scratch::Dst{}));
+        done.clear();
         result.m_Comb.m_Scratch.m_CurrPartId = id + 1U;
         return result;
     }
@@ -148,12 +142,9 @@ NxtPa GetNxtPart(const PartId id, const size_t max, const Combination& comb, con
     std::pair<const Edge*, PartId> lowestDstPart(nullptr, std::numeric_limits<PartId>::max());
     for (const auto& it : mOfPa.m_Destination)
     {
-        const Edge* edge             = it.first;
-        Scratch::Edges::iterator eIt = result.m_Comb.m_Scratch.m_Edges.find(id);
-        const bool saved             = (eIt != result.m_Comb.m_Scratch.m_Edges.end());
-        Scratch::Dst dst             = saved ? (eIt->second) : Scratch::Dst{};
-        const bool done              = (std::find(std::begin(dst), std::end(dst), edge) != std::end(dst));
-        if (!done && it.second < lowestDstPart.second)
+        const Edge* edge  = it.first;
+        const bool isDone = (std::find(std::begin(done), std::end(done), edge) != std::end(done));
+        if (!isDone && it.second < lowestDstPart.second)
         {
             lowestDstPart.first  = it.first;
             lowestDstPart.second = it.second;
@@ -164,20 +155,16 @@ NxtPa GetNxtPart(const PartId id, const size_t max, const Combination& comb, con
         return result;
     }
 
-    const Edge* edge             = lowestDstPart.first;
-    Scratch::Edges::iterator eIt = result.m_Comb.m_Scratch.m_Edges.find(id);
-    const bool saved             = (eIt != result.m_Comb.m_Scratch.m_Edges.end());
-    if (saved)
-    {
-        (eIt->second).push_back(edge);
-    }
-    else
-    {
-        result.m_Comb.m_Scratch.m_Edges.insert(std::make_pair(id, Scratch::Dst{ { edge } }));
-    }
-    const bool last = (mOfPa.m_Destination.size() == (result.m_Comb.m_Scratch.m_Edges.find(id)->second).size());
+    const Edge* edge = lowestDstPart.first;
+    done.push_back(edge);
+    const bool last = (mOfPa.m_Destination.size() == done.size());
     result.m_Dst    = edge;
     result.m_Found  = true;
+    if (last)
+    {
+        // Moving on to the next Part, which hasn't been grown along any of its Edges yet
+        done.clear();
+    }
     result.m_Comb.m_Scratch.m_CurrPartId = last ? (id + 1U) : id;
     return result;
 }
@@ -202,14 +189,11 @@ PlanFromSource GetPlanFromSource(PartId id, const Combination& comb, const Metad
     SrcPart::const_iterator it = mOfPa.m_Source.begin();
     while (it != mOfPa.m_Source.end())
     {
-        const PartId src                       = it->second;
-        Scratch::Indexes::const_iterator idxIt = comb.m_Scratch.m_Idx.find(src);
-        if (idxIt != comb.m_Scratch.m_Idx.end())
+        const Elem* el = comb.m_Elems.Find(it->second);
+        if (el != nullptr)
         {
-            size_t combIdx                   = idxIt->first;
-            const Elem& el                   = comb.m_Elems.at(combIdx);
-            Elem::Glues::const_iterator glIt = el.m_Glues.find(it->first);
-            if (glIt != el.m_Glues.end())
+            Elem::Glues::const_iterator glIt = el->m_Glues.find(it->first);
+            if (glIt != el->m_Glues.end())
             {
                 result.m_Id    = (glIt->second).m_Id;
                 result.m_Found = true;
@@ -646,43 +630,42 @@ Combination PruneCombinations(const GraphOfParts& parts,
                               const HardwareCapabilities& caps,
                               const Metadata& metadata,
                               const Combinations& combs,
-                              const EstimationOptions& estimationOpts,
+                              EstimationCache& estimationCache,
                               const DebuggingContext& debuggingContext,
                               const std::string folder)
 {
     if (combs.size() > 0)
     {
         utils::Optional<Combination> result;
-        NetworkPerformanceData refNetPerfData;
+        DataMetrics refMetrics;
         std::vector<uint64_t> stats = {};
         size_t combinationNumber    = 0;
         for (const Combination& combination : combs)
         {
-            try
+            GrownSeeds local = GrowSeeds({ combination }, parts, metadata, caps, GrowScheme::DramOnly, true);
+            // Most of the Parts will be the same as in the other combinations, so these estimates are mostly cached
+            utils::Optional<DataMetrics> curMetrics;
+            if (!local.m_Combinations.empty())
             {
-                GrownSeeds local = GrowSeeds({ combination }, parts, metadata, caps, GrowScheme::DramOnly, true);
-                if (!local.m_Combinations.empty())
+                curMetrics = estimationCache.EstimateCombination(local.m_Combinations.front());
+            }
+            if (curMetrics.has_value())
+            {
+                if (debuggingContext.m_DebugInfo->m_DumpDebugFiles >= CompilationOptions::DebugLevel::High)
                 {
-                    OpGraph combiOpGraph = GetOpGraphForCombination(local.m_Combinations.front(), parts);
-                    EstimatedOpGraph curNetPerfData =
-                        ethosn::support_library::EstimateOpGraph(combiOpGraph, caps, estimationOpts);
-                    if (debuggingContext.m_DebugInfo->m_DumpDebugFiles >= CompilationOptions::DebugLevel::High)
-                    {
-                        stats.push_back(combinationNumber);
-                        stats.push_back(GetPerformanceTotalDataMetric(curNetPerfData.m_PerfData));
-                        stats.push_back(GetPerformanceNonParallelDataMetric(curNetPerfData.m_PerfData));
-                        stats.push_back(GetPerformanceNumberOfPassesMetric(curNetPerfData.m_PerfData));
-                    }
+                    stats.push_back(combinationNumber);
+                    stats.push_back(curMetrics.value().m_Total);
+                    stats.push_back(curMetrics.value().m_NonParallel);
+                    stats.push_back(curMetrics.value().m_NumPasses);
+                }
 
-                    if (!result.has_value() ||
-                        IsLeftMoreDataPerformantThanRight(curNetPerfData.m_PerfData, refNetPerfData))
-                    {
-                        refNetPerfData = curNetPerfData.m_PerfData;
-                        result         = combination;
-                    }
+                if (!result.has_value() || curMetrics.value() < refMetrics)
+                {
+                    refMetrics = curMetrics.value();
+                    result     = combination;
                 }
             }
-            catch (const NotSupportedException&)
+            else if (!local.m_Combinations.empty())
             {
                 // Skip this combination
                 if (debuggingContext.m_DebugInfo->m_DumpDebugFiles >= CompilationOptions::DebugLevel::High)
@@ -705,8 +688,241 @@ Combination PruneCombinations(const GraphOfParts& parts,
     return Combination{};
 }
 
+/// A partial combination in the beam: a plan for each Part up to the one being processed,
+/// and the CompatiblePlan (i.e. the destination plan and glue) chosen for each Edge between them.
+struct BeamState
+{
+    std::vector<PlanId> m_Plans;
+    std::vector<const CompatiblePlan*> m_Links;
+    /// For each Part, the SRAM used by the section its plan ends, which a following Part continues if it merges
+    /// with it (see AddSeed). Parts are not visited in section order, so this can't be a single value.
+    std::vector<uint32_t> m_SectionSram;
+    /// Cost of the Parts whose inputs and outputs have all been decided.
+    DataMetrics m_Cost;
+    /// Cost of the other Parts, estimated as if their outputs were left where their plans put them.
+    /// These are replaced with the real cost once the outputs are known.
+    std::vector<std::pair<PartId, DataMetrics>> m_Provisional;
+
+    DataMetrics GetRankingCost() const
+    {
+        DataMetrics result = m_Cost;
+        for (const auto& p : m_Provisional)
+        {
+            result += p.second;
+        }
+        return result;
+    }
+};
+
+/// Static information about the connections in the GraphOfParts, looked up for every state in the beam.
+struct BeamTopology
+{
+    struct Connection
+    {
+        const Edge* m_Edge;
+        PartId m_Part;
+        size_t m_EdgeIdx;
+    };
+
+    explicit BeamTopology(const GraphOfParts& parts, const Metadata& metadata)
+        : m_Inputs(parts.GetNumParts())
+        , m_Outputs(parts.GetNumParts())
+        , m_FinalisedAt(parts.GetNumParts())
+        , m_NumEdges(0)
+    {
+        const PartId numParts = static_cast<PartId>(parts.GetNumParts());
+        std::unordered_map<const Edge*, size_t> edgeIdxs;
+        for (PartId p = 0; p < numParts; ++p)
+        {
+            const MetadataOfPart& mOfPa = metadata.at(p);
+            PartId lastUser             = p;
+            for (const Edge* edge : parts.GetPart(p).GetOutputs())
+            {
+                const PartId dst = mOfPa.m_Destination.at(edge);
+                edgeIdxs[edge]   = m_NumEdges;
+                m_Outputs[p].push_back(Connection{ edge, dst, m_NumEdges });
+                lastUser = std::max(lastUser, dst);
+                ++m_NumEdges;
+            }
+            m_FinalisedAt[lastUser].push_back(p);
+        }
+        for (PartId p = 0; p < numParts; ++p)
+        {
+            for (const Edge* edge : parts.GetPart(p).GetInputs())
+            {
+                m_Inputs[p].push_back(Connection{ edge, metadata.at(p).m_Source.at(edge), edgeIdxs.at(edge) });
+            }
+        }
+    }
+
+    std::vector<std::vector<Connection>> m_Inputs;
+    std::vector<std::vector<Connection>> m_Outputs;
+    /// For each Part, the Parts whose cost becomes known once a plan has been chosen for it
+    /// (i.e. the Parts for which it is the last destination).
+    std::vector<std::vector<PartId>> m_FinalisedAt;
+    size_t m_NumEdges;
+};
+
+/// Estimates a single Part using the plans and links chosen around it in the given state.
+utils::Optional<DataMetrics> EstimateBeamPart(EstimationCache& cache,
+                                              const BeamTopology& topology,
+                                              PartId partId,
+                                              const BeamState& state,
+                                              bool complete)
+{
+    std::vector<EstimationCache::Connection> inputs;
+    for (const auto& in : topology.m_Inputs[partId])
+    {
+        inputs.push_back({ state.m_Plans[in.m_Part], &state.m_Links[in.m_EdgeIdx]->m_Glue });
+    }
+    std::vector<utils::Optional<EstimationCache::Connection>> outputs;
+    for (const auto& out : topology.m_Outputs[partId])
+    {
+        const CompatiblePlan* link = state.m_Links[out.m_EdgeIdx];
+        outputs.push_back(link != nullptr ? utils::Optional<EstimationCache::Connection>(
+                                                EstimationCache::Connection{ link->m_Id, &link->m_Glue })
+                                          : utils::Optional<EstimationCache::Connection>());
+    }
+    return cache.EstimatePart(partId, state.m_Plans[partId], inputs, outputs, complete);
+}
+
+/// Appends to 'result' every way of linking the inputs of a Part (from input number 'inputIdx' onwards) to the
+/// given plan of that Part.
+void GetInputLinks(const BeamState& state,
+                   const std::vector<BeamTopology::Connection>& inputs,
+                   const Metadata& metadata,
+                   PlanId planId,
+                   size_t inputIdx,
+                   std::vector<const CompatiblePlan*>& current,
+                   std::vector<std::vector<const CompatiblePlan*>>& result)
+{
+    if (inputIdx == inputs.size())
+    {
+        result.push_back(current);
+        return;
+    }
+    const BeamTopology::Connection& in          = inputs[inputIdx];
+    const CompatiblePlansOfParts& comPlsOfPas   = metadata.at(in.m_Part).m_Comp;
+    CompatiblePlansOfParts::const_iterator edge = comPlsOfPas.find(in.m_Edge);
+    if (edge == comPlsOfPas.end())
+    {
+        return;
+    }
+    CompatiblePlansOfPart::const_iterator srcPlan = edge->second.find(state.m_Plans[in.m_Part]);
+    if (srcPlan == edge->second.end())
+    {
+        return;
+    }
+    for (const CompatiblePlan& comPl : srcPlan->second)
+    {
+        if (comPl.m_Id == planId)
+        {
+            current[inputIdx] = &comPl;
+            GetInputLinks(state, inputs, metadata, planId, inputIdx + 1, current, result);
+        }
+    }
+}
+
 }    // namespace
 
+Elem::Glues::Glues(std::initializer_list<value_type> glues)
+{
+    for (const value_type& glue : glues)
+    {
+        insert(glue);
+    }
+}
+
+Elem::Glues::iterator Elem::Glues::find(const Edge* edge)
+{
+    return std::find_if(m_Glues.begin(), m_Glues.end(), [edge](const value_type& g) { return g.first == edge; });
+}
+
+Elem::Glues::const_iterator Elem::Glues::find(const Edge* edge) const
+{
+    return std::find_if(m_Glues.begin(), m_Glues.end(), [edge](const value_type& g) { return g.first == edge; });
+}
+
+std::pair<Elem::Glues::iterator, bool> Elem::Glues::insert(const value_type& glue)
+{
+    iterator it = find(glue.first);
+    if (it != m_Glues.end())
+    {
+        return { it, false };
+    }
+    m_Glues.push_back(glue);
+    return { std::prev(m_Glues.end()), true };
+}
+
+Elem::Link& Elem::Glues::operator[](const Edge* edge)
+{
+    return insert({ edge, Link{} }).first->second;
+}
+
+void ElemList::push_back(Elem elem)
+{
+    m_Last = std::make_shared<Node>(Node{ std::move(elem), std::move(m_Last) });
+    ++m_Size;
+}
+
+const Elem& ElemList::back() const
+{
+    assert(m_Last);
+    return m_Last->m_Elem;
+}
+
+Elem& ElemList::back()
+{
+    assert(m_Last);
+    if (m_Last.use_count() > 1)
+    {
+        m_Last = std::make_shared<Node>(*m_Last);
+    }
+    return m_Last->m_Elem;
+}
+
+const Elem& ElemList::at(size_t idx) const
+{
+    if (idx >= m_Size)
+    {
+        throw std::out_of_range("ElemList::at");
+    }
+    const Node* node = m_Last.get();
+    for (size_t i = m_Size - 1; i > idx; --i)
+    {
+        node = node->m_Prev.get();
+    }
+    return node->m_Elem;
+}
+
+const Elem* ElemList::Find(PartId partId) const
+{
+    for (const Node* node = m_Last.get(); node != nullptr; node = node->m_Prev.get())
+    {
+        if (node->m_Elem.m_PartId == partId)
+        {
+            return &node->m_Elem;
+        }
+    }
+    return nullptr;
+}
+
+ElemList::const_iterator ElemList::begin() const
+{
+    auto elems = std::make_shared<std::vector<const Elem*>>(m_Size);
+    size_t idx = m_Size;
+    for (const Node* node = m_Last.get(); node != nullptr; node = node->m_Prev.get())
+    {
+        (*elems)[--idx] = &node->m_Elem;
+    }
+    return const_iterator(std::move(elems), 0);
+}
+
+ElemList::const_iterator ElemList::end() const
+{
+    return const_iterator(nullptr, m_Size);
+}
+
 PlanCompatibilityResult ArePlansCompatible(
     const Plan& plan1, const Plan& plan2, const Edge& edge, const HardwareCapabilities& hwCap, const bool forceGlue)
 {
@@ -1008,12 +1224,179 @@ GrownSeeds GrowSeeds(const Combinations& combs,
     return GrowSeeds(combs, parts, metadata, caps, scheme, false);
 }
 
+Combinations CombineBeamSearch(const GraphOfParts& parts,
+                               const Metadata& metadata,
+                               const HardwareCapabilities& caps,
+                               EstimationCache& cache,
+                               const size_t beamWidth)
+{
+    const PartId numParts = static_cast<PartId>(parts.GetNumParts());
+    const BeamTopology topology(parts, metadata);
+    SramAllocator alloc(caps.GetTotalSramSize() / caps.GetNumberOfSrams());
+
+    BeamState initialState;
+    initialState.m_Plans.resize(numParts, unassignedPlanId);
+    initialState.m_Links.resize(topology.m_NumEdges, nullptr);
+    initialState.m_SectionSram.resize(numParts, 0);
+    std::vector<BeamState> beam = { initialState };
+
+    for (PartId partId = 0; partId < numParts; ++partId)
+    {
+        const Part& part                                     = parts.GetPart(partId);
+        const std::vector<BeamTopology::Connection>& inputs  = topology.m_Inputs[partId];
+        const std::vector<BeamTopology::Connection>& outputs = topology.m_Outputs[partId];
+        const CompatiblePlansOfParts& outComp                = metadata.at(partId).m_Comp;
+
+        std::vector<BeamState> nextBeam;
+        // States which will behave identically from here on (same plans and section SRAM usage for the Parts which
+        // still have outputs to be decided) only need to be kept once, with the lowest cost.
+        std::map<std::vector<size_t>, size_t> equivalentStates;
+
+        for (const BeamState& state : beam)
+        {
+            for (PlanId planId = 0; planId < part.GetNumPlans(); ++planId)
+            {
+                // Skip plans that can't be connected to any plan of a following Part
+                bool hasOutputs = true;
+                for (const auto& out : outputs)
+                {
+                    auto edge  = outComp.find(out.m_Edge);
+                    hasOutputs = hasOutputs && edge != outComp.end() && edge->second.count(planId) > 0;
+                }
+                if (!hasOutputs)
+                {
+                    continue;
+                }
+
+                std::vector<const CompatiblePlan*> current(inputs.size(), nullptr);
+                std::vector<std::vector<const CompatiblePlan*>> inputLinks;
+                GetInputLinks(state, inputs, metadata, planId, 0, current, inputLinks);
+
+                for (const auto& links : inputLinks)
+                {
+                    // Check the section this plan ends up in still fits in SRAM, in the same way as AddSeed.
+                    const Plan& plan          = part.GetPlan(planId);
+                    const SizeInBytes totSize = GetTotSizeInBytes(plan);
+                    const SizeInBytes inSize  = GetInputsSizeInBytes(plan);
+                    bool canMerge             = inputs.size() == 1 && links[0]->m_Glue.m_Graph.GetOps().empty();
+                    if (canMerge)
+                    {
+                        const Plan& srcPlan = parts.GetPart(inputs[0].m_Part).GetPlan(state.m_Plans[inputs[0].m_Part]);
+                        canMerge            = !IsOutputBufferInDram(srcPlan, *inputs[0].m_Edge);
+                    }
+                    const uint32_t addSizeInBytes =
+                        canMerge ? (state.m_SectionSram[inputs[0].m_Part] + totSize.m_Tot - inSize.m_Tot)
+                                 : totSize.m_Tot;
+                    alloc.Reset();
+                    if (!alloc.Allocate(0, addSizeInBytes / caps.GetNumberOfSrams(), AllocationPreference::Start)
+                             .first)
+                    {
+                        continue;
+                    }
+
+                    BeamState next       = state;
+                    next.m_Plans[partId] = planId;
+                    for (size_t i = 0; i < inputs.size(); ++i)
+                    {
+                        next.m_Links[inputs[i].m_EdgeIdx] = links[i];
+                    }
+                    next.m_SectionSram[partId] = addSizeInBytes - (canMerge ? inSize.m_TotAtomic : 0U);
+
+                    bool valid = true;
+                    if (!outputs.empty())
+                    {
+                        utils::Optional<DataMetrics> provisional =
+                            EstimateBeamPart(cache, topology, partId, next, false);
+                        valid = provisional.has_value();
+                        if (valid)
+                        {
+                            next.m_Provisional.push_back({ partId, provisional.value() });
+                        }
+                    }
+                    for (PartId finalised : topology.m_FinalisedAt[partId])
+                    {
+                        if (!valid)
+                        {
+                            break;
+                        }
+                        utils::Optional<DataMetrics> cost = EstimateBeamPart(cache, topology, finalised, next, true);
+                        valid                             = cost.has_value();
+                        if (valid)
+                        {
+                            next.m_Cost += cost.value();
+                            auto provisional = std::find_if(
+                                next.m_Provisional.begin(), next.m_Provisional.end(),
+                                [finalised](const std::pair<PartId, DataMetrics>& p) { return p.first == finalised; });
+                            if (provisional != next.m_Provisional.end())
+                            {
+                                next.m_Provisional.erase(provisional);
+                            }
+                        }
+                    }
+                    if (!valid)
+                    {
+                        continue;
+                    }
+
+                    std::vector<size_t> key;
+                    for (const auto& p : next.m_Provisional)
+                    {
+                        key.push_back(p.first);
+                        key.push_back(next.m_Plans[p.first]);
+                        key.push_back(next.m_SectionSram[p.first]);
+                    }
+                    auto equivalent = equivalentStates.find(key);
+                    if (equivalent == equivalentStates.end())
+                    {
+                        equivalentStates.emplace(std::move(key), nextBeam.size());
+                        nextBeam.push_back(std::move(next));
+                    }
+                    else if (next.GetRankingCost() < nextBeam[equivalent->second].GetRankingCost())
+                    {
+                        nextBeam[equivalent->second] = std::move(next);
+                    }
+                }
+            }
+        }
+
+        std::stable_sort(nextBeam.begin(), nextBeam.end(), [](const BeamState& l, const BeamState& r) {
+            return l.GetRankingCost() < r.GetRankingCost();
+        });
+        if (nextBeam.size() > beamWidth)
+        {
+            nextBeam.erase(nextBeam.begin() + static_cast<std::ptrdiff_t>(beamWidth), nextBeam.end());
+        }
+        beam = std::move(nextBeam);
+    }
+
+    // All Parts have now been finalised, so the beam is ordered by the full cost, best first.
+    Combinations result;
+    for (const BeamState& state : beam)
+    {
+        Combination comb;
+        for (PartId partId = 0; partId < numParts; ++partId)
+        {
+            Elem elem{ partId, state.m_Plans[partId], {} };
+            for (const auto& out : topology.m_Outputs[partId])
+            {
+                const CompatiblePlan* link = state.m_Links[out.m_EdgeIdx];
+                elem.m_Glues.insert(std::make_pair(out.m_Edge, Elem::Link{ link->m_Id, &link->m_Glue }));
+            }
+            comb.m_Elems.push_back(std::move(elem));
+        }
+        result.push_back(std::move(comb));
+    }
+    return result;
+}
+
 Combinations Cascading::Combine(const GraphOfParts& parts)
 {
     m_Metadata = CreateMetadata(parts, m_Capabilities);
 
     DumpDebugInfo(parts, m_Metadata, m_DebuggingContext, "Metadata");
 
+    m_EstimationCache = std::make_unique<EstimationCache>(parts, m_Capabilities, GetEstimationOptions());
+
     Combinations currSeeds = CreateSeeds(parts, m_Metadata, m_Capabilities);
 
     // It contains "Merged in Sram" combinations
@@ -1040,7 +1423,7 @@ Combinations Cascading::Combine(const GraphOfParts& parts)
 
         // Take the best combination of the lot
         Combination pruned =
-            PruneCombinations(parts, m_Capabilities, m_Metadata, currSeeds, GetEstimationOptions(), m_DebuggingContext,
+            PruneCombinations(parts, m_Capabilities, m_Metadata, currSeeds, *m_EstimationCache, m_DebuggingContext,
                               "IntermediatePrunedCombinationsIteration" + std::to_string(iteration));
         // Grow combinations "Back to Dram"
         haltedSeeds = GrowSeeds({ pruned }, parts, m_Metadata, m_Capabilities, GrowScheme::DramOnly);
@@ -1058,6 +1441,17 @@ Combinations Cascading::Combine(const GraphOfParts& parts)
     return currSeeds;
 }
 
+Combinations Cascading::CombineBeamSearch(const GraphOfParts& parts)
+{
+    m_Metadata = CreateMetadata(parts, m_Capabilities);
+
+    DumpDebugInfo(parts, m_Metadata, m_DebuggingContext, "Metadata");
+
+    m_EstimationCache = std::make_unique<EstimationCache>(parts, m_Capabilities, GetEstimationOptions());
+
+    return ethosn::support_library::CombineBeamSearch(parts, m_Metadata, m_Capabilities, *m_EstimationCache);
+}
+
 OpGraph GetOpGraphForCombination(const Combination& combination, const GraphOfParts& parts)
 {
     OpGraph result;
@@ -1142,9 +1536,13 @@ OpGraph GetOpGraphForCombination(const Combination& combination, const GraphOfPa
             if (inputEdgeIt != plan.m_InputMappings.end())
             {
                 Edge* inputEdge = inputEdgeIt->second;
-                if (incomingGlueOps.find(inputEdge) == incomingGlueOps.end())
+                // The Part this input comes from may not be in the Combination if it only covers part of the
+                // network (see CombineBeamSearch), in which case the plan's own input buffer is kept.
+                auto connectionIt = edgeConnectionBuffers.find(inputEdge);
+                if (incomingGlueOps.find(inputEdge) == incomingGlueOps.end() &&
+                    connectionIt != edgeConnectionBuffers.end())
                 {
-                    sharedBuffer = edgeConnectionBuffers.find(inputEdge)->second;
+                    sharedBuffer = connectionIt->second;
                 }
             }
             if (sharedBuffer)
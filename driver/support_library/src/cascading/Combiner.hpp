@@ -9,13 +9,19 @@
 #include "Plan.hpp"
 
 #include <deque>
+#include <initializer_list>
+#include <iterator>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 namespace ethosn
 {
 namespace support_library
 {
+
+class EstimationCache;
+
 /// The graph of Ops and Buffers that would need to be inserted between two plans to make the compatible,
 /// for example some DmaOps.
 struct Glue
@@ -57,23 +63,151 @@ struct Elem
         PlanId m_Id;
         const Glue* m_Glue;
     };
-    using Glues = std::unordered_map<const Edge*, Link>;
+
+    /// The Link for each output Edge of the Part.
+    /// Parts only have a handful of outputs, so this is a flat list (in the order the Links were added)
+    /// rather than a hash map, which makes it much cheaper to copy.
+    class Glues
+    {
+    public:
+        using value_type     = std::pair<const Edge*, Link>;
+        using iterator       = std::vector<value_type>::iterator;
+        using const_iterator = std::vector<value_type>::const_iterator;
+
+        Glues() = default;
+        Glues(std::initializer_list<value_type> glues);
+
+        iterator find(const Edge* edge);
+        const_iterator find(const Edge* edge) const;
+        /// Does nothing if there is already a Link for the Edge, like std::unordered_map::insert.
+        std::pair<iterator, bool> insert(const value_type& glue);
+        Link& operator[](const Edge* edge);
+
+        size_t size() const
+        {
+            return m_Glues.size();
+        }
+        bool empty() const
+        {
+            return m_Glues.empty();
+        }
+        iterator begin()
+        {
+            return m_Glues.begin();
+        }
+        iterator end()
+        {
+            return m_Glues.end();
+        }
+        const_iterator begin() const
+        {
+            return m_Glues.begin();
+        }
+        const_iterator end() const
+        {
+            return m_Glues.end();
+        }
+
+    private:
+        std::vector<value_type> m_Glues;
+    };
 
     PartId m_PartId;
     PlanId m_PlanId;
     Glues m_Glues;
 };
 
+/// The Elems of a Combination, in the order they were added (which is the topological order of their Parts).
+/// This is a persistent list: copies share the Elems they have in common, so copying a Combination and adding an
+/// Elem to the end (as growing a combination does) takes O(1) time and memory however long it is.
+/// Only the last Elem can be modified, and it is copied first if it is shared with another list.
+class ElemList
+{
+private:
+    struct Node
+    {
+        Elem m_Elem;
+        std::shared_ptr<Node> m_Prev;
+    };
+
+public:
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = Elem;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = const Elem*;
+        using reference         = const Elem&;
+
+        const_iterator(std::shared_ptr<const std::vector<const Elem*>> elems, size_t idx)
+            : m_Elems(std::move(elems))
+            , m_Idx(idx)
+        {}
+
+        reference operator*() const
+        {
+            return *(*m_Elems)[m_Idx];
+        }
+        pointer operator->() const
+        {
+            return (*m_Elems)[m_Idx];
+        }
+        const_iterator& operator++()
+        {
+            ++m_Idx;
+            return *this;
+        }
+        bool operator==(const const_iterator& rhs) const
+        {
+            return m_Idx == rhs.m_Idx;
+        }
+        bool operator!=(const const_iterator& rhs) const
+        {
+            return m_Idx != rhs.m_Idx;
+        }
+
+    private:
+        std::shared_ptr<const std::vector<const Elem*>> m_Elems;
+        size_t m_Idx;
+    };
+
+    size_t size() const
+    {
+        return m_Size;
+    }
+    bool empty() const
+    {
+        return m_Size == 0;
+    }
+
+    void push_back(Elem elem);
+    const Elem& back() const;
+    /// Copies the last Elem first if it is shared with another list.
+    Elem& back();
+    /// This walks back from the end, so is O(size() - idx).
+    const Elem& at(size_t idx) const;
+    /// Returns the Elem for the given Part, or nullptr if it isn't in the list.
+    /// This walks back from the end, so is fastest for recently added Parts.
+    const Elem* Find(PartId partId) const;
+
+    /// Iterating takes O(size()) time and memory to begin with, as the list only links backwards.
+    const_iterator begin() const;
+    const_iterator end() const;
+
+private:
+    std::shared_ptr<Node> m_Last;
+    size_t m_Size = 0;
+};
+
 struct Scratch
 {
-    using Indexes = std::unordered_map<PartId, size_t>;
-    using Dst     = std::vector<const Edge*>;
-    using Edges   = std::unordered_map<PartId, Dst>;
+    using Dst = std::vector<const Edge*>;
 
     uint32_t m_AllocatedSram;
 
-    Indexes m_Idx;
-    Edges m_Edges;
+    /// The output Edges of the current Part which the combination has already been grown along.
+    Dst m_Edges;
     PartId m_CurrPartId;
 
     size_t m_Score = 0;
@@ -81,7 +215,7 @@ struct Scratch
 
 struct Combination
 {
-    using Elems          = std::vector<Elem>;
+    using Elems          = ElemList;
     Combination& operator=(const Combination& c) = default;
 
     /// Helpers
@@ -222,6 +356,23 @@ Combinations CreateSeeds(const GraphOfParts&, const Metadata&, const HardwareCap
 GrownSeeds
     GrowSeeds(const Combinations&, const GraphOfParts&, const Metadata&, const HardwareCapabilities&, const GrowScheme);
 
+/// The number of partial combinations that CombineBeamSearch keeps after each Part, unless told otherwise.
+constexpr size_t g_DefaultCombinerBeamWidth = 32;
+
+// An alternative to growing and pruning seeds (see Cascading::Combine), which visits the parts once each in
+// topological order, keeping only the best beamWidth partial combinations after each one.
+// Partial combinations are ranked by the estimated cost of the parts they contain, with each part estimated
+// on its own using just the plans either side of it (see EstimationCache), so the work per part doesn't depend
+// on the network size.
+// Partial combinations that will behave identically from then on are merged, keeping the cheapest
+// (the dynamic programming part), so with a wide enough beam this finds the best combination.
+// Returns the complete combinations that are left, best first.
+Combinations CombineBeamSearch(const GraphOfParts&,
+                               const Metadata&,
+                               const HardwareCapabilities&,
+                               EstimationCache&,
+                               const size_t beamWidth = g_DefaultCombinerBeamWidth);
+
 /// Creates a single OpGraph which contains the full graph of Ops and Buffers for the given Combination.
 /// This handles merging of adjacent Plans and Glues to give a homogenous structure, suitable for
 /// Estimation or Generation into a command stream.
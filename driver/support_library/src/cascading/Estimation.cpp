@@ -12,8 +12,12 @@
 #include "EstimationUtils.hpp"
 #include "MceEstimationUtils.hpp"
 #include "Part.hpp"
+#include "WeightEncoderCache.hpp"
 
+#include <algorithm>
 #include <iostream>
+#include <limits>
+#include <tuple>
 
 using namespace std;
 using namespace ethosn::support_library::utils;
@@ -133,10 +137,21 @@ EstimatedPass EstimatePassGrownFrom(const OpGraph& opGraph,
             throw NotSupportedException("Weights Dram buffer must not have a producer");
         }
 
+        // Use the real sizes of the weights if they have been encoded, otherwise the ones estimated for the plan
+        EncodedWeightsSizes weightsSizes = weightsDram->m_EncodedWeights->GetEstimatedSizes();
+        if (std::shared_ptr<EncodedWeights> encodedWeights = weightsDram->m_EncodedWeights->GetIfEncoded())
+        {
+            weightsSizes = GetSizes(*encodedWeights);
+            if (weightsSizes.m_MaxStripeSize * weightsSram->m_NumStripes > weightsSram->m_SizeInBytes)
+            {
+                throw NotSupportedException("Encoded weights are larger than estimated and don't fit in Sram");
+            }
+        }
+
         weightsTensorInfo = TensorInfo(weightsDram->m_TensorShape, DataType::UINT8_QUANTIZED, GetWeightsFormat(*mceOp),
                                        weightsDram->m_QuantizationInfo);
         result.m_Stats.m_Weights =
-            GetWeightsStats(capabilities, *weightsDram->m_EncodedWeights, weightsTensorInfo, weightsSram->m_StripeShape,
+            GetWeightsStats(capabilities, weightsSizes, weightsTensorInfo, weightsSram->m_StripeShape,
                             weightsSram->m_SizeInBytes, inputBuffer->m_TensorShape, inputBuffer->m_StripeShape);
 
         includeOp(dmaOp);
@@ -356,5 +371,262 @@ EstimatedOpGraph EstimateOpGraph(const OpGraph& opGraph,
     return result;
 }
 
+DataMetrics& DataMetrics::operator+=(const DataMetrics& rhs)
+{
+    m_Total += rhs.m_Total;
+    m_NonParallel += rhs.m_NonParallel;
+    m_NumPasses += rhs.m_NumPasses;
+    return *this;
+}
+
+DataMetrics& DataMetrics::operator-=(const DataMetrics& rhs)
+{
+    m_Total -= rhs.m_Total;
+    m_NonParallel -= rhs.m_NonParallel;
+    m_NumPasses -= rhs.m_NumPasses;
+    return *this;
+}
+
+bool DataMetrics::operator<(const DataMetrics& rhs) const
+{
+    return std::tie(m_Total, m_NonParallel, m_NumPasses) < std::tie(rhs.m_Total, rhs.m_NonParallel, rhs.m_NumPasses);
+}
+
+DataMetrics GetDataMetrics(const NetworkPerformanceData& perfData)
+{
+    DataMetrics result;
+    result.m_Total       = GetPerformanceTotalDataMetric(perfData);
+    result.m_NonParallel = GetPerformanceNonParallelDataMetric(perfData);
+    result.m_NumPasses   = GetPerformanceNumberOfPassesMetric(perfData);
+    return result;
+}
+
+EstimationCache::EstimationCache(const GraphOfParts& parts,
+                                 const HardwareCapabilities& caps,
+                                 const EstimationOptions& estOpts)
+    : m_Parts(parts)
+    , m_Capabilities(caps)
+    , m_EstimationOptions(estOpts)
+    , m_Sources(parts.GetNumParts())
+    , m_Destinations(parts.GetNumParts())
+    , m_NumHits(0)
+    , m_NumMisses(0)
+{
+    const PartId numParts = static_cast<PartId>(parts.GetNumParts());
+    std::unordered_map<const Edge*, PartId> sourceOfEdge;
+    std::unordered_map<const Edge*, PartId> destinationOfEdge;
+    for (PartId p = 0; p < numParts; ++p)
+    {
+        for (const Edge* edge : parts.GetPart(p).GetOutputs())
+        {
+            sourceOfEdge[edge] = p;
+        }
+        for (const Edge* edge : parts.GetPart(p).GetInputs())
+        {
+            destinationOfEdge[edge] = p;
+        }
+    }
+    for (PartId p = 0; p < numParts; ++p)
+    {
+        for (const Edge* edge : parts.GetPart(p).GetInputs())
+        {
+            m_Sources[p].push_back(sourceOfEdge.at(edge));
+        }
+        for (const Edge* edge : parts.GetPart(p).GetOutputs())
+        {
+            m_Destinations[p].push_back(destinationOfEdge.at(edge));
+        }
+    }
+}
+
+utils::Optional<DataMetrics> EstimationCache::EstimatePart(PartId partId,
+                                                           PlanId planId,
+                                                           const std::vector<Connection>& inputs,
+                                                           const std::vector<utils::Optional<Connection>>& outputs,
+                                                           bool complete)
+{
+    assert(inputs.size() == m_Sources.at(partId).size());
+    assert(outputs.size() == m_Destinations.at(partId).size());
+
+    std::vector<uintptr_t> key = { partId, planId, complete };
+    for (const Connection& in : inputs)
+    {
+        key.push_back(in.m_PlanId);
+        key.push_back(reinterpret_cast<uintptr_t>(in.m_Glue));
+    }
+    for (const utils::Optional<Connection>& out : outputs)
+    {
+        key.push_back(out.has_value() ? out.value().m_PlanId : std::numeric_limits<uintptr_t>::max());
+        key.push_back(out.has_value() ? reinterpret_cast<uintptr_t>(out.value().m_Glue) : 0);
+    }
+
+    auto it = m_Cache.find(key);
+    if (it != m_Cache.end())
+    {
+        ++m_NumHits;
+        return it->second;
+    }
+    ++m_NumMisses;
+    return m_Cache.emplace(std::move(key), EstimatePartUncached(partId, planId, inputs, outputs, complete))
+        .first->second;
+}
+
+utils::Optional<DataMetrics> EstimationCache::EstimateCombination(const Combination& comb)
+{
+    std::vector<const Elem*> elems(m_Parts.GetNumParts(), nullptr);
+    for (const Elem& elem : comb.m_Elems)
+    {
+        elems.at(elem.m_PartId) = &elem;
+    }
+
+    DataMetrics result;
+    for (PartId partId = 0; partId < elems.size(); ++partId)
+    {
+        const Elem* elem = elems[partId];
+        if (elem == nullptr)
+        {
+            return {};
+        }
+        const Part& part = m_Parts.GetPart(partId);
+
+        std::vector<Connection> inputs;
+        for (size_t i = 0; i < part.GetInputs().size(); ++i)
+        {
+            const Elem* source = elems[m_Sources[partId][i]];
+            if (source == nullptr)
+            {
+                return {};
+            }
+            auto glue = source->m_Glues.find(part.GetInputs()[i]);
+            inputs.push_back(
+                Connection{ source->m_PlanId, glue != source->m_Glues.end() ? glue->second.m_Glue : nullptr });
+        }
+        std::vector<utils::Optional<Connection>> outputs;
+        for (size_t i = 0; i < part.GetOutputs().size(); ++i)
+        {
+            const Elem* destination = elems[m_Destinations[partId][i]];
+            if (destination == nullptr)
+            {
+                return {};
+            }
+            auto glue = elem->m_Glues.find(part.GetOutputs()[i]);
+            outputs.push_back(
+                Connection{ destination->m_PlanId, glue != elem->m_Glues.end() ? glue->second.m_Glue : nullptr });
+        }
+
+        utils::Optional<DataMetrics> partMetrics = EstimatePart(partId, elem->m_PlanId, inputs, outputs, true);
+        if (!partMetrics.has_value())
+        {
+            return {};
+        }
+        result += partMetrics.value();
+    }
+    return result;
+}
+
+utils::Optional<DataMetrics>
+    EstimationCache::EstimatePartUncached(PartId partId,
+                                          PlanId planId,
+                                          const std::vector<Connection>& inputs,
+                                          const std::vector<utils::Optional<Connection>>& outputs,
+                                          bool complete) const
+{
+    // Build a Combination of this Part and the Parts either side of it. Parts are numbered in topological order,
+    // so sorting by PartId gives the order GetOpGraphForCombination needs.
+    // Only this Part's own Edges are connected up, as the estimate mustn't depend on anything else.
+    const Part& part = m_Parts.GetPart(partId);
+    std::map<PartId, Elem> window;
+    window[partId] = Elem{ partId, planId, {} };
+    for (size_t i = 0; i < inputs.size(); ++i)
+    {
+        Elem& source = window[m_Sources[partId][i]];
+        source.m_PartId = m_Sources[partId][i];
+        source.m_PlanId = inputs[i].m_PlanId;
+        if (inputs[i].m_Glue != nullptr)
+        {
+            source.m_Glues[part.GetInputs()[i]] = Elem::Link{ planId, inputs[i].m_Glue };
+        }
+    }
+    for (size_t i = 0; i < outputs.size(); ++i)
+    {
+        if (outputs[i].has_value())
+        {
+            window[m_Destinations[partId][i]] = Elem{ m_Destinations[partId][i], outputs[i].value().m_PlanId, {} };
+            if (outputs[i].value().m_Glue != nullptr)
+            {
+                window[partId].m_Glues[part.GetOutputs()[i]] =
+                    Elem::Link{ outputs[i].value().m_PlanId, outputs[i].value().m_Glue };
+            }
+        }
+    }
+    Combination windowComb;
+    for (auto& elem : window)
+    {
+        windowComb.m_Elems.push_back(std::move(elem.second));
+    }
+
+    const Plan& plan = part.GetPlan(planId);
+    std::unordered_set<Op*> ownOps(plan.m_OpGraph.GetOps().begin(), plan.m_OpGraph.GetOps().end());
+    for (const Connection& in : inputs)
+    {
+        if (in.m_Glue != nullptr)
+        {
+            ownOps.insert(in.m_Glue->m_Graph.GetOps().begin(), in.m_Glue->m_Graph.GetOps().end());
+        }
+    }
+
+    try
+    {
+        const OpGraph opGraph = GetOpGraphForCombination(windowComb, m_Parts);
+        std::unordered_set<Op*> unestimatedOps(opGraph.GetOps().begin(), opGraph.GetOps().end());
+
+        // Passes are grown in the same order as EstimateOpGraph so that each DmaOp ends up in the same pass as it
+        // would for the whole network, but only the passes for this Part's own Mce/PleOps are counted.
+        // The neighbours' passes may be missing things from further away, so are allowed to fail.
+        NetworkPerformanceData perfData;
+        for (Op* op : opGraph.GetOps())
+        {
+            if ((IsObjectOfType<MceOp>(op) || IsObjectOfType<PleOp>(op)) && unestimatedOps.count(op) > 0)
+            {
+                const bool isOwn = ownOps.count(op) > 0;
+                try
+                {
+                    EstimatedPass pass =
+                        EstimatePassGrownFrom(opGraph, op, m_Capabilities, m_EstimationOptions, unestimatedOps);
+                    if (isOwn)
+                    {
+                        perfData.m_Stream.push_back({});
+                        perfData.m_Stream.back().m_Stats = pass.m_Stats;
+                    }
+                }
+                catch (const NotSupportedException&)
+                {
+                    if (isOwn)
+                    {
+                        throw;
+                    }
+                }
+            }
+        }
+
+        if (complete)
+        {
+            for (Op* op : ownOps)
+            {
+                if (unestimatedOps.count(op) > 0)
+                {
+                    return {};
+                }
+            }
+        }
+
+        return GetDataMetrics(perfData);
+    }
+    catch (const NotSupportedException&)
+    {
+        return {};
+    }
+}
+
 }    // namespace support_library
 }    // namespace ethosn
@@ -5,9 +5,11 @@
 
 #pragma once
 
+#include "../include/ethosn_support_library/Optional.hpp"
 #include "../include/ethosn_support_library/Support.hpp"
 #include "Combiner.hpp"
 
+#include <map>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -40,5 +42,85 @@ EstimatedOpGraph EstimateOpGraph(const OpGraph& opGraph,
                                  const HardwareCapabilities& capabilities,
                                  const EstimationOptions& estimationOpts);
 
+/// The metrics compared by IsLeftMoreDataPerformantThanRight, in the same order (total data, then non-parallel
+/// data, then number of passes). All three are sums over the passes, so they can be built up one Part at a time.
+struct DataMetrics
+{
+    uint64_t m_Total       = 0;
+    uint64_t m_NonParallel = 0;
+    uint64_t m_NumPasses   = 0;
+
+    DataMetrics& operator+=(const DataMetrics& rhs);
+    DataMetrics& operator-=(const DataMetrics& rhs);
+    bool operator<(const DataMetrics& rhs) const;
+};
+
+DataMetrics GetDataMetrics(const NetworkPerformanceData& perfData);
+
+/// Estimates Combinations one Part at a time, remembering the result for each Part so that estimating many
+/// Combinations which share most of their choices (as when combining) only needs to estimate the Parts which differ.
+///
+/// The passes for a Part are its own Mce/PleOps and the glues on its inputs. These are estimated using an OpGraph
+/// containing just the Part and the Parts it is directly connected to, so each result depends only on the plan
+/// chosen for the Part, the plans either side of it and the glues on its Edges, which is what results are keyed on.
+class EstimationCache
+{
+public:
+    /// How one Edge of a Part is connected: the plan chosen for the Part at the other end and the glue along it
+    /// (nullptr if there is no glue).
+    struct Connection
+    {
+        PlanId m_PlanId;
+        const Glue* m_Glue;
+    };
+
+    EstimationCache(const GraphOfParts& parts, const HardwareCapabilities& caps, const EstimationOptions& estOpts);
+
+    /// Estimates the passes for the given Part. 'inputs' and 'outputs' are in the same order as the Part's input
+    /// and output Edges. Outputs which haven't been decided yet are left empty, in which case the Part is estimated
+    /// as if those outputs stay wherever the plan leaves them.
+    /// If 'complete' is set, all the Ops belonging to the Part must be covered by a pass, as EstimateOpGraph
+    /// requires for the whole network.
+    /// Returns an empty Optional if the Part can't be estimated this way.
+    utils::Optional<DataMetrics> EstimatePart(PartId partId,
+                                              PlanId planId,
+                                              const std::vector<Connection>& inputs,
+                                              const std::vector<utils::Optional<Connection>>& outputs,
+                                              bool complete);
+
+    /// Estimates a Combination which covers the whole network, as the sum of the estimates for each of its Parts.
+    /// This gives the same metrics as EstimateOpGraph on GetOpGraphForCombination, without merging the whole graph.
+    /// Returns an empty Optional if any Part can't be estimated.
+    utils::Optional<DataMetrics> EstimateCombination(const Combination& comb);
+
+    uint64_t GetNumHits() const
+    {
+        return m_NumHits;
+    }
+    uint64_t GetNumMisses() const
+    {
+        return m_NumMisses;
+    }
+
+private:
+    utils::Optional<DataMetrics> EstimatePartUncached(PartId partId,
+                                                      PlanId planId,
+                                                      const std::vector<Connection>& inputs,
+                                                      const std::vector<utils::Optional<Connection>>& outputs,
+                                                      bool complete) const;
+
+    const GraphOfParts& m_Parts;
+    const HardwareCapabilities& m_Capabilities;
+    /// Held by value, as callers usually pass a temporary copy (e.g. IEstimationStrategy::GetEstimationOptions()).
+    const EstimationOptions m_EstimationOptions;
+    /// For each Part, the Part at the other end of each of its input and output Edges.
+    std::vector<std::vector<PartId>> m_Sources;
+    std::vector<std::vector<PartId>> m_Destinations;
+
+    std::map<std::vector<uintptr_t>, utils::Optional<DataMetrics>> m_Cache;
+    uint64_t m_NumHits;
+    uint64_t m_NumMisses;
+};
+
 }    // namespace support_library
 }    // namespace ethosn
@@ -24,7 +24,7 @@ MceStats GetMceStats(const HardwareCapabilities& caps,
                      const TensorShape& weightsShape);
 
 WeightsStats GetWeightsStats(const HardwareCapabilities& caps,
-                             const EncodedWeights& encodedWeights,
+                             const EncodedWeightsSizes& encodedWeights,
                              const TensorInfo& info,
                              const TensorShape& stripeShape,
                              const uint32_t tileSize,
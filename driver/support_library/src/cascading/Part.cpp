@@ -506,6 +506,13 @@ const Parts& GraphOfParts::GetParts() const
 }
 
 void Part::CreatePlans()
+{
+    std::shared_ptr<WeightEncoderCache> weightEncoderCache =
+        std::make_shared<WeightEncoderCache>(m_Capabilities, m_CompilationOptions.m_WeightEncoderCacheDir);
+    CreatePlans(*weightEncoderCache);
+}
+
+void Part::CreatePlans(WeightEncoderCache& weightEncoderCache)
 {
     m_NumInvalidPlans = 0;
     Node* node        = m_SubGraph.front();
@@ -519,7 +526,6 @@ void Part::CreatePlans()
     }
     else
     {
-        WeightEncoderCache weightEncoderCache{ m_Capabilities };
         GenerateWithTraversalOrders(node, weightEncoderCache);
     }
 
@@ -665,11 +671,13 @@ void AddWeightBuffersAndDmaOpToMceOp(OwnedOpGraph& opGraph,
     wp.iterationSize                      = weightStripeSize;
     wp.operation                          = mceOp->m_Op;
     wp.algorithm                          = mceOp->m_Algo;
-    weightsBufferInDram->m_EncodedWeights = weightEncoderCache.Encode(wp);
+    weightsBufferInDram->m_EncodedWeights = weightEncoderCache.EncodeLazily(wp, weightStripeShape);
 
-    // Use the encoded weights to determine the size of the sram and dram buffers
-    weightsBufferInDram->m_SizeInBytes = static_cast<uint32_t>(weightsBufferInDram->m_EncodedWeights->m_Data.size());
-    weightsBufferInSram->m_SizeInBytes = weightsBufferInDram->m_EncodedWeights->m_MaxSize * numWeightStripes;
+    // Use the estimated size of the encoded weights to determine the size of the sram and dram buffers.
+    // The estimated maximum stripe size is an upper bound, so the sram buffer is always large enough.
+    const EncodedWeightsSizes& weightsSizes = weightsBufferInDram->m_EncodedWeights->GetEstimatedSizes();
+    weightsBufferInDram->m_SizeInBytes      = weightsSizes.m_TotalSize;
+    weightsBufferInSram->m_SizeInBytes      = weightsSizes.m_MaxStripeSize * numWeightStripes;
 }
 
 Buffer* Part::AddIdentityMceOpForSubGraph(OwnedOpGraph& opGraph,
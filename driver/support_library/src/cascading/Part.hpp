@@ -74,6 +74,8 @@ public:
     {}
 
     void CreatePlans();
+    /// As above, but encoding weights through the given cache, so that it can be shared between Parts.
+    void CreatePlans(WeightEncoderCache& weightEncoderCache);
     const Plan& GetPlan(const PlanId id) const;
     size_t GetNumPlans() const;
     std::vector<const Edge*> GetInputs() const;
@@ -200,16 +200,29 @@ Buffer* OwnedOpGraph::AddBuffer(std::unique_ptr<Buffer> buffer)
     return raw;
 }
 
-int DebuggableObject::ms_IdCounter = 0;
+int DebuggableObject::ms_IdCounter                       = 0;
+thread_local int* DebuggableObject::ms_ThreadIdCounter = nullptr;
 
 DebuggableObject::DebuggableObject(const char* defaultTagPrefix)
 {
+    int& counter = ms_ThreadIdCounter != nullptr ? *ms_ThreadIdCounter : ms_IdCounter;
     // Generate an arbitrary and unique (but deterministic) default debug tag for this object.
     // This means that if no-one sets anything more useful, we still have a way to identify it.
-    m_DebugTag = std::string(defaultTagPrefix) + " " + std::to_string(ms_IdCounter);
+    m_DebugTag = std::string(defaultTagPrefix) + " " + std::to_string(counter);
     //m_DebugId is very useful for conditional breakpoints
-    m_DebugId = ms_IdCounter;
-    ++ms_IdCounter;
+    m_DebugId = counter;
+    ++counter;
+}
+
+void DebuggableObject::OffsetDebugId(int offset)
+{
+    const std::string defaultTag = m_DebugTag.substr(0, m_DebugTag.rfind(' ') + 1) + std::to_string(m_DebugId);
+    m_DebugId += offset;
+    // Only renumber the tag if it is still the default one, so that tags set by the caller are left alone.
+    if (m_DebugTag == defaultTag)
+    {
+        m_DebugTag = m_DebugTag.substr(0, m_DebugTag.rfind(' ') + 1) + std::to_string(m_DebugId);
+    }
 }
 
 Op::Op(const char* defaultTagPrefix)
@@ -66,6 +66,7 @@ struct SizeInBytes
 bool IsCompressed(CascadingBufferFormat format);
 
 class Buffer;
+class LazyEncodedWeights;
 class Op;
 
 using PartId = size_t;
@@ -158,9 +159,18 @@ public:
     std::string m_DebugTag;
     int m_DebugId;
 
+    /// Shifts m_DebugId (and the number at the end of m_DebugTag) by the given amount.
+    /// Used to renumber objects which were created using a thread-local counter (see ms_ThreadIdCounter).
+    void OffsetDebugId(int offset);
+
     /// Counter for generating unique debug tags (see DebuggableObject constructor).
     /// This is publicly exposed so can be manipulated by tests.
+    /// It is reset at the start of each compilation (see Cascading::Estimate), so that the ids don't depend on what
+    /// was compiled before.
     static int ms_IdCounter;
+    /// If set, objects created on this thread take their ids from this counter rather than ms_IdCounter.
+    /// This lets several threads create objects at once, with the ids fixed up afterwards using OffsetDebugId.
+    static thread_local int* ms_ThreadIdCounter;
 };
 
 class Plan : public DebuggableObject
@@ -289,8 +299,9 @@ public:
     /// but is useful to store by itself nonetheless.
     uint32_t m_NumStripes;
 
-    /// Relevant only if this is a weights buffer in Dram.
-    std::shared_ptr<EncodedWeights> m_EncodedWeights;
+    /// Relevant only if this is a weights buffer in Dram. The weights are only encoded once they are needed, which for
+    /// most plans is never, and until then m_SizeInBytes (of this and the Sram buffer it is copied to) is estimated.
+    std::shared_ptr<LazyEncodedWeights> m_EncodedWeights;
 };
 
 bool IsOutputBufferInDram(const Plan& plan, const Edge& edge);
@@ -0,0 +1,412 @@
+//
+// Copyright © 2021 Arm Limited.
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "WeightEncoderCache.hpp"
+
+#include <ethosn_utils/Filesystem.hpp>
+#include <ethosn_utils/Hash.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+namespace ethosn
+{
+namespace support_library
+{
+
+namespace
+{
+
+/// Tag and version at the start of each file in the cache directory. The version must be increased whenever
+/// the file format, the key or the output of the weight encoder changes.
+constexpr char g_CacheFileTag[4]        = { 'E', 'N', 'W', 'C' };
+constexpr uint32_t g_CacheFileVersion   = 1;
+constexpr uint64_t g_WeightsDigestSeed2 = 0x5745494748545332ULL;
+
+void Write(std::vector<uint8_t>& out, const uint32_t data)
+{
+    // Write in little-endian order, regardless of host endianness
+    out.push_back(static_cast<uint8_t>(data & 0xFF));
+    out.push_back(static_cast<uint8_t>((data >> 8) & 0xFF));
+    out.push_back(static_cast<uint8_t>((data >> 16) & 0xFF));
+    out.push_back(static_cast<uint8_t>((data >> 24) & 0xFF));
+}
+
+void Write(std::vector<uint8_t>& out, const uint64_t data)
+{
+    Write(out, static_cast<uint32_t>(data));
+    Write(out, static_cast<uint32_t>(data >> 32));
+}
+
+void Write(std::vector<uint8_t>& out, const float data)
+{
+    uint32_t bits;
+    static_assert(sizeof(bits) == sizeof(data), "Unexpected float size");
+    std::memcpy(&bits, &data, sizeof(bits));
+    Write(out, bits);
+}
+
+void Write(std::vector<uint8_t>& out, const QuantizationInfo& info)
+{
+    Write(out, static_cast<uint32_t>(info.GetZeroPoint()));
+    Write(out, static_cast<uint32_t>(info.GetScales().size()));
+    for (float scale : info.GetScales())
+    {
+        Write(out, scale);
+    }
+    Write(out, static_cast<uint32_t>(info.GetQuantizationDim().has_value()));
+    Write(out, info.GetQuantizationDim().has_value() ? info.GetQuantizationDim().value() : 0U);
+}
+
+void Write(std::vector<uint8_t>& out, const TensorInfo& info)
+{
+    for (uint32_t dim : info.m_Dimensions)
+    {
+        Write(out, dim);
+    }
+    Write(out, static_cast<uint32_t>(info.m_DataType));
+    Write(out, static_cast<uint32_t>(info.m_DataFormat));
+    Write(out, info.m_QuantizationInfo);
+}
+
+bool Read(std::istream& in, uint32_t& data)
+{
+    uint8_t bytes[4];
+    if (!in.read(reinterpret_cast<char*>(bytes), sizeof(bytes)))
+    {
+        return false;
+    }
+    data = static_cast<uint32_t>(bytes[0]) | (static_cast<uint32_t>(bytes[1]) << 8) |
+           (static_cast<uint32_t>(bytes[2]) << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+    return true;
+}
+
+bool ReadByteArray(std::istream& in, std::vector<uint8_t>& data)
+{
+    uint32_t size;
+    if (!Read(in, size))
+    {
+        return false;
+    }
+    // Check the size against what is left of the file before allocating, in case the file is corrupt
+    const std::istream::pos_type pos = in.tellg();
+    in.seekg(0, std::ios::end);
+    const std::istream::pos_type end = in.tellg();
+    in.seekg(pos);
+    if (pos < 0 || end < 0 || static_cast<uint64_t>(end - pos) < size)
+    {
+        return false;
+    }
+    data.resize(size);
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(data.data()), size));
+}
+
+}    // namespace
+
+WeightEncoderCache::WeightEncoderCache(const HardwareCapabilities& caps, std::string cacheDir, ThreadPool* threadPool)
+    : m_Capabilities(caps)
+    , m_CapabilitiesDigest([&caps]() {
+        const std::vector<char> data = caps.GetData();
+        return ethosn::utils::Xxh64(data.data(), data.size());
+    }())
+    , m_CacheDir(std::move(cacheDir))
+    , m_ThreadPool(threadPool)
+    , m_NumHits(0)
+    , m_NumDiskHits(0)
+    , m_NumMisses(0)
+{
+    if (!m_CacheDir.empty())
+    {
+        // This fails if the directory already exists, which is fine
+        ethosn::utils::MakeDirectory(m_CacheDir.c_str());
+    }
+}
+
+std::shared_ptr<EncodedWeights> WeightEncoderCache::Encode(const Params& params)
+{
+    std::promise<std::shared_ptr<EncodedWeights>> promise;
+    Key key;
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        key     = CreateKey(params);
+        auto it = m_Entries.find(key);
+        if (it != m_Entries.end())
+        {
+            ++m_NumHits;
+            // The weights might still be being encoded by another thread, so wait without holding the lock
+            std::shared_future<std::shared_ptr<EncodedWeights>> entry = it->second;
+            lock.unlock();
+            return entry.get();
+        }
+        m_Entries.emplace(key, promise.get_future().share());
+    }
+
+    try
+    {
+        std::shared_ptr<EncodedWeights> result = m_CacheDir.empty() ? nullptr : LoadFromDisk(key);
+        if (result)
+        {
+            ++m_NumDiskHits;
+        }
+        else
+        {
+            ++m_NumMisses;
+            // Weight encoders aren't thread-safe, so each encoding has its own
+            std::unique_ptr<WeightEncoder> encoder = WeightEncoder::CreateWeightEncoder(m_Capabilities, m_ThreadPool);
+            result                                 = std::make_shared<EncodedWeights>(encoder->Encode(
+                params.weightsTensorInfo, params.weightsData->data(), params.biasTensorInfo, params.biasData.data(),
+                params.inputQuantizationInfo, params.outputQuantizationInfo, params.stripeDepth, params.strideY,
+                params.strideX, params.paddingTop, params.paddingLeft, params.iterationSize, params.operation,
+                params.algorithm));
+            if (!m_CacheDir.empty())
+            {
+                SaveToDisk(key, *result);
+            }
+        }
+        promise.set_value(result);
+        return result;
+    }
+    catch (...)
+    {
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+}
+
+std::shared_ptr<LazyEncodedWeights> WeightEncoderCache::EncodeLazily(const Params& params,
+                                                                     const TensorShape& stripeShape)
+{
+    return std::make_shared<LazyEncodedWeights>(shared_from_this(), params, EstimateSizes(params, stripeShape));
+}
+
+EncodedWeightsSizes WeightEncoderCache::EstimateSizes(const Params& params, const TensorShape& stripeShape)
+{
+    const TensorInfo& weightsInfo = params.weightsTensorInfo;
+    const bool isHwim             = weightsInfo.m_DataFormat == DataFormat::HWIM;
+    const uint32_t numOfms =
+        isHwim ? weightsInfo.m_Dimensions[2] * weightsInfo.m_Dimensions[3] : weightsInfo.m_Dimensions[3];
+    const uint32_t numIfms       = weightsInfo.m_Dimensions[2] * params.strideX * params.strideY;
+    const uint32_t numIterations = isHwim ? 1 : utils::DivRoundUp(numIfms, params.iterationSize);
+
+    // The uncompressed (worst case) size of a stripe, for the given stripe shape and for the whole tensor
+    const uint32_t maxStripeSize = utils::EstimateWeightSizeBytes(stripeShape, m_Capabilities, isHwim);
+    const TensorShape singleStripeShape = { weightsInfo.m_Dimensions[0], weightsInfo.m_Dimensions[1], numIfms,
+                                            isHwim ? 1 : numOfms };
+    const uint32_t maxSingleStripeSize = utils::EstimateWeightSizeBytes(singleStripeShape, m_Capabilities, isHwim);
+
+    Params singleStripeParams        = params;
+    singleStripeParams.stripeDepth   = numOfms;
+    singleStripeParams.iterationSize = numIfms;
+    const uint32_t singleStripeSize  = static_cast<uint32_t>(Encode(singleStripeParams)->m_Data.size());
+    const double compressionRatio =
+        std::min(1.0, static_cast<double>(singleStripeSize) / static_cast<double>(maxSingleStripeSize));
+
+    // Each stripe is aligned to 16 bytes in Dram
+    const uint32_t compressedStripeSize =
+        std::min(maxStripeSize,
+                 utils::RoundUpToNearestMultiple(
+                     static_cast<uint32_t>(std::ceil(compressionRatio * static_cast<double>(maxStripeSize))), 16U));
+
+    EncodedWeightsSizes sizes;
+    sizes.m_NumStripes = utils::DivRoundUp(numOfms, params.stripeDepth) * numIterations;
+    // Individual stripes may compress worse than the whole tensor, so the largest one is the uncompressed size.
+    // This is what sizes the Sram buffer, which must never be too small. The compression ratio is only used for
+    // the Dram size and the bandwidth, where an estimate is good enough.
+    sizes.m_MaxStripeSize   = maxStripeSize;
+    sizes.m_FirstStripeSize = compressedStripeSize;
+    sizes.m_TotalSize       = compressedStripeSize * sizes.m_NumStripes;
+    return sizes;
+}
+
+uint64_t WeightEncoderCache::GetNumHits() const
+{
+    return m_NumHits;
+}
+
+uint64_t WeightEncoderCache::GetNumDiskHits() const
+{
+    return m_NumDiskHits;
+}
+
+uint64_t WeightEncoderCache::GetNumMisses() const
+{
+    return m_NumMisses;
+}
+
+size_t WeightEncoderCache::KeyHasher::operator()(const Key& key) const
+{
+    return static_cast<size_t>(ethosn::utils::Xxh64(key.data(), key.size()));
+}
+
+WeightEncoderCache::Key WeightEncoderCache::CreateKey(const Params& params)
+{
+    auto digestIt = m_WeightsDigests.find(params.weightsData.get());
+    if (digestIt == m_WeightsDigests.end())
+    {
+        const std::vector<uint8_t>& weights = *params.weightsData;
+        // Two digests with different seeds, to make it vanishingly unlikely that different weights are mixed up,
+        // even across all the networks sharing a cache directory.
+        const WeightsDigest digest = { ethosn::utils::Xxh64(weights.data(), weights.size()),
+                                       ethosn::utils::Xxh64(weights.data(), weights.size(), g_WeightsDigestSeed2) };
+        digestIt = m_WeightsDigests.emplace(params.weightsData.get(), std::make_pair(params.weightsData, digest)).first;
+    }
+    const WeightsDigest& weightsDigest = digestIt->second.second;
+
+    Key key;
+    key.reserve(256 + params.biasData.size() * sizeof(int32_t));
+    // Any version of the support library may encode the same parameters differently
+    Write(key, static_cast<uint32_t>(ETHOSN_SUPPORT_LIBRARY_VERSION_MAJOR));
+    Write(key, static_cast<uint32_t>(ETHOSN_SUPPORT_LIBRARY_VERSION_MINOR));
+    Write(key, static_cast<uint32_t>(ETHOSN_SUPPORT_LIBRARY_VERSION_PATCH));
+    Write(key, m_CapabilitiesDigest);
+    Write(key, params.weightsTensorInfo);
+    Write(key, static_cast<uint64_t>(params.weightsData->size()));
+    Write(key, weightsDigest[0]);
+    Write(key, weightsDigest[1]);
+    Write(key, params.biasTensorInfo);
+    Write(key, static_cast<uint32_t>(params.biasData.size()));
+    for (int32_t bias : params.biasData)
+    {
+        Write(key, static_cast<uint32_t>(bias));
+    }
+    Write(key, params.inputQuantizationInfo);
+    Write(key, params.outputQuantizationInfo);
+    Write(key, params.stripeDepth);
+    Write(key, params.strideY);
+    Write(key, params.strideX);
+    Write(key, params.paddingTop);
+    Write(key, params.paddingLeft);
+    Write(key, params.iterationSize);
+    Write(key, static_cast<uint32_t>(params.operation));
+    Write(key, static_cast<uint32_t>(params.algorithm));
+    return key;
+}
+
+std::string WeightEncoderCache::GetCacheFilePath(const Key& key) const
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.enwc",
+             static_cast<unsigned long long>(ethosn::utils::Xxh64(key.data(), key.size())));
+    return m_CacheDir + "/" + name;
+}
+
+std::shared_ptr<EncodedWeights> WeightEncoderCache::LoadFromDisk(const Key& key) const
+{
+    // Anything unexpected in the file (including a different key whose digest happens to be the same)
+    // is treated as a miss, and the file will be overwritten.
+    std::ifstream in(GetCacheFilePath(key), std::ios::binary);
+    if (!in)
+    {
+        return nullptr;
+    }
+
+    char tag[sizeof(g_CacheFileTag)];
+    uint32_t version;
+    if (!in.read(tag, sizeof(tag)) || std::memcmp(tag, g_CacheFileTag, sizeof(tag)) != 0 || !Read(in, version) ||
+        version != g_CacheFileVersion)
+    {
+        return nullptr;
+    }
+
+    std::vector<uint8_t> fileKey;
+    if (!ReadByteArray(in, fileKey) || fileKey != key)
+    {
+        return nullptr;
+    }
+
+    auto result = std::make_shared<EncodedWeights>();
+    uint32_t numMetadata;
+    if (!Read(in, result->m_MaxSize) || !Read(in, numMetadata))
+    {
+        return nullptr;
+    }
+    for (uint32_t i = 0; i < numMetadata; ++i)
+    {
+        WeightsMetadata metadata;
+        if (!Read(in, metadata.m_Offset) || !Read(in, metadata.m_Size))
+        {
+            return nullptr;
+        }
+        result->m_Metadata.push_back(metadata);
+    }
+    if (!ReadByteArray(in, result->m_Data) || in.peek() != std::ifstream::traits_type::eof())
+    {
+        return nullptr;
+    }
+    return result;
+}
+
+void WeightEncoderCache::SaveToDisk(const Key& key, const EncodedWeights& encodedWeights) const
+{
+    std::vector<uint8_t> contents;
+    contents.insert(contents.end(), std::begin(g_CacheFileTag), std::end(g_CacheFileTag));
+    Write(contents, g_CacheFileVersion);
+    Write(contents, static_cast<uint32_t>(key.size()));
+    contents.insert(contents.end(), key.begin(), key.end());
+    Write(contents, encodedWeights.m_MaxSize);
+    Write(contents, static_cast<uint32_t>(encodedWeights.m_Metadata.size()));
+    for (const WeightsMetadata& metadata : encodedWeights.m_Metadata)
+    {
+        Write(contents, metadata.m_Offset);
+        Write(contents, metadata.m_Size);
+    }
+    Write(contents, static_cast<uint32_t>(encodedWeights.m_Data.size()));
+    contents.insert(contents.end(), encodedWeights.m_Data.begin(), encodedWeights.m_Data.end());
+
+    // Write to a temporary file and rename it into place, so that other compilations sharing the directory
+    // never see a partially written file.
+    // Failing to save isn't an error, as the cache is only an optimisation.
+    const std::string path    = GetCacheFilePath(key);
+    const std::string tmpPath = path + "." + std::to_string(std::random_device()()) + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary);
+        if (!out.write(reinterpret_cast<const char*>(contents.data()), contents.size()))
+        {
+            out.close();
+            std::remove(tmpPath.c_str());
+            return;
+        }
+    }
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0)
+    {
+        std::remove(tmpPath.c_str());
+    }
+}
+
+LazyEncodedWeights::LazyEncodedWeights(std::shared_ptr<WeightEncoderCache> cache,
+                                       const WeightEncoderCache::Params& params,
+                                       const EncodedWeightsSizes& estimatedSizes)
+    : m_Cache(std::move(cache))
+    , m_Params(params)
+    , m_EstimatedSizes(estimatedSizes)
+{}
+
+const EncodedWeightsSizes& LazyEncodedWeights::GetEstimatedSizes() const
+{
+    return m_EstimatedSizes;
+}
+
+std::shared_ptr<EncodedWeights> LazyEncodedWeights::Encode()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (!m_EncodedWeights)
+    {
+        m_EncodedWeights = m_Cache->Encode(m_Params);
+    }
+    return m_EncodedWeights;
+}
+
+std::shared_ptr<EncodedWeights> LazyEncodedWeights::GetIfEncoded() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_EncodedWeights;
+}
+
+}    // namespace support_library
+}    // namespace ethosn
@@ -7,10 +7,15 @@
 
 #include "../../include/ethosn_support_library/Support.hpp"
 #include "../Utils.hpp"
+#include "../WeightEncoder.hpp"
 #include <ethosn_command_stream/CommandData.hpp>
 
-#include <functional>
+#include <array>
+#include <atomic>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -19,12 +24,21 @@ namespace ethosn
 namespace support_library
 {
 
-class WeightEncoderCache
+class LazyEncodedWeights;
+
+/// Encodes weights, re-using the results of previous encodings with the same parameters.
+/// Entries are identified by a digest of the weights and biases rather than by comparing them, so equal-shaped layers
+/// with different weights don't slow each other down, and identical layers share one encoding.
+/// If a cache directory is given, encoded weights are also saved there and loaded back by later compilations
+/// (including in other processes), so recompiling the same network doesn't need to encode any weights.
+class WeightEncoderCache : public std::enable_shared_from_this<WeightEncoderCache>
 {
 public:
-    WeightEncoderCache(const HardwareCapabilities& caps)
-        : m_Encoder(WeightEncoder::CreateWeightEncoder(caps))
-    {}
+    /// @param cacheDir Directory to save encoded weights to and load them from, which is created if it doesn't exist
+    ///                 (but its parent must). Empty to only cache in memory.
+    /// @param threadPool Pool to run each encoding's OGs in parallel on (see WeightEncoder::CreateWeightEncoder),
+    ///                   or nullptr to encode on the calling thread. It must outlive the cache.
+    WeightEncoderCache(const HardwareCapabilities& caps, std::string cacheDir = "", ThreadPool* threadPool = nullptr);
 
     struct Params
     {
@@ -42,57 +56,93 @@ public:
         uint32_t iterationSize;
         ethosn::command_stream::MceOperation operation;
         CompilerMceAlgorithm algorithm;
-
-        bool operator==(const Params& r) const
-        {
-            return weightsTensorInfo == r.weightsTensorInfo && *weightsData == *r.weightsData &&
-                   biasTensorInfo == r.biasTensorInfo && biasData == r.biasData &&
-                   inputQuantizationInfo == r.inputQuantizationInfo &&
-                   outputQuantizationInfo == r.outputQuantizationInfo && stripeDepth == r.stripeDepth &&
-                   strideY == r.strideY && strideX == r.strideX && paddingTop == r.paddingTop &&
-                   paddingLeft == r.paddingLeft && iterationSize == r.iterationSize && operation == r.operation &&
-                   algorithm == r.algorithm;
-        }
     };
 
-    std::shared_ptr<EncodedWeights> Encode(const Params& params)
-    {
-        auto it = m_Entries.find(params);
-        if (it == m_Entries.end())
-        {
-            EncodedWeights w =
-                m_Encoder->Encode(params.weightsTensorInfo, params.weightsData->data(), params.biasTensorInfo,
-                                  params.biasData.data(), params.inputQuantizationInfo, params.outputQuantizationInfo,
-                                  params.stripeDepth, params.strideY, params.strideX, params.paddingTop,
-                                  params.paddingLeft, params.iterationSize, params.operation, params.algorithm);
-            it = m_Entries.insert({ params, std::make_shared<EncodedWeights>(w) }).first;
-        }
-        return it->second;
-    }
+    /// Returns the encoded weights for the given params, encoding them if they have not been seen before.
+    /// This is safe to call from multiple threads. Different weights are encoded in parallel, and if several
+    /// threads ask for the same weights at once, only one of them encodes them.
+    std::shared_ptr<EncodedWeights> Encode(const Params& params);
+
+    /// Returns a handle which encodes the weights for the given params only when they are first needed, along with
+    /// an estimate of their sizes for a weights stripe of the given shape. This is much cheaper than Encode when
+    /// most of the handles are never used, e.g. for plans which are not chosen.
+    /// The estimate scales the uncompressed size of the stripes by the compression ratio achieved when encoding all
+    /// of the weights as a single stripe. That encoding is shared between all the params with the same weights, so
+    /// the estimate is the same whatever order handles are created in.
+    /// The cache must be owned by a std::shared_ptr, which the handles share.
+    std::shared_ptr<LazyEncodedWeights> EncodeLazily(const Params& params, const TensorShape& stripeShape);
+
+    /// Statistics, for debugging and testing.
+    /// @{
+    /// The number of calls to Encode which were served from memory.
+    uint64_t GetNumHits() const;
+    /// The number of calls to Encode which were served from the cache directory.
+    uint64_t GetNumDiskHits() const;
+    /// The number of calls to Encode which had to encode the weights.
+    uint64_t GetNumMisses() const;
+    /// @}
 
 private:
-    struct Hasher
+    /// A serialized form of everything which affects the encoding (with the weights replaced by a digest).
+    using Key = std::vector<uint8_t>;
+
+    struct KeyHasher
     {
-        size_t operator()(const Params& p) const
-        {
-            // This hash function is deliberately very simple and therefore you might think would lead to lots of
-            // collisions. We may now get more hash collisions, which could be an issue as the equality comparison
-            // is very expensive. However, so far we've noticed that comparing weights is less expensive than
-            // copying them around for each part so this function is good enough.
-            size_t h = 17;
-            h        = h * 37 + std::hash<size_t>()(p.weightsData->size());
-            h        = h * 37 + std::hash<size_t>()(p.biasData.size());
-            h        = h * 37 + std::hash<uint32_t>()(p.stripeDepth);
-            h        = h * 37 + std::hash<uint32_t>()(p.iterationSize);
-            // Note we cast the enum to an integral type, as some compilers (e.g. aarch64-linux-gnu-g++ 5.3.1)
-            // don't support using the enum type directly, even though the spec indicates that they should.
-            h = h * 37 + std::hash<uint32_t>()(static_cast<uint32_t>(p.algorithm));
-            return h;
-        }
+        size_t operator()(const Key& key) const;
     };
 
-    std::unique_ptr<WeightEncoder> m_Encoder;
-    std::unordered_map<Params, std::shared_ptr<EncodedWeights>, Hasher> m_Entries;
+    Key CreateKey(const Params& params);
+    EncodedWeightsSizes EstimateSizes(const Params& params, const TensorShape& stripeShape);
+    std::string GetCacheFilePath(const Key& key) const;
+    std::shared_ptr<EncodedWeights> LoadFromDisk(const Key& key) const;
+    void SaveToDisk(const Key& key, const EncodedWeights& encodedWeights) const;
+
+    const HardwareCapabilities m_Capabilities;
+    const uint64_t m_CapabilitiesDigest;
+    const std::string m_CacheDir;
+    ThreadPool* const m_ThreadPool;
+
+    /// 128-bit digest of each weights vector seen so far. The vectors are shared between many Params (e.g. all the
+    /// plans for a Part), so this means each one is only hashed once. The map also keeps the vectors alive so that a
+    /// different vector can't be allocated at the same address.
+    using WeightsDigest = std::array<uint64_t, 2>;
+    std::unordered_map<const std::vector<uint8_t>*,
+                       std::pair<std::shared_ptr<const std::vector<uint8_t>>, WeightsDigest>>
+        m_WeightsDigests;
+    std::unordered_map<Key, std::shared_future<std::shared_ptr<EncodedWeights>>, KeyHasher> m_Entries;
+    std::mutex m_Mutex;
+
+    std::atomic<uint64_t> m_NumHits;
+    std::atomic<uint64_t> m_NumDiskHits;
+    std::atomic<uint64_t> m_NumMisses;
+};
+
+/// Weights which are only encoded when they are first needed, with an estimate of their sizes before then.
+/// See WeightEncoderCache::EncodeLazily.
+class LazyEncodedWeights
+{
+public:
+    LazyEncodedWeights(std::shared_ptr<WeightEncoderCache> cache,
+                       const WeightEncoderCache::Params& params,
+                       const EncodedWeightsSizes& estimatedSizes);
+
+    /// The sizes estimated when this was created. These don't change once the weights are encoded.
+    const EncodedWeightsSizes& GetEstimatedSizes() const;
+
+    /// Encodes the weights (through the cache), unless this has already been done. This is safe to call from
+    /// multiple threads.
+    std::shared_ptr<EncodedWeights> Encode();
+
+    /// Returns the encoded weights if Encode has been called, otherwise nullptr.
+    std::shared_ptr<EncodedWeights> GetIfEncoded() const;
+
+private:
+    const std::shared_ptr<WeightEncoderCache> m_Cache;
+    const WeightEncoderCache::Params m_Params;
+    const EncodedWeightsSizes m_EstimatedSizes;
+
+    mutable std::mutex m_Mutex;
+    std::shared_ptr<EncodedWeights> m_EncodedWeights;
 };
 
 }    // namespace support_library
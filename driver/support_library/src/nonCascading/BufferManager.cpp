@@ -7,9 +7,15 @@
 
 #include "Utils.hpp"
 
+#include <ethosn_command_stream/CommandStream.hpp>
 #include <ethosn_command_stream/CommandStreamBuffer.hpp>
+#include <ethosn_utils/Hash.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <limits>
+#include <set>
+#include <unordered_map>
 
 namespace ethosn
 {
@@ -118,17 +124,255 @@ uint32_t AppendBufferAligned(std::vector<uint8_t>& dest, uint32_t alignment, con
     return offset;
 }
 
+/// The range of time (inclusive) during which the contents of a buffer must be preserved.
+/// Time is measured in sections of the command stream, which the firmware starts in order. The firmware may still be
+/// accessing a buffer after the section which last uses it has ended, until it executes a FENCE command.
+struct BufferLifetime
+{
+    uint32_t m_Start;
+    uint32_t m_End;
+
+    bool Overlaps(const BufferLifetime& other) const
+    {
+        return m_Start <= other.m_End && other.m_Start <= m_End;
+    }
+};
+
+/// Finds when each DRAM buffer is used by the command stream, as its lifetime.
+/// Buffers which aren't referenced by any command are not included.
+std::map<uint32_t, BufferLifetime> GetDramBufferLifetimes(const std::vector<uint8_t>& cmdStreamData)
+{
+    std::map<uint32_t, BufferLifetime> result;
+    uint32_t time = 0;
+
+    auto use = [&](uint32_t bufferId) {
+        auto it = result.find(bufferId);
+        if (it == result.end())
+        {
+            result.insert({ bufferId, { time, time } });
+        }
+        else
+        {
+            it->second.m_End = time;
+        }
+    };
+    auto useTensor = [&](const command_stream::TensorInfo& info) {
+        if (info.m_DataLocation() == command_stream::DataLocation::DRAM)
+        {
+            use(info.m_DramBufferId());
+        }
+    };
+
+    command_stream::CommandStream cmdStream(cmdStreamData.data(), cmdStreamData.data() + cmdStreamData.size());
+    for (const command_stream::CommandHeader& header : cmdStream)
+    {
+        switch (header.m_Opcode())
+        {
+            case command_stream::Opcode::SECTION:
+                ++time;
+                break;
+            case command_stream::Opcode::OPERATION_MCE_PLE:
+            {
+                const command_stream::McePle& data =
+                    header.GetCommand<command_stream::Opcode::OPERATION_MCE_PLE>()->m_Data();
+                useTensor(data.m_InputInfo());
+                useTensor(data.m_OutputInfo());
+                break;
+            }
+            case command_stream::Opcode::OPERATION_PLE_ONLY:
+            {
+                const command_stream::PleOnly& data =
+                    header.GetCommand<command_stream::Opcode::OPERATION_PLE_ONLY>()->m_Data();
+                useTensor(data.m_InputInfo());
+                if (data.m_NumInputInfos() == 2)
+                {
+                    useTensor(data.m_InputInfo2());
+                }
+                useTensor(data.m_OutputInfo());
+                break;
+            }
+            case command_stream::Opcode::OPERATION_SOFTMAX:
+            {
+                const command_stream::Softmax& data =
+                    header.GetCommand<command_stream::Opcode::OPERATION_SOFTMAX>()->m_Data();
+                useTensor(data.m_InputInfo());
+                useTensor(data.m_OutputInfo());
+                break;
+            }
+            case command_stream::Opcode::OPERATION_CONVERT:
+            {
+                const command_stream::Convert& data =
+                    header.GetCommand<command_stream::Opcode::OPERATION_CONVERT>()->m_Data();
+                useTensor(data.m_InputInfo());
+                useTensor(data.m_OutputInfo());
+                break;
+            }
+            case command_stream::Opcode::OPERATION_SPACE_TO_DEPTH:
+            {
+                const command_stream::SpaceToDepth& data =
+                    header.GetCommand<command_stream::Opcode::OPERATION_SPACE_TO_DEPTH>()->m_Data();
+                useTensor(data.m_InputInfo());
+                useTensor(data.m_OutputInfo());
+                break;
+            }
+            case command_stream::Opcode::DUMP_DRAM:
+                use(header.GetCommand<command_stream::Opcode::DUMP_DRAM>()->m_Data().m_DramBufferId());
+                break;
+            default:
+                break;
+        }
+    }
+    return result;
+}
+
+/// Buffers without a lifetime are assumed to be live for the whole inference.
+BufferLifetime GetLifetime(const std::map<uint32_t, BufferLifetime>& lifetimes, uint32_t bufferId)
+{
+    auto it = lifetimes.find(bufferId);
+    return it == lifetimes.end() ? BufferLifetime{ 0, std::numeric_limits<uint32_t>::max() } : it->second;
+}
+
+/// Sets the offsets of the given intermediate buffers so that buffers whose lifetimes overlap don't overlap in memory,
+/// but others may share it.
+/// This is greedy by size: the largest buffers are placed first, each in the smallest gap between the buffers already
+/// placed which it needs to avoid (or after all of them).
+void PackIntermediates(std::vector<std::pair<uint32_t, CompilerBufferInfo*>> buffers,
+                       const std::map<uint32_t, BufferLifetime>& lifetimes,
+                       uint32_t alignment)
+{
+    // Largest first, and otherwise in order of ID so that the result is deterministic
+    std::stable_sort(buffers.begin(), buffers.end(), [](const auto& a, const auto& b) {
+        return a.second->m_Size > b.second->m_Size;
+    });
+
+    struct Placed
+    {
+        uint32_t m_Begin;
+        uint32_t m_End;
+        BufferLifetime m_Lifetime;
+    };
+    std::vector<Placed> placed;
+    std::vector<const Placed*> conflicts;
+    for (const auto& idAndBuffer : buffers)
+    {
+        CompilerBufferInfo& buffer    = *idAndBuffer.second;
+        const BufferLifetime lifetime = GetLifetime(lifetimes, idAndBuffer.first);
+
+        conflicts.clear();
+        for (const Placed& p : placed)
+        {
+            if (p.m_Lifetime.Overlaps(lifetime))
+            {
+                conflicts.push_back(&p);
+            }
+        }
+        std::sort(conflicts.begin(), conflicts.end(),
+                  [](const Placed* a, const Placed* b) { return a->m_Begin < b->m_Begin; });
+
+        uint32_t bestOffset  = 0;
+        uint32_t bestGapSize = std::numeric_limits<uint32_t>::max();
+        uint32_t gapBegin    = 0;
+        for (const Placed* conflict : conflicts)
+        {
+            const uint32_t offset = utils::RoundUpToNearestMultiple(gapBegin, alignment);
+            if (offset + buffer.m_Size <= conflict->m_Begin && conflict->m_Begin - offset < bestGapSize)
+            {
+                bestOffset  = offset;
+                bestGapSize = conflict->m_Begin - offset;
+            }
+            gapBegin = std::max(gapBegin, conflict->m_End);
+        }
+        if (bestGapSize == std::numeric_limits<uint32_t>::max())
+        {
+            bestOffset = utils::RoundUpToNearestMultiple(gapBegin, alignment);
+        }
+
+        buffer.m_Offset = bestOffset;
+        placed.push_back({ bestOffset, bestOffset + buffer.m_Size, lifetime });
+    }
+}
+
+/// Finds where FENCE commands are needed so that, whenever two of the given buffers share memory, the firmware has
+/// finished with the first one before the second one is used.
+/// Returns the (1-based) indices of the sections which need a fence before them.
+std::set<uint32_t> GetRequiredFences(const std::vector<std::pair<uint32_t, CompilerBufferInfo*>>& buffers,
+                                     const std::map<uint32_t, BufferLifetime>& lifetimes)
+{
+    // For each pair of buffers sharing memory, the range of sections before which a fence would separate them
+    std::vector<BufferLifetime> ranges;
+    for (size_t i = 0; i < buffers.size(); ++i)
+    {
+        for (size_t j = i + 1; j < buffers.size(); ++j)
+        {
+            const CompilerBufferInfo& a = *buffers[i].second;
+            const CompilerBufferInfo& b = *buffers[j].second;
+            if (a.m_Offset >= b.m_Offset + b.m_Size || b.m_Offset >= a.m_Offset + a.m_Size)
+            {
+                continue;
+            }
+            const BufferLifetime first  = GetLifetime(lifetimes, buffers[i].first);
+            const BufferLifetime second = GetLifetime(lifetimes, buffers[j].first);
+            assert(!first.Overlaps(second));
+            ranges.push_back(first.m_End < second.m_Start ? BufferLifetime{ first.m_End + 1, second.m_Start }
+                                                          : BufferLifetime{ second.m_End + 1, first.m_Start });
+        }
+    }
+
+    // As few fences as possible, each as late as possible so that the firmware can overlap the other sections
+    std::sort(ranges.begin(), ranges.end(),
+              [](const BufferLifetime& a, const BufferLifetime& b) { return a.m_End < b.m_End; });
+    std::set<uint32_t> result;
+    for (const BufferLifetime& range : ranges)
+    {
+        if (result.empty() || *result.rbegin() < range.m_Start)
+        {
+            result.insert(range.m_End);
+        }
+    }
+    return result;
+}
+
+/// Returns a copy of the given command stream with a FENCE command before each of the given sections.
+std::vector<uint8_t> AddFences(const std::vector<uint8_t>& cmdStreamData, const std::set<uint32_t>& sections)
+{
+    std::vector<uint32_t> fence;
+    command_stream::EmplaceBackCommands(fence, command_stream::Fence{});
+    const uint8_t* fenceBegin = reinterpret_cast<const uint8_t*>(fence.data());
+    const uint8_t* fenceEnd   = reinterpret_cast<const uint8_t*>(fence.data() + fence.size());
+
+    std::vector<uint8_t> result;
+    const uint8_t* copied = cmdStreamData.data();
+    uint32_t section      = 0;
+    command_stream::CommandStream cmdStream(cmdStreamData.data(), cmdStreamData.data() + cmdStreamData.size());
+    for (const command_stream::CommandHeader& header : cmdStream)
+    {
+        if (header.m_Opcode() == command_stream::Opcode::SECTION && sections.count(++section) > 0)
+        {
+            const uint8_t* command = reinterpret_cast<const uint8_t*>(&header);
+            result.insert(result.end(), copied, command);
+            result.insert(result.end(), fenceBegin, fenceEnd);
+            copied = command;
+        }
+    }
+    result.insert(result.end(), copied, cmdStreamData.data() + cmdStreamData.size());
+    return result;
+}
+
 }    // namespace
 
-void BufferManager::Allocate()
+void BufferManager::Allocate(bool packIntermediates)
 {
     // There is a restriction on the alignment of DRAM accesses for NHWCB and NHWCB_COMPRESSED formats.
     // NHWCB needs to be 16 byte aligned.
     // NHWCB_COMPRESSED needs to be 64 byte aligned.
     constexpr uint32_t alignment = 64;
-    uint32_t intermediatesOffset = 0;
     uint32_t inputsOffset        = 0;
     uint32_t outputsOffset       = 0;
+    // Intermediates go first, as sharing memory between them may add commands to the command stream
+    AllocateIntermediates(packIntermediates, alignment);
+    // Constant DMA buffers which have already been appended, looked up by a hash of their contents, so that
+    // identical data (e.g. the same weights used by several layers) is only stored once.
+    std::unordered_multimap<uint64_t, const CompilerBufferInfo*> constantDmaBuffers;
     for (auto& internalBufferIt : m_Buffers)
     {
         CompilerBufferInfo& buffer = internalBufferIt.second;
@@ -141,14 +385,29 @@ void BufferManager::Allocate()
         switch (buffer.m_Type)
         {
             case BufferType::Intermediate:
-                buffer.m_Offset = AppendBufferAligned(intermediatesOffset, alignment, buffer.m_Size);
+                // Already allocated above
                 break;
             case BufferType::ConstantControlUnit:
                 buffer.m_Offset = AppendBufferAligned(m_ConstantControlUnitData, alignment, buffer.m_ConstantData);
                 break;
             case BufferType::ConstantDma:
-                buffer.m_Offset = AppendBufferAligned(m_ConstantDmaData, alignment, buffer.m_ConstantData);
+            {
+                const uint64_t hash = ethosn::utils::Xxh64(buffer.m_ConstantData.data(), buffer.m_ConstantData.size());
+                auto candidates     = constantDmaBuffers.equal_range(hash);
+                auto existing       = std::find_if(candidates.first, candidates.second, [&buffer](const auto& c) {
+                    return c.second->m_ConstantData == buffer.m_ConstantData;
+                });
+                if (existing != candidates.second)
+                {
+                    buffer.m_Offset = existing->second->m_Offset;
+                }
+                else
+                {
+                    buffer.m_Offset = AppendBufferAligned(m_ConstantDmaData, alignment, buffer.m_ConstantData);
+                    constantDmaBuffers.emplace(hash, &buffer);
+                }
                 break;
+            }
             case BufferType::Input:
                 buffer.m_Offset = AppendBufferAligned(inputsOffset, alignment, buffer.m_Size);
                 break;
@@ -161,6 +420,51 @@ void BufferManager::Allocate()
     }
 }
 
+void BufferManager::AllocateIntermediates(bool packIntermediates, uint32_t alignment)
+{
+    std::vector<std::pair<uint32_t, CompilerBufferInfo*>> intermediates;
+    for (auto& internalBufferIt : m_Buffers)
+    {
+        CompilerBufferInfo& buffer = internalBufferIt.second;
+        if (buffer.m_Location == BufferLocation::Dram && buffer.m_Type == BufferType::Intermediate)
+        {
+            intermediates.push_back({ internalBufferIt.first, &buffer });
+        }
+    }
+
+    if (!packIntermediates)
+    {
+        uint32_t intermediatesOffset = 0;
+        for (const auto& idAndBuffer : intermediates)
+        {
+            idAndBuffer.second->m_Offset =
+                AppendBufferAligned(intermediatesOffset, alignment, idAndBuffer.second->m_Size);
+        }
+        return;
+    }
+
+    // Intermediate buffers which aren't needed at the same time can share memory. The command stream is
+    // buffer 0, if it has been added.
+    auto cmdStreamIt = m_Buffers.find(0);
+    if (cmdStreamIt == m_Buffers.end())
+    {
+        PackIntermediates(intermediates, {}, alignment);
+        return;
+    }
+    CompilerBufferInfo& cmdStream                      = cmdStreamIt->second;
+    const std::map<uint32_t, BufferLifetime> lifetimes = GetDramBufferLifetimes(cmdStream.m_ConstantData);
+    PackIntermediates(intermediates, lifetimes, alignment);
+
+    // The firmware only guarantees that it has finished with a buffer at a FENCE command, so add them wherever
+    // memory is reused
+    const std::set<uint32_t> fences = GetRequiredFences(intermediates, lifetimes);
+    if (!fences.empty())
+    {
+        cmdStream.m_ConstantData = AddFences(cmdStream.m_ConstantData, fences);
+        cmdStream.m_Size         = static_cast<uint32_t>(cmdStream.m_ConstantData.size());
+    }
+}
+
 const std::map<uint32_t, CompilerBufferInfo>& BufferManager::GetBuffers() const
 {
     return m_Buffers;
@@ -93,16 +93,22 @@ public:
     uint32_t GetSramOffset(uint32_t bufferId);
 
     /// Sets of m_Offset field of all DRAM buffers such that all buffers of each type are laid out contiguously.
+    /// If packIntermediates is true, intermediate buffers which are not used by the command stream at the same time
+    /// may share memory, and FENCE commands are added to the command stream where needed so that the firmware has
+    /// finished with one before reusing its memory for another. Constant DMA buffers with identical contents share a single copy of the data.
     /// Also fills in m_ConstantDmaData and m_ConstantControlUnitData with the concatenated data from all
     /// constant buffers of the corresponding type.
-    /// Call this once all buffers have been added.
-    void Allocate();
+    /// Call this once all buffers (including the command stream) have been added.
+    void Allocate(bool packIntermediates);
 
     const std::map<uint32_t, CompilerBufferInfo>& GetBuffers() const;
     const std::vector<uint8_t>& GetConstantDmaData() const;
     const std::vector<uint8_t>& GetConstantControlUnitData() const;
 
 private:
+    /// Sets the m_Offset field of all DRAM intermediate buffers. See Allocate().
+    void AllocateIntermediates(bool packIntermediates, uint32_t alignment);
+
     /// All the buffers we currently know about, looked up by ID.
     /// Note that the order of this map is unimportant but we still use an ordered map so that the
     /// order of iteration is consistent across implementations so that Allocate() will allocate
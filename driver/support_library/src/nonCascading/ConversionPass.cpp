@@ -30,10 +30,12 @@ using namespace utils;
 namespace
 {
 bool ChooseAndSetupStripe(const HardwareCapabilities& capabilities,
-                          SramAllocator sramAllocator,
+                          SramAllocator& sramAllocator,
                           TensorShape& outputStripe,
                           const TensorShape& outputShape)
 {
+    // This only checks whether a stripe fits in SRAM, so the allocation is undone before returning
+    const SramAllocator::Checkpoint checkpoint = sramAllocator.GetCheckpoint();
     std::pair<bool, uint32_t> outputAllocateResult;
     AllocationPreference outputAllocationPreference = AllocationPreference::Start;
     outputAllocateResult.first                      = false;
@@ -75,6 +77,7 @@ bool ChooseAndSetupStripe(const HardwareCapabilities& capabilities,
         }
     }
 
+    sramAllocator.Rollback(checkpoint);
     return outputAllocateResult.first;
 }
 }    // namespace
@@ -165,7 +168,7 @@ std::unique_ptr<ethosn::support_library::ConversionPass> ConversionPass::CreateG
         else if (definiteNodes.front()->GetInputLocation(0) == BufferLocation::Dram)
         {
             // For DRAM -> DRAM conversion we use the biggest possible stripe shape in the Y-direction.
-            // This allocator is passed by value! I.E it is given as a hint to check whether the selected
+            // Nothing is left allocated in sramAllocator, it is only used to check whether the selected
             // stripe fits in SRAM.
             ChooseAndSetupStripe(capabilities, sramAllocator, stripeShape, definiteNodes.back()->GetShape());
 
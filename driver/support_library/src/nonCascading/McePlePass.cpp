@@ -409,7 +409,8 @@ std::unique_ptr<ethosn::support_library::McePlePass>
                                bool enableWinograd,
                                Node* firstNode,
                                SramAllocator& sramAllocator,
-                               bool forwardEst)
+                               bool forwardEst,
+                               ThreadPool& threadPool)
 {
     // Find the largest set of linear nodes which can be formed into a pass
     LinearNodesOutput linearNodes = FindLinearWorkingNodes(firstNode, sramAllocator, capabilities, allowedStrategies,
@@ -539,7 +540,7 @@ std::unique_ptr<ethosn::support_library::McePlePass>
 
     std::unique_ptr<ethosn::support_library::McePlePass> result = std::make_unique<McePlePass>(
         capabilities, id, linearNodes.m_WorkingNodes, linearNodes.m_StrategyConfig, linearNodes.m_OutputLocation,
-        intermediateOutputCompressedFormat, linearNodes.m_Algorithm, sramOffset);
+        intermediateOutputCompressedFormat, linearNodes.m_Algorithm, sramOffset, threadPool);
 
     return result;
 }
@@ -551,12 +552,13 @@ McePlePass::McePlePass(const HardwareCapabilities& capabilities,
                        BufferLocation outputLocation,
                        CompilerDataCompressedFormat intermediateCompressedFormat,
                        CompilerMceAlgorithm algorithm,
-                       uint32_t sramOffset)
+                       uint32_t sramOffset,
+                       ThreadPool& threadPool)
     : Pass(capabilities, id)
     , m_ExtractSubtensorNode(nullptr)
     , m_MceOperation(nullptr)
     , m_PleOperation(nullptr)
-    , m_WeightEncoder(WeightEncoder::CreateWeightEncoder(capabilities))
+    , m_WeightEncoder(WeightEncoder::CreateWeightEncoder(capabilities, &threadPool))
     , m_StrategyConfig(strategyConfig)
 {
     m_Nodes = nodes;
@@ -1063,7 +1065,7 @@ PassStats McePlePass::GetStats(const EstimationOptions& estimationOptions)
     EncodedWeights encodedWeights =
         m_WeightEncoder->Encode(*m_MceOperation, weightStripeDepth, weightStripeSize, quantizationInfo);
 
-    perfData.m_Weights = GetWeightsStats(m_Capabilities, encodedWeights, weightsInfo, weightsStripeShape,
+    perfData.m_Weights = GetWeightsStats(m_Capabilities, GetSizes(encodedWeights), weightsInfo, weightsStripeShape,
                                          weightsTileSize, inputShape, inputStripeShape);
 
     perfData.m_Mce = GetMceStats(m_Capabilities, m_MceOperation->GetStride(), m_MceOperation->GetOperation(),
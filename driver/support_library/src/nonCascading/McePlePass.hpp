@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include "../ThreadPool.hpp"
 #include "GraphNodes.hpp"
 #include "Pass.hpp"
 #include "SramAllocator.hpp"
@@ -104,7 +105,8 @@ public:
                                                       bool enableWinograd,
                                                       Node* firstNode,
                                                       SramAllocator& sramAllocator,
-                                                      bool forwardEst);
+                                                      bool forwardEst,
+                                                      ThreadPool& threadPool);
 
     McePlePass(const HardwareCapabilities& capabilities,
                size_t id,
@@ -113,7 +115,8 @@ public:
                BufferLocation outputLocation,
                CompilerDataCompressedFormat intermediateCompressedFormat,
                CompilerMceAlgorithm algorithm,
-               uint32_t sramOffset);
+               uint32_t sramOffset,
+               ThreadPool& threadPool);
 
     /// Generates this Pass by adding appropriate entries to the given command stream, memory map and buffer table.
     void Generate(command_stream::CommandStreamBuffer& cmdStream, BufferManager& bufferManager, bool dumpRam) override;
@@ -0,0 +1,251 @@
+//
+// Copyright © 2021 Arm Limited.
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "../src/nonCascading/BufferManager.hpp"
+
+#include <catch.hpp>
+#include <ethosn_command_stream/CommandStreamBuffer.hpp>
+
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <vector>
+
+using namespace ethosn::support_library;
+namespace cs = ethosn::command_stream;
+
+namespace
+{
+
+/// Adds a section containing a single command which converts between the given DRAM buffers.
+void AddConvert(cs::CommandStreamBuffer& cmdStream, uint32_t inputBufferId, uint32_t outputBufferId)
+{
+    cs::Section section;
+    section.m_Type() = cs::SectionType::SISO;
+    cmdStream.EmplaceBack(section);
+
+    cs::Convert convert;
+    convert.m_InputInfo().m_DataLocation()  = cs::DataLocation::DRAM;
+    convert.m_InputInfo().m_DramBufferId()  = inputBufferId;
+    convert.m_OutputInfo().m_DataLocation() = cs::DataLocation::DRAM;
+    convert.m_OutputInfo().m_DramBufferId() = outputBufferId;
+    cmdStream.EmplaceBack(convert);
+}
+
+bool Overlap(const CompilerBufferInfo& a, const CompilerBufferInfo& b)
+{
+    return a.m_Offset < b.m_Offset + b.m_Size && b.m_Offset < a.m_Offset + a.m_Size;
+}
+
+/// Checks that whenever two of the given buffers share memory, the command stream has a FENCE between the last command
+/// using one of them and the first command using the other.
+void RequireFenceBetweenSharedBuffers(const std::map<uint32_t, CompilerBufferInfo>& buffers,
+                                      const std::vector<uint32_t>& ids)
+{
+    // Index of the first and last commands which use each buffer, and of each fence
+    std::map<uint32_t, std::pair<uint32_t, uint32_t>> uses;
+    std::vector<uint32_t> fences;
+    const std::vector<uint8_t>& data = buffers.at(0).m_ConstantData;
+    cs::CommandStream cmdStream(data.data(), data.data() + data.size());
+    uint32_t index = 0;
+    for (const cs::CommandHeader& header : cmdStream)
+    {
+        if (header.m_Opcode() == cs::Opcode::FENCE)
+        {
+            fences.push_back(index);
+        }
+        else if (header.m_Opcode() == cs::Opcode::OPERATION_CONVERT)
+        {
+            const cs::Convert& convert = header.GetCommand<cs::Opcode::OPERATION_CONVERT>()->m_Data();
+            for (uint32_t id : { convert.m_InputInfo().m_DramBufferId(), convert.m_OutputInfo().m_DramBufferId() })
+            {
+                auto it = uses.find(id);
+                if (it == uses.end())
+                {
+                    uses[id] = { index, index };
+                }
+                else
+                {
+                    it->second.second = index;
+                }
+            }
+        }
+        ++index;
+    }
+
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+        for (size_t j = i + 1; j < ids.size(); ++j)
+        {
+            if (!Overlap(buffers.at(ids[i]), buffers.at(ids[j])))
+            {
+                continue;
+            }
+            std::pair<uint32_t, uint32_t> first  = uses.at(ids[i]);
+            std::pair<uint32_t, uint32_t> second = uses.at(ids[j]);
+            if (second.first < first.first)
+            {
+                std::swap(first, second);
+            }
+            REQUIRE(std::any_of(fences.begin(), fences.end(),
+                                [&](uint32_t fence) { return first.second < fence && fence < second.first; }));
+        }
+    }
+}
+
+}    // namespace
+
+TEST_CASE("BufferManager: Intermediates which are not live at the same time share memory")
+{
+    BufferManager bufferManager;
+    const uint32_t input  = bufferManager.AddDramInput(1000, 0);
+    const uint32_t a      = bufferManager.AddDram(BufferType::Intermediate, 1000);
+    const uint32_t b      = bufferManager.AddDram(BufferType::Intermediate, 2000);
+    const uint32_t c      = bufferManager.AddDram(BufferType::Intermediate, 1000);
+    const uint32_t d      = bufferManager.AddDram(BufferType::Intermediate, 500);
+    const uint32_t e      = bufferManager.AddDram(BufferType::Intermediate, 100);
+    const uint32_t output = bufferManager.AddDram(BufferType::Intermediate, 1000);
+    bufferManager.ChangeToOutput(output, 0, 0);
+    // Not used by any command, so must not share memory with anything
+    const uint32_t unused = bufferManager.AddDram(BufferType::Intermediate, 100);
+
+    // A chain: input -> a -> b -> c -> d -> e -> output
+    cs::CommandStreamBuffer cmdStream;
+    AddConvert(cmdStream, input, a);
+    AddConvert(cmdStream, a, b);
+    AddConvert(cmdStream, b, c);
+    AddConvert(cmdStream, c, d);
+    AddConvert(cmdStream, d, e);
+    AddConvert(cmdStream, e, output);
+    bufferManager.AddCommandStream(cmdStream);
+    bufferManager.Allocate(true);
+
+    const std::map<uint32_t, CompilerBufferInfo>& buffers = bufferManager.GetBuffers();
+    const std::vector<uint32_t> intermediates             = { a, b, c, d, e, unused };
+    uint32_t footprint                                    = 0;
+    for (uint32_t id : intermediates)
+    {
+        REQUIRE(buffers.at(id).m_Offset % 64 == 0);
+        footprint = std::max(footprint, buffers.at(id).m_Offset + buffers.at(id).m_Size);
+    }
+
+    // Buffers used in the same section must not overlap
+    REQUIRE_FALSE(Overlap(buffers.at(a), buffers.at(b)));
+    REQUIRE_FALSE(Overlap(buffers.at(b), buffers.at(c)));
+    REQUIRE_FALSE(Overlap(buffers.at(c), buffers.at(d)));
+    REQUIRE_FALSE(Overlap(buffers.at(d), buffers.at(e)));
+    for (uint32_t id : { a, b, c, d, e })
+    {
+        REQUIRE_FALSE(Overlap(buffers.at(unused), buffers.at(id)));
+    }
+    // But others may, so less memory is needed than for all of them
+    uint32_t total = 0;
+    for (uint32_t id : intermediates)
+    {
+        total += buffers.at(id).m_Size;
+    }
+    REQUIRE(footprint < total);
+    REQUIRE(Overlap(buffers.at(a), buffers.at(c)));
+    RequireFenceBetweenSharedBuffers(buffers, { a, b, c, d, e });
+}
+
+TEST_CASE("BufferManager: A fence separates buffers sharing memory in consecutive sections")
+{
+    BufferManager bufferManager;
+    const uint32_t input = bufferManager.AddDramInput(1000, 0);
+    const uint32_t a     = bufferManager.AddDram(BufferType::Intermediate, 1000);
+    const uint32_t b     = bufferManager.AddDram(BufferType::Intermediate, 1000);
+    const uint32_t c     = bufferManager.AddDram(BufferType::Intermediate, 1000);
+
+    // a is last read in the second section, while c is first written in the third. The firmware may still be reading
+    // a when the third section starts, so c can only reuse its memory after a fence.
+    cs::CommandStreamBuffer cmdStream;
+    AddConvert(cmdStream, input, a);
+    AddConvert(cmdStream, a, b);
+    AddConvert(cmdStream, b, c);
+    bufferManager.AddCommandStream(cmdStream);
+    bufferManager.Allocate(true);
+
+    const std::map<uint32_t, CompilerBufferInfo>& buffers = bufferManager.GetBuffers();
+    REQUIRE(Overlap(buffers.at(a), buffers.at(c)));
+    RequireFenceBetweenSharedBuffers(buffers, { a, b, c });
+
+    // Only the one fence which is needed, right before the third section
+    std::vector<cs::Opcode> opcodes;
+    const std::vector<uint8_t>& data = buffers.at(0).m_ConstantData;
+    for (const cs::CommandHeader& header : cs::CommandStream(data.data(), data.data() + data.size()))
+    {
+        opcodes.push_back(header.m_Opcode());
+    }
+    const std::vector<cs::Opcode> expected = { cs::Opcode::SECTION, cs::Opcode::OPERATION_CONVERT,
+                                               cs::Opcode::SECTION, cs::Opcode::OPERATION_CONVERT,
+                                               cs::Opcode::FENCE,   cs::Opcode::SECTION,
+                                               cs::Opcode::OPERATION_CONVERT };
+    REQUIRE(opcodes == expected);
+    REQUIRE(buffers.at(0).m_Size == data.size());
+}
+
+TEST_CASE("BufferManager: Intermediates are laid out contiguously without a command stream")
+{
+    BufferManager bufferManager;
+    const uint32_t a = bufferManager.AddDram(BufferType::Intermediate, 100);
+    const uint32_t b = bufferManager.AddDram(BufferType::Intermediate, 200);
+    bufferManager.Allocate(true);
+
+    const std::map<uint32_t, CompilerBufferInfo>& buffers = bufferManager.GetBuffers();
+    REQUIRE_FALSE(Overlap(buffers.at(a), buffers.at(b)));
+    // The largest buffer is placed first
+    REQUIRE(buffers.at(b).m_Offset == 0);
+    REQUIRE(buffers.at(a).m_Offset == 256);
+}
+
+TEST_CASE("BufferManager: Intermediates don't share memory when packing is disabled")
+{
+    BufferManager bufferManager;
+    const uint32_t input = bufferManager.AddDramInput(1000, 0);
+    const uint32_t a     = bufferManager.AddDram(BufferType::Intermediate, 100);
+    const uint32_t b     = bufferManager.AddDram(BufferType::Intermediate, 200);
+    const uint32_t c     = bufferManager.AddDram(BufferType::Intermediate, 100);
+    const uint32_t d     = bufferManager.AddDram(BufferType::Intermediate, 100);
+
+    // a and d are never needed at the same time, so would share memory if packing was enabled
+    cs::CommandStreamBuffer cmdStream;
+    AddConvert(cmdStream, input, a);
+    AddConvert(cmdStream, a, b);
+    AddConvert(cmdStream, b, c);
+    AddConvert(cmdStream, c, d);
+    bufferManager.AddCommandStream(cmdStream);
+    bufferManager.Allocate(false);
+
+    // Laid out in order of ID, one after the other
+    const std::map<uint32_t, CompilerBufferInfo>& buffers = bufferManager.GetBuffers();
+    REQUIRE(buffers.at(a).m_Offset == 0);
+    REQUIRE(buffers.at(b).m_Offset == 128);
+    REQUIRE(buffers.at(c).m_Offset == 384);
+    REQUIRE(buffers.at(d).m_Offset == 512);
+    // The command stream is left as it is
+    REQUIRE(buffers.at(0).m_ConstantData.size() == cmdStream.GetData().size() * sizeof(uint32_t));
+}
+
+TEST_CASE("BufferManager: Identical constant DMA buffers share data")
+{
+    BufferManager bufferManager;
+    const std::vector<uint8_t> weights1(100, 1);
+    const std::vector<uint8_t> weights2(100, 2);
+    const uint32_t a = bufferManager.AddDramConstant(BufferType::ConstantDma, weights1);
+    const uint32_t b = bufferManager.AddDramConstant(BufferType::ConstantDma, weights2);
+    const uint32_t c = bufferManager.AddDramConstant(BufferType::ConstantDma, weights1);
+    // Same contents, but a different type of buffer
+    const uint32_t d = bufferManager.AddDramConstant(BufferType::ConstantControlUnit, weights1);
+    bufferManager.Allocate(true);
+
+    const std::map<uint32_t, CompilerBufferInfo>& buffers = bufferManager.GetBuffers();
+    REQUIRE(buffers.at(a).m_Offset == 0);
+    REQUIRE(buffers.at(b).m_Offset == 128);
+    REQUIRE(buffers.at(c).m_Offset == buffers.at(a).m_Offset);
+    REQUIRE(bufferManager.GetConstantDmaData().size() == 228);
+    REQUIRE(bufferManager.GetConstantControlUnitData() == weights1);
+    REQUIRE(buffers.at(d).m_Offset == 0);
+}
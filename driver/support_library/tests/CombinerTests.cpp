@@ -5,12 +5,20 @@
 
 #include "../src/DebuggingContext.hpp"
 #include "../src/GraphNodes.hpp"
+#include "../src/Optimization.hpp"
 #include "../src/cascading/Cascading.hpp"
 #include "../src/cascading/Combiner.hpp"
+#include "../src/cascading/Estimation.hpp"
+#include "../src/cascading/EstimationUtils.hpp"
 #include "TestUtils.hpp"
 
 #include <catch.hpp>
+#include <chrono>
 #include <fstream>
+#include <iostream>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
 
 using namespace ethosn::support_library;
 namespace sl = ethosn::support_library;
@@ -2268,3 +2276,200 @@ TEST_CASE("GetOpGraphForCombination")
 
     REQUIRE(combOpGraph.GetConsumers(combOpGraph.GetBuffers()[7]).size() == 0);
 }
+
+namespace
+{
+
+/// Creates an estimation network with a chain of numConvs convolutions, alternating between 3x3 and 1x1 kernels.
+std::shared_ptr<Network> CreateConvolutionChain(uint32_t numConvs)
+{
+    std::shared_ptr<Network> network = CreateEstimationNetwork(GetRawDefaultCapabilities());
+    std::shared_ptr<Operand> tensor  = AddInput(network, sl::TensorInfo({ 1, 32, 32, 16 })).tensor;
+    for (uint32_t i = 0; i < numConvs; ++i)
+    {
+        const uint32_t kernel = (i % 2 == 0) ? 3 : 1;
+        const uint32_t pad    = kernel / 2;
+        std::shared_ptr<Constant> bias =
+            AddConstant(network, sl::TensorInfo({ 1, 1, 1, 16 }, sl::DataType::INT32_QUANTIZED, sl::DataFormat::NHWC,
+                                            QuantizationInfo(0, 1.0f / 256)),
+                        std::vector<int32_t>(16, 0).data())
+                .tensor;
+        std::shared_ptr<Constant> weights =
+            AddConstant(network,
+                        sl::TensorInfo({ kernel, kernel, 16, 16 }, sl::DataType::UINT8_QUANTIZED, sl::DataFormat::HWIO,
+                                   QuantizationInfo(0, 1.0f / 256)),
+                        std::vector<uint8_t>(kernel * kernel * 16 * 16, 1).data())
+                .tensor;
+        tensor = AddConvolution(network, *tensor, *bias, *weights,
+                                ConvolutionInfo(Padding(pad, pad, pad, pad), Stride(1, 1), QuantizationInfo(0, 1.0f)))
+                     .tensor;
+    }
+    AddOutput(network, *tensor);
+    return network;
+}
+
+/// Resets the peak resident memory of this process to its current resident memory, where this is supported.
+/// Free memory is returned to the system first, so that it isn't counted.
+void ResetPeakMemory()
+{
+#if defined(__GLIBC__)
+    malloc_trim(0);
+#endif
+#if defined(__linux__)
+    std::ofstream("/proc/self/clear_refs") << "5";
+#endif
+}
+
+/// Returns the peak resident memory of this process in kilobytes since it was last reset,
+/// or 0 if this isn't available.
+long GetPeakMemoryKb()
+{
+#if defined(__linux__)
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (line.compare(0, 7, "VmHWM:\t") == 0)
+        {
+            return std::stol(line.substr(7));
+        }
+    }
+#endif
+    return 0;
+}
+
+NetworkPerformanceData EstimateWithCombiner(const Network& network, CompilerAlgorithm algorithm)
+{
+    CompilationOptions options  = GetDefaultCompilationOptions();
+    options.m_CompilerAlgorithm = algorithm;
+    return EstimatePerformance(network, options, EstimationOptions());
+}
+
+}    // namespace
+
+/// Checks that the beam search combiner produces a complete combination which is estimated to perform
+/// at least as well as the one chosen by growing and pruning.
+TEST_CASE("CombineBeamSearch is at least as good as Combine")
+{
+    std::shared_ptr<Network> network = CreateConvolutionChain(3);
+
+    NetworkPerformanceData growPrune = EstimateWithCombiner(*network, CompilerAlgorithm::CascadingOnly);
+    NetworkPerformanceData beam      = EstimateWithCombiner(*network, CompilerAlgorithm::CascadingBeamSearchOnly);
+
+    REQUIRE(!beam.m_Stream.empty());
+    REQUIRE(!IsLeftMoreDataPerformantThanRight(growPrune, beam));
+}
+
+/// Checks that estimating a Combination one Part at a time with EstimationCache gives the same metrics as
+/// estimating its whole OpGraph, and that estimating it again is served entirely from the cache.
+TEST_CASE("EstimationCache matches EstimateOpGraph")
+{
+    const EstimationOptions estOpt;
+    CompilationOptions compOpt           = GetDefaultCompilationOptions();
+    compOpt.m_DebugInfo.m_DumpDebugFiles = CompilationOptions::DebugLevel::None;
+    const HardwareCapabilities caps      = GetEthosN77HwCapabilities();
+    DebuggingContext debuggingCtxt(&compOpt.m_DebugInfo);
+    SetDebuggingContext(debuggingCtxt);
+
+    const uint32_t numConvs = GENERATE(1, 2, 4);
+    INFO("Number of convolutions: " << numConvs);
+
+    std::shared_ptr<Network> network = CreateConvolutionChain(numConvs);
+    Graph graph(*network, caps, estOpt, false);
+    OptimizeGraph(graph);
+    GraphOfParts parts = CreateGraphOfParts(graph, estOpt, compOpt, caps);
+    CreatePlans(parts.m_Parts, 1);
+
+    // Take the combinations found by both combiners
+    Cascading cascading(estOpt, compOpt, caps);
+    Combinations combs      = cascading.Combine(parts);
+    const Metadata metadata = CreateMetadata(parts, caps);
+    EstimationCache beamCache(parts, caps, estOpt);
+    Combinations beamCombs = CombineBeamSearch(parts, metadata, caps, beamCache);
+    combs.insert(combs.end(), beamCombs.begin(), beamCombs.end());
+
+    EstimationCache cache(parts, caps, estOpt);
+    for (const Combination& comb : combs)
+    {
+        const OpGraph opGraph             = GetOpGraphForCombination(comb, parts);
+        const DataMetrics full            = GetDataMetrics(EstimateOpGraph(opGraph, caps, estOpt).m_PerfData);
+        utils::Optional<DataMetrics> part = cache.EstimateCombination(comb);
+        REQUIRE(part.has_value());
+        REQUIRE(part.value().m_Total == full.m_Total);
+        REQUIRE(part.value().m_NonParallel == full.m_NonParallel);
+        REQUIRE(part.value().m_NumPasses == full.m_NumPasses);
+    }
+
+    const uint64_t numHits   = cache.GetNumHits();
+    const uint64_t numMisses = cache.GetNumMisses();
+    cache.EstimateCombination(combs.front());
+    REQUIRE(cache.GetNumMisses() == numMisses);
+    REQUIRE(cache.GetNumHits() == numHits + parts.GetNumParts());
+}
+
+/// Compares compile time and estimated performance of the two combiners on increasingly long networks.
+/// Hidden as it takes a long time with the grow/prune combiner. Run with: UnitTests "[.benchmark]"
+TEST_CASE("Combiner benchmark", "[.benchmark]")
+{
+    for (uint32_t numConvs : { 2u, 4u, 8u, 16u })
+    {
+        std::shared_ptr<Network> network = CreateConvolutionChain(numConvs);
+        for (CompilerAlgorithm algorithm :
+             { CompilerAlgorithm::CascadingOnly, CompilerAlgorithm::CascadingBeamSearchOnly })
+        {
+            const auto start                = std::chrono::steady_clock::now();
+            NetworkPerformanceData perfData = EstimateWithCombiner(*network, algorithm);
+            const auto duration             = std::chrono::steady_clock::now() - start;
+
+            std::cout << numConvs << " convolutions, " << EthosNCompilerAlgorithmAsString(algorithm) << ": "
+                      << std::chrono::duration_cast<std::chrono::milliseconds>(duration).count() << " ms, "
+                      << "total data " << GetPerformanceTotalDataMetric(perfData) << ", non-parallel data "
+                      << GetPerformanceNonParallelDataMetric(perfData) << ", " << perfData.m_Stream.size()
+                      << " passes" << std::endl;
+        }
+    }
+}
+
+/// Measures the time and memory used by the combiners on increasingly long MobileNet-style chains of convolutions,
+/// up to one with over 100 Parts. The number of combinations the grow/prune combiner explores grows much faster than
+/// the network, so it is only run on the shorter chains.
+/// Hidden as it takes a long time. Run with: UnitTests "[.benchmark]"
+TEST_CASE("Combiner long network benchmark", "[.benchmark]")
+{
+    const EstimationOptions estOpt;
+    CompilationOptions compOpt           = GetDefaultCompilationOptions();
+    compOpt.m_DebugInfo.m_DumpDebugFiles = CompilationOptions::DebugLevel::None;
+    const HardwareCapabilities caps      = GetEthosN77HwCapabilities();
+    DebuggingContext debuggingCtxt(&compOpt.m_DebugInfo);
+    SetDebuggingContext(debuggingCtxt);
+
+    for (bool beamSearch : { true, false })
+    {
+        for (uint32_t numConvs : { 8u, 16u, 32u, 64u, 128u })
+        {
+            if (!beamSearch && numConvs > 32)
+            {
+                break;
+            }
+
+            std::shared_ptr<Network> network = CreateConvolutionChain(numConvs);
+            Graph graph(*network, caps, estOpt, false);
+            OptimizeGraph(graph);
+            GraphOfParts parts = CreateGraphOfParts(graph, estOpt, compOpt, caps);
+            CreatePlans(parts.m_Parts, 0);
+
+            Cascading cascading(estOpt, compOpt, caps);
+            ResetPeakMemory();
+            const long peakMemoryBefore = GetPeakMemoryKb();
+            const auto start            = std::chrono::steady_clock::now();
+            Combinations combs = beamSearch ? cascading.CombineBeamSearch(parts) : cascading.Combine(parts);
+            const auto duration = std::chrono::steady_clock::now() - start;
+
+            std::cout << parts.GetNumParts() << " parts, " << (beamSearch ? "beam search" : "grow/prune") << ": "
+                      << std::chrono::duration_cast<std::chrono::milliseconds>(duration).count()
+                      << " ms, peak memory grew by " << (GetPeakMemoryKb() - peakMemoryBefore) << " kB, "
+                      << combs.size() << " combinations" << std::endl;
+            REQUIRE(!combs.empty());
+        }
+    }
+}
@@ -733,12 +733,17 @@ TEST_CASE("PlanGenerator:MceOperationNode")
     REQUIRE(dynamic_cast<MceOp*>(ops2[0]) != nullptr);
     REQUIRE(dynamic_cast<PleOp*>(ops2[2]) != nullptr);
 
-    // Check the weights have been encoded properly
+    // Check the weights have been sized from the estimate, and are only encoded when asked
     REQUIRE(buffers2[2]->m_Format == CascadingBufferFormat::WEIGHT);
     REQUIRE(buffers2[2]->m_EncodedWeights != nullptr);
-    REQUIRE(buffers2[2]->m_EncodedWeights->m_Data.size() > 0);
-    REQUIRE(buffers2[2]->m_SizeInBytes == buffers2[2]->m_EncodedWeights->m_Data.size());
-    REQUIRE(buffers2[3]->m_SizeInBytes == buffers2[2]->m_EncodedWeights->m_MaxSize);
+    const EncodedWeightsSizes& estimatedSizes = buffers2[2]->m_EncodedWeights->GetEstimatedSizes();
+    REQUIRE(estimatedSizes.m_TotalSize > 0);
+    REQUIRE(buffers2[2]->m_SizeInBytes == estimatedSizes.m_TotalSize);
+    REQUIRE(buffers2[3]->m_SizeInBytes == estimatedSizes.m_MaxStripeSize * buffers2[3]->m_NumStripes);
+    REQUIRE(buffers2[2]->m_EncodedWeights->GetIfEncoded() == nullptr);
+    std::shared_ptr<EncodedWeights> encodedWeights = buffers2[2]->m_EncodedWeights->Encode();
+    REQUIRE(encodedWeights->m_Data.size() > 0);
+    REQUIRE(buffers2[2]->m_EncodedWeights->GetIfEncoded() == encodedWeights);
 }
 
 TEST_CASE("PlanGenerator: Generate plans from a part with single format conversion node")
@@ -1210,3 +1215,52 @@ TEST_CASE("PlanGenerator: Split output in depth")
         REQUIRE(ContainsPlanWithStripes(part.m_Plans, inputStripe, numInputStripes, outputStripe, numOutputStripes));
     }
 }
+
+TEST_CASE("PlanGenerator: Plans generated in parallel match those generated serially")
+{
+    const EstimationOptions estOpt;
+    const CompilationOptions compOpt = GetDefaultCompilationOptions();
+    const HardwareCapabilities caps  = GetEthosN77HwCapabilities();
+
+    auto generate = [&](uint32_t numThreads) {
+        Graph g;
+        Parts parts;
+        parts.push_back(std::make_unique<Part>(
+            BuildPartWithMceNode(g, TS{ 1, 32, 32, 16 }, TS{ 1, 32, 32, 16 }, TS{ 3, 3, 16, 16 },
+                                 ethosn::command_stream::MceOperation::CONVOLUTION, estOpt, compOpt, caps)));
+        parts.push_back(std::make_unique<Part>(
+            BuildPartWithMceNode(g, TS{ 1, 16, 16, 64 }, TS{ 1, 16, 16, 64 }, TS{ 3, 3, 64, 1 },
+                                 ethosn::command_stream::MceOperation::DEPTHWISE_CONVOLUTION, estOpt, compOpt, caps)));
+        parts.push_back(std::make_unique<Part>(
+            BuildPartWithMceNode(g, TS{ 1, 8, 8, 32 }, TS{ 1, 8, 8, 32 }, TS{ 1, 1, 32, 32 },
+                                 ethosn::command_stream::MceOperation::CONVOLUTION, estOpt, compOpt, caps)));
+
+        DebuggableObject::ms_IdCounter = 0;
+        CreatePlans(parts, numThreads);
+
+        std::vector<std::string> tags;
+        for (const auto& part : parts)
+        {
+            for (const auto& plan : part->m_Plans)
+            {
+                tags.push_back(plan->m_DebugTag);
+                for (const Op* op : plan->m_OpGraph.GetOps())
+                {
+                    tags.push_back(op->m_DebugTag);
+                }
+                for (const Buffer* buffer : plan->m_OpGraph.GetBuffers())
+                {
+                    tags.push_back(buffer->m_DebugTag);
+                }
+            }
+            tags.push_back("");
+        }
+        tags.push_back(std::to_string(DebuggableObject::ms_IdCounter));
+        return tags;
+    };
+
+    const std::vector<std::string> serial = generate(1);
+    REQUIRE(serial.size() > 3);
+    REQUIRE(generate(4) == serial);
+    REQUIRE(generate(0) == serial);
+}
@@ -7,8 +7,315 @@
 
 #include <catch.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <unordered_set>
+
 using namespace ethosn::support_library;
 
+namespace
+{
+
+/// The original SramAllocator, which keeps an unsorted list of used chunks and sorts the free list on every Free.
+/// SramAllocator must make exactly the same allocations as this.
+class ReferenceSramAllocator
+{
+public:
+    using UserId = size_t;
+
+    ReferenceSramAllocator(uint32_t capacity)
+        : m_Capacity(capacity)
+    {
+        Reset();
+    }
+
+    std::pair<bool, uint32_t> Allocate(UserId userId,
+                                       uint32_t size,
+                                       AllocationPreference pref = AllocationPreference::Start,
+                                       std::string debugName     = "")
+    {
+        if (pref == AllocationPreference::Start)
+        {
+            for (auto range = m_FreeMemory.begin(); range != m_FreeMemory.end(); ++range)
+            {
+                if (size <= range->m_End - range->m_Begin)
+                {
+                    MemoryChunk chunk = { range->m_Begin, range->m_Begin + size, { userId }, debugName };
+                    m_UsedMemory.emplace_back(chunk);
+                    range->m_Begin += size;
+                    if (range->m_Begin == range->m_End)
+                    {
+                        m_FreeMemory.erase(range);
+                    }
+                    return { true, chunk.m_Begin };
+                }
+            }
+        }
+        else
+        {
+            for (auto range = m_FreeMemory.rbegin(); range != m_FreeMemory.rend(); ++range)
+            {
+                if (size <= range->m_End - range->m_Begin)
+                {
+                    MemoryChunk chunk = { range->m_End - size, range->m_End, { userId }, debugName };
+                    m_UsedMemory.emplace_back(chunk);
+                    range->m_End -= size;
+                    if (range->m_Begin == range->m_End)
+                    {
+                        m_FreeMemory.erase(std::next(range).base());
+                    }
+                    return { true, chunk.m_Begin };
+                }
+            }
+        }
+        return { false, 0 };
+    }
+
+    bool Free(UserId userId, uint32_t offset)
+    {
+        auto memoryChunkIt = std::find_if(m_UsedMemory.begin(), m_UsedMemory.end(),
+                                          [offset](const MemoryChunk& chunk) { return offset == chunk.m_Begin; });
+        if (memoryChunkIt == m_UsedMemory.end())
+        {
+            return false;
+        }
+        memoryChunkIt->m_ListOfUsers.erase(userId);
+        if (memoryChunkIt->m_ListOfUsers.empty())
+        {
+            MemoryChunk memoryChunk = *memoryChunkIt;
+            m_UsedMemory.erase(memoryChunkIt);
+            m_FreeMemory.push_back(memoryChunk);
+            std::sort(m_FreeMemory.begin(), m_FreeMemory.end(),
+                      [](const MemoryChunk& lhs, const MemoryChunk& rhs) { return lhs.m_Begin < rhs.m_Begin; });
+            for (size_t i = m_FreeMemory.size() - 1; i >= 1; --i)
+            {
+                if (m_FreeMemory[i - 1].m_End == m_FreeMemory[i].m_Begin)
+                {
+                    m_FreeMemory[i - 1].m_End = m_FreeMemory[i].m_End;
+                    m_FreeMemory.erase(m_FreeMemory.begin() + i);
+                }
+            }
+        }
+        return true;
+    }
+
+    void IncrementReferenceCount(UserId userId, uint32_t offset)
+    {
+        auto memoryChunkIt = std::find_if(m_UsedMemory.begin(), m_UsedMemory.end(),
+                                          [offset](const MemoryChunk& chunk) { return offset == chunk.m_Begin; });
+        memoryChunkIt->m_ListOfUsers.emplace(userId);
+    }
+
+    void Reset()
+    {
+        m_FreeMemory = { { 0, m_Capacity, {}, "" } };
+        m_UsedMemory = {};
+    }
+
+    bool IsFull()
+    {
+        return m_FreeMemory.empty();
+    }
+
+    bool IsEmpty()
+    {
+        return m_UsedMemory.empty();
+    }
+
+private:
+    struct MemoryChunk
+    {
+        uint32_t m_Begin;
+        uint32_t m_End;
+        std::unordered_set<UserId> m_ListOfUsers;
+        std::string m_Debug;
+    };
+
+    uint32_t m_Capacity;
+    std::vector<MemoryChunk> m_FreeMemory;
+    std::vector<MemoryChunk> m_UsedMemory;
+};
+
+/// One step of an allocation trace.
+struct TraceStep
+{
+    enum class Type
+    {
+        Allocate,
+        Free,
+        IncrementReferenceCount,
+    };
+    Type m_Type;
+    SramAllocator::UserId m_UserId;
+    uint32_t m_Size;
+    AllocationPreference m_Pref;
+    /// For Free and IncrementReferenceCount, the index of the (successful) Allocate step whose chunk is used.
+    size_t m_Allocation;
+};
+
+/// A trace of allocations like those made when compiling a network: a few long lived buffers, and for each
+/// layer a number of attempts at allocating a set of tiles (see FitsInSram) of which the last one succeeds.
+/// Each attempt is a group of steps which is either kept or undone.
+struct Trace
+{
+    uint32_t m_Capacity;
+    std::vector<std::vector<TraceStep>> m_Attempts;
+    std::vector<bool> m_Keep;
+};
+
+Trace GenerateTrace(uint32_t seed, uint32_t numLayers)
+{
+    std::mt19937 gen(seed);
+    auto random = [&gen](uint32_t n) { return static_cast<uint32_t>(gen() % n); };
+    Trace trace;
+    trace.m_Capacity = 128 * 1024;
+    std::vector<size_t> live;
+    size_t numAllocations = 0;
+    for (uint32_t layer = 0; layer < numLayers; ++layer)
+    {
+        // Free some of the buffers from previous layers, one of which may have picked up another user
+        std::vector<TraceStep> frees;
+        while (live.size() > 3)
+        {
+            const size_t i = random(static_cast<uint32_t>(live.size()));
+            if (random(4) == 0)
+            {
+                frees.push_back({ TraceStep::Type::IncrementReferenceCount, layer + 1000, 0,
+                                  AllocationPreference::Start, live[i] });
+                frees.push_back({ TraceStep::Type::Free, layer + 1000, 0, AllocationPreference::Start, live[i] });
+            }
+            frees.push_back({ TraceStep::Type::Free, live[i], 0, AllocationPreference::Start, live[i] });
+            live.erase(live.begin() + static_cast<ptrdiff_t>(i));
+        }
+        trace.m_Attempts.push_back(frees);
+        trace.m_Keep.push_back(true);
+
+        // Try decreasing tile sizes until they fit, keeping the last attempt
+        const uint32_t numAttempts = 1 + random(8);
+        for (uint32_t attempt = 0; attempt < numAttempts; ++attempt)
+        {
+            const bool keep = attempt + 1 == numAttempts;
+            const uint32_t scale = numAttempts - attempt;
+            std::vector<TraceStep> steps;
+            for (uint32_t tile = 0; tile < 4; ++tile)
+            {
+                const uint32_t size = 256 * (1 + random(8)) * scale;
+                const AllocationPreference pref =
+                    tile % 2 == 0 ? AllocationPreference::Start : AllocationPreference::End;
+                steps.push_back({ TraceStep::Type::Allocate, numAllocations, size, pref, numAllocations });
+                if (keep && tile != 0)
+                {
+                    live.push_back(numAllocations);
+                }
+                ++numAllocations;
+            }
+            // The PLE tile (the first one) is freed straight away when the attempt is kept
+            if (keep)
+            {
+                steps.push_back({ TraceStep::Type::Free, numAllocations - 4, 0, AllocationPreference::Start,
+                                  numAllocations - 4 });
+            }
+            trace.m_Attempts.push_back(steps);
+            trace.m_Keep.push_back(keep);
+        }
+    }
+    return trace;
+}
+
+/// Replays the steps on the allocator, recording the results so that allocators can be compared.
+template <typename Allocator>
+void ReplaySteps(Allocator& alloc,
+                 const std::vector<TraceStep>& steps,
+                 std::vector<std::pair<bool, uint32_t>>& allocations,
+                 std::vector<uint32_t>& results)
+{
+    for (const TraceStep& step : steps)
+    {
+        switch (step.m_Type)
+        {
+            case TraceStep::Type::Allocate:
+            {
+                if (allocations.size() <= step.m_Allocation)
+                {
+                    allocations.resize(step.m_Allocation + 1, { false, 0 });
+                }
+                allocations[step.m_Allocation] = alloc.Allocate(step.m_UserId, step.m_Size, step.m_Pref);
+                results.push_back(allocations[step.m_Allocation].first ? allocations[step.m_Allocation].second
+                                                                       : UINT32_MAX);
+                break;
+            }
+            case TraceStep::Type::Free:
+            {
+                if (allocations[step.m_Allocation].first)
+                {
+                    results.push_back(alloc.Free(step.m_UserId, allocations[step.m_Allocation].second));
+                }
+                break;
+            }
+            case TraceStep::Type::IncrementReferenceCount:
+            {
+                if (allocations[step.m_Allocation].first)
+                {
+                    alloc.IncrementReferenceCount(step.m_UserId, allocations[step.m_Allocation].second);
+                }
+                break;
+            }
+            default:
+            {
+                FAIL("Unknown trace step");
+                break;
+            }
+        }
+    }
+    results.push_back(alloc.IsFull());
+    results.push_back(alloc.IsEmpty());
+}
+
+/// Replays a trace, copying the allocator for each attempt and keeping the copy if the attempt is kept.
+template <typename Allocator>
+std::vector<uint32_t> ReplayWithCopies(const Trace& trace)
+{
+    Allocator alloc(trace.m_Capacity);
+    std::vector<std::pair<bool, uint32_t>> allocations;
+    std::vector<uint32_t> results;
+    for (size_t i = 0; i < trace.m_Attempts.size(); ++i)
+    {
+        Allocator attempt = alloc;
+        ReplaySteps(attempt, trace.m_Attempts[i], allocations, results);
+        if (trace.m_Keep[i])
+        {
+            alloc = attempt;
+        }
+    }
+    return results;
+}
+
+/// Replays a trace on a single allocator, rolling back the attempts which aren't kept.
+std::vector<uint32_t> ReplayWithCheckpoints(const Trace& trace)
+{
+    SramAllocator alloc(trace.m_Capacity);
+    std::vector<std::pair<bool, uint32_t>> allocations;
+    std::vector<uint32_t> results;
+    for (size_t i = 0; i < trace.m_Attempts.size(); ++i)
+    {
+        const SramAllocator::Checkpoint checkpoint = alloc.GetCheckpoint();
+        ReplaySteps(alloc, trace.m_Attempts[i], allocations, results);
+        if (trace.m_Keep[i])
+        {
+            alloc.Release(checkpoint);
+        }
+        else
+        {
+            alloc.Rollback(checkpoint);
+        }
+    }
+    return results;
+}
+
+}    // namespace
+
 TEST_CASE("SramAllocator: Allocate")
 {
     SramAllocator sram(10);
@@ -254,3 +561,121 @@ SCENARIO("SramAllocated: CheckReferenceCounter")
         }
     }
 }
+
+TEST_CASE("SramAllocator: Allocate zero size")
+{
+    SramAllocator sram(10);
+
+    NodeId nodeId{ 0 };
+    REQUIRE(sram.Allocate(nodeId, 3) == std::make_pair(true, 0u));
+    REQUIRE(sram.Allocate(nodeId, 0) == std::make_pair(true, 3u));
+    REQUIRE(sram.Allocate(nodeId, 0, AllocationPreference::End) == std::make_pair(true, 10u));
+    // The empty chunks take no memory, so the next chunk starts at the same offset
+    REQUIRE(sram.Allocate(1, 7) == std::make_pair(true, 3u));
+    REQUIRE(sram.IsFull());
+    REQUIRE(sram.Allocate(nodeId, 0).first == false);
+
+    // Freeing the empty chunk leaves the chunk in use at the same offset alone
+    REQUIRE(sram.Free(nodeId, 3));
+    REQUIRE(sram.IsFull());
+    REQUIRE(sram.Free(1, 3));
+    REQUIRE_FALSE(sram.IsFull());
+    REQUIRE(sram.Free(nodeId, 10));
+    REQUIRE(sram.Free(nodeId, 0));
+    REQUIRE(sram.IsEmpty());
+}
+
+TEST_CASE("SramAllocator: Rollback empty chunks")
+{
+    SramAllocator sram(10);
+    NodeId nodeId{ 0 };
+    REQUIRE(sram.Allocate(nodeId, 0) == std::make_pair(true, 0u));
+
+    const SramAllocator::Checkpoint checkpoint = sram.GetCheckpoint();
+    sram.IncrementReferenceCount(1, 0);
+    REQUIRE(sram.Free(nodeId, 0));
+    REQUIRE(sram.Allocate(2, 0) == std::make_pair(true, 0u));
+    sram.Rollback(checkpoint);
+
+    REQUIRE_FALSE(sram.Free(1, 0));
+    REQUIRE_FALSE(sram.Free(2, 0));
+    REQUIRE_FALSE(sram.IsEmpty());
+    REQUIRE(sram.Free(nodeId, 0));
+    REQUIRE(sram.IsEmpty());
+}
+
+TEST_CASE("SramAllocator: Rollback")
+{
+    SramAllocator sram(10);
+    NodeId nodeId{ 0 };
+    auto res0 = sram.Allocate(nodeId, 3, AllocationPreference::Start, "kept");
+    const std::string before = sram.DumpUsage();
+
+    const SramAllocator::Checkpoint outer = sram.GetCheckpoint();
+    auto res1                             = sram.Allocate(nodeId, 3, AllocationPreference::End);
+    REQUIRE(res1.first == true);
+    sram.IncrementReferenceCount(1, res0.second);
+    REQUIRE(sram.Free(nodeId, res0.second));
+    REQUIRE(sram.Free(1, res0.second));
+
+    const SramAllocator::Checkpoint inner = sram.GetCheckpoint();
+    auto res2                             = sram.Allocate(nodeId, 7);
+    REQUIRE(res2.first == true);
+    REQUIRE(res2.second == 0);
+    REQUIRE(sram.IsFull());
+    sram.Rollback(inner);
+    REQUIRE_FALSE(sram.IsFull());
+
+    sram.Rollback(outer);
+    REQUIRE(sram.DumpUsage() == before);
+    // The chunk is back in use, by its original user only
+    REQUIRE(sram.Free(nodeId, res0.second));
+    REQUIRE(sram.IsEmpty());
+}
+
+TEST_CASE("SramAllocator: Release keeps changes")
+{
+    SramAllocator sram(10);
+    NodeId nodeId{ 0 };
+    const SramAllocator::Checkpoint checkpoint = sram.GetCheckpoint();
+    auto res                                   = sram.Allocate(nodeId, 4);
+    sram.Release(checkpoint);
+    REQUIRE_FALSE(sram.IsEmpty());
+    REQUIRE(sram.Free(nodeId, res.second));
+    REQUIRE(sram.IsEmpty());
+}
+
+TEST_CASE("SramAllocator: Matches the reference allocator")
+{
+    const uint32_t seed = GENERATE(range(0u, 20u));
+    CAPTURE(seed);
+    const Trace trace = GenerateTrace(seed, 50);
+
+    const std::vector<uint32_t> expected = ReplayWithCopies<ReferenceSramAllocator>(trace);
+    REQUIRE(ReplayWithCopies<SramAllocator>(trace) == expected);
+    REQUIRE(ReplayWithCheckpoints(trace) == expected);
+}
+
+TEST_CASE("SramAllocator benchmark", "[.benchmark]")
+{
+    std::vector<Trace> traces;
+    for (uint32_t seed = 0; seed < 100; ++seed)
+    {
+        traces.push_back(GenerateTrace(seed, 200));
+    }
+
+    const auto timeReplays = [&traces](const char* name, auto replay) {
+        const auto start = std::chrono::steady_clock::now();
+        size_t numResults = 0;
+        for (const Trace& trace : traces)
+        {
+            numResults += replay(trace).size();
+        }
+        const auto duration = std::chrono::steady_clock::now() - start;
+        printf("%s: %zu results in %.2f ms\n", name, numResults,
+               std::chrono::duration<double, std::milli>(duration).count());
+    };
+    timeReplays("ReferenceSramAllocator with copies", ReplayWithCopies<ReferenceSramAllocator>);
+    timeReplays("SramAllocator with copies", ReplayWithCopies<SramAllocator>);
+    timeReplays("SramAllocator with checkpoints", ReplayWithCheckpoints);
+}
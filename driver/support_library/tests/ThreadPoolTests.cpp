@@ -0,0 +1,84 @@
+//
+// Copyright © 2021 Arm Limited.
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ThreadPool.hpp"
+
+#include <catch.hpp>
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace ethosn::support_library;
+
+TEST_CASE("ThreadPool ParallelFor calls every index once")
+{
+    const uint32_t numThreads = GENERATE(0u, 1u, 2u, 4u);
+    ThreadPool pool(numThreads);
+    REQUIRE(pool.GetNumThreads() >= 1);
+
+    std::vector<std::atomic<int>> calls(1000);
+    for (auto& c : calls)
+    {
+        c = 0;
+    }
+    pool.ParallelFor(calls.size(), [&](size_t i) { ++calls[i]; });
+
+    for (const auto& c : calls)
+    {
+        REQUIRE(c == 1);
+    }
+}
+
+TEST_CASE("ThreadPool ParallelFor rethrows the exception for the lowest index")
+{
+    ThreadPool pool(4);
+    std::atomic<size_t> numCalls(0);
+
+    auto func = [&](size_t i) {
+        ++numCalls;
+        if (i % 10 == 3)
+        {
+            throw std::runtime_error(std::to_string(i));
+        }
+    };
+
+    std::string message;
+    try
+    {
+        pool.ParallelFor(100, func);
+    }
+    catch (const std::runtime_error& e)
+    {
+        message = e.what();
+    }
+    // All the calls are made even though some of them throw
+    REQUIRE(numCalls == 100);
+    REQUIRE(message == "3");
+}
+
+TEST_CASE("ThreadPool ParallelFor can be nested")
+{
+    ThreadPool pool(3);
+    std::atomic<int> total(0);
+    pool.ParallelFor(8, [&](size_t) { pool.ParallelFor(8, [&](size_t j) { total += static_cast<int>(j); }); });
+    REQUIRE(total == 8 * 28);
+}
+
+TEST_CASE("ThreadPool Post runs every task")
+{
+    const uint32_t numThreads = GENERATE(1u, 3u);
+    std::atomic<int> total(0);
+    {
+        ThreadPool pool(numThreads);
+        for (int i = 0; i < 100; ++i)
+        {
+            pool.Post([&total, i]() { total += i; });
+        }
+        // Destroying the pool waits for the queued tasks
+    }
+    REQUIRE(total == 99 * 100 / 2);
+}
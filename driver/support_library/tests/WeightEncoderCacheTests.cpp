@@ -0,0 +1,158 @@
+//
+// Copyright © 2021 Arm Limited.
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "../src/cascading/WeightEncoderCache.hpp"
+#include "TestUtils.hpp"
+
+#include <catch.hpp>
+
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace ethosn::support_library;
+
+namespace
+{
+
+WeightEncoderCache::Params CreateParams(std::vector<uint8_t> weights)
+{
+    WeightEncoderCache::Params params;
+    params.weightsTensorInfo = TensorInfo({ 1, 1, 16, 16 }, DataType::UINT8_QUANTIZED, DataFormat::HWIO,
+                                          QuantizationInfo(0, 1.0f / 256));
+    params.weightsData       = std::make_shared<const std::vector<uint8_t>>(std::move(weights));
+    params.biasTensorInfo =
+        TensorInfo({ 1, 1, 1, 16 }, DataType::INT32_QUANTIZED, DataFormat::NHWC, QuantizationInfo(0, 1.0f / 256));
+    params.biasData               = std::vector<int32_t>(16, 0);
+    params.inputQuantizationInfo  = QuantizationInfo(0, 1.0f);
+    params.outputQuantizationInfo = QuantizationInfo(0, 1.0f);
+    params.stripeDepth            = 16;
+    params.strideY                = 1;
+    params.strideX                = 1;
+    params.paddingTop             = 0;
+    params.paddingLeft            = 0;
+    params.iterationSize          = 16;
+    params.operation              = ethosn::command_stream::MceOperation::CONVOLUTION;
+    params.algorithm              = CompilerMceAlgorithm::Direct;
+    return params;
+}
+
+std::vector<uint8_t> CreateWeights(uint8_t seed)
+{
+    std::vector<uint8_t> weights(16 * 16);
+    for (size_t i = 0; i < weights.size(); ++i)
+    {
+        weights[i] = static_cast<uint8_t>(i * 7 + seed);
+    }
+    return weights;
+}
+
+}    // namespace
+
+TEST_CASE("WeightEncoderCache shares the encoding of identical weights")
+{
+    WeightEncoderCache cache(GetEthosN77HwCapabilities());
+
+    // Same weights, but in a different vector
+    std::shared_ptr<EncodedWeights> a = cache.Encode(CreateParams(CreateWeights(0)));
+    std::shared_ptr<EncodedWeights> b = cache.Encode(CreateParams(CreateWeights(0)));
+    REQUIRE(a == b);
+    REQUIRE(cache.GetNumMisses() == 1);
+    REQUIRE(cache.GetNumHits() == 1);
+
+    // Same shape, different weights
+    std::shared_ptr<EncodedWeights> c = cache.Encode(CreateParams(CreateWeights(1)));
+    REQUIRE(a != c);
+    REQUIRE(a->m_Data != c->m_Data);
+    REQUIRE(cache.GetNumMisses() == 2);
+
+    // Same weights, different encoding parameters
+    WeightEncoderCache::Params params = CreateParams(CreateWeights(0));
+    params.stripeDepth                = 8;
+    std::shared_ptr<EncodedWeights> d = cache.Encode(params);
+    REQUIRE(a != d);
+    REQUIRE(cache.GetNumMisses() == 3);
+    REQUIRE(cache.GetNumDiskHits() == 0);
+}
+
+TEST_CASE("WeightEncoderCache saves encoded weights to the cache directory")
+{
+    // Use a new directory each time, so that nothing is left over from previous runs
+    const std::string cacheDir = "WeightEncoderCache" + std::to_string(std::random_device()());
+
+    std::shared_ptr<EncodedWeights> encoded;
+    {
+        WeightEncoderCache cache(GetEthosN77HwCapabilities(), cacheDir);
+        encoded = cache.Encode(CreateParams(CreateWeights(0)));
+        REQUIRE(cache.GetNumMisses() == 1);
+    }
+
+    SECTION("Loaded by a later cache")
+    {
+        WeightEncoderCache cache(GetEthosN77HwCapabilities(), cacheDir);
+        std::shared_ptr<EncodedWeights> loaded = cache.Encode(CreateParams(CreateWeights(0)));
+        REQUIRE(cache.GetNumMisses() == 0);
+        REQUIRE(cache.GetNumDiskHits() == 1);
+        REQUIRE(loaded->m_Data == encoded->m_Data);
+        REQUIRE(loaded->m_MaxSize == encoded->m_MaxSize);
+        REQUIRE(loaded->m_Metadata.size() == encoded->m_Metadata.size());
+        for (size_t i = 0; i < loaded->m_Metadata.size(); ++i)
+        {
+            REQUIRE(loaded->m_Metadata[i].m_Offset == encoded->m_Metadata[i].m_Offset);
+            REQUIRE(loaded->m_Metadata[i].m_Size == encoded->m_Metadata[i].m_Size);
+        }
+    }
+
+    SECTION("Not used for different weights")
+    {
+        WeightEncoderCache cache(GetEthosN77HwCapabilities(), cacheDir);
+        cache.Encode(CreateParams(CreateWeights(1)));
+        REQUIRE(cache.GetNumMisses() == 1);
+        REQUIRE(cache.GetNumDiskHits() == 0);
+    }
+
+    SECTION("Not used for different hardware")
+    {
+        WeightEncoderCache cache(GetEthosN57HwCapabilities(), cacheDir);
+        cache.Encode(CreateParams(CreateWeights(0)));
+        REQUIRE(cache.GetNumMisses() == 1);
+        REQUIRE(cache.GetNumDiskHits() == 0);
+    }
+}
+
+TEST_CASE("WeightEncoderCache encodes lazily")
+{
+    std::shared_ptr<WeightEncoderCache> cache = std::make_shared<WeightEncoderCache>(GetEthosN77HwCapabilities());
+    WeightEncoderCache::Params params         = CreateParams(CreateWeights(0));
+    params.stripeDepth                        = 8;
+
+    std::shared_ptr<LazyEncodedWeights> lazy = cache->EncodeLazily(params, { 1, 1, 16, 8 });
+    // Only the whole tensor, which the estimate is based on, has been encoded
+    REQUIRE(cache->GetNumMisses() == 1);
+    REQUIRE(lazy->GetIfEncoded() == nullptr);
+
+    // Estimates for the same weights share that encoding
+    std::shared_ptr<LazyEncodedWeights> other = cache->EncodeLazily(params, { 1, 1, 16, 8 });
+    REQUIRE(cache->GetNumMisses() == 1);
+
+    const EncodedWeightsSizes estimatedSizes = lazy->GetEstimatedSizes();
+    REQUIRE(estimatedSizes.m_NumStripes == 2);
+    REQUIRE(estimatedSizes.m_TotalSize == estimatedSizes.m_FirstStripeSize * 2);
+    REQUIRE(estimatedSizes.m_FirstStripeSize % 16 == 0);
+    // The Sram buffer is sized from the largest stripe, which is estimated as if the weights were uncompressed
+    REQUIRE(estimatedSizes.m_MaxStripeSize == ethosn::support_library::utils::EstimateWeightSizeBytes(
+                                                  { 1, 1, 16, 8 }, GetEthosN77HwCapabilities(), false));
+    REQUIRE(estimatedSizes.m_FirstStripeSize <= estimatedSizes.m_MaxStripeSize);
+
+    std::shared_ptr<EncodedWeights> encoded = lazy->Encode();
+    REQUIRE(cache->GetNumMisses() == 2);
+    REQUIRE(lazy->GetIfEncoded() == encoded);
+    REQUIRE(encoded->m_Metadata.size() == estimatedSizes.m_NumStripes);
+    REQUIRE(encoded->m_MaxSize <= estimatedSizes.m_MaxStripeSize);
+    REQUIRE(other->Encode() == encoded);
+    REQUIRE(cache->GetNumMisses() == 2);
+    // The estimate doesn't change once the weights are encoded
+    REQUIRE(lazy->GetEstimatedSizes().m_TotalSize == estimatedSizes.m_TotalSize);
+}
@@ -0,0 +1,348 @@
+//
+// Copyright © 2021 Arm Limited.
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "../src/BitstreamWriter.hpp"
+#include "../src/ThreadPool.hpp"
+#include "../src/WeightEncoder.hpp"
+#include "TestUtils.hpp"
+
+#include <catch.hpp>
+#include <ethosn_utils/Hash.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace ethosn::support_library;
+
+namespace
+{
+
+/// The original BitstreamWriter, which writes one byte (or bit) at a time.
+/// BitstreamWriter must produce exactly the same bitstream as this.
+class ReferenceBitstreamWriter
+{
+public:
+    size_t GetOffset()
+    {
+        return m_EndPos;
+    }
+
+    void Write(uint8_t elem, int numBits, size_t offset)
+    {
+        for (int i = 0; i < numBits; ++i)
+        {
+            size_t idx = offset / 8;
+            int bit    = offset % 8;
+
+            if (idx >= m_Bitstream.size())
+            {
+                m_Bitstream.push_back(static_cast<uint8_t>((elem >> i) & 1));
+            }
+            else
+            {
+                m_Bitstream[idx] = static_cast<uint8_t>(m_Bitstream[idx] | (((elem >> i) & 1) << bit));
+            }
+
+            ++offset;
+        }
+
+        if (static_cast<size_t>(offset) > m_EndPos)
+        {
+            m_EndPos = offset;
+        }
+    }
+
+    void Write(uint8_t elem, int numBits)
+    {
+        if (numBits == 0)
+        {
+            return;
+        }
+
+        const size_t requiredSize = (m_EndPos + static_cast<size_t>(numBits) + 7) / 8;
+        if (requiredSize > m_Bitstream.size())
+        {
+            m_Bitstream.push_back(0);
+        }
+
+        const uint32_t destBitIdxA = m_EndPos % 8;
+        const uint32_t numBitsA    = std::min<uint32_t>(8 - destBitIdxA, numBits);
+        const uint8_t bitsA        = static_cast<uint8_t>(elem & ((1u << numBitsA) - 1u));
+        uint8_t& destA             = m_Bitstream[m_EndPos / 8];
+        destA                      = static_cast<uint8_t>(destA | (bitsA << destBitIdxA));
+
+        const uint32_t numBitsB = numBits - numBitsA;
+        if (numBitsB > 0)
+        {
+            const uint8_t bitsB = static_cast<uint8_t>((elem >> numBitsA) & ((1u << numBitsB) - 1u));
+            m_Bitstream.back()  = bitsB;
+        }
+
+        m_EndPos += numBits;
+    }
+
+    template <class T>
+    void Write(const T* elem, int numBits)
+    {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(elem);
+        while (numBits > 0)
+        {
+            Write(*p, std::min(numBits, 8));
+            numBits -= 8;
+            ++p;
+        }
+    }
+
+    void Reserve(size_t numBits)
+    {
+        size_t i = 0;
+        while (i < numBits)
+        {
+            size_t idx = (m_EndPos + i) / 8;
+            if (idx >= m_Bitstream.size())
+            {
+                m_Bitstream.push_back(0);
+            }
+            i += 8 - ((m_EndPos + i) % 8);
+        }
+        m_EndPos += numBits;
+    }
+
+    const std::vector<uint8_t>& GetBitstream()
+    {
+        return m_Bitstream;
+    }
+
+private:
+    std::vector<uint8_t> m_Bitstream;
+    size_t m_EndPos = 0;
+};
+
+/// A weights tensor which is representative of a real network in some way, e.g. it is dense, sparse or uses
+/// only a few distinct values, so that each of the compression schemes gets exercised.
+struct WeightsCase
+{
+    std::string m_Name;
+    TensorInfo m_WeightsInfo;
+    std::vector<uint8_t> m_Weights;
+    ethosn::command_stream::MceOperation m_Operation;
+    /// Digests of the weights encoded for Ethos-N77 and Ethos-N78, as produced by the original bit-at-a-time
+    /// BitstreamWriter (see ReferenceBitstreamWriter).
+    uint64_t m_ExpectedDigestN77;
+    uint64_t m_ExpectedDigestN78;
+};
+
+/// Creates weights where roughly zeroPercent of them are equal to the zero point (128), and the rest use either
+/// numDistinctValues values around the zero point, or any value if numDistinctValues is 0.
+std::vector<uint8_t> CreateWeights(size_t size, uint32_t zeroPercent, uint32_t numDistinctValues, uint32_t seed)
+{
+    // Use the raw generator output rather than a std distribution, so that the weights are the same on all hosts
+    std::mt19937 gen(seed);
+    std::vector<uint8_t> weights(size);
+    for (uint8_t& w : weights)
+    {
+        const uint32_t r = static_cast<uint32_t>(gen());
+        if (r % 100 < zeroPercent)
+        {
+            w = 128;
+        }
+        else if (numDistinctValues == 0)
+        {
+            w = static_cast<uint8_t>(r >> 24);
+        }
+        else
+        {
+            w = static_cast<uint8_t>(128 + 5 * ((r >> 8) % numDistinctValues) - 5 * (numDistinctValues / 2));
+        }
+    }
+    return weights;
+}
+
+std::vector<WeightsCase> GetWeightsCases()
+{
+    const QuantizationInfo weightsQuantInfo(128, 1.0f / 128);
+    return {
+        { "Dense 3x3 convolution",
+          TensorInfo({ 3, 3, 64, 64 }, DataType::UINT8_QUANTIZED, DataFormat::HWIO, weightsQuantInfo),
+          CreateWeights(3 * 3 * 64 * 64, 0, 0, 1), ethosn::command_stream::MceOperation::CONVOLUTION, 0xd3c7b851fd1cbd13ULL,
+          0x05e07a12ec17014bULL },
+        { "Sparse 1x1 convolution",
+          TensorInfo({ 1, 1, 256, 128 }, DataType::UINT8_QUANTIZED, DataFormat::HWIO, weightsQuantInfo),
+          CreateWeights(256 * 128, 70, 0, 2), ethosn::command_stream::MceOperation::CONVOLUTION, 0xe57f8bffb8f294fdULL,
+          0x4a8b7ad1880e4cf9ULL },
+        { "Palettised 3x3 convolution",
+          TensorInfo({ 3, 3, 32, 64 }, DataType::UINT8_QUANTIZED, DataFormat::HWIO, weightsQuantInfo),
+          CreateWeights(3 * 3 * 32 * 64, 30, 6, 3), ethosn::command_stream::MceOperation::CONVOLUTION, 0x054e3416f27361ffULL,
+          0x063d281135a71525ULL },
+        { "Depthwise 3x3 convolution",
+          TensorInfo({ 3, 3, 128, 1 }, DataType::UINT8_QUANTIZED, DataFormat::HWIM, weightsQuantInfo),
+          CreateWeights(3 * 3 * 128, 10, 0, 4), ethosn::command_stream::MceOperation::DEPTHWISE_CONVOLUTION, 0x85ed9db56cbaba53ULL,
+          0xa2b727fbd3064c92ULL },
+    };
+}
+
+EncodedWeights EncodeWeights(WeightEncoder& encoder, const WeightsCase& weightsCase)
+{
+    const uint32_t numOfms = weightsCase.m_WeightsInfo.m_DataFormat == DataFormat::HWIM
+                                 ? weightsCase.m_WeightsInfo.m_Dimensions[2]
+                                 : weightsCase.m_WeightsInfo.m_Dimensions[3];
+    const uint32_t numIfms = weightsCase.m_WeightsInfo.m_Dimensions[2];
+    const TensorInfo biasInfo({ 1, 1, 1, numOfms }, DataType::INT32_QUANTIZED, DataFormat::NHWC,
+                              QuantizationInfo(0, 1.0f / 128));
+    std::vector<int32_t> bias(numOfms);
+    for (uint32_t i = 0; i < numOfms; ++i)
+    {
+        bias[i] = static_cast<int32_t>(i * 37) - 1000;
+    }
+    return encoder.Encode(weightsCase.m_WeightsInfo, weightsCase.m_Weights.data(), biasInfo, bias.data(),
+                          QuantizationInfo(0, 1.0f), QuantizationInfo(0, 1.0f), std::min(numOfms, 32u), 1, 1, 0, 0,
+                          numIfms, weightsCase.m_Operation, CompilerMceAlgorithm::Direct);
+}
+
+uint64_t GetDigest(const EncodedWeights& encodedWeights)
+{
+    return ethosn::utils::Xxh64(encodedWeights.m_Data.data(), encodedWeights.m_Data.size());
+}
+
+}    // namespace
+
+TEST_CASE("WeightEncoder output is unchanged")
+{
+    // The encoders keep a reference to the capabilities
+    const HardwareCapabilities capsN77 = GetEthosN77HwCapabilities();
+    const HardwareCapabilities capsN78 = GetEthosN78HwCapabilities();
+    for (const WeightsCase& weightsCase : GetWeightsCases())
+    {
+        INFO(weightsCase.m_Name);
+        std::unique_ptr<WeightEncoder> encoderN77 = WeightEncoder::CreateWeightEncoder(capsN77);
+        CHECK(GetDigest(EncodeWeights(*encoderN77, weightsCase)) == weightsCase.m_ExpectedDigestN77);
+        std::unique_ptr<WeightEncoder> encoderN78 = WeightEncoder::CreateWeightEncoder(capsN78);
+        CHECK(GetDigest(EncodeWeights(*encoderN78, weightsCase)) == weightsCase.m_ExpectedDigestN78);
+    }
+}
+
+TEST_CASE("WeightEncoder output does not depend on the thread pool")
+{
+    const uint32_t numThreads        = GENERATE(0u, 2u, 5u);
+    const HardwareCapabilities caps = GetEthosN78HwCapabilities();
+    ThreadPool threadPool(numThreads);
+    std::unique_ptr<WeightEncoder> serialEncoder   = WeightEncoder::CreateWeightEncoder(caps);
+    std::unique_ptr<WeightEncoder> parallelEncoder = WeightEncoder::CreateWeightEncoder(caps, &threadPool);
+    for (const WeightsCase& weightsCase : GetWeightsCases())
+    {
+        INFO(weightsCase.m_Name);
+        const EncodedWeights serial   = EncodeWeights(*serialEncoder, weightsCase);
+        const EncodedWeights parallel = EncodeWeights(*parallelEncoder, weightsCase);
+        REQUIRE(parallel.m_Data == serial.m_Data);
+        REQUIRE(parallel.m_MaxSize == serial.m_MaxSize);
+        REQUIRE(parallel.m_Metadata.size() == serial.m_Metadata.size());
+    }
+}
+
+TEST_CASE("BitstreamWriter matches the reference writer")
+{
+    std::mt19937 gen(42);
+    BitstreamWriter writer(0);
+    ReferenceBitstreamWriter reference;
+
+    for (uint32_t i = 0; i < 10000; ++i)
+    {
+        const uint32_t r      = static_cast<uint32_t>(gen());
+        const uint64_t value  = (static_cast<uint64_t>(gen()) << 32) | gen();
+        const uint32_t choice = r % 8;
+        if (choice < 4)
+        {
+            // Small fields, as written for each symbol
+            const uint32_t numBits = (r >> 8) % 9;
+            writer.Write(value, numBits);
+            reference.Write(static_cast<uint8_t>(value), static_cast<int>(numBits));
+        }
+        else if (choice < 6)
+        {
+            // Wide fields, as written for headers and packed symbols
+            const int numBits = static_cast<int>((r >> 8) % 65);
+            writer.Write(&value, numBits);
+            reference.Write(&value, numBits);
+        }
+        else if (choice == 6)
+        {
+            // Reserve space and fill it in later, as done for the masks of ZeroCompressor
+            const size_t offset = writer.GetOffset();
+            const uint32_t size = (r >> 8) % 20;
+            writer.Reserve(size);
+            reference.Reserve(size);
+            writer.Write(static_cast<uint8_t>(value), static_cast<int>(std::min(size, 8u)), offset);
+            reference.Write(static_cast<uint8_t>(value), static_cast<int>(std::min(size, 8u)), offset);
+        }
+        else
+        {
+            // Look at the stream part way through, which must not affect later writes
+            REQUIRE(writer.GetBitstream() == reference.GetBitstream());
+        }
+        REQUIRE(writer.GetOffset() == reference.GetOffset());
+    }
+    REQUIRE(writer.GetBitstream() == reference.GetBitstream());
+
+    writer.Clear();
+    REQUIRE(writer.GetOffset() == 0);
+    REQUIRE(writer.GetBitstream().empty());
+    writer.Write(uint64_t{ 0x1ff }, 9);
+    REQUIRE(writer.GetBitstream() == std::vector<uint8_t>{ 0xff, 0x01 });
+}
+
+TEST_CASE("WeightEncoder benchmark", "[.benchmark]")
+{
+    // Writing symbol-sized fields on their own, as done when packing a chunk of weights
+    {
+        std::mt19937 gen(1);
+        std::vector<uint8_t> values(1 << 20);
+        for (uint8_t& v : values)
+        {
+            v = static_cast<uint8_t>(gen());
+        }
+        const auto timeWrites = [&values](auto& writer) {
+            const auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < values.size(); ++i)
+            {
+                writer.Write(values[i], static_cast<int>(3 + i % 6));
+            }
+            const size_t size   = writer.GetBitstream().size();
+            const auto duration = std::chrono::steady_clock::now() - start;
+            printf("%zu bytes in %.2f ms\n", size, std::chrono::duration<double, std::milli>(duration).count());
+        };
+        printf("ReferenceBitstreamWriter: ");
+        ReferenceBitstreamWriter reference;
+        timeWrites(reference);
+        printf("BitstreamWriter: ");
+        BitstreamWriter writer(0);
+        timeWrites(writer);
+    }
+
+    const std::vector<WeightsCase> weightsCases = GetWeightsCases();
+    const std::vector<std::pair<std::string, HardwareCapabilities>> variants = {
+        { "N77", GetEthosN77HwCapabilities() }, { "N78", GetEthosN78HwCapabilities() }
+    };
+    for (const auto& variant : variants)
+    {
+        const HardwareCapabilities& caps = variant.second;
+        for (const WeightsCase& weightsCase : weightsCases)
+        {
+            std::unique_ptr<WeightEncoder> encoder = WeightEncoder::CreateWeightEncoder(caps);
+            const auto start                       = std::chrono::steady_clock::now();
+            const uint32_t numRepeats              = 20;
+            for (uint32_t i = 0; i < numRepeats; ++i)
+            {
+                EncodeWeights(*encoder, weightsCase);
+            }
+            const auto duration = std::chrono::steady_clock::now() - start;
+            printf("%s (%s): %.2f ms\n", weightsCase.m_Name.c_str(), variant.first.c_str(),
+                   std::chrono::duration<double, std::milli>(duration).count() / numRepeats);
+        }
+    }
+}
@@ -0,0 +1,124 @@
+//
+// Copyright © 2021 Arm Limited.
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ethosn
+{
+namespace utils
+{
+
+namespace detail
+{
+
+constexpr uint64_t g_Xxh64Prime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t g_Xxh64Prime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t g_Xxh64Prime3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t g_Xxh64Prime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t g_Xxh64Prime5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t RotateLeft(uint64_t x, uint32_t r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+/// Reads a little-endian value, regardless of host endianness and alignment.
+template <typename T>
+T ReadLittleEndian(const uint8_t* p)
+{
+    T result = 0;
+    for (size_t i = 0; i < sizeof(T); ++i)
+    {
+        result |= static_cast<T>(p[i]) << (8 * i);
+    }
+    return result;
+}
+
+inline uint64_t Xxh64Round(uint64_t acc, uint64_t input)
+{
+    acc += input * g_Xxh64Prime2;
+    acc = RotateLeft(acc, 31);
+    return acc * g_Xxh64Prime1;
+}
+
+inline uint64_t Xxh64MergeRound(uint64_t acc, uint64_t val)
+{
+    acc ^= Xxh64Round(0, val);
+    return acc * g_Xxh64Prime1 + g_Xxh64Prime4;
+}
+
+}    // namespace detail
+
+/// Computes the XXH64 digest of the given data.
+/// This is a fast non-cryptographic 64-bit hash, suitable for identifying large blocks of data such as weights.
+/// The result is the same on all hosts, so it can be used to name data that is saved to disk.
+inline uint64_t Xxh64(const void* data, size_t size, uint64_t seed = 0)
+{
+    using namespace detail;
+
+    const uint8_t* p         = static_cast<const uint8_t*>(data);
+    const uint8_t* const end = p + size;
+    uint64_t h;
+
+    if (size >= 32)
+    {
+        uint64_t v1 = seed + g_Xxh64Prime1 + g_Xxh64Prime2;
+        uint64_t v2 = seed + g_Xxh64Prime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - g_Xxh64Prime1;
+        do
+        {
+            v1 = Xxh64Round(v1, ReadLittleEndian<uint64_t>(p));
+            v2 = Xxh64Round(v2, ReadLittleEndian<uint64_t>(p + 8));
+            v3 = Xxh64Round(v3, ReadLittleEndian<uint64_t>(p + 16));
+            v4 = Xxh64Round(v4, ReadLittleEndian<uint64_t>(p + 24));
+            p += 32;
+        } while (end - p >= 32);
+
+        h = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+        h = Xxh64MergeRound(h, v1);
+        h = Xxh64MergeRound(h, v2);
+        h = Xxh64MergeRound(h, v3);
+        h = Xxh64MergeRound(h, v4);
+    }
+    else
+    {
+        h = seed + g_Xxh64Prime5;
+    }
+
+    h += static_cast<uint64_t>(size);
+
+    while (end - p >= 8)
+    {
+        h ^= Xxh64Round(0, ReadLittleEndian<uint64_t>(p));
+        h = RotateLeft(h, 27) * g_Xxh64Prime1 + g_Xxh64Prime4;
+        p += 8;
+    }
+    if (end - p >= 4)
+    {
+        h ^= static_cast<uint64_t>(ReadLittleEndian<uint32_t>(p)) * g_Xxh64Prime1;
+        h = RotateLeft(h, 23) * g_Xxh64Prime2 + g_Xxh64Prime3;
+        p += 4;
+    }
+    while (p < end)
+    {
+        h ^= (*p) * g_Xxh64Prime5;
+        h = RotateLeft(h, 11) * g_Xxh64Prime1;
+        ++p;
+    }
+
+    h ^= h >> 33;
+    h *= g_Xxh64Prime2;
+    h ^= h >> 29;
+    h *= g_Xxh64Prime3;
+    h ^= h >> 32;
+    return h;
+}
+
+}    // namespace utils
+}    // namespace ethosn
@@ -0,0 +1,213 @@
+//
+// Copyright © 2021 Arm Limited.
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ethosn
+{
+namespace utils
+{
+
+namespace detail
+{
+
+/// State of one ThreadPool::ParallelFor call, shared with the tasks helping it.
+/// Tasks which only start once the loop is closed leave without touching the loop body, so the calling thread does
+/// not need to wait for tasks which are still queued behind other work.
+struct Loop
+{
+    Loop(size_t count, const std::function<void(size_t)>& func)
+        : m_Count(count)
+        , m_Func(func)
+        , m_Next(0)
+        , m_Exceptions(count)
+        , m_Closed(false)
+        , m_NumHelping(0)
+    {}
+
+    void Run()
+    {
+        for (size_t i = m_Next++; i < m_Count; i = m_Next++)
+        {
+            try
+            {
+                m_Func(i);
+            }
+            catch (...)
+            {
+                m_Exceptions[i] = std::current_exception();
+            }
+        }
+    }
+
+    const size_t m_Count;
+    const std::function<void(size_t)>& m_Func;
+    std::atomic<size_t> m_Next;
+    std::vector<std::exception_ptr> m_Exceptions;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_HelpersDone;
+    bool m_Closed;
+    uint32_t m_NumHelping;
+};
+
+}    // namespace detail
+
+/// A fixed set of worker threads which run loops in parallel (see ParallelFor) and tasks in the background
+/// (see Post).
+class ThreadPool
+{
+public:
+    /// Creates a pool which runs loops on numThreads threads in total, including the thread calling ParallelFor.
+    /// 0 means one thread per hardware thread. 1 runs everything on the calling thread.
+    explicit ThreadPool(uint32_t numThreads)
+        : m_Stopping(false)
+    {
+        if (numThreads == 0)
+        {
+            numThreads = std::max(std::thread::hardware_concurrency(), 1U);
+        }
+        // The calling thread of ParallelFor is one of the threads
+        for (uint32_t i = 1; i < numThreads; ++i)
+        {
+            m_Workers.emplace_back(&ThreadPool::WorkerLoop, this);
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /// Waits for all the queued tasks to finish.
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stopping = true;
+        }
+        m_TaskAvailable.notify_all();
+        for (std::thread& worker : m_Workers)
+        {
+            worker.join();
+        }
+    }
+
+    /// Total number of threads used by ParallelFor, including the calling thread.
+    uint32_t GetNumThreads() const
+    {
+        return static_cast<uint32_t>(m_Workers.size()) + 1;
+    }
+
+    /// Calls func(i) for every i in [0, count), in an unspecified order and on an unspecified thread,
+    /// and returns once all calls have completed.
+    /// The calling thread takes part, so this can be called from one of the pool's threads.
+    /// If any call throws, the exception thrown for the lowest i is rethrown, once all calls have completed.
+    void ParallelFor(size_t count, const std::function<void(size_t)>& func)
+    {
+        auto loop = std::make_shared<detail::Loop>(count, func);
+
+        const size_t numHelpers = std::min(m_Workers.size(), count > 0 ? count - 1 : 0);
+        if (numHelpers > 0)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                for (size_t i = 0; i < numHelpers; ++i)
+                {
+                    m_Tasks.emplace_back([loop]() {
+                        {
+                            std::lock_guard<std::mutex> loopLock(loop->m_Mutex);
+                            if (loop->m_Closed)
+                            {
+                                return;
+                            }
+                            ++loop->m_NumHelping;
+                        }
+                        loop->Run();
+                        {
+                            std::lock_guard<std::mutex> loopLock(loop->m_Mutex);
+                            --loop->m_NumHelping;
+                        }
+                        loop->m_HelpersDone.notify_all();
+                    });
+                }
+            }
+            m_TaskAvailable.notify_all();
+        }
+
+        loop->Run();
+
+        {
+            std::unique_lock<std::mutex> lock(loop->m_Mutex);
+            loop->m_Closed = true;
+            loop->m_HelpersDone.wait(lock, [&loop] { return loop->m_NumHelping == 0; });
+        }
+
+        for (const std::exception_ptr& exception : loop->m_Exceptions)
+        {
+            if (exception)
+            {
+                std::rethrow_exception(exception);
+            }
+        }
+    }
+
+    /// Queues task to be called on one of the workers, without waiting for it. Tasks are started in the order they
+    /// are posted. A pool with no workers (one thread in total) calls task before returning.
+    /// task must not throw (e.g. wrap it in a std::packaged_task to get its result or exception).
+    void Post(std::function<void()> task)
+    {
+        if (m_Workers.empty())
+        {
+            task();
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Tasks.push_back(std::move(task));
+        }
+        m_TaskAvailable.notify_one();
+    }
+
+private:
+    void WorkerLoop()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_TaskAvailable.wait(lock, [this] { return m_Stopping || !m_Tasks.empty(); });
+                if (m_Tasks.empty())
+                {
+                    return;
+                }
+                task = std::move(m_Tasks.front());
+                m_Tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> m_Workers;
+    std::mutex m_Mutex;
+    std::condition_variable m_TaskAvailable;
+    std::deque<std::function<void()>> m_Tasks;
+    bool m_Stopping;
+};
+
+}    // namespace utils
+}    // namespace ethosn
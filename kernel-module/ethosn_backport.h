@@ -23,6 +23,8 @@
 #ifndef _ETHOSN_BACKPORT_H_
 #define _ETHOSN_BACKPORT_H_
 
+#include <linux/debugfs.h>
+#include <linux/eventfd.h>
 #include <linux/eventpoll.h>
 #include <linux/version.h>
 
@@ -37,4 +39,40 @@
 typedef unsigned __bitwise __poll_t;
 #endif
 
+#if (KERNEL_VERSION(6, 8, 0) <= LINUX_VERSION_CODE)
+#define ethosn_eventfd_signal(ctx) eventfd_signal(ctx)
+#else
+#define ethosn_eventfd_signal(ctx) eventfd_signal(ctx, 1)
+#endif
+
+/*
+ * Protect the private data of a file created with
+ * debugfs_create_file_unsafe() against the file being removed. On kernels
+ * before 4.15 this is done with SRCU, whose index is kept in srcu_idx.
+ */
+static inline int ethosn_debugfs_file_get(struct dentry *dentry,
+					  int *srcu_idx)
+{
+#if (KERNEL_VERSION(4, 15, 0) > LINUX_VERSION_CODE)
+	int ret = debugfs_use_file_start(dentry, srcu_idx);
+
+	if (ret)
+		debugfs_use_file_finish(*srcu_idx);
+
+	return ret;
+#else
+	return debugfs_file_get(dentry);
+#endif
+}
+
+static inline void ethosn_debugfs_file_put(struct dentry *dentry,
+					   int *srcu_idx)
+{
+#if (KERNEL_VERSION(4, 15, 0) > LINUX_VERSION_CODE)
+	debugfs_use_file_finish(*srcu_idx);
+#else
+	debugfs_file_put(dentry);
+#endif
+}
+
 #endif /* _ETHOSN_BACKPORT_H_ */
@@ -27,10 +27,15 @@
 
 #include <linux/anon_inodes.h>
 #include <linux/device.h>
+#include <linux/dma-buf.h>
 #include <linux/file.h>
 #include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/scatterlist.h>
 #include <linux/slab.h>
 #include <linux/types.h>
+#include <linux/version.h>
 
 #if (MB_RDONLY != O_RDONLY) ||	   \
 	(MB_WRONLY != O_WRONLY) || \
@@ -38,6 +43,10 @@
 #error "MB_ flags are not correctly defined"
 #endif
 
+#if (KERNEL_VERSION(5, 16, 0) <= LINUX_VERSION_CODE)
+MODULE_IMPORT_NS(DMA_BUF);
+#endif
+
 static int ethosn_buffer_release(struct inode *inode,
 				 struct file *file);
 static int ethosn_buffer_mmap(struct file *file,
@@ -74,8 +83,8 @@ static bool is_ethosn_dma_view_file(const struct file *const file)
 	return file->f_op == &ethosn_dma_view_fops;
 }
 
-static void buffer_unmap_and_free_dma(struct ethosn_buffer *buf,
-				      int num_cores)
+static void buffer_unmap_dma(struct ethosn_buffer *buf,
+			     int num_cores)
 {
 	struct ethosn_device *ethosn = buf->ethosn;
 	int i;
@@ -86,8 +95,135 @@ static void buffer_unmap_and_free_dma(struct ethosn_buffer *buf,
 			ethosn->core[i]->allocator,
 			buf->dma_info,
 			ETHOSN_STREAM_DMA);
+}
+
+static int buffer_prot(struct ethosn_buffer *buf)
+{
+	return buf->writable ? ETHOSN_PROT_READ | ETHOSN_PROT_WRITE :
+	       ETHOSN_PROT_READ;
+}
+
+static int buffer_map_dma(struct ethosn_buffer *buf)
+{
+	struct ethosn_device *ethosn = buf->ethosn;
+	int ret;
+	int i;
+
+	/* Map iova per core through core allocator */
+	for (i = 0; i < ethosn->num_cores; ++i) {
+		ret = ethosn_dma_map(
+			ethosn->core[i]->allocator,
+			buf->dma_info,
+			buffer_prot(buf),
+			ETHOSN_STREAM_DMA);
+
+		if (ret < 0) {
+			buffer_unmap_dma(buf, i);
+
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+static enum dma_data_direction buffer_import_dir(struct ethosn_buffer *buf)
+{
+	return buf->writable ? DMA_BIDIRECTIONAL : DMA_TO_DEVICE;
+}
+
+#if (KERNEL_VERSION(5, 11, 0) <= LINUX_VERSION_CODE)
+#if (KERNEL_VERSION(5, 18, 0) <= LINUX_VERSION_CODE)
+#define ethosn_dma_buf_map iosys_map
+#define ETHOSN_DMA_BUF_MAP_INIT_VADDR IOSYS_MAP_INIT_VADDR
+#else
+#define ethosn_dma_buf_map dma_buf_map
+#define ETHOSN_DMA_BUF_MAP_INIT_VADDR DMA_BUF_MAP_INIT_VADDR
+#endif
+
+#if (KERNEL_VERSION(6, 2, 0) <= LINUX_VERSION_CODE)
+#define ethosn_dma_buf_vmap dma_buf_vmap_unlocked
+#define ethosn_dma_buf_vunmap dma_buf_vunmap_unlocked
+#else
+#define ethosn_dma_buf_vmap dma_buf_vmap
+#define ethosn_dma_buf_vunmap dma_buf_vunmap
+#endif
+
+static void *buffer_vmap_dma_buf(struct dma_buf *dma_buf)
+{
+	struct ethosn_dma_buf_map map;
+
+	if (ethosn_dma_buf_vmap(dma_buf, &map))
+		return NULL;
+
+	/* I/O memory can't be accessed through a plain pointer */
+	if (map.is_iomem) {
+		ethosn_dma_buf_vunmap(dma_buf, &map);
+
+		return NULL;
+	}
+
+	return map.vaddr;
+}
+
+static void buffer_vunmap_dma_buf(struct dma_buf *dma_buf,
+				  void *vaddr)
+{
+	struct ethosn_dma_buf_map map = ETHOSN_DMA_BUF_MAP_INIT_VADDR(vaddr);
+
+	ethosn_dma_buf_vunmap(dma_buf, &map);
+}
+
+#else
+static void *buffer_vmap_dma_buf(struct dma_buf *dma_buf)
+{
+	return dma_buf_vmap(dma_buf);
+}
+
+static void buffer_vunmap_dma_buf(struct dma_buf *dma_buf,
+				  void *vaddr)
+{
+	dma_buf_vunmap(dma_buf, vaddr);
+}
+
+#endif
+
+static void buffer_release_import(struct ethosn_buffer *buf)
+{
+	if (buf->dma_buf) {
+		if (buf->vaddr)
+			buffer_vunmap_dma_buf(buf->dma_buf, buf->vaddr);
+
+		dma_buf_unmap_attachment(buf->attach, buf->sgt,
+					 buffer_import_dir(buf));
+		dma_buf_detach(buf->dma_buf, buf->attach);
+		dma_buf_put(buf->dma_buf);
+	} else {
+		vunmap(buf->vaddr);
+		dma_unmap_sgtable(buf->ethosn->dev, buf->sgt,
+				  buffer_import_dir(buf), 0);
+		sg_free_table(buf->sgt);
+		kfree(buf->sgt);
+
+		/* The Ethos-N may have written to any of the writable pages */
+		unpin_user_pages_dirty_lock(buf->pages, buf->nr_pages,
+					    buf->writable);
+		kfree(buf->pages);
+	}
+}
+
+static void buffer_unmap_and_free_dma(struct ethosn_buffer *buf,
+				      int num_cores)
+{
+	struct ethosn_device *ethosn = buf->ethosn;
+
+	buffer_unmap_dma(buf, num_cores);
 
 	ethosn_dma_free(ethosn->allocator, buf->dma_info);
+
+	/* Imported memory is only released once nothing refers to it */
+	if (buf->sgt)
+		buffer_release_import(buf);
 }
 
 static int ethosn_buffer_release(struct inode *const inode,
@@ -117,6 +253,28 @@ static int ethosn_buffer_release(struct inode *const inode,
 	return 0;
 }
 
+static int buffer_mmap_user_pages(struct ethosn_buffer *buf,
+				  struct vm_area_struct *const vma)
+{
+	unsigned long nr_pages = vma_pages(vma);
+	unsigned long i;
+
+	if ((vma->vm_pgoff > buf->nr_pages) ||
+	    (nr_pages > buf->nr_pages - vma->vm_pgoff))
+		return -EINVAL;
+
+	for (i = 0; i < nr_pages; ++i) {
+		unsigned long addr = vma->vm_start + i * PAGE_SIZE;
+		unsigned long pfn = page_to_pfn(buf->pages[vma->vm_pgoff + i]);
+
+		if (remap_pfn_range(vma, addr, pfn, PAGE_SIZE,
+				    vma->vm_page_prot))
+			return -EAGAIN;
+	}
+
+	return 0;
+}
+
 static int ethosn_buffer_mmap(struct file *const file,
 			      struct vm_area_struct *const vma)
 {
@@ -130,6 +288,13 @@ static int ethosn_buffer_mmap(struct file *const file,
 	buf = file->private_data;
 	allocator = buf->ethosn->allocator;
 
+	/* Imported memory is mapped the way its owner maps it */
+	if (buf->dma_buf)
+		return dma_buf_mmap(buf->dma_buf, vma, vma->vm_pgoff);
+
+	if (buf->pages)
+		return buffer_mmap_user_pages(buf, vma);
+
 	return ethosn_dma_mmap(allocator, vma, buf->dma_info);
 }
 
@@ -161,6 +326,28 @@ static loff_t ethosn_buffer_llseek(struct file *const file,
 		return -EINVAL;
 }
 
+static int buffer_get_fd(struct ethosn_buffer *buf,
+			 __u32 flags)
+{
+	int fd;
+
+	fd = anon_inode_getfd("ethosn-buffer",
+			      &ethosn_buffer_fops,
+			      buf,
+			      (flags & O_ACCMODE) | O_CLOEXEC);
+	if (fd < 0)
+		return fd;
+
+	buf->file = fget(fd);
+	buf->file->f_mode |= FMODE_LSEEK;
+
+	fput(buf->file);
+
+	get_device(buf->ethosn->dev);
+
+	return fd;
+}
+
 /**
  * ethosn_buffer_register() - Register a new Ethos-N buffer
  * @ethosn: [in]     pointer to Ethos-N device
@@ -177,7 +364,6 @@ int ethosn_buffer_register(struct ethosn_device *ethosn,
 	struct ethosn_log_uapi_buffer_req log;
 	int fd;
 	int ret = -ENOMEM;
-	int i;
 
 	buf = kzalloc(sizeof(*buf), GFP_KERNEL);
 	if (!buf)
@@ -194,39 +380,25 @@ int ethosn_buffer_register(struct ethosn_device *ethosn,
 	 *             is yet to be done.
 	 */
 	buf->ethosn = ethosn;
+	/* The memory belongs to the buffer, so the Ethos-N may always write
+	 * it, whatever access user space has to the file descriptor.
+	 */
+	buf->writable = true;
 
 	buf->dma_info =
 		ethosn_dma_alloc(ethosn->allocator, buf_req->size, GFP_KERNEL);
 	if (IS_ERR_OR_NULL(buf->dma_info))
 		goto err_kfree;
 
-	/* Map iova per core through core allocator */
-	for (i = 0; i < ethosn->num_cores; ++i) {
-		int ret = ethosn_dma_map(
-			ethosn->core[i]->allocator,
-			buf->dma_info,
-			ETHOSN_PROT_READ | ETHOSN_PROT_WRITE,
-			ETHOSN_STREAM_DMA);
-
-		if (ret < 0)
-			goto err_dma_free;
-	}
-
-	ret = anon_inode_getfd("ethosn-buffer",
-			       &ethosn_buffer_fops,
-			       buf,
-			       (buf_req->flags & O_ACCMODE) | O_CLOEXEC);
+	ret = buffer_map_dma(buf);
 	if (ret < 0)
 		goto err_dma_free;
 
-	fd = ret;
-
-	buf->file = fget(fd);
-	buf->file->f_mode |= FMODE_LSEEK;
-
-	fput(buf->file);
+	ret = buffer_get_fd(buf, buf_req->flags);
+	if (ret < 0)
+		goto err_dma_unmap;
 
-	get_device(ethosn->dev);
+	fd = ret;
 
 	if (buf_req->flags & MB_ZERO) {
 		memset(buf->dma_info->cpu_addr, 0, buf->dma_info->size);
@@ -244,14 +416,279 @@ int ethosn_buffer_register(struct ethosn_device *ethosn,
 
 	return fd;
 
+err_dma_unmap:
+	buffer_unmap_dma(buf, ethosn->num_cores);
+err_dma_free:
+	ethosn_dma_free(ethosn->allocator, buf->dma_info);
+err_kfree:
+	kfree(buf);
+
+	return ret;
+}
+
+static int buffer_pin_user_pages(struct ethosn_buffer *buf,
+				 __u64 user_ptr,
+				 __u32 size)
+{
+	unsigned int gup_flags = FOLL_LONGTERM;
+	int ret;
+
+	buf->pages = kcalloc(buf->nr_pages, sizeof(*buf->pages), GFP_KERNEL);
+	if (!buf->pages)
+		return -ENOMEM;
+
+	/* The pages stay pinned for as long as the buffer exists */
+	if (buf->writable)
+		gup_flags |= FOLL_WRITE;
+
+	ret = pin_user_pages_fast((unsigned long)user_ptr, buf->nr_pages,
+				  gup_flags, buf->pages);
+	if (ret < 0)
+		goto err_free_pages;
+
+	if (ret != buf->nr_pages) {
+		/* Only part of the range is mapped, release what we got */
+		unpin_user_pages(buf->pages, ret);
+		ret = -EFAULT;
+		goto err_free_pages;
+	}
+
+	buf->sgt = kzalloc(sizeof(*buf->sgt), GFP_KERNEL);
+	if (!buf->sgt) {
+		ret = -ENOMEM;
+		goto err_unpin;
+	}
+
+	ret = sg_alloc_table_from_pages(buf->sgt, buf->pages, buf->nr_pages, 0,
+					size, GFP_KERNEL);
+	if (ret)
+		goto err_free_sgt;
+
+	ret = dma_map_sgtable(buf->ethosn->dev, buf->sgt,
+			      buffer_import_dir(buf), 0);
+	if (ret)
+		goto err_free_table;
+
+	buf->vaddr = vmap(buf->pages, buf->nr_pages, 0, PAGE_KERNEL);
+	if (!buf->vaddr) {
+		ret = -ENOMEM;
+		goto err_unmap;
+	}
+
+	return 0;
+
+err_unmap:
+	dma_unmap_sgtable(buf->ethosn->dev, buf->sgt, buffer_import_dir(buf),
+			  0);
+err_free_table:
+	sg_free_table(buf->sgt);
+err_free_sgt:
+	kfree(buf->sgt);
+	buf->sgt = NULL;
+err_unpin:
+	unpin_user_pages(buf->pages, buf->nr_pages);
+err_free_pages:
+	kfree(buf->pages);
+	buf->pages = NULL;
+
+	return ret;
+}
+
+static int buffer_attach_dma_buf(struct ethosn_buffer *buf,
+				 int fd,
+				 __u32 size)
+{
+	struct ethosn_device *ethosn = buf->ethosn;
+	struct sg_table *sgt;
+	int ret;
+
+	buf->dma_buf = dma_buf_get(fd);
+	if (IS_ERR(buf->dma_buf)) {
+		ret = PTR_ERR(buf->dma_buf);
+		goto err_clear;
+	}
+
+	if (buf->dma_buf->size < size) {
+		dev_dbg(ethosn->dev,
+			"dma-buf too small. size=%zu, requested=%u\n",
+			buf->dma_buf->size, size);
+		ret = -EINVAL;
+		goto err_put;
+	}
+
+	buf->attach = dma_buf_attach(buf->dma_buf, ethosn->dev);
+	if (IS_ERR(buf->attach)) {
+		ret = PTR_ERR(buf->attach);
+		goto err_put;
+	}
+
+	/* Only the DMA addresses of the attachment are used, so memory
+	 * without struct pages can be imported too.
+	 */
+	sgt = dma_buf_map_attachment(buf->attach, buffer_import_dir(buf));
+	if (IS_ERR(sgt)) {
+		ret = PTR_ERR(sgt);
+		goto err_detach;
+	}
+
+	buf->sgt = sgt;
+
+	/* The kernel doesn't need to access the memory, so exporters which
+	 * can't map it for the CPU are still supported.
+	 */
+	buf->vaddr = buffer_vmap_dma_buf(buf->dma_buf);
+
+	return 0;
+
+err_detach:
+	dma_buf_detach(buf->dma_buf, buf->attach);
+err_put:
+	dma_buf_put(buf->dma_buf);
+err_clear:
+	buf->dma_buf = NULL;
+
+	return ret;
+}
+
+/**
+ * ethosn_buffer_import() - Wrap existing memory as an Ethos-N buffer
+ * @ethosn: [in]     pointer to Ethos-N device
+ * @import_req: [in] memory to import, size and flags
+ *
+ * The memory is used in place by inferences, it is not copied. It stays
+ * pinned until the returned file descriptor is closed.
+ *
+ * Return:
+ * * File descriptor for the new Ethos-N buffer on success
+ * * Negative error code on failure
+ */
+int ethosn_buffer_import(struct ethosn_device *ethosn,
+			 struct ethosn_buffer_import_req *import_req)
+{
+	struct ethosn_buffer *buf;
+	struct ethosn_log_uapi_buffer_import_req log;
+	int fd;
+	int ret;
+
+	if (!import_req->size)
+		return -EINVAL;
+
+	if (import_req->type == ETHOSN_BUFFER_IMPORT_USER_PTR &&
+	    !PAGE_ALIGNED(import_req->user_ptr))
+		return -EINVAL;
+
+	if (import_req->type != ETHOSN_BUFFER_IMPORT_USER_PTR &&
+	    import_req->type != ETHOSN_BUFFER_IMPORT_DMA_BUF)
+		return -EINVAL;
+
+	buf = kzalloc(sizeof(*buf), GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	dev_dbg(ethosn->dev, "Import buffer. handle=0x%pK, type=%u, size=%u\n",
+		buf, import_req->type, import_req->size);
+
+	buf->ethosn = ethosn;
+	buf->writable = (import_req->flags & O_ACCMODE) != MB_RDONLY;
+	buf->nr_pages = DIV_ROUND_UP(import_req->size, PAGE_SIZE);
+
+	if (import_req->type == ETHOSN_BUFFER_IMPORT_USER_PTR)
+		ret = buffer_pin_user_pages(buf, import_req->user_ptr,
+					    import_req->size);
+	else
+		ret = buffer_attach_dma_buf(buf, import_req->fd,
+					    import_req->size);
+
+	if (ret)
+		goto err_kfree;
+
+	buf->dma_info = ethosn_dma_import(ethosn->allocator, buf->sgt,
+					  buf->vaddr, import_req->size);
+	if (IS_ERR_OR_NULL(buf->dma_info)) {
+		ret = buf->dma_info ? PTR_ERR(buf->dma_info) : -ENOMEM;
+		goto err_release_import;
+	}
+
+	ret = buffer_map_dma(buf);
+	if (ret < 0)
+		goto err_dma_free;
+
+	ret = buffer_get_fd(buf, import_req->flags);
+	if (ret < 0)
+		goto err_dma_unmap;
+
+	fd = ret;
+
+	log.request = *import_req;
+	log.handle = (ptrdiff_t)buf;
+	log.fd = fd;
+
+	ethosn_log_uapi(ethosn->core[0], ETHOSN_IOCTL_IMPORT_BUFFER, &log,
+			sizeof(log));
+
+	return fd;
+
+err_dma_unmap:
+	buffer_unmap_dma(buf, ethosn->num_cores);
 err_dma_free:
-	buffer_unmap_and_free_dma(buf, i);
+	ethosn_dma_free(ethosn->allocator, buf->dma_info);
+err_release_import:
+	buffer_release_import(buf);
 err_kfree:
 	kfree(buf);
 
 	return ret;
 }
 
+/**
+ * ethosn_buffer_sync_for_device() - Hand a buffer over to the Ethos-N before
+ *				     an inference uses it
+ * @buf: [in]    Ethos-N buffer
+ */
+void ethosn_buffer_sync_for_device(struct ethosn_buffer *buf)
+{
+	struct ethosn_device *ethosn = buf->ethosn;
+
+	if (buf->dma_buf) {
+		/* The exporter knows how the CPU has been accessing it */
+		if (dma_buf_end_cpu_access(buf->dma_buf, DMA_TO_DEVICE))
+			dev_warn(ethosn->dev,
+				 "Failed to sync dma-buf for the device. handle=0x%pK\n",
+				 buf);
+	} else if (buf->sgt) {
+		dma_sync_sgtable_for_device(ethosn->dev, buf->sgt,
+					    buffer_import_dir(buf));
+	} else {
+		ethosn_dma_sync_for_device(ethosn->allocator, buf->dma_info);
+	}
+}
+
+/**
+ * ethosn_buffer_sync_for_cpu() - Hand a buffer back to the CPU after an
+ *				  inference wrote to it
+ * @buf: [in]    Ethos-N buffer
+ */
+void ethosn_buffer_sync_for_cpu(struct ethosn_buffer *buf)
+{
+	struct ethosn_device *ethosn = buf->ethosn;
+
+	/* The Ethos-N can't have written to a read-only buffer */
+	if (!buf->writable)
+		return;
+
+	if (buf->dma_buf) {
+		if (dma_buf_begin_cpu_access(buf->dma_buf, DMA_FROM_DEVICE))
+			dev_warn(ethosn->dev,
+				 "Failed to sync dma-buf for the CPU. handle=0x%pK\n",
+				 buf);
+	} else if (buf->sgt) {
+		dma_sync_sgtable_for_cpu(ethosn->dev, buf->sgt,
+					 DMA_FROM_DEVICE);
+	} else {
+		ethosn_dma_sync_for_cpu(ethosn->allocator, buf->dma_info);
+	}
+}
+
 /**
  * ethosn_buffer_get() - Returns the ethosn_buffer structure related to an fd
  * @fd: [in]    fd associated with the ethosn_buffer to be returned
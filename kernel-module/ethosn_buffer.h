@@ -29,17 +29,44 @@
 
 #include <linux/types.h>
 
+struct dma_buf;
+struct dma_buf_attachment;
+struct page;
+struct sg_table;
+
 struct ethosn_buffer {
-	struct ethosn_device   *ethosn;
-	struct ethosn_dma_info *dma_info;
+	struct ethosn_device      *ethosn;
+	struct ethosn_dma_info    *dma_info;
 	/* file pointer used for user-space mmap and for ref-counting */
-	struct file            *file;
+	struct file               *file;
+	/* False if the importer only allowed the Ethos-N to read the memory,
+	 * which is then mapped read-only and can't be an inference output.
+	 */
+	bool                      writable;
+
+	/* Only set for buffers created by ethosn_buffer_import(). sgt holds
+	 * the DMA addresses of the memory for the device, pages are only set
+	 * for imported user memory and dma_buf and attach for dma-bufs.
+	 */
+	struct sg_table           *sgt;
+	int                       nr_pages;
+	struct page               **pages;
+	struct dma_buf            *dma_buf;
+	struct dma_buf_attachment *attach;
+	/* Kernel mapping of imported memory, or NULL if the exporter of a
+	 * dma-buf can't provide one
+	 */
+	void                      *vaddr;
 };
 
 int ethosn_buffer_register(struct ethosn_device *ethosn,
 			   struct ethosn_buffer_req *buf_req);
+int ethosn_buffer_import(struct ethosn_device *ethosn,
+			 struct ethosn_buffer_import_req *import_req);
 struct ethosn_buffer *ethosn_buffer_get(int fd);
 void put_ethosn_buffer(struct ethosn_buffer *buf);
+void ethosn_buffer_sync_for_device(struct ethosn_buffer *buf);
+void ethosn_buffer_sync_for_cpu(struct ethosn_buffer *buf);
 
 int ethosn_get_dma_view_fd(struct ethosn_device *ethosn,
 			   struct ethosn_dma_info *dma_info);
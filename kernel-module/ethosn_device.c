@@ -22,17 +22,24 @@
 
 #include "ethosn_device.h"
 
+#include "ethosn_backport.h"
 #include "ethosn_firmware.h"
 #include "ethosn_log.h"
 #include "ethosn_smc.h"
 
 #include <linux/firmware.h>
 #include <linux/iommu.h>
+#include <linux/kref.h>
+#include <linux/list.h>
 #include <linux/log2.h>
+#include <linux/mm.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/of.h>
+#include <linux/slab.h>
 #include <linux/uaccess.h>
 #include <linux/time.h>
+#include <linux/version.h>
 
 /* Number of bits the MCU Vector Table address is shifted. */
 #define SYSCTLR0_INITVTOR_SHIFT         7
@@ -1022,7 +1029,7 @@ int ethosn_configure_firmware_profiling(struct ethosn_core *core,
 		core->profiling.firmware_buffer_pending = NULL;
 	}
 
-	core->profiling.is_waiting_for_firmware_ack = true;
+	WRITE_ONCE(core->profiling.is_waiting_for_firmware_ack, true);
 
 	ret = ethosn_send_configure_profiling(
 		core, new_config->enable_profiling,
@@ -1048,6 +1055,123 @@ ret:
 	return ret;
 }
 
+/**
+ * struct ethosn_profiling_mapping - Reference to a firmware profiling buffer
+ *				     which is mapped into user space.
+ * @kref:	One reference for each VMA mapping the buffer, plus one
+ *		held by the core while the buffer is in use by the firmware.
+ * @core:	Core which the buffer was allocated by, or NULL once the core
+ *		has been torn down.
+ * @buffer:	The buffer, which is freed along with this, or NULL once the
+ *		core has been torn down.
+ * @node:	Entry in the core's list of mappings.
+ *
+ * The pages of the buffer are mapped directly, so they must not be freed
+ * until the last user space mapping of them has been removed. If the core is
+ * torn down first, its allocator goes with it, so the user space mappings
+ * are removed and the buffer is freed then instead.
+ */
+struct ethosn_profiling_mapping {
+	struct kref            kref;
+	struct ethosn_core     *core;
+	struct ethosn_dma_info *buffer;
+	struct list_head       node;
+};
+
+/* Protects the firmware profiling buffer mappings of every core. This isn't
+ * part of the core, as the mappings can outlive it.
+ */
+static DEFINE_MUTEX(profiling_mapping_mutex);
+
+static void firmware_profiling_mapping_release(struct kref *kref)
+	__releases(&profiling_mapping_mutex)
+{
+	struct ethosn_profiling_mapping *mapping =
+		container_of(kref, struct ethosn_profiling_mapping, kref);
+
+	if (mapping->core) {
+		list_del(&mapping->node);
+		ethosn_dma_unmap_and_free(mapping->core->allocator,
+					  mapping->buffer,
+					  ETHOSN_STREAM_WORKING_DATA);
+	}
+
+	mutex_unlock(&profiling_mapping_mutex);
+	kfree(mapping);
+}
+
+static void firmware_profiling_mapping_put(
+	struct ethosn_profiling_mapping *mapping)
+{
+	kref_put_mutex(&mapping->kref, &firmware_profiling_mapping_release,
+		       &profiling_mapping_mutex);
+}
+
+/**
+ * firmware_profiling_set_buffer() - Replace the firmware profiling buffer.
+ * @core:	Ethos-N core.
+ * @buffer:	The new buffer, or NULL.
+ *
+ * The old buffer is freed, unless it is still mapped into user space, in which
+ * case it is freed when the last mapping is removed.
+ * The core mutex must be held, unless the core is being torn down.
+ */
+static void firmware_profiling_set_buffer(struct ethosn_core *core,
+					  struct ethosn_dma_info *buffer)
+{
+	struct ethosn_dma_info *old_buffer;
+	struct ethosn_profiling_mapping *mapping;
+
+	mutex_lock(&profiling_mapping_mutex);
+	old_buffer = core->profiling.firmware_buffer;
+	mapping = core->profiling.firmware_buffer_mapping;
+	core->profiling.firmware_buffer = buffer;
+	core->profiling.firmware_buffer_mapping = NULL;
+	mutex_unlock(&profiling_mapping_mutex);
+
+	if (mapping)
+		firmware_profiling_mapping_put(mapping);
+	else
+		ethosn_dma_unmap_and_free(core->allocator, old_buffer,
+					  ETHOSN_STREAM_WORKING_DATA);
+}
+
+/**
+ * firmware_profiling_unmap_all() - Remove all the user space mappings of the
+ *				    firmware profiling buffers, and free them.
+ * @core:	Ethos-N core, which is being torn down. The firmware must have
+ *		been stopped and the profiling buffer set to NULL.
+ *
+ * This must be called while the core's allocator still exists, as the
+ * buffers are freed with it. Any later access through the user space
+ * mappings faults, and the struct ethosn_profiling_mapping of each is freed
+ * once it is unmapped, without referring to the core.
+ */
+static void firmware_profiling_unmap_all(struct ethosn_core *core)
+{
+	struct ethosn_profiling_mapping *mapping;
+	struct ethosn_profiling_mapping *tmp;
+
+	mutex_lock(&profiling_mapping_mutex);
+
+	if (!list_empty(&core->profiling.mappings) &&
+	    !IS_ERR_OR_NULL(core->profiling.debugfs_file))
+		unmap_mapping_range(
+			d_inode(core->profiling.debugfs_file)->i_mapping, 0, 0,
+			1);
+
+	list_for_each_entry_safe(mapping, tmp, &core->profiling.mappings,
+				 node) {
+		list_del(&mapping->node);
+		ethosn_dma_unmap_and_free(core->allocator, mapping->buffer,
+					  ETHOSN_STREAM_WORKING_DATA);
+		mapping->buffer = NULL;
+		mapping->core = NULL;
+	}
+
+	mutex_unlock(&profiling_mapping_mutex);
+}
+
 int ethosn_configure_firmware_profiling_ack(struct ethosn_core *core)
 {
 	if (!core->profiling.is_waiting_for_firmware_ack) {
@@ -1058,17 +1182,13 @@ int ethosn_configure_firmware_profiling_ack(struct ethosn_core *core)
 	}
 
 	/* We can now free the old buffer (if any), as we know the firmware is
-	 * no longer writing to it
+	 * no longer writing to it.
+	 * What used to be the pending buffer is now the proper one.
 	 */
-	ethosn_dma_unmap_and_free(core->allocator,
-				  core->profiling.firmware_buffer,
-				  ETHOSN_STREAM_WORKING_DATA);
-
-	/* What used to be the pending buffer is now the proper one. */
-	core->profiling.firmware_buffer =
-		core->profiling.firmware_buffer_pending;
+	firmware_profiling_set_buffer(core,
+				      core->profiling.firmware_buffer_pending);
 	core->profiling.firmware_buffer_pending = NULL;
-	core->profiling.is_waiting_for_firmware_ack = false;
+	WRITE_ONCE(core->profiling.is_waiting_for_firmware_ack, false);
 
 	return 0;
 }
@@ -1455,6 +1575,8 @@ static ssize_t firmware_profiling_read(struct file *file,
 				       loff_t *position)
 {
 	struct ethosn_core *core = file->f_inode->i_private;
+	struct dentry *dentry = file->f_path.dentry;
+	int srcu_idx;
 	ssize_t ret;
 	ssize_t num_bytes_read;
 	size_t buffer_entries_offset;
@@ -1464,10 +1586,15 @@ static ssize_t firmware_profiling_read(struct file *file,
 	struct ethosn_profiling_buffer *buffer;
 	uint32_t firmware_write_offset;
 
+	/* Make sure the core isn't torn down underneath us */
+	ret = ethosn_debugfs_file_get(dentry, &srcu_idx);
+	if (ret)
+		return ret;
+
 	/* Make sure the profiling buffer isn't deallocated underneath us */
 	ret = mutex_lock_interruptible(&core->mutex);
 	if (ret != 0)
-		return ret;
+		goto put_file;
 
 	/* Report error if profiling is not enabled (i.e. no profiling buffer
 	 * allocated)
@@ -1547,6 +1674,131 @@ static ssize_t firmware_profiling_read(struct file *file,
 cleanup:
 	mutex_unlock(&core->mutex);
 
+put_file:
+	ethosn_debugfs_file_put(dentry, &srcu_idx);
+
+	return ret;
+}
+
+static void firmware_profiling_vm_open(struct vm_area_struct *vma)
+{
+	struct ethosn_profiling_mapping *mapping = vma->vm_private_data;
+
+	kref_get(&mapping->kref);
+}
+
+static void firmware_profiling_vm_close(struct vm_area_struct *vma)
+{
+	struct ethosn_profiling_mapping *mapping = vma->vm_private_data;
+
+	firmware_profiling_mapping_put(mapping);
+}
+
+static const struct vm_operations_struct firmware_profiling_vm_ops = {
+	.open  = &firmware_profiling_vm_open,
+	.close = &firmware_profiling_vm_close,
+};
+
+/**
+ * firmware_profiling_mmap - Called when a userspace process maps the
+ *			     firmware_profiling debugfs entry.
+ *
+ * This maps the firmware's profiling buffer read-only, laid out as
+ * struct ethosn_profiling_buffer, so that the entries can be consumed in
+ * place instead of being copied by read(). User space tracks its own read
+ * index against the firmware_write_index which the firmware publishes at the
+ * start of the buffer (see ETHOSN_PROFILING_BUFFER_ENTRIES_OFFSET).
+ * The whole buffer must be mapped, from offset zero.
+ *
+ * Unlike read(), this doesn't take the core mutex. The buffer stays allocated
+ * while it is mapped, even if profiling is reconfigured and the firmware
+ * moves to a new buffer. In that case the mapping is no longer updated, and
+ * user space must map the file again. This fails with -EAGAIN until the
+ * firmware has acknowledged the new configuration.
+ * If the core is torn down, the buffer is unmapped and freed regardless.
+ *
+ * @file:		File handle.
+ * @vma:		Virtual memory area to map the buffer into.
+ *
+ * Return: 0 on success, else error code.
+ */
+static int firmware_profiling_mmap(struct file *file,
+				   struct vm_area_struct *vma)
+{
+	struct ethosn_core *core = file->f_inode->i_private;
+	struct dentry *dentry = file->f_path.dentry;
+	struct ethosn_profiling_mapping *mapping;
+	struct ethosn_dma_info *buffer;
+	int srcu_idx;
+	int ret;
+
+	BUILD_BUG_ON(offsetof(struct ethosn_profiling_buffer, entries) !=
+		     ETHOSN_PROFILING_BUFFER_ENTRIES_OFFSET);
+
+	if ((vma->vm_flags & VM_WRITE) || vma->vm_pgoff != 0)
+		return -EINVAL;
+
+	/* Make sure the core isn't torn down underneath us */
+	ret = ethosn_debugfs_file_get(dentry, &srcu_idx);
+	if (ret)
+		return ret;
+
+	/* The buffer is mapped with the lock held, so that it can't be freed
+	 * (e.g. by the core being torn down) before the mapping is counted.
+	 */
+	mutex_lock(&profiling_mapping_mutex);
+
+	/* Don't map the old buffer if the firmware is about to move to a
+	 * new one.
+	 */
+	if (READ_ONCE(core->profiling.is_waiting_for_firmware_ack)) {
+		ret = -EAGAIN;
+		goto unlock;
+	}
+
+	buffer = core->profiling.firmware_buffer;
+	mapping = core->profiling.firmware_buffer_mapping;
+	if (IS_ERR_OR_NULL(buffer) ||
+	    vma->vm_end - vma->vm_start != PAGE_ALIGN(buffer->size)) {
+		ret = -EINVAL;
+		goto unlock;
+	}
+
+	if (!mapping) {
+		mapping = kzalloc(sizeof(*mapping), GFP_KERNEL);
+		if (!mapping) {
+			ret = -ENOMEM;
+			goto unlock;
+		}
+
+		/* The first reference is held by the core */
+		kref_init(&mapping->kref);
+		mapping->core = core;
+		mapping->buffer = buffer;
+		list_add(&mapping->node, &core->profiling.mappings);
+		core->profiling.firmware_buffer_mapping = mapping;
+	}
+
+#if (KERNEL_VERSION(6, 3, 0) <= LINUX_VERSION_CODE)
+	vm_flags_clear(vma, VM_MAYWRITE);
+	vm_flags_set(vma, VM_DONTEXPAND | VM_DONTDUMP);
+#else
+	vma->vm_flags &= ~VM_MAYWRITE;
+	vma->vm_flags |= VM_DONTEXPAND | VM_DONTDUMP;
+#endif
+
+	ret = ethosn_dma_mmap(core->allocator, vma, mapping->buffer);
+	if (ret)
+		goto unlock;
+
+	kref_get(&mapping->kref);
+	vma->vm_private_data = mapping;
+	vma->vm_ops = &firmware_profiling_vm_ops;
+
+unlock:
+	mutex_unlock(&profiling_mapping_mutex);
+	ethosn_debugfs_file_put(dentry, &srcu_idx);
+
 	return ret;
 }
 
@@ -1588,7 +1840,8 @@ static void dfs_init(struct ethosn_core *core)
 	};
 	static const struct file_operations firmware_profiling_fops = {
 		.owner = THIS_MODULE,
-		.read  = &firmware_profiling_read
+		.read  = &firmware_profiling_read,
+		.mmap  = &firmware_profiling_mmap
 	};
 	char name[16];
 
@@ -1609,10 +1862,15 @@ static void dfs_init(struct ethosn_core *core)
 	debugfs_create_file("mailbox", 0400, core->debug_dir, core,
 			    &mailbox_fops);
 
-	/* Expose the firmware's profiling stream to user-space as a file. */
-	debugfs_create_file("firmware_profiling", 0400, core->debug_dir,
-			    core,
-			    &firmware_profiling_fops);
+	/* Expose the firmware's profiling stream to user-space as a file.
+	 * debugfs_create_file() would wrap the file operations in a proxy
+	 * which doesn't support mmap, so the file operations protect
+	 * themselves against the file being removed instead.
+	 */
+	core->profiling.debugfs_file =
+		debugfs_create_file_unsafe("firmware_profiling", 0400,
+					   core->debug_dir, core,
+					   &firmware_profiling_fops);
 }
 
 /****************************************************************************
@@ -1686,21 +1944,28 @@ void ethosn_device_deinit(struct ethosn_core *core)
 	ethosn_firmware_deinit(core);
 	ethosn_mailbox_free(core);
 	ethosn_log_deinit(core);
-	dfs_deinit(core);
+
+	/* The firmware has stopped, so the profiling buffers can be freed,
+	 * even those which are still mapped into user space. This is done
+	 * before the debugfs file is removed, as that's needed to unmap them.
+	 */
+	if (!IS_ERR_OR_NULL(core->profiling.firmware_buffer))
+		firmware_profiling_set_buffer(core, NULL);
+
+	firmware_profiling_unmap_all(core);
 	mutex_unlock(&core->mutex);
+
+	/* Removing the debugfs files waits for their file operations to
+	 * finish, and those may be waiting for the core mutex.
+	 */
+	dfs_deinit(core);
+	core->profiling.debugfs_file = NULL;
+
 	if (core->fw_and_hw_caps.data) {
 		devm_kfree(core->parent->dev, core->fw_and_hw_caps.data);
 		core->fw_and_hw_caps.data = NULL;
 	}
 
-	if (!IS_ERR_OR_NULL(core->profiling.firmware_buffer)) {
-		ethosn_dma_unmap_and_free(
-			core->allocator,
-			core->profiling.firmware_buffer,
-			ETHOSN_STREAM_WORKING_DATA);
-		core->profiling.firmware_buffer = NULL;
-	}
-
 	if (!IS_ERR_OR_NULL(core->profiling.firmware_buffer_pending)) {
 		ethosn_dma_unmap_and_free(
 			core->allocator,
@@ -27,6 +27,7 @@
 #include "scylla_regs_public.h"
 #include "ethosn_dma.h"
 #include "ethosn_firmware.h"
+#include "ethosn_sched.h"
 #include "uapi/ethosn.h"
 
 #include <linux/atomic.h>
@@ -36,10 +37,12 @@
 #include <linux/io.h>
 #include <linux/list.h>
 #include <linux/mutex.h>
+#include <linux/spinlock.h>
 #include <linux/timer.h>
 #include <linux/wait.h>
 
 struct ethosn_inference;
+struct ethosn_profiling_mapping;
 
 struct ethosn_addr_map {
 	u32              region;
@@ -47,8 +50,8 @@ struct ethosn_addr_map {
 };
 
 struct ethosn_inference_queue {
-	struct mutex     inference_queue_mutex;
-	struct list_head inference_queue;
+	struct mutex              inference_queue_mutex;
+	struct ethosn_sched_queue inference_queue;
 };
 
 struct ethosn_device {
@@ -59,6 +62,12 @@ struct ethosn_device {
 	int                           num_cores;
 	struct ethosn_inference_queue queue;
 	struct ethosn_dma_allocator   *allocator;
+
+	/* Constant data shared between networks, protected by mutex */
+	struct list_head              constant_data_pool;
+
+	/* See ETHOSN_IOCTL_SET_HW_COUNTER_SAMPLING_INTERVAL */
+	u32                           hw_counter_sampling_interval;
 };
 
 enum ethosn_core_status {
@@ -120,6 +129,9 @@ struct ethosn_core {
 
 	struct ethosn_inference *current_inference;
 
+	/* Protected by the core mutex */
+	struct ethosn_sched_core sched;
+
 	/* Indicates if the core is busy or free.
 	 */
 	enum ethosn_core_status status;
@@ -164,6 +176,25 @@ struct ethosn_core {
 		 */
 		bool                   is_waiting_for_firmware_ack;
 		struct ethosn_dma_info *firmware_buffer_pending;
+
+		/* Keeps firmware_buffer allocated while it is mapped into
+		 * user space, or NULL if it isn't.
+		 * firmware_buffer and firmware_buffer_mapping are protected
+		 * against mmap of the firmware_profiling debugfs file, which
+		 * can't take the core mutex, by profiling_mapping_mutex in
+		 * ethosn_device.c. Both must be changed with that held, as
+		 * well as the core mutex.
+		 */
+		struct ethosn_profiling_mapping *firmware_buffer_mapping;
+
+		/* Every buffer which is still mapped into user space, including
+		 * old ones which the firmware no longer writes to. These are
+		 * unmapped and freed when the core is torn down.
+		 */
+		struct list_head                mappings;
+
+		/* The firmware_profiling debugfs file, which is mapped */
+		struct dentry                   *debugfs_file;
 	} profiling;
 };
 
@@ -84,6 +84,37 @@ exit:
 	return dma_info;
 }
 
+struct ethosn_dma_info *ethosn_dma_import(struct ethosn_dma_allocator *allocator,
+					  struct sg_table *sgt,
+					  void *cpu_addr,
+					  const size_t size)
+{
+	const struct ethosn_dma_allocator_ops *ops = get_ops(allocator);
+	struct ethosn_dma_info *dma_info;
+
+	if (!ops)
+		return ERR_PTR(-EINVAL);
+
+	if (!ops->import) {
+		dev_dbg(allocator->dev,
+			"Allocator does not support importing memory\n");
+
+		return ERR_PTR(-EOPNOTSUPP);
+	}
+
+	dma_info = ops->import(allocator, sgt, cpu_addr, size);
+
+	if (IS_ERR_OR_NULL(dma_info))
+		dev_err(allocator->dev, "failed to dma_import %zu bytes\n",
+			size);
+	else
+		dev_dbg(allocator->dev,
+			"DMA import. handle=0x%pK, cpu_addr=0x%pK, size=%zu\n",
+			dma_info, dma_info->cpu_addr, size);
+
+	return dma_info;
+}
+
 int ethosn_dma_map(struct ethosn_dma_allocator *allocator,
 		   struct ethosn_dma_info *dma_info,
 		   int prot,
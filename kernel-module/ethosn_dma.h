@@ -34,6 +34,7 @@
 #define ETHOSN_PROT_WRITE (1 << 1)
 
 struct device;
+struct sg_table;
 struct vm_area_struct;
 
 /*
@@ -60,7 +61,10 @@ struct ethosn_dma_allocator {
  * struct ethosn_dma_allocator_ops - Allocator operations for DMA memory
  * @destroy:           Deinitialize the allocator and free private resources
  * @alloc:             Allocate DMA memory
- * @free               Free DMA memory allocated with alloc
+ * @free               Free DMA memory allocated with alloc or import
+ * @import             Wrap memory owned by the caller without copying it.
+ *                     The memory is not released, mapped for the CPU or
+ *                     synced by the allocator
  * @map                Map virtual addresses
  * @unmap              Unmap virtual addresses
  * @sync_for_device    Transfer ownership of the memory buffer to the Ethos-N by
@@ -78,6 +82,11 @@ struct ethosn_dma_allocator_ops {
 	struct ethosn_dma_info *(*alloc)(struct ethosn_dma_allocator *allocator,
 					 size_t size,
 					 gfp_t gfp);
+	struct ethosn_dma_info *(*import)(struct ethosn_dma_allocator *
+					  allocator,
+					  struct sg_table *sgt,
+					  void *cpu_addr,
+					  size_t size);
 	int                    (*map)(struct ethosn_dma_allocator *allocator,
 				      struct ethosn_dma_info *dma_info,
 				      int prot,
@@ -153,6 +162,29 @@ struct ethosn_dma_info *ethosn_dma_alloc(struct ethosn_dma_allocator *allocator,
 					 size_t size,
 					 gfp_t gfp);
 
+/**
+ * ethosn_dma_import() - Wrap existing memory as DMA memory without mapping
+ * @allocator: Allocator object
+ * @sgt: Memory owned by the caller, DMA mapped for the allocator's device.
+ *       Only the DMA addresses are used, the memory needs no struct pages.
+ * @cpu_addr: Kernel mapping of the memory made by the caller, or NULL
+ * @size: bytes of memory
+ *
+ * The caller must keep @sgt mapped and @cpu_addr valid until the allocation
+ * has been released with ethosn_dma_free(). The caller is also responsible
+ * for syncing the memory, ethosn_dma_sync_for_device() and
+ * ethosn_dma_sync_for_cpu() do nothing for it, and for mapping it into user
+ * space.
+ *
+ * Return:
+ *  Pointer to ethosn_dma_info struct representing the allocation
+ *  Or negative error code on failure
+ */
+struct ethosn_dma_info *ethosn_dma_import(struct ethosn_dma_allocator *allocator,
+					  struct sg_table *sgt,
+					  void *cpu_addr,
+					  size_t size);
+
 /**
  * ethosn_dma_map() - Map DMA memory
  * @allocator: Allocator object
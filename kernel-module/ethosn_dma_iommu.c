@@ -27,6 +27,7 @@
 #include <linux/iommu.h>
 #include <linux/iova.h>
 #include <linux/kernel.h>
+#include <linux/scatterlist.h>
 #include <linux/version.h>
 #include <linux/vmalloc.h>
 
@@ -72,6 +73,10 @@ struct ethosn_dma_info_internal {
 	/* Allocator private members */
 	dma_addr_t             *dma_addr;
 	struct page            **pages;
+	/* Memory of the importer, which is not owned, mapped for the CPU or
+	 * synced here. It only has dma_addr, the address of each page.
+	 */
+	bool                   imported;
 };
 
 static struct ethosn_iommu_stream *iommu_get_stream(
@@ -293,6 +298,88 @@ early_exit:
 	return ERR_PTR(-ENOMEM);
 }
 
+static struct ethosn_dma_info *iommu_import(
+	struct ethosn_dma_allocator *allocator,
+	struct sg_table *sgt,
+	void *cpu_addr,
+	const size_t size)
+{
+	struct ethosn_dma_info_internal *dma_info;
+	int nr_pages = DIV_ROUND_UP(size, PAGE_SIZE);
+	struct sg_dma_page_iter iter;
+	dma_addr_t *dma_addr;
+	int i = 0;
+
+	if (!size)
+		return ERR_PTR(-EINVAL);
+
+	dma_info =
+		devm_kzalloc(allocator->dev,
+			     sizeof(struct ethosn_dma_info_internal),
+			     GFP_KERNEL);
+	if (!dma_info)
+		return ERR_PTR(-ENOMEM);
+
+	dma_addr = (dma_addr_t *)
+		   devm_kzalloc(allocator->dev,
+				sizeof(dma_addr_t) * nr_pages,
+				GFP_KERNEL);
+	if (!dma_addr)
+		goto free_dma_info;
+
+	for_each_sgtable_dma_page(sgt, &iter, 0) {
+		if (i == nr_pages)
+			break;
+
+		dma_addr[i] = sg_page_iter_dma_address(&iter);
+		if (!PAGE_ALIGNED(dma_addr[i]))
+			break;
+
+		++i;
+	}
+
+	if (i != nr_pages) {
+		dev_dbg(allocator->dev,
+			"Imported memory is too small or not page aligned\n");
+		devm_kfree(allocator->dev, dma_addr);
+		devm_kfree(allocator->dev, dma_info);
+
+		return ERR_PTR(-EINVAL);
+	}
+
+	dev_dbg(allocator->dev, "Imported DMA. handle=%p", dma_info);
+
+	*dma_info = (struct ethosn_dma_info_internal) {
+		.info = (struct ethosn_dma_info) {
+			.size = size,
+			.cpu_addr = cpu_addr,
+			.iova_addr = 0
+		},
+		.dma_addr = dma_addr,
+		.imported = true
+	};
+
+	return &dma_info->info;
+
+free_dma_info:
+	devm_kfree(allocator->dev, dma_info);
+
+	return ERR_PTR(-ENOMEM);
+}
+
+/* Physical address of a page of the memory, for the cores' IOMMUs to map.
+ * See ethosn_dma_iommu_allocator_create() for why that of an imported page is
+ * its DMA address.
+ */
+static phys_addr_t iommu_page_addr(struct ethosn_dma_info_internal *dma_info,
+				   int i)
+{
+	if (dma_info->imported)
+		return dma_info->dma_addr[i];
+
+	return page_to_phys(dma_info->pages[i]);
+}
+
 static void iommu_unmap_iova_pages(struct ethosn_dma_info_internal *dma_info,
 				   struct iommu_domain *domain,
 				   struct ethosn_iommu_stream *stream)
@@ -304,7 +391,7 @@ static void iommu_unmap_iova_pages(struct ethosn_dma_info_internal *dma_info,
 		unsigned long iova_addr =
 			dma_info->info.iova_addr + i * PAGE_SIZE;
 
-		if (dma_info->pages[i]) {
+		if (dma_info->imported || dma_info->pages[i]) {
 			/* TODO: Should handle error here */
 			iommu_unmap(domain, iova_addr, PAGE_SIZE);
 
@@ -344,7 +431,7 @@ static int iommu_iova_map(struct ethosn_dma_allocator *allocator,
 	if (!stream)
 		goto early_exit;
 
-	if (!dma_info->pages)
+	if (!dma_info->pages && !dma_info->imported)
 		goto early_exit;
 
 	start_addr = iommu_alloc_iova(dma_info, domain, stream);
@@ -371,7 +458,7 @@ static int iommu_iova_map(struct ethosn_dma_allocator *allocator,
 		err = iommu_map(
 			domain->iommu_domain,
 			start_addr + i * PAGE_SIZE,
-			page_to_phys(dma_info->pages[i]),
+			iommu_page_addr(dma_info, i),
 			PAGE_SIZE,
 			iommu_prot);
 
@@ -379,7 +466,7 @@ static int iommu_iova_map(struct ethosn_dma_allocator *allocator,
 			dev_err(allocator->dev,
 				"failed to iommu map iova 0x%llX pa 0x%llX size %lu\n",
 				start_addr + i * PAGE_SIZE,
-				page_to_phys(dma_info->pages[i]), PAGE_SIZE);
+				iommu_page_addr(dma_info, i), PAGE_SIZE);
 			goto unmap_pages;
 		}
 	}
@@ -432,6 +519,14 @@ static void iommu_free(struct ethosn_dma_allocator *allocator,
 		container_of(_dma_info, typeof(*dma_info), info);
 	int nr_pages = DIV_ROUND_UP(_dma_info->size, PAGE_SIZE);
 
+	if (dma_info->imported) {
+		devm_kfree(allocator->dev, dma_info->dma_addr);
+		memset(dma_info, 0, sizeof(*dma_info));
+		devm_kfree(allocator->dev, dma_info);
+
+		return;
+	}
+
 	vunmap(dma_info->info.cpu_addr);
 
 	if (dma_info->info.size) {
@@ -454,6 +549,9 @@ static void iommu_sync_for_device(struct ethosn_dma_allocator *allocator,
 	int nr_pages = DIV_ROUND_UP(_dma_info->size, PAGE_SIZE);
 	int i;
 
+	if (dma_info->imported)
+		return;
+
 	for (i = 0; i < nr_pages; ++i)
 		dma_sync_single_for_device(allocator->dev,
 					   dma_info->dma_addr[i], PAGE_SIZE,
@@ -469,6 +567,9 @@ static void iommu_sync_for_cpu(struct ethosn_dma_allocator *allocator,
 
 	int i;
 
+	if (dma_info->imported)
+		return;
+
 	for (i = 0; i < nr_pages; ++i)
 		dma_sync_single_for_cpu(allocator->dev,
 					dma_info->dma_addr[i],
@@ -484,6 +585,9 @@ static int iommu_mmap(struct ethosn_dma_allocator *allocator,
 	int nr_pages = DIV_ROUND_UP(_dma_info->size, PAGE_SIZE);
 	int i;
 
+	if (dma_info->imported)
+		return -EINVAL;
+
 	for (i = 0; i < nr_pages; ++i) {
 		unsigned long addr = vma->vm_start + i * PAGE_SIZE;
 		unsigned long pfn = page_to_pfn(dma_info->pages[i]);
@@ -620,9 +724,14 @@ struct ethosn_dma_allocator *ethosn_dma_iommu_allocator_create(
 		.get_addr_base   = iommu_get_addr_base,
 		.get_addr_size   = iommu_get_addr_size
 	};
+	/* Only an allocator for a device which is not behind an IOMMU can
+	 * import memory: the cores' IOMMUs are given the addresses which the
+	 * device uses for the memory, which are then its physical addresses.
+	 */
 	static const struct ethosn_dma_allocator_ops ops_no_iommu = {
 		.destroy         = iommu_allocator_destroy,
 		.alloc           = iommu_alloc,
+		.import          = iommu_import,
 		.free            = iommu_free,
 		.mmap            = iommu_mmap,
 		.sync_for_device = iommu_sync_for_device,
@@ -69,6 +69,12 @@
 
 #define ETHOSN_MAX_NUM_IRQS 3
 
+/* Time in ms after which a queued inference runs before any higher priority
+ * one. 0 for strict priorities.
+ */
+static unsigned int starvation_ms = 1000;
+module_param(starvation_ms, uint, 0440);
+
 static int ethosn_major;
 static struct ethosn_device *ethosn_global_device_for_testing;
 static DEFINE_IDA(ethosn_ida);
@@ -739,10 +745,44 @@ static long ethosn_ioctl(struct file *const filep,
 
 		break;
 	}
-	case ETHOSN_IOCTL_REGISTER_NETWORK: {
-		struct ethosn_network_req net_req;
+	case ETHOSN_IOCTL_IMPORT_BUFFER: {
+		struct ethosn_buffer_import_req import_req;
+
+		if (copy_from_user(&import_req, udata, sizeof(import_req))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		ret = mutex_lock_interruptible(&ethosn->mutex);
+		if (ret)
+			break;
+
+		dev_dbg(ethosn->dev,
+			"IOCTL: Import buffer. type=%u, size=%u, flags=0x%x\n",
+			import_req.type, import_req.size, import_req.flags);
+
+		ret = ethosn_buffer_import(ethosn, &import_req);
+
+		dev_dbg(ethosn->dev,
+			"IOCTL: Imported buffer. fd=%d\n", ret);
+
+		mutex_unlock(&ethosn->mutex);
+
+		break;
+	}
+	case ETHOSN_IOCTL_REGISTER_NETWORK:
+	case ETHOSN_IOCTL_REGISTER_NETWORK2: {
+		/* The original request is the start of the newer one, and
+		 * leaves the rest of it at its defaults.
+		 */
+		struct ethosn_network_req2 net_req2 = {
+			.priority.priority = ETHOSN_PRIORITY_MEDIUM,
+		};
+		struct ethosn_network_req *net_req = &net_req2.req;
+		size_t size = (cmd == ETHOSN_IOCTL_REGISTER_NETWORK2) ?
+			      sizeof(net_req2) : sizeof(*net_req);
 
-		if (copy_from_user(&net_req, udata, sizeof(net_req))) {
+		if (copy_from_user(&net_req2, udata, size)) {
 			ret = -EFAULT;
 			break;
 		}
@@ -753,24 +793,24 @@ static long ethosn_ioctl(struct file *const filep,
 
 		dev_dbg(ethosn->dev,
 			"IOCTL: Register network. num_dma=%u, num_cu=%u, num_inputs=%u, num_outputs=%u\n",
-			net_req.dma_buffers.num,
-			net_req.cu_buffers.num,
-			net_req.input_buffers.num,
-			net_req.output_buffers.num);
-
-		print_buffer_info(ethosn, "dma", net_req.dma_buffers.num,
-				  net_req.dma_buffers.info);
-		print_buffer_info(ethosn, "cu", net_req.cu_buffers.num,
-				  net_req.cu_buffers.info);
+			net_req->dma_buffers.num,
+			net_req->cu_buffers.num,
+			net_req->input_buffers.num,
+			net_req->output_buffers.num);
+
+		print_buffer_info(ethosn, "dma", net_req->dma_buffers.num,
+				  net_req->dma_buffers.info);
+		print_buffer_info(ethosn, "cu", net_req->cu_buffers.num,
+				  net_req->cu_buffers.info);
 		print_buffer_info(ethosn, "intermediate",
-				  net_req.intermediate_buffers.num,
-				  net_req.intermediate_buffers.info);
-		print_buffer_info(ethosn, "input", net_req.input_buffers.num,
-				  net_req.input_buffers.info);
-		print_buffer_info(ethosn, "output", net_req.output_buffers.num,
-				  net_req.output_buffers.info);
+				  net_req->intermediate_buffers.num,
+				  net_req->intermediate_buffers.info);
+		print_buffer_info(ethosn, "input", net_req->input_buffers.num,
+				  net_req->input_buffers.info);
+		print_buffer_info(ethosn, "output", net_req->output_buffers.num,
+				  net_req->output_buffers.info);
 
-		ret = ethosn_network_register(ethosn, &net_req);
+		ret = ethosn_network_register(ethosn, &net_req2);
 
 		dev_dbg(ethosn->dev,
 			"IOCTL: Registered network. fd=%d\n", ret);
@@ -855,6 +895,29 @@ configure_profiling_end:
 
 		break;
 	}
+	case ETHOSN_IOCTL_SET_HW_COUNTER_SAMPLING_INTERVAL: {
+		u32 interval;
+
+		if (!ethosn_profiling_enabled()) {
+			ret = -EACCES;
+			dev_err(ethosn->dev, "Profiling: access denied\n");
+			break;
+		}
+
+		if (get_user(interval, (u32 __user *)udata)) {
+			ret = -EFAULT;
+			break;
+		}
+
+		dev_dbg(ethosn->dev,
+			"IOCTL: Set hardware counter sampling interval. interval=%u\n",
+			interval);
+
+		/* Read without locking when inferences are sent to a core */
+		WRITE_ONCE(ethosn->hw_counter_sampling_interval, interval);
+
+		break;
+	}
 	case ETHOSN_IOCTL_GET_COUNTER_VALUE: {
 		struct ethosn_core *core = ethosn->core[0];
 		enum ethosn_poll_counter_name counter_name;
@@ -1113,6 +1176,9 @@ static int ethosn_driver_probe(struct ethosn_core *core,
 	core->profiling.is_waiting_for_firmware_ack = false;
 	core->profiling.firmware_buffer = NULL;
 	core->profiling.firmware_buffer_pending = NULL;
+	core->profiling.firmware_buffer_mapping = NULL;
+	INIT_LIST_HEAD(&core->profiling.mappings);
+	core->profiling.debugfs_file = NULL;
 
 	ret = ethosn_device_init(core);
 	if (ret)
@@ -1348,7 +1414,8 @@ static int ethosn_pdev_probe(struct platform_device *pdev)
 	if (IS_ERR_OR_NULL(ethosn->allocator))
 		goto err_free_ethosn;
 
-	INIT_LIST_HEAD(&ethosn->queue.inference_queue);
+	ethosn_sched_init(&ethosn->queue.inference_queue,
+			  (u64)starvation_ms * NSEC_PER_MSEC);
 
 	/* Allocate space for num_of_npus ethosn cores */
 	ethosn->core = devm_kzalloc(&pdev->dev,
@@ -1378,6 +1445,8 @@ static int ethosn_pdev_probe(struct platform_device *pdev)
 
 	mutex_init(&ethosn->mutex);
 
+	INIT_LIST_HEAD(&ethosn->constant_data_pool);
+
 	mutex_init(&ethosn->queue.inference_queue_mutex);
 
 	/* Currently we assume that the reserved memory is
@@ -28,6 +28,7 @@
 #include "ethosn_dma.h"
 #include "ethosn_firmware.h"
 #include "ethosn_log.h"
+#include "ethosn_sched.h"
 #include "uapi/ethosn.h"
 
 #include <linux/anon_inodes.h>
@@ -37,9 +38,12 @@
 #include <linux/fs.h>
 #include <linux/kref.h>
 #include <linux/list.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
 #include <linux/module.h>
 #include <linux/poll.h>
 #include <linux/slab.h>
+#include <linux/spinlock.h>
 #include <linux/uaccess.h>
 #include <linux/version.h>
 #include <linux/wait.h>
@@ -52,6 +56,37 @@
 
 #define MAX_PENDING ((int)-1)
 
+/* Id of the first hardware counter in the firmware's COUNTER_VALUE profiling
+ * entries (FirmwareCounterName::BusAccessRdTransfers). The others follow in
+ * the order of enum ethosn_profiling_hw_counter_types.
+ */
+#define ETHOSN_FIRMWARE_HW_COUNTER_ID_BASE 6
+
+/* Source of unique ids for bound inferences, 0 is never used */
+static atomic64_t next_binding_id = ATOMIC64_INIT(0);
+
+/**
+ * struct ethosn_constant_data_entry - Constant data of one or more networks.
+ * @node:	Entry in the device's constant_data_pool, if it has a digest.
+ *		Otherwise the entry is only used by one network and the node is
+ *		empty.
+ * @digest:	Digest supplied when the data was registered.
+ * @stream_id:	Stream the data is mapped to on every core.
+ * @size:	Size of the data.
+ * @dma_info:	The data.
+ * @refcount:	Number of networks using the data.
+ *
+ * Entries are protected by the device mutex.
+ */
+struct ethosn_constant_data_entry {
+	struct list_head              node;
+	struct ethosn_constant_digest digest;
+	enum ethosn_stream_id         stream_id;
+	u32                           size;
+	struct ethosn_dma_info        *dma_info;
+	unsigned int                  refcount;
+};
+
 struct ethosn_network {
 	/* This is the ethosn device on which the memory for constant_dma_data,
 	 * constant_cu_data, inference_data and intermediate_data was
@@ -59,6 +94,9 @@ struct ethosn_network {
 	 */
 	struct ethosn_device      *ethosn;
 
+	/* May be shared with other networks, see get_constant_data() */
+	struct ethosn_constant_data_entry *constant_dma_entry;
+	struct ethosn_constant_data_entry *constant_cu_entry;
 	struct ethosn_dma_info    *constant_dma_data;
 	struct ethosn_dma_info    *constant_cu_data;
 	struct ethosn_dma_info    **inference_data;
@@ -73,25 +111,82 @@ struct ethosn_network {
 	u32                       num_outputs;
 	struct ethosn_buffer_info *outputs;
 
+	/* Per core, binding id of the bound inference whose buffers are
+	 * currently written in inference_data, or 0.
+	 */
+	u64                       *binding_ids;
+
+	/* Protected by the inference queue mutex */
+	struct ethosn_network_priority priority;
+
+	/* Core which last ran an inference of this network, or -1 */
+	int                       last_core_id;
+
+	/* Protects latency and hw_counters */
+	spinlock_t                stats_lock;
+	/* See add_latency() */
+	struct ethosn_inference_latency_stats latency;
+	/* See finish_hw_counter_sampling() */
+	struct ethosn_hw_counter_summary hw_counters;
+
+	/* Number of inferences sent to a core, to pick those whose hardware
+	 * counters are sampled
+	 */
+	atomic_t                  num_dispatched;
+
 	/* file pointer used for ref-counting */
 	struct file               *file;
 };
 
+struct ethosn_inference_batch;
+
 struct ethosn_inference {
-	struct ethosn_core    *core;
-	struct ethosn_network *network;
+	struct ethosn_core            *core;
+	struct ethosn_network         *network;
+	/* Batch this inference belongs to, if any */
+	struct ethosn_inference_batch *batch;
+
+	struct ethosn_sched_entry     queue_entry;
+
+	struct ethosn_buffer          **inputs;
+	struct ethosn_buffer          **outputs;
+
+	u32                           status;
 
-	struct list_head      queue_node;
+	/* Non-zero for inferences created by ETHOSN_IOCTL_BIND_INFERENCE */
+	u64                           binding_id;
 
-	struct ethosn_buffer  **inputs;
-	struct ethosn_buffer  **outputs;
+	/* Times of the latest run, in ns. completed_ns is cleared once
+	 * user space has read the status.
+	 */
+	u64                           queued_ns;
+	u64                           dispatched_ns;
+	u64                           completed_ns;
 
-	u32                   status;
+	/* Profiling buffer the hardware counters of the latest run are being
+	 * sampled from, or NULL. See start_hw_counter_sampling().
+	 */
+	struct ethosn_dma_info        *hw_counter_buffer;
+	u32                           hw_counter_start_index;
+	u64                           hw_counter_start_timestamp;
 
-	wait_queue_head_t     poll_wqh;
+	wait_queue_head_t             poll_wqh;
 
 	/* Reference counting */
-	struct kref           kref;
+	struct kref                   kref;
+};
+
+struct ethosn_inference_batch {
+	u32                     num_inferences;
+	struct ethosn_inference **inferences;
+
+	/* Optional eventfd signalled once per finished inference */
+	struct eventfd_ctx      *eventfd;
+
+	wait_queue_head_t       poll_wqh;
+
+	/* Reference counting, one per inference plus one for the file */
+	struct kref             kref;
 };
 
 static struct device *net_to_dev(const struct ethosn_network *const net)
@@ -212,6 +307,243 @@ static int update_bindings(struct ethosn_network *network,
 	return 0;
 }
 
+/**
+ * add_latency() - Add a latency to one of the histograms of a network
+ * @hist:	One of the histograms of network->latency.
+ * @start_ns:	Start of the interval.
+ * @end_ns:	End of the interval.
+ *
+ * The network's stats_lock must be held. Only a spinlock is used, so that
+ * the statistics are cheap enough to always be kept.
+ */
+static void add_latency(struct ethosn_latency_histogram *hist,
+			u64 start_ns,
+			u64 end_ns)
+{
+	u64 latency_ns = end_ns > start_ns ? end_ns - start_ns : 0;
+	u64 latency_us = div_u64(latency_ns, NSEC_PER_USEC);
+	u32 bucket = 0;
+
+	if (latency_us)
+		bucket = min_t(u32, ilog2(latency_us),
+			       ETHOSN_LATENCY_HISTOGRAM_BUCKETS - 1);
+
+	++hist->count;
+	hist->sum_ns += latency_ns;
+	hist->max_ns = max(hist->max_ns, latency_ns);
+	++hist->buckets[bucket];
+}
+
+static void record_queue_wait(struct ethosn_inference *inference)
+{
+	struct ethosn_network *network = inference->network;
+
+	spin_lock(&network->stats_lock);
+	add_latency(&network->latency.queue_wait, inference->queued_ns,
+		    inference->dispatched_ns);
+	spin_unlock(&network->stats_lock);
+}
+
+static void record_execution(struct ethosn_inference *inference,
+			     u64 completed_ns)
+{
+	struct ethosn_network *network = inference->network;
+
+	spin_lock(&network->stats_lock);
+	add_latency(&network->latency.execution, inference->dispatched_ns,
+		    completed_ns);
+	inference->completed_ns = completed_ns;
+	spin_unlock(&network->stats_lock);
+}
+
+/**
+ * record_completion_to_wake() - Record how long user space took to see that
+ *				 an inference has finished.
+ * @inference:	Inference whose status has been read.
+ * @status:	The status read.
+ *
+ * Only the first read after the inference has completed is recorded.
+ */
+static void record_completion_to_wake(struct ethosn_inference *inference,
+				      u32 status)
+{
+	struct ethosn_network *network = inference->network;
+	u64 now;
+
+	if (status != ETHOSN_INFERENCE_COMPLETED)
+		return;
+
+	now = ktime_get_ns();
+
+	spin_lock(&network->stats_lock);
+	if (inference->completed_ns) {
+		add_latency(&network->latency.completion_to_wake,
+			    inference->completed_ns, now);
+		inference->completed_ns = 0;
+	}
+
+	spin_unlock(&network->stats_lock);
+}
+
+static u32 profiling_buffer_num_entries(struct ethosn_dma_info *dma_info)
+{
+	size_t entries_offset =
+		offsetof(struct ethosn_profiling_buffer, entries);
+
+	if (dma_info->size <= entries_offset)
+		return 0;
+
+	return (dma_info->size - entries_offset) /
+	       sizeof(struct ethosn_profiling_entry);
+}
+
+/**
+ * start_hw_counter_sampling() - Decide whether to sample the hardware counters
+ *				 of an inference which is about to be sent to
+ *				 a core.
+ * @core:	Core the inference runs on.
+ * @inference:	Inference to sample.
+ *
+ * One in the device's hw_counter_sampling_interval inferences of each network
+ * is sampled, so that the cost stays low. This only remembers where the
+ * firmware is in its profiling buffer. The core mutex must be held.
+ */
+static void start_hw_counter_sampling(struct ethosn_core *core,
+				      struct ethosn_inference *inference)
+{
+	struct ethosn_dma_info *dma_info = core->profiling.firmware_buffer;
+	u32 interval = READ_ONCE(core->parent->hw_counter_sampling_interval);
+	struct ethosn_profiling_buffer *buffer;
+	u32 num_entries;
+	u32 start_index;
+
+	inference->hw_counter_buffer = NULL;
+
+	if (IS_ERR_OR_NULL(dma_info) || (interval == 0) ||
+	    (core->profiling.config.num_hw_counters == 0))
+		return;
+
+	if ((u32)atomic_inc_return(&inference->network->num_dispatched) %
+	    interval)
+		return;
+
+	buffer = (struct ethosn_profiling_buffer *)dma_info->cpu_addr;
+	num_entries = profiling_buffer_num_entries(dma_info);
+	start_index = READ_ONCE(buffer->firmware_write_index);
+	if (start_index >= num_entries)
+		return;
+
+	/* Newest entry written before the inference, which is used to tell
+	 * whether the firmware has gone all the way round the buffer since.
+	 */
+	inference->hw_counter_start_timestamp =
+		buffer->entries[(start_index + num_entries - 1) %
+				num_entries].timestamp;
+	inference->hw_counter_start_index = start_index;
+	inference->hw_counter_buffer = dma_info;
+}
+
+/**
+ * finish_hw_counter_sampling() - Add the hardware counter samples of a
+ *				  sampled inference to its network's summary.
+ * @core:	Core the inference ran on.
+ * @inference:	Inference which has completed.
+ * @now:	Time the inference completed, in ns.
+ *
+ * The core only runs one inference at a time, so all the counter samples
+ * which the firmware wrote to the profiling buffer since the inference was
+ * sent belong to it. Like the pollable counters, each sample is the running
+ * 32-bit value of the counter, which is also how the driver library's trace
+ * dump plots them. So the increase during the inference is the last sample
+ * minus the first one, modulo 2^32. The core mutex must be held.
+ */
+static void finish_hw_counter_sampling(struct ethosn_core *core,
+				       struct ethosn_inference *inference,
+				       u64 now)
+{
+	struct ethosn_dma_info *dma_info = inference->hw_counter_buffer;
+	struct ethosn_network *network = inference->network;
+	struct ethosn_hw_counter_summary *summary = &network->hw_counters;
+	struct ethosn_hw_counter_inference *recent;
+	u32 first[ETHOSN_NUM_HW_COUNTER_TYPES] = { 0 };
+	u32 last[ETHOSN_NUM_HW_COUNTER_TYPES] = { 0 };
+	u32 num_samples[ETHOSN_NUM_HW_COUNTER_TYPES] = { 0 };
+	struct ethosn_profiling_buffer *buffer;
+	u32 num_entries;
+	u32 end_index;
+	u32 i;
+
+	inference->hw_counter_buffer = NULL;
+
+	if (!dma_info)
+		return;
+
+	/* The buffer is only replaced with the core mutex held, so if it is
+	 * still the same, it hasn't been freed.
+	 */
+	if (dma_info != core->profiling.firmware_buffer)
+		goto lost;
+
+	buffer = (struct ethosn_profiling_buffer *)dma_info->cpu_addr;
+	num_entries = profiling_buffer_num_entries(dma_info);
+	end_index = READ_ONCE(buffer->firmware_write_index);
+	if (end_index >= num_entries)
+		goto lost;
+
+	/* The entry which the firmware writes next is the oldest one. If it
+	 * is newer than those from before the inference, some of the
+	 * inference's own entries have been overwritten.
+	 */
+	if (buffer->entries[end_index].timestamp >
+	    inference->hw_counter_start_timestamp)
+		goto lost;
+
+	for (i = inference->hw_counter_start_index; i != end_index;
+	     i = (i + 1) % num_entries) {
+		const struct ethosn_profiling_entry *entry =
+			&buffer->entries[i];
+		u32 counter;
+
+		if ((entry->type != COUNTER_VALUE) ||
+		    (entry->id < ETHOSN_FIRMWARE_HW_COUNTER_ID_BASE))
+			continue;
+
+		counter = entry->id - ETHOSN_FIRMWARE_HW_COUNTER_ID_BASE;
+		if (counter >= ETHOSN_NUM_HW_COUNTER_TYPES)
+			continue;
+
+		if (num_samples[counter] == 0)
+			first[counter] = entry->data;
+
+		last[counter] = entry->data;
+		++num_samples[counter];
+	}
+
+	spin_lock(&network->stats_lock);
+	recent = &summary->recent[summary->num_inferences %
+				  ETHOSN_HW_COUNTER_RECENT_INFERENCES];
+	recent->completed_ns = now;
+	for (i = 0; i < ETHOSN_NUM_HW_COUNTER_TYPES; ++i) {
+		u64 value = (u32)(last[i] - first[i]);
+
+		recent->values[i] = value;
+		summary->num_samples[i] += num_samples[i];
+		summary->totals[i] += value;
+		summary->max_per_inference[i] =
+			max(summary->max_per_inference[i], value);
+	}
+
+	++summary->num_inferences;
+	spin_unlock(&network->stats_lock);
+
+	return;
+
+lost:
+	spin_lock(&network->stats_lock);
+	++summary->num_lost_inferences;
+	spin_unlock(&network->stats_lock);
+}
+
 static void get_network(struct ethosn_network *network)
 {
 	get_file(network->file);
@@ -236,6 +568,23 @@ static void free_buffers(const u32 n,
 	kfree(bufs);
 }
 
+static void inference_batch_kref_release(struct kref *kref)
+{
+	struct ethosn_inference_batch *const batch =
+		container_of(kref, struct ethosn_inference_batch, kref);
+
+	if (batch->eventfd)
+		eventfd_ctx_put(batch->eventfd);
+
+	kfree(batch->inferences);
+	kfree(batch);
+}
+
+static void put_inference_batch(struct ethosn_inference_batch *batch)
+{
+	kref_put(&batch->kref, &inference_batch_kref_release);
+}
+
 static void inference_kref_release(struct kref *kref)
 {
 	struct ethosn_inference *const inference =
@@ -251,6 +600,9 @@ static void inference_kref_release(struct kref *kref)
 	free_buffers(network->num_inputs, inference->inputs);
 	free_buffers(network->num_outputs, inference->outputs);
 
+	if (inference->batch)
+		put_inference_batch(inference->batch);
+
 	kfree(inference);
 }
 
@@ -267,7 +619,8 @@ static int put_inference(struct ethosn_inference *inference)
 static struct ethosn_buffer **read_buffer_fds(struct ethosn_network *network,
 					      u32 n,
 					      const int __user *fds,
-					      struct ethosn_buffer_info *infos)
+					      struct ethosn_buffer_info *infos,
+					      bool written)
 {
 	struct ethosn_buffer **bufs;
 	int error;
@@ -314,6 +667,15 @@ static struct ethosn_buffer **read_buffer_fds(struct ethosn_network *network,
 			error = -EINVAL;
 			goto err_free_bufs;
 		}
+
+		if (written && !buf->writable) {
+			dev_err(net_to_dev(
+					network),
+				"Read-only buffer can't be an output. handle=0x%pK, fd=%d\n",
+				buf, fd);
+			error = -EACCES;
+			goto err_free_bufs;
+		}
 	}
 
 	return bufs;
@@ -324,6 +686,22 @@ err_free_bufs:
 	return ERR_PTR(error);
 }
 
+/*
+ * Wake everyone waiting for the inference to end: pollers of the inference
+ * and, for a batched inference, pollers of the batch and its eventfd.
+ */
+static void inference_wake_waiters(struct ethosn_inference *inference)
+{
+	wake_up_poll(&inference->poll_wqh, EPOLLIN);
+
+	if (inference->batch) {
+		if (inference->batch->eventfd)
+			ethosn_eventfd_signal(inference->batch->eventfd);
+
+		wake_up_poll(&inference->batch->poll_wqh, EPOLLIN);
+	}
+}
+
 /**
  * schedule_inference() - Send an inference to Ethos-N
  *
@@ -338,6 +716,11 @@ static int schedule_inference(struct ethosn_inference *inference)
 	struct ethosn_core *core = inference->core;
 	uint32_t core_id = core->core_id;
 	struct device *dev = core->dev;
+	/* A bound inference which was the last one to run on this core finds
+	 * its buffers already in the binding table.
+	 */
+	bool rebind = !inference->binding_id ||
+		      (network->binding_ids[core_id] != inference->binding_id);
 	u32 i;
 	int ret;
 
@@ -346,13 +729,17 @@ static int schedule_inference(struct ethosn_inference *inference)
 
 	inference->status = ETHOSN_INFERENCE_RUNNING;
 
+	if (rebind)
+		network->binding_ids[core_id] = 0;
+
 	for (i = 0; i < network->num_inputs; ++i) {
 		struct ethosn_dma_info *dma_info =
 			inference->inputs[i]->dma_info;
-		struct ethosn_dma_allocator *allocator =
-			core->parent->allocator;
 
-		ethosn_dma_sync_for_device(allocator, dma_info);
+		ethosn_buffer_sync_for_device(inference->inputs[i]);
+
+		if (!rebind)
+			continue;
 
 		ret = update_bindings(network,
 				      core_id,
@@ -369,10 +756,11 @@ static int schedule_inference(struct ethosn_inference *inference)
 	for (i = 0; i < network->num_outputs; ++i) {
 		struct ethosn_dma_info *dma_info =
 			inference->outputs[i]->dma_info;
-		struct ethosn_dma_allocator *allocator =
-			core->parent->allocator;
 
-		ethosn_dma_sync_for_device(allocator, dma_info);
+		ethosn_buffer_sync_for_device(inference->outputs[i]);
+
+		if (!rebind)
+			continue;
 
 		ret = update_bindings(network,
 				      core_id,
@@ -386,35 +774,44 @@ static int schedule_inference(struct ethosn_inference *inference)
 			goto out_inference_error;
 	}
 
-	ethosn_dma_sync_for_device(core->allocator,
-				   network->intermediate_data[core_id]);
-	ret = update_bindings(network,
-			      core_id,
-			      network->num_intermediates,
-			      network->intermediates,
-			      network->intermediate_data[core_id] == NULL ? 0 :
-			      network->intermediate_data[core_id]->iova_addr,
-			      network->intermediate_data[core_id] == NULL ? 0 :
-			      network->intermediate_data[core_id]->size,
-			      false,
-			      true);
+	if (rebind) {
+		ethosn_dma_sync_for_device(core->allocator,
+					   network->intermediate_data[core_id]);
+		ret = update_bindings(network,
+				      core_id,
+				      network->num_intermediates,
+				      network->intermediates,
+				      network->intermediate_data[core_id] == NULL ?
+				      0 :
+				      network->intermediate_data[core_id]->
+				      iova_addr,
+				      network->intermediate_data[core_id] == NULL ?
+				      0 :
+				      network->intermediate_data[core_id]->size,
+				      false,
+				      true);
 
-	if (ret)
-		return ret;
+		if (ret)
+			goto out_inference_error;
+
+		ethosn_dma_sync_for_device(core->allocator,
+					   network->inference_data[core_id]);
+		network->binding_ids[core_id] = inference->binding_id;
+	}
 
 	if (ethosn_mailbox_empty(core->mailbox_request->cpu_addr) &&
 	    core->profiling.config.enable_profiling) {
 		/* Send sync message */
 		ret = ethosn_send_time_sync(core);
 		if (ret)
-			return ret;
+			goto out_inference_error;
 	}
 
 	/* kick off execution */
 	dev_dbg(dev, "Starting execution of inference");
-	ethosn_dma_sync_for_device(core->allocator,
-				   network->inference_data[core_id]);
 	core->current_inference = inference;
+	inference->dispatched_ns = ktime_get_ns();
+	start_hw_counter_sampling(core, inference);
 
 	/* send the inference to the core (ethosn) assigned to it */
 	ret = ethosn_send_inference(core,
@@ -422,63 +819,115 @@ static int schedule_inference(struct ethosn_inference *inference)
 				    (ptrdiff_t)inference);
 	if (ret) {
 		core->current_inference = NULL;
-
-		return ret;
+		inference->hw_counter_buffer = NULL;
+		goto out_inference_error;
 	}
 
 	get_inference(inference);
+	record_queue_wait(inference);
+	ethosn_sched_core_start(&core->sched, inference->dispatched_ns);
+	WRITE_ONCE(network->last_core_id, core_id);
 	dev_dbg(dev, "Scheduled inference 0x%pK on core_id = %d\n", inference,
 		core->core_id);
 
 	return 0;
 
 out_inference_error:
+	/* The inference has already left the queue, so it has to be finished
+	 * here like a completed one, or its waiters would never wake up.
+	 */
 	dev_err(dev, "Error scheduling inference 0x%pK: %d on core_id = %d\n",
 		inference, ret, core->core_id);
 	inference->status = ETHOSN_INFERENCE_ERROR;
+	inference_wake_waiters(inference);
 
 	return ret;
 }
 
+/*
+ * Core which last ran the network of the next queued inference, or -1 if
+ * there is none.
+ */
+static int next_inference_affinity(struct ethosn_device *ethosn)
+{
+	struct ethosn_sched_entry *entry;
+	struct ethosn_inference *inference;
+	int affinity = -1;
+
+	mutex_lock(&ethosn->queue.inference_queue_mutex);
+
+	entry = ethosn_sched_peek(&ethosn->queue.inference_queue,
+				  ktime_get_ns());
+	if (entry) {
+		inference = container_of(entry, typeof(*inference),
+					 queue_entry);
+		affinity = READ_ONCE(inference->network->last_core_id);
+	}
+
+	mutex_unlock(&ethosn->queue.inference_queue_mutex);
+
+	return affinity;
+}
+
 /**
- * get_free_core() - Get the next free core.
+ * get_free_core() - Get the best free core for the next queued inference.
  * @ethosn:	ethosn_parent_device
  *
- * Iterates through the list of cores present in the parent device and returns
- * the first free core.
+ * Prefers the core which last ran the network of the next queued inference,
+ * then the one which has been idle the longest, see ethosn_sched_prefer_core(). The returned core
+ * is marked as busy.
  *
  * Return: Pointer to ethosn_device (corresponding to the free core), else
  * NULL (if all the cores are busy)
  */
 static struct ethosn_core *get_free_core(struct ethosn_device *ethosn)
 {
-	int i = 0, ret = 0;
-	bool found = false;
-	struct ethosn_core *core = NULL;
+	int affinity = next_inference_affinity(ethosn);
+	struct ethosn_sched_core best_sched = { 0 };
+	struct ethosn_core *core;
+	int best, i, ret;
 
-	while (i < ethosn->num_cores) {
-		/* Check the status of the core
-		 */
-		ret = mutex_lock_interruptible(&ethosn->core[i]->mutex);
+retry:
+	best = -1;
 
-		if (ret)
-			goto end;
+	for (i = 0; i < ethosn->num_cores; ++i) {
+		core = ethosn->core[i];
 
-		if (ethosn->core[i]->status == ETHOSN_CORE_FREE) {
-			core = ethosn->core[i];
-			core->status = ETHOSN_CORE_BUSY;
-			found = true;
+		ret = mutex_lock_interruptible(&core->mutex);
+		if (ret)
+			return NULL;
+
+		if ((core->status == ETHOSN_CORE_FREE) &&
+		    ((best < 0) ||
+		     ethosn_sched_prefer_core(&core->sched, core->core_id,
+					      &best_sched,
+					      ethosn->core[best]->core_id,
+					      affinity))) {
+			best_sched = core->sched;
+			best = i;
 		}
 
-		mutex_unlock(&ethosn->core[i]->mutex);
+		mutex_unlock(&core->mutex);
+	}
 
-		if (found)
-			break;
+	if (best < 0)
+		return NULL;
 
-		i++;
+	core = ethosn->core[best];
+
+	ret = mutex_lock_interruptible(&core->mutex);
+	if (ret)
+		return NULL;
+
+	/* Another caller may have taken the core since it was checked */
+	if (core->status != ETHOSN_CORE_FREE) {
+		mutex_unlock(&core->mutex);
+		goto retry;
 	}
 
-end:
+	core->status = ETHOSN_CORE_BUSY;
+
+	mutex_unlock(&core->mutex);
 
 	return core;
 }
@@ -492,12 +941,18 @@ end:
  */
 static void schedule_queued_inference(struct ethosn_core *core)
 {
-	struct ethosn_inference *inference = NULL;
+	struct ethosn_inference *inference;
 	struct ethosn_device *ethosn = core->parent;
+	struct ethosn_sched_entry *entry;
 	int ret = 0;
-	bool found = false;
 
-	if (!list_empty(&ethosn->queue.inference_queue)) {
+	/* An inference which fails to be scheduled is finished with an error,
+	 * so carry on with the next one rather than leaving the core idle.
+	 */
+	while (!core->current_inference &&
+	       !ethosn_sched_empty(&ethosn->queue.inference_queue)) {
+		inference = NULL;
+
 		/* This will be invoked from the irq handlers of multiple npus.
 		 * The inference queue needs to be protected against concurrent
 		 * operation.
@@ -507,33 +962,45 @@ static void schedule_queued_inference(struct ethosn_core *core)
 		if (ret)
 			return;
 
-		found = false;
-
-		inference = list_first_entry(&ethosn->queue.inference_queue,
-					     typeof(*inference),
-					     queue_node);
-		if (inference == NULL) {
+		entry = ethosn_sched_dequeue(&ethosn->queue.inference_queue,
+					     ktime_get_ns());
+		if (entry == NULL) {
 			dev_dbg(ethosn->dev,
 				"Inference is NULL\n");
-			found = false;
 		} else {
-			found = true;
-		}
+			inference = container_of(entry, typeof(*inference),
+						 queue_entry);
 
-		if (found) {
 			/* Schedule the inference on a particular core */
 			inference->core = core;
-
-			list_del(&inference->queue_node);
 		}
 
 		mutex_unlock(&ethosn->queue.inference_queue_mutex);
 
-		if (found)
-			(void)schedule_inference(inference);
+		if (!inference)
+			return;
+
+		(void)schedule_inference(inference);
 	}
 }
 
+/**
+ * queue_inference() - Add an inference to the queue of its device
+ * @inference:	Inference to queue
+ *
+ * The inference queue mutex must be held.
+ */
+static void queue_inference(struct ethosn_inference *inference)
+{
+	struct ethosn_network *network = inference->network;
+
+	inference->queued_ns = ktime_get_ns();
+	ethosn_sched_enqueue(&network->ethosn->queue.inference_queue,
+			     &inference->queue_entry,
+			     &network->priority,
+			     inference->queued_ns);
+}
+
 /**
  * inference_create() - Create and schedule an inference job
  * @network: Inference network
@@ -561,13 +1028,15 @@ struct ethosn_inference *inference_create(struct ethosn_network *network,
 
 	inference->network = network;
 	inference->status = ETHOSN_INFERENCE_SCHEDULED;
+	ethosn_sched_entry_init(&inference->queue_entry);
 	init_waitqueue_head(&inference->poll_wqh);
 	kref_init(&inference->kref);
 
 	inference->inputs = read_buffer_fds(network,
 					    ifr_req->num_inputs,
 					    ifr_req->input_fds,
-					    network->inputs);
+					    network->inputs,
+					    false);
 	if (IS_ERR(inference->inputs)) {
 		ret = PTR_ERR(inference->inputs);
 		goto err_put_inference;
@@ -576,7 +1045,8 @@ struct ethosn_inference *inference_create(struct ethosn_network *network,
 	inference->outputs = read_buffer_fds(network,
 					     ifr_req->num_outputs,
 					     ifr_req->output_fds,
-					     network->outputs);
+					     network->outputs,
+					     true);
 	if (IS_ERR(inference->outputs)) {
 		ret = PTR_ERR(inference->outputs);
 		goto err_put_inference;
@@ -590,30 +1060,35 @@ err_put_inference:
 	return ERR_PTR(ret);
 }
 
-static int inference_release(struct inode *inode,
-			     struct file *filep)
+/**
+ * inference_abort() - Stop an inference which is queued or running
+ * @inference:	Inference to abort
+ *
+ * Removes the inference from the queue if it has not started yet, or resets
+ * the core it is running on otherwise.
+ */
+static void inference_abort(struct ethosn_inference *inference)
 {
-	struct ethosn_inference *inference = filep->private_data;
+	struct ethosn_device *ethosn = inference->network->ethosn;
 
 	/*
 	 * Note we don't use mutex_lock_interruptible here as we need to make
 	 * sure we release the network so we don't leak resources.
 	 * This would prevent the kernel module from being unloaded
 	 * when requested.
+	 *
+	 * Use the same mutex that is used for adding inferences to the queue
+	 * and taking them off it. A scheduled inference may have been
+	 * dequeued by a core already, so only remove it if it is still queued.
 	 */
-	if (inference->status == ETHOSN_INFERENCE_SCHEDULED) {
-		/*
-		 * Use the same mutex that is used for adding
-		 * inference to the list.
-		 */
-		struct ethosn_device *ethosn = inference->network->ethosn;
+	mutex_lock(&ethosn->queue.inference_queue_mutex);
 
-		mutex_lock(
-			&ethosn->queue.inference_queue_mutex);
-		list_del(&inference->queue_node);
-		mutex_unlock(
-			&ethosn->queue.inference_queue_mutex);
-	}
+	if ((inference->status == ETHOSN_INFERENCE_SCHEDULED) &&
+	    ethosn_sched_queued(&inference->queue_entry))
+		ethosn_sched_remove(&ethosn->queue.inference_queue,
+				    &inference->queue_entry);
+
+	mutex_unlock(&ethosn->queue.inference_queue_mutex);
 
 	if (inference->status == ETHOSN_INFERENCE_RUNNING) {
 		struct ethosn_core *core = inference->core;
@@ -637,6 +1112,14 @@ static int inference_release(struct inode *inode,
 	}
 
 	wake_up_poll(&inference->poll_wqh, EPOLLHUP);
+}
+
+static int inference_release(struct inode *inode,
+			     struct file *filep)
+{
+	struct ethosn_inference *inference = filep->private_data;
+
+	inference_abort(inference);
 
 	put_inference(inference);
 
@@ -666,17 +1149,21 @@ static ssize_t inference_read(struct file *file,
 			      loff_t *ppos)
 {
 	struct ethosn_inference *inference = file->private_data;
+	u32 status = READ_ONCE(inference->status);
 
-	if (WARN_ON((inference->status < ETHOSN_INFERENCE_SCHEDULED) ||
-		    (inference->status > ETHOSN_INFERENCE_ERROR)))
+	if (WARN_ON((status < ETHOSN_INFERENCE_SCHEDULED) ||
+		    (status > ETHOSN_INFERENCE_ERROR)))
 		return -EINVAL;
 
-	if (count != sizeof(inference->status))
+	if (count != sizeof(status))
 		return -EINVAL;
 
-	return put_user(inference->status,
-			(int32_t __user *)buf) ? -EFAULT :
-	       sizeof(inference->status);
+	if (put_user(status, (int32_t __user *)buf))
+		return -EFAULT;
+
+	record_completion_to_wake(inference, status);
+
+	return sizeof(status);
 }
 
 /**
@@ -724,7 +1211,7 @@ static int ethosn_inference_register(struct ethosn_network *network,
 	ethosn_log_uapi(core, ETHOSN_IOCTL_SCHEDULE_INFERENCE, &log,
 			sizeof(log));
 
-	ret = mutex_lock_interruptible(&ethosn->mutex);
+	ret = mutex_lock_interruptible(&ethosn->queue.inference_queue_mutex);
 	if (ret) {
 		put_inference(inference);
 
@@ -732,9 +1219,9 @@ static int ethosn_inference_register(struct ethosn_network *network,
 	}
 
 	/* Queue and schedule inference. */
-	list_add_tail(&inference->queue_node, &ethosn->queue.inference_queue);
+	queue_inference(inference);
 
-	mutex_unlock(&ethosn->mutex);
+	mutex_unlock(&ethosn->queue.inference_queue_mutex);
 
 	/* Get the next free core. */
 	core = get_free_core(ethosn);
@@ -765,57 +1252,478 @@ static int ethosn_inference_register(struct ethosn_network *network,
 }
 
 /**
- * network_ioctl() - Take network command from user space
- * @filep: File struct
- * @cmd: User command
- * * ETHOSN_IOCTL_SCHEDULE_INFERENCE
+ * schedule_on_free_cores() - Start queued inferences on idle cores
+ * @ethosn:	Ethos-N device
+ * @max_cores:	Maximum number of cores to start
  *
- * Return:
- * * Inference file descriptor on success
- * * Negative error code on failure
+ * Stops early when there is no free core left or the queue runs empty.
  */
-static long network_ioctl(struct file *filep,
-			  unsigned int cmd,
-			  unsigned long arg)
+static void schedule_on_free_cores(struct ethosn_device *ethosn,
+				   u32 max_cores)
 {
-	struct ethosn_network *network = filep->private_data;
-	const void __user *udata = (void __user *)arg;
-	int ret;
-	u64 time;
-
-	time = ktime_get_ns();
+	struct ethosn_core *core;
+	u32 i;
 
-	switch (cmd) {
-	case ETHOSN_IOCTL_SCHEDULE_INFERENCE: {
-		struct ethosn_inference_req infer_req;
+	for (i = 0; i < max_cores; ++i) {
+		core = get_free_core(ethosn);
+		if (!core) {
+			dev_dbg(ethosn->dev,
+				"Could not find any free core. Total cores = %d\n",
+				ethosn->num_cores);
 
-		if (copy_from_user(&infer_req, udata, sizeof(infer_req))) {
-			ret = -EFAULT;
-			break;
+			return;
 		}
 
-		ret = ethosn_inference_register(network, &infer_req);
+		mutex_lock(&core->mutex);
 
-		dev_dbg(net_to_dev(network), "SCHEDULE_INFERENCE: %llu", time);
+		schedule_queued_inference(core);
 
-		break;
-	}
-	case ETHOSN_IOCTL_GET_INTERMEDIATE_BUFFER: {
-		if (network->ethosn->num_cores > 1)
-			dev_warn(net_to_dev(
-					 network),
-				 "Intermediate buffer for multi-core system: core 0 will be returned.");
+		/* If no inference was scheduled on the core, set the status
+		 * as free and stop as the queue is empty.
+		 */
+		if (core->current_inference == NULL) {
+			core->status = ETHOSN_CORE_FREE;
+			mutex_unlock(&core->mutex);
 
-		ret = ethosn_get_dma_view_fd(network->ethosn,
-					     network->intermediate_data[0]);
-		break;
-	}
-	default: {
-		ret = -EINVAL;
-	}
-	}
+			return;
+		}
 
-	return ret;
+		mutex_unlock(&core->mutex);
+	}
+}
+
+static long bound_inference_ioctl(struct file *filep,
+				  unsigned int cmd,
+				  unsigned long arg)
+{
+	struct ethosn_inference *inference = filep->private_data;
+	struct ethosn_device *ethosn = inference->network->ethosn;
+
+	if (cmd != ETHOSN_IOCTL_TRIGGER_INFERENCE)
+		return -EINVAL;
+
+	mutex_lock(&ethosn->queue.inference_queue_mutex);
+
+	if ((inference->status == ETHOSN_INFERENCE_SCHEDULED) ||
+	    (inference->status == ETHOSN_INFERENCE_RUNNING)) {
+		mutex_unlock(&ethosn->queue.inference_queue_mutex);
+
+		return -EBUSY;
+	}
+
+	inference->status = ETHOSN_INFERENCE_SCHEDULED;
+	queue_inference(inference);
+
+	mutex_unlock(&ethosn->queue.inference_queue_mutex);
+
+	schedule_on_free_cores(ethosn, 1);
+
+	return 0;
+}
+
+/**
+ * ethosn_bound_inference_register() - Create a reusable inference
+ * @network:	Network to run the inference on
+ * @req:	Input and output buffers to bind
+ *
+ * The buffers are looked up and referenced once, here. The inference is not
+ * run until it is triggered with ETHOSN_IOCTL_TRIGGER_INFERENCE.
+ *
+ * Return: File descriptor on success, else error code.
+ */
+static int ethosn_bound_inference_register(struct ethosn_network *network,
+					   struct ethosn_inference_req *req)
+{
+	static const struct file_operations bound_inference_fops = {
+		.owner          = THIS_MODULE,
+		.release        = &inference_release,
+		.poll           = &inference_poll,
+		.read           = &inference_read,
+		.unlocked_ioctl = &bound_inference_ioctl,
+#ifdef CONFIG_COMPAT
+		.compat_ioctl   = &bound_inference_ioctl,
+#endif
+	};
+	struct ethosn_inference *inference;
+	int ret_fd;
+
+	inference = inference_create(network, req);
+	if (IS_ERR(inference))
+		return PTR_ERR(inference);
+
+	inference->binding_id = atomic64_inc_return(&next_binding_id);
+
+	/* Nothing has run yet, report the same as a finished inference so
+	 * that the first trigger is accepted.
+	 */
+	inference->status = ETHOSN_INFERENCE_COMPLETED;
+
+	ret_fd = anon_inode_getfd("ethosn-bound-inference",
+				  &bound_inference_fops,
+				  inference,
+				  O_RDONLY | O_CLOEXEC);
+	if (ret_fd < 0) {
+		put_inference(inference);
+
+		return ret_fd;
+	}
+
+	dev_dbg(ifr_to_dev(inference),
+		"Registered bound inference. handle=0x%pK, binding_id=%llu\n",
+		inference, inference->binding_id);
+
+	return ret_fd;
+}
+
+static int inference_batch_release(struct inode *inode,
+				   struct file *filep)
+{
+	struct ethosn_inference_batch *batch = filep->private_data;
+	u32 i;
+
+	for (i = 0; i < batch->num_inferences; ++i) {
+		inference_abort(batch->inferences[i]);
+		put_inference(batch->inferences[i]);
+	}
+
+	wake_up_poll(&batch->poll_wqh, EPOLLHUP);
+
+	put_inference_batch(batch);
+
+	return 0;
+}
+
+static __poll_t inference_batch_poll(struct file *file,
+				     poll_table *wait)
+{
+	struct ethosn_inference_batch *batch = file->private_data;
+	u32 i;
+
+	poll_wait(file, &batch->poll_wqh, wait);
+
+	for (i = 0; i < batch->num_inferences; ++i) {
+		s32 status = batch->inferences[i]->status;
+
+		if (status < ETHOSN_INFERENCE_SCHEDULED)
+			return EPOLLERR;
+
+		if (status <= ETHOSN_INFERENCE_RUNNING)
+			return 0;
+	}
+
+	return EPOLLIN;
+}
+
+static ssize_t inference_batch_read(struct file *file,
+				    char __user *buf,
+				    size_t count,
+				    loff_t *ppos)
+{
+	struct ethosn_inference_batch *batch = file->private_data;
+	int32_t __user *statuses = (int32_t __user *)buf;
+	u32 i;
+
+	if (count != batch->num_inferences * sizeof(*statuses))
+		return -EINVAL;
+
+	for (i = 0; i < batch->num_inferences; ++i) {
+		u32 status = READ_ONCE(batch->inferences[i]->status);
+
+		if (put_user(status, &statuses[i]))
+			return -EFAULT;
+
+		record_completion_to_wake(batch->inferences[i], status);
+	}
+
+	return count;
+}
+
+/**
+ * ethosn_inference_batch_register() - Create and queue a batch of inferences
+ * @network:	Network to run the inferences on
+ * @req:	Batch description
+ *
+ * All inferences of the batch are queued at once and share one file
+ * descriptor, which avoids a system call and a file per inference.
+ *
+ * Return: File descriptor on success, else error code.
+ */
+static int ethosn_inference_batch_register(struct ethosn_network *network,
+					   struct ethosn_inference_batch_req *req)
+{
+	static const struct file_operations inference_batch_fops = {
+		.owner   = THIS_MODULE,
+		.release = &inference_batch_release,
+		.poll    = &inference_batch_poll,
+		.read    = &inference_batch_read,
+		.llseek  = &noop_llseek,
+	};
+	struct ethosn_device *ethosn = network->ethosn;
+	struct ethosn_inference_batch *batch;
+	struct file *file;
+	int fd;
+	int ret;
+	u32 i;
+
+	if ((req->num_inferences == 0) ||
+	    (req->num_inferences > ETHOSN_MAX_INFERENCE_BATCH) ||
+	    (req->num_inputs != network->num_inputs) ||
+	    (req->num_outputs != network->num_outputs))
+		return -EINVAL;
+
+	batch = kzalloc(sizeof(*batch), GFP_KERNEL);
+	if (!batch)
+		return -ENOMEM;
+
+	kref_init(&batch->kref);
+	init_waitqueue_head(&batch->poll_wqh);
+
+	batch->inferences = kcalloc(req->num_inferences,
+				    sizeof(*batch->inferences), GFP_KERNEL);
+	if (!batch->inferences) {
+		ret = -ENOMEM;
+		goto err_put_batch;
+	}
+
+	if (req->eventfd >= 0) {
+		batch->eventfd = eventfd_ctx_fdget(req->eventfd);
+		if (IS_ERR(batch->eventfd)) {
+			ret = PTR_ERR(batch->eventfd);
+			batch->eventfd = NULL;
+			goto err_put_batch;
+		}
+	}
+
+	for (i = 0; i < req->num_inferences; ++i) {
+		struct ethosn_inference_req ifr_req = {
+			.num_inputs  = req->num_inputs,
+			.input_fds   = req->input_fds + i * req->num_inputs,
+			.num_outputs = req->num_outputs,
+			.output_fds  = req->output_fds + i * req->num_outputs,
+		};
+		struct ethosn_inference *inference;
+
+		inference = inference_create(network, &ifr_req);
+		if (IS_ERR(inference)) {
+			ret = PTR_ERR(inference);
+			goto err_put_inferences;
+		}
+
+		kref_get(&batch->kref);
+		inference->batch = batch;
+		batch->inferences[i] = inference;
+		batch->num_inferences = i + 1;
+	}
+
+	/* The file descriptor is only published once all the inferences are
+	 * queued, otherwise closing it concurrently would abort inferences
+	 * which are not in the queue yet.
+	 */
+	fd = get_unused_fd_flags(O_CLOEXEC);
+	if (fd < 0) {
+		ret = fd;
+		goto err_put_inferences;
+	}
+
+	file = anon_inode_getfile("ethosn-inference-batch",
+				  &inference_batch_fops,
+				  batch,
+				  O_RDONLY | O_CLOEXEC);
+	if (IS_ERR(file)) {
+		ret = PTR_ERR(file);
+		goto err_put_fd;
+	}
+
+	dev_dbg(net_to_dev(network),
+		"Registered inference batch. handle=0x%pK, num_inferences=%u\n",
+		batch, batch->num_inferences);
+
+	/* Queue the whole batch at once, then start as many cores as can
+	 * take work.
+	 */
+	mutex_lock(&ethosn->queue.inference_queue_mutex);
+
+	for (i = 0; i < batch->num_inferences; ++i)
+		queue_inference(batch->inferences[i]);
+
+	mutex_unlock(&ethosn->queue.inference_queue_mutex);
+
+	schedule_on_free_cores(ethosn, batch->num_inferences);
+
+	fd_install(fd, file);
+
+	return fd;
+
+err_put_fd:
+	put_unused_fd(fd);
+
+err_put_inferences:
+	for (i = 0; i < batch->num_inferences; ++i)
+		put_inference(batch->inferences[i]);
+
+err_put_batch:
+	put_inference_batch(batch);
+
+	return ret;
+}
+
+/**
+ * network_ioctl() - Take network command from user space
+ * @filep: File struct
+ * @cmd: User command
+ * * ETHOSN_IOCTL_SCHEDULE_INFERENCE
+ * * ETHOSN_IOCTL_SCHEDULE_INFERENCE_BATCH
+ * * ETHOSN_IOCTL_BIND_INFERENCE
+ * * ETHOSN_IOCTL_SET_NETWORK_PRIORITY
+ * * ETHOSN_IOCTL_GET_INFERENCE_LATENCY_STATS
+ * * ETHOSN_IOCTL_GET_HW_COUNTER_SUMMARY
+ *
+ * Return:
+ * * Inference file descriptor on success
+ * * Negative error code on failure
+ */
+static long network_ioctl(struct file *filep,
+			  unsigned int cmd,
+			  unsigned long arg)
+{
+	struct ethosn_network *network = filep->private_data;
+	const void __user *udata = (void __user *)arg;
+	int ret;
+	u64 time;
+
+	time = ktime_get_ns();
+
+	switch (cmd) {
+	case ETHOSN_IOCTL_SCHEDULE_INFERENCE: {
+		struct ethosn_inference_req infer_req;
+
+		if (copy_from_user(&infer_req, udata, sizeof(infer_req))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		ret = ethosn_inference_register(network, &infer_req);
+
+		dev_dbg(net_to_dev(network), "SCHEDULE_INFERENCE: %llu", time);
+
+		break;
+	}
+	case ETHOSN_IOCTL_SCHEDULE_INFERENCE_BATCH: {
+		struct ethosn_inference_batch_req batch_req;
+
+		if (copy_from_user(&batch_req, udata, sizeof(batch_req))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		ret = ethosn_inference_batch_register(network, &batch_req);
+
+		dev_dbg(net_to_dev(network),
+			"SCHEDULE_INFERENCE_BATCH: %llu", time);
+
+		break;
+	}
+	case ETHOSN_IOCTL_BIND_INFERENCE: {
+		struct ethosn_inference_req infer_req;
+
+		if (copy_from_user(&infer_req, udata, sizeof(infer_req))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		ret = ethosn_bound_inference_register(network, &infer_req);
+
+		dev_dbg(net_to_dev(network), "BIND_INFERENCE: %llu", time);
+
+		break;
+	}
+	case ETHOSN_IOCTL_SET_NETWORK_PRIORITY: {
+		struct ethosn_network_priority prio;
+		struct ethosn_device *ethosn = network->ethosn;
+
+		if (copy_from_user(&prio, udata, sizeof(prio))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		ret = ethosn_sched_check_priority(&prio);
+		if (ret)
+			break;
+
+		/* Applies to the inferences queued from now on */
+		mutex_lock(&ethosn->queue.inference_queue_mutex);
+		network->priority = prio;
+		mutex_unlock(&ethosn->queue.inference_queue_mutex);
+
+		dev_dbg(net_to_dev(network),
+			"SET_NETWORK_PRIORITY: priority=%u, deadline_us=%u\n",
+			prio.priority, prio.deadline_us);
+
+		break;
+	}
+	case ETHOSN_IOCTL_GET_INFERENCE_LATENCY_STATS: {
+		struct ethosn_inference_latency_stats *stats;
+
+		/* Too big to go on the stack */
+		stats = kmalloc(sizeof(*stats), GFP_KERNEL);
+		if (!stats) {
+			ret = -ENOMEM;
+			break;
+		}
+
+		spin_lock(&network->stats_lock);
+		*stats = network->latency;
+		spin_unlock(&network->stats_lock);
+
+		ret = copy_to_user((void __user *)arg, stats,
+				   sizeof(*stats)) ? -EFAULT : 0;
+
+		kfree(stats);
+
+		break;
+	}
+	case ETHOSN_IOCTL_GET_HW_COUNTER_SUMMARY: {
+		struct ethosn_hw_counter_summary *summary;
+
+		summary = kmalloc(sizeof(*summary), GFP_KERNEL);
+		if (!summary) {
+			ret = -ENOMEM;
+			break;
+		}
+
+		spin_lock(&network->stats_lock);
+		*summary = network->hw_counters;
+		spin_unlock(&network->stats_lock);
+
+		ret = copy_to_user((void __user *)arg, summary,
+				   sizeof(*summary)) ? -EFAULT : 0;
+
+		kfree(summary);
+
+		break;
+	}
+	case ETHOSN_IOCTL_GET_INTERMEDIATE_BUFFER: {
+		/* The core which last ran the network holds its latest
+		 * intermediate data. Core 0 before it has run.
+		 */
+		int core_id = max(READ_ONCE(network->last_core_id), 0);
+
+		if (network->ethosn->num_cores > 1)
+			dev_warn(net_to_dev(
+					 network),
+				 "Intermediate buffer for multi-core system: core %d will be returned.",
+				 core_id);
+
+		ret = ethosn_get_dma_view_fd(network->ethosn,
+					     network->intermediate_data[core_id]);
+		break;
+	}
+	default: {
+		ret = -EINVAL;
+	}
+	}
+
+	return ret;
 }
 
 static int init_bindings(struct ethosn_network *network,
@@ -1021,7 +1929,9 @@ static int alloc_init_inference_data(struct ethosn_network *network,
 
 	/*
 	 * Each core needs it own intermediate data. It reads/writes to this
-	 * data during the execution of an inference.
+	 * data during the execution of an inference. It is allocated up front
+	 * so that scheduling an inference on any core cannot fail for lack of
+	 * memory.
 	 */
 	network->intermediate_data = kzalloc(
 		(sizeof(*(network->intermediate_data)) * num_cores),
@@ -1029,6 +1939,12 @@ static int alloc_init_inference_data(struct ethosn_network *network,
 	if (!network->intermediate_data)
 		return ret;
 
+	network->binding_ids = kcalloc(num_cores,
+				       sizeof(*network->binding_ids),
+				       GFP_KERNEL);
+	if (!network->binding_ids)
+		return ret;
+
 	for (i = 0; i < num_cores; i++) {
 		core = network->ethosn->core[i];
 		ret = -ENOMEM;
@@ -1061,6 +1977,162 @@ static int alloc_init_inference_data(struct ethosn_network *network,
 	return ret;
 }
 
+static bool has_digest(const struct ethosn_constant_digest *digest)
+{
+	return digest->hash[0] != 0 || digest->hash[1] != 0;
+}
+
+/**
+ * constant_data_equals() - Compare constant data with data from user space
+ * @dma_info:	Existing data.
+ * @data:	User space data, of the same size as dma_info.
+ *
+ * The user space data is read a page at a time, so it doesn't need a copy
+ * as large as itself.
+ *
+ * Return: True if the data is identical, else false (including when the user
+ * space data can't be read).
+ */
+static bool constant_data_equals(struct ethosn_dma_info *dma_info,
+				 const struct ethosn_constant_data *data)
+{
+	const u8 *existing = dma_info->cpu_addr;
+	const u8 __user *user_data = data->data;
+	bool equal = true;
+	u32 offset;
+	u8 *chunk;
+
+	chunk = kmalloc(PAGE_SIZE, GFP_KERNEL);
+	if (!chunk)
+		return false;
+
+	for (offset = 0; offset < data->size && equal; offset += PAGE_SIZE) {
+		u32 n = min_t(u32, data->size - offset, PAGE_SIZE);
+
+		equal = !copy_from_user(chunk, user_data + offset, n) &&
+			!memcmp(chunk, existing + offset, n);
+	}
+
+	kfree(chunk);
+
+	return equal;
+}
+
+static void free_constant_data(struct ethosn_device *ethosn,
+			       struct ethosn_constant_data_entry *entry)
+{
+	int i;
+
+	if (!IS_ERR_OR_NULL(entry->dma_info)) {
+		for (i = 0; i < ethosn->num_cores; ++i)
+			ethosn_dma_unmap(ethosn->core[i]->allocator,
+					 entry->dma_info,
+					 entry->stream_id);
+
+		ethosn_dma_free(ethosn->allocator, entry->dma_info);
+	}
+
+	kfree(entry);
+}
+
+/**
+ * get_constant_data() - Get a reference to constant data for a network
+ * @ethosn:	Ethos-N device, whose mutex must be held.
+ * @data:	User space data.
+ * @digest:	Digest of the data, supplied by user space.
+ * @stream_id:	Stream to map the data to on every core.
+ *
+ * If an entry with the same digest, size, stream and contents is already in
+ * the pool, it is shared. Otherwise the data is copied into a new allocation,
+ * which is added to the pool if it has a digest.
+ *
+ * Return: Entry on success, else error pointer.
+ */
+static struct ethosn_constant_data_entry *get_constant_data(
+	struct ethosn_device *ethosn,
+	const struct ethosn_constant_data *data,
+	const struct ethosn_constant_digest *digest,
+	enum ethosn_stream_id stream_id)
+{
+	struct ethosn_constant_data_entry *entry;
+	int ret = -ENOMEM;
+	int i;
+
+	if (has_digest(digest)) {
+		list_for_each_entry(entry, &ethosn->constant_data_pool, node) {
+			if (entry->stream_id != stream_id ||
+			    entry->size != data->size ||
+			    memcmp(&entry->digest, digest, sizeof(*digest)))
+				continue;
+
+			/* The digest comes from user space, so only trust
+			 * the contents.
+			 */
+			if (!constant_data_equals(entry->dma_info, data))
+				continue;
+
+			++entry->refcount;
+
+			return entry;
+		}
+	}
+
+	entry = kzalloc(sizeof(*entry), GFP_KERNEL);
+	if (!entry)
+		return ERR_PTR(-ENOMEM);
+
+	INIT_LIST_HEAD(&entry->node);
+	entry->digest = *digest;
+	entry->stream_id = stream_id;
+	entry->size = data->size;
+	entry->refcount = 1;
+
+	entry->dma_info = ethosn_dma_alloc(ethosn->allocator, data->size,
+					   GFP_KERNEL);
+	if (IS_ERR_OR_NULL(entry->dma_info))
+		goto err_free_entry;
+
+	for (i = 0; i < ethosn->num_cores; ++i) {
+		ret = ethosn_dma_map(ethosn->core[i]->allocator,
+				     entry->dma_info,
+				     ETHOSN_PROT_READ,
+				     stream_id);
+		if (ret)
+			goto err_free_entry;
+	}
+
+	if (copy_from_user(entry->dma_info->cpu_addr, data->data,
+			   data->size)) {
+		ret = -EFAULT;
+		goto err_free_entry;
+	}
+
+	if (has_digest(digest))
+		list_add(&entry->node, &ethosn->constant_data_pool);
+
+	return entry;
+
+err_free_entry:
+	free_constant_data(ethosn, entry);
+
+	return ERR_PTR(ret);
+}
+
+/**
+ * put_constant_data() - Release a network's reference to constant data
+ * @ethosn:	Ethos-N device, whose mutex must be held.
+ * @entry:	Entry from get_constant_data(), or NULL.
+ */
+static void put_constant_data(struct ethosn_device *ethosn,
+			      struct ethosn_constant_data_entry *entry)
+{
+	if (!entry || --entry->refcount)
+		return;
+
+	list_del(&entry->node);
+	free_constant_data(ethosn, entry);
+}
+
 static void free_network(struct ethosn_network *network)
 {
 	int i = 0;
@@ -1083,14 +2155,6 @@ static void free_network(struct ethosn_network *network)
 	for (i = 0; i < ethosn->num_cores; i++) {
 		struct ethosn_core *core = ethosn->core[i];
 
-		/* Unmap virtual addresses from core */
-		ethosn_dma_unmap(core->allocator,
-				 network->constant_dma_data,
-				 ETHOSN_STREAM_DMA);
-		ethosn_dma_unmap(core->allocator,
-				 network->constant_cu_data,
-				 ETHOSN_STREAM_COMMAND_STREAM);
-
 		/* Free allocated dma from core */
 		if (network->intermediate_data)
 			ethosn_dma_unmap_and_free(
@@ -1105,10 +2169,10 @@ static void free_network(struct ethosn_network *network)
 				ETHOSN_STREAM_COMMAND_STREAM);
 	}
 
-	/* Free allocated dma from top level device */
-	ethosn_dma_free(ethosn->allocator, network->constant_dma_data);
-	ethosn_dma_free(ethosn->allocator, network->constant_cu_data);
+	put_constant_data(ethosn, network->constant_dma_entry);
+	put_constant_data(ethosn, network->constant_cu_entry);
 
+	kfree(network->binding_ids);
 	kfree(network->intermediate_data);
 	kfree(network->inference_data);
 	kfree(network->intermediates);
@@ -1128,7 +2192,7 @@ static void free_network(struct ethosn_network *network)
  * Return: Network pointer on success, else error code.
  */
 static struct ethosn_network *create_network(struct ethosn_device *ethosn,
-					     struct ethosn_network_req *net_req)
+					     struct ethosn_network_req2 *net_req)
 {
 	/* Note:- We register network on ethosn.
 	 * For carveout :- We allocate constant data. inference data
@@ -1142,13 +2206,15 @@ static struct ethosn_network *create_network(struct ethosn_device *ethosn,
 	 */
 	struct ethosn_network *network;
 	int ret = -ENOMEM;
-	int i;
 
 	network = kzalloc(sizeof(*network), GFP_KERNEL);
 	if (!network)
 		return ERR_PTR(-ENOMEM);
 
 	network->ethosn = ethosn;
+	network->last_core_id = -1;
+	spin_lock_init(&network->stats_lock);
+	atomic_set(&network->num_dispatched, 0);
 
 	/* Increment ref-count on device. Not sure why this is necessary,
 	 * but it needs to be before any potential failures so that when we
@@ -1157,55 +2223,33 @@ static struct ethosn_network *create_network(struct ethosn_device *ethosn,
 	 */
 	get_device(ethosn->dev);
 
-	network->constant_dma_data = ethosn_dma_alloc(ethosn->allocator,
-						      net_req->dma_data.size,
-						      GFP_KERNEL);
-
-	if (IS_ERR_OR_NULL(network->constant_dma_data))
-		goto err_free_network;
-
-	for (i = 0; i < ethosn->num_cores; ++i) {
-		ret = ethosn_dma_map(ethosn->core[i]->allocator,
-				     network->constant_dma_data,
-				     ETHOSN_PROT_READ,
-				     ETHOSN_STREAM_DMA);
-		if (ret)
-			goto err_free_network;
-	}
-
-	if (copy_from_user(network->constant_dma_data->cpu_addr,
-			   net_req->dma_data.data,
-			   net_req->dma_data.size)) {
+	network->constant_dma_entry = get_constant_data(
+		ethosn, &net_req->req.dma_data, &net_req->dma_digest,
+		ETHOSN_STREAM_DMA);
+	if (IS_ERR(network->constant_dma_entry)) {
+		ret = PTR_ERR(network->constant_dma_entry);
+		network->constant_dma_entry = NULL;
 		dev_err(ethosn->dev,
-			"Error reading constant dma data\n");
+			"Error getting constant dma data\n");
 		goto err_free_network;
 	}
 
-	network->constant_cu_data =
-		ethosn_dma_alloc(ethosn->allocator,
-				 net_req->cu_data.size,
-				 GFP_KERNEL);
-	if (IS_ERR_OR_NULL(network->constant_cu_data))
-		goto err_free_network;
-
-	for (i = 0; i < ethosn->num_cores; ++i) {
-		ret = ethosn_dma_map(ethosn->core[i]->allocator,
-				     network->constant_cu_data,
-				     ETHOSN_PROT_READ,
-				     ETHOSN_STREAM_COMMAND_STREAM);
-		if (ret)
-			goto err_free_network;
-	}
+	network->constant_dma_data = network->constant_dma_entry->dma_info;
 
-	if (copy_from_user(network->constant_cu_data->cpu_addr,
-			   net_req->cu_data.data,
-			   net_req->cu_data.size)) {
+	network->constant_cu_entry = get_constant_data(
+		ethosn, &net_req->req.cu_data, &net_req->cu_digest,
+		ETHOSN_STREAM_COMMAND_STREAM);
+	if (IS_ERR(network->constant_cu_entry)) {
+		ret = PTR_ERR(network->constant_cu_entry);
+		network->constant_cu_entry = NULL;
 		dev_err(ethosn->dev,
-			"Error reading constant cu data\n");
+			"Error getting constant cu data\n");
 		goto err_free_network;
 	}
 
-	ret = alloc_init_inference_data(network, net_req);
+	network->constant_cu_data = network->constant_cu_entry->dma_info;
+
+	ret = alloc_init_inference_data(network, &net_req->req);
 	if (ret)
 		goto err_free_network;
 
@@ -1245,7 +2289,7 @@ static int network_release(struct inode *inode,
  * Return: FD on success, else error code
  */
 int ethosn_network_register(struct ethosn_device *ethosn,
-			    struct ethosn_network_req *net_req)
+			    struct ethosn_network_req2 *net_req)
 {
 	static const struct file_operations network_fops = {
 		.owner          = THIS_MODULE,
@@ -1258,12 +2302,18 @@ int ethosn_network_register(struct ethosn_device *ethosn,
 
 	struct ethosn_network *network;
 	struct ethosn_log_uapi_network_req log;
-	int fd;
+	int fd, ret;
+
+	ret = ethosn_sched_check_priority(&net_req->priority);
+	if (ret)
+		return ret;
 
 	network = create_network(ethosn, net_req);
 	if (IS_ERR(network))
 		return PTR_ERR(network);
 
+	network->priority = net_req->priority;
+
 	fd = anon_inode_getfd("ethosn-network",
 			      &network_fops,
 			      network,
@@ -1280,7 +2330,7 @@ int ethosn_network_register(struct ethosn_device *ethosn,
 	dev_dbg(ethosn->dev,
 		"Registered network. handle=0x%pK\n", network);
 
-	log.request = *net_req;
+	log.request = net_req->req;
 	log.handle = (ptrdiff_t)network;
 	log.fd = fd;
 
@@ -1298,20 +2348,30 @@ void ethosn_network_poll(struct ethosn_core *core,
 			 int status)
 {
 	if (inference) {
-		struct ethosn_dma_allocator *allocator =
-			core->parent->allocator;
+		u64 now = ktime_get_ns();
 		int i;
 
+		/* Recorded before the status changes, so that it is there
+		 * when user space reads the status.
+		 */
+		if (status == ETHOSN_INFERENCE_COMPLETED) {
+			record_execution(inference, now);
+			finish_hw_counter_sampling(core, inference, now);
+		} else {
+			inference->hw_counter_buffer = NULL;
+		}
+
 		inference->status = status;
 
 		for (i = 0; i < inference->network->num_outputs; ++i)
-			ethosn_dma_sync_for_cpu(
-				allocator,
-				inference->outputs[i]->dma_info);
+			ethosn_buffer_sync_for_cpu(inference->outputs[i]);
+
+		inference_wake_waiters(inference);
 
-		wake_up_poll(&inference->poll_wqh, EPOLLIN);
 		put_inference(inference);
 
+		ethosn_sched_core_stop(&core->sched, now);
+
 		dev_dbg(core->dev,
 			"END_INFERENCE: %llu on core_id = %d",
 			ktime_get_ns(), core->core_id);
@@ -28,11 +28,11 @@
 
 struct ethosn_core;
 struct ethosn_inference;
-struct ethosn_network_req;
+struct ethosn_network_req2;
 struct ethosn_inference_req;
 
 int ethosn_network_register(struct ethosn_device *ethosn,
-			    struct ethosn_network_req *net_req);
+			    struct ethosn_network_req2 *net_req);
 
 void ethosn_network_poll(struct ethosn_core *core,
 			 struct ethosn_inference *inference,
@@ -0,0 +1,267 @@
+/*
+ *
+ * (C) COPYRIGHT 2021 Arm Limited.
+ *
+ * This program is free software and is provided to you under the terms of the
+ * GNU General Public License version 2 as published by the Free Software
+ * Foundation, and any use by you of this program is subject to the terms
+ * of such GNU licence.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you can access it online at
+ * http://www.gnu.org/licenses/gpl-2.0.html.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+#include "ethosn_sched.h"
+
+#include <linux/errno.h>
+
+void ethosn_sched_init(struct ethosn_sched_queue *queue,
+		       u64 starvation_ns)
+{
+	u32 i;
+
+	for (i = 0; i < ETHOSN_NUM_PRIORITIES; ++i) {
+		INIT_LIST_HEAD(&queue->classes[i]);
+		INIT_LIST_HEAD(&queue->deadlines[i]);
+	}
+
+	queue->num_queued = 0;
+	queue->starvation_ns = starvation_ns;
+	queue->missed_deadlines = 0;
+}
+
+/**
+ * ethosn_sched_check_priority() - Validate scheduling parameters
+ * @prio:	Parameters from userspace
+ *
+ * Return: 0 on success, else -EINVAL.
+ */
+int ethosn_sched_check_priority(const struct ethosn_network_priority *prio)
+{
+	if (prio->priority > ETHOSN_PRIORITY_HIGH)
+		return -EINVAL;
+
+	return 0;
+}
+
+/**
+ * ethosn_sched_enqueue() - Queue an inference
+ * @queue:	Queue
+ * @entry:	Entry of the inference, which must not be queued already
+ * @prio:	Scheduling parameters of the inference's network
+ * @now_ns:	Current time
+ */
+void ethosn_sched_enqueue(struct ethosn_sched_queue *queue,
+			  struct ethosn_sched_entry *entry,
+			  const struct ethosn_network_priority *prio,
+			  u64 now_ns)
+{
+	entry->priority = prio->priority;
+	entry->queued_ns = now_ns;
+	entry->deadline_ns = prio->deadline_us ?
+			     now_ns + (u64)prio->deadline_us * 1000 : 0;
+
+	list_add_tail(&entry->node, &queue->classes[entry->priority]);
+	++queue->num_queued;
+
+	if (entry->deadline_ns) {
+		struct list_head *deadlines =
+			&queue->deadlines[entry->priority];
+		struct ethosn_sched_entry *pos;
+
+		/* Deadlines mostly arrive in order, so search from the latest.
+		 * If there is no earlier deadline, pos ends up on the list head
+		 * and the entry goes first.
+		 */
+		list_for_each_entry_reverse(pos, deadlines, deadline_node) {
+			if (pos->deadline_ns <= entry->deadline_ns)
+				break;
+		}
+
+		list_add(&entry->deadline_node, &pos->deadline_node);
+	}
+}
+
+/*
+ * The oldest entry below the highest priority which has waited for longer
+ * than the starvation limit, if any.
+ */
+static struct ethosn_sched_entry *find_starved(struct ethosn_sched_queue *queue,
+					       u64 now_ns)
+{
+	struct ethosn_sched_entry *starved = NULL;
+	struct ethosn_sched_entry *head;
+	u32 i;
+
+	if (!queue->starvation_ns)
+		return NULL;
+
+	for (i = 0; i < ETHOSN_PRIORITY_HIGH; ++i) {
+		head = list_first_entry_or_null(&queue->classes[i],
+						struct ethosn_sched_entry,
+						node);
+		if (!head || (now_ns - head->queued_ns <= queue->starvation_ns))
+			continue;
+
+		if (!starved || (head->queued_ns < starved->queued_ns))
+			starved = head;
+	}
+
+	return starved;
+}
+
+/*
+ * The next entry to run: a starving entry if there is one, else the entry of
+ * the highest priority with the earliest deadline, or the first one queued if
+ * none has a deadline. Ties go to the entry queued first.
+ */
+static struct ethosn_sched_entry *select_next(struct ethosn_sched_queue *queue,
+					      u64 now_ns)
+{
+	struct ethosn_sched_entry *entry;
+	int i;
+
+	if (ethosn_sched_empty(queue))
+		return NULL;
+
+	entry = find_starved(queue, now_ns);
+
+	for (i = ETHOSN_PRIORITY_HIGH; !entry && i >= 0; --i) {
+		entry = list_first_entry_or_null(&queue->deadlines[i],
+						 struct ethosn_sched_entry,
+						 deadline_node);
+		if (!entry)
+			entry = list_first_entry_or_null(
+				&queue->classes[i], struct ethosn_sched_entry,
+				node);
+	}
+
+	return entry;
+}
+
+/**
+ * ethosn_sched_peek() - Get the next inference to run without removing it
+ * @queue:	Queue
+ * @now_ns:	Current time
+ *
+ * Return: Entry of the inference, or NULL if the queue is empty.
+ */
+struct ethosn_sched_entry *ethosn_sched_peek(struct ethosn_sched_queue *queue,
+					     u64 now_ns)
+{
+	return select_next(queue, now_ns);
+}
+
+/**
+ * ethosn_sched_dequeue() - Remove the next inference to run
+ * @queue:	Queue
+ * @now_ns:	Current time
+ *
+ * Return: Entry of the inference, or NULL if the queue is empty.
+ */
+struct ethosn_sched_entry *ethosn_sched_dequeue(
+	struct ethosn_sched_queue *queue,
+	u64 now_ns)
+{
+	struct ethosn_sched_entry *entry = select_next(queue, now_ns);
+
+	if (!entry)
+		return NULL;
+
+	ethosn_sched_remove(queue, entry);
+
+	if (entry->deadline_ns && (now_ns > entry->deadline_ns))
+		++queue->missed_deadlines;
+
+	return entry;
+}
+
+/**
+ * ethosn_sched_remove() - Remove an inference which has not been dequeued
+ * @queue:	Queue
+ * @entry:	Entry of the inference
+ */
+void ethosn_sched_remove(struct ethosn_sched_queue *queue,
+			 struct ethosn_sched_entry *entry)
+{
+	list_del_init(&entry->node);
+	if (entry->deadline_ns)
+		list_del(&entry->deadline_node);
+
+	--queue->num_queued;
+}
+
+/**
+ * ethosn_sched_core_start() - Account for an inference starting on a core
+ * @core:	Scheduling state of the core
+ * @now_ns:	Current time
+ */
+void ethosn_sched_core_start(struct ethosn_sched_core *core,
+			     u64 now_ns)
+{
+	core->start_ns = now_ns;
+	core->running = true;
+	++core->num_inferences;
+}
+
+/**
+ * ethosn_sched_core_stop() - Account for the inference of a core ending
+ * @core:	Scheduling state of the core
+ * @now_ns:	Current time
+ *
+ * Does nothing if no inference was started.
+ */
+void ethosn_sched_core_stop(struct ethosn_sched_core *core,
+			    u64 now_ns)
+{
+	if (!core->running)
+		return;
+
+	core->busy_ns += now_ns - core->start_ns;
+	core->idle_ns = now_ns;
+	core->running = false;
+}
+
+/**
+ * ethosn_sched_prefer_core() - Compare two cores
+ * @core:	Scheduling state of the candidate core
+ * @core_id:	Id of the candidate core
+ * @best:	Scheduling state of the best core so far
+ * @best_id:	Id of the best core so far
+ * @affinity:	Id of the core which last ran the network to schedule, or -1
+ *
+ * The core which last ran the network is preferred, as its binding table
+ * already points to the network's buffers. Otherwise the load is balanced on
+ * the work the cores currently have: an idle core is preferred to a running
+ * one, and among idle cores the one which has been idle the longest. How busy
+ * a core was in the past is not taken into account, so that a core which was
+ * loaded earlier on is not avoided for good.
+ *
+ * Return: True if the candidate core should be used rather than the best one.
+ */
+bool ethosn_sched_prefer_core(const struct ethosn_sched_core *core,
+			      int core_id,
+			      const struct ethosn_sched_core *best,
+			      int best_id,
+			      int affinity)
+{
+	if (best_id == affinity)
+		return false;
+
+	if (core_id == affinity)
+		return true;
+
+	if (core->running != best->running)
+		return !core->running;
+
+	return core->idle_ns < best->idle_ns;
+}
@@ -0,0 +1,150 @@
+/*
+ *
+ * (C) COPYRIGHT 2021 Arm Limited.
+ *
+ * This program is free software and is provided to you under the terms of the
+ * GNU General Public License version 2 as published by the Free Software
+ * Foundation, and any use by you of this program is subject to the terms
+ * of such GNU licence.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you can access it online at
+ * http://www.gnu.org/licenses/gpl-2.0.html.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+#ifndef _ETHOSN_SCHED_H_
+#define _ETHOSN_SCHED_H_
+
+#include "uapi/ethosn.h"
+
+#include <linux/list.h>
+#include <linux/types.h>
+
+/*
+ * Queueing policy of the inferences waiting for a free core, and choice of
+ * the core to run them on.
+ *
+ * This only depends on <linux/list.h> and takes the current time as an
+ * argument, so that it can be built and tested in userspace. Locking is left
+ * to the caller.
+ */
+
+#define ETHOSN_NUM_PRIORITIES (ETHOSN_PRIORITY_HIGH + 1)
+
+/**
+ * struct ethosn_sched_entry - Queued inference
+ * @node:		Position in the queue of its priority
+ * @deadline_node:	Position in the deadline order of its priority, only
+ *			used if it has a deadline
+ * @priority:		Priority, see enum ethosn_priority
+ * @queued_ns:		Time at which it was queued
+ * @deadline_ns:	Time by which it should start, 0 for none
+ */
+struct ethosn_sched_entry {
+	struct list_head node;
+	struct list_head deadline_node;
+	u32              priority;
+	u64              queued_ns;
+	u64              deadline_ns;
+};
+
+/**
+ * struct ethosn_sched_queue - Priority queue of inferences
+ * @classes:		One queue per priority, in queueing order
+ * @deadlines:		The entries of each priority which have a deadline, in
+ *			deadline order and then in queueing order
+ * @num_queued:		Number of queued entries
+ * @starvation_ns:	Entries waiting for longer than this are dequeued before
+ *			any higher priority entry. 0 disables it.
+ * @missed_deadlines:	Number of entries dequeued after their deadline
+ */
+struct ethosn_sched_queue {
+	struct list_head classes[ETHOSN_NUM_PRIORITIES];
+	struct list_head deadlines[ETHOSN_NUM_PRIORITIES];
+	u32              num_queued;
+	u64              starvation_ns;
+	u64              missed_deadlines;
+};
+
+/**
+ * struct ethosn_sched_core - Scheduling state of a core
+ * @busy_ns:		Total time spent running inferences, for statistics
+ * @start_ns:		Start time of the running inference, if any
+ * @idle_ns:		End time of the last inference, 0 if none has run
+ * @running:		Whether an inference is running
+ * @num_inferences:	Number of inferences started
+ */
+struct ethosn_sched_core {
+	u64  busy_ns;
+	u64  start_ns;
+	u64  idle_ns;
+	bool running;
+	u64  num_inferences;
+};
+
+void ethosn_sched_init(struct ethosn_sched_queue *queue,
+		       u64 starvation_ns);
+
+static inline bool ethosn_sched_empty(const struct ethosn_sched_queue *queue)
+{
+	return queue->num_queued == 0;
+}
+
+/**
+ * ethosn_sched_entry_init() - Initialize an entry which is not queued
+ * @entry:	Entry
+ */
+static inline void ethosn_sched_entry_init(struct ethosn_sched_entry *entry)
+{
+	INIT_LIST_HEAD(&entry->node);
+}
+
+/**
+ * ethosn_sched_queued() - Check whether an entry is still queued
+ * @entry:	Entry, initialized with ethosn_sched_entry_init()
+ *
+ * An entry stops being queued when it is dequeued or removed.
+ */
+static inline bool ethosn_sched_queued(const struct ethosn_sched_entry *entry)
+{
+	return !list_empty(&entry->node);
+}
+
+int ethosn_sched_check_priority(const struct ethosn_network_priority *prio);
+
+void ethosn_sched_enqueue(struct ethosn_sched_queue *queue,
+			  struct ethosn_sched_entry *entry,
+			  const struct ethosn_network_priority *prio,
+			  u64 now_ns);
+
+struct ethosn_sched_entry *ethosn_sched_peek(struct ethosn_sched_queue *queue,
+					     u64 now_ns);
+
+struct ethosn_sched_entry *ethosn_sched_dequeue(
+	struct ethosn_sched_queue *queue,
+	u64 now_ns);
+
+void ethosn_sched_remove(struct ethosn_sched_queue *queue,
+			 struct ethosn_sched_entry *entry);
+
+void ethosn_sched_core_start(struct ethosn_sched_core *core,
+			     u64 now_ns);
+
+void ethosn_sched_core_stop(struct ethosn_sched_core *core,
+			    u64 now_ns);
+
+bool ethosn_sched_prefer_core(const struct ethosn_sched_core *core,
+			      int core_id,
+			      const struct ethosn_sched_core *best,
+			      int best_id,
+			      int affinity);
+
+#endif /* _ETHOSN_SCHED_H_ */
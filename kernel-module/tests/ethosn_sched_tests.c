@@ -0,0 +1,413 @@
+/*
+ *
+ * (C) COPYRIGHT 2021 Arm Limited.
+ *
+ * This program is free software and is provided to you under the terms of the
+ * GNU General Public License version 2 as published by the Free Software
+ * Foundation, and any use by you of this program is subject to the terms
+ * of such GNU licence.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you can access it online at
+ * http://www.gnu.org/licenses/gpl-2.0.html.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+/*
+ * Userspace tests of the inference queueing policy in ethosn_sched.c.
+ *
+ * Besides direct tests of the queue and of the choice of core, scenarios are
+ * replayed on the simulated device of sched_sim.c.
+ */
+
+#include "sched_sim.h"
+
+#include <stdio.h>
+
+#define NSEC_PER_MSEC 1000000ULL
+
+static int failures;
+
+#define CHECK(cond)							  \
+	do {								  \
+		if (!(cond)) {						  \
+			fprintf(stderr, "%s:%d: CHECK(%s) failed\n",	  \
+				__FILE__, __LINE__, #cond);		  \
+			++failures;					  \
+		}							  \
+	} while (0)
+
+struct test_inference {
+	struct ethosn_sched_entry entry;
+	int                       id;
+};
+
+static void enqueue(struct ethosn_sched_queue *queue,
+		    struct test_inference *inference,
+		    int id,
+		    u32 priority,
+		    u32 deadline_us,
+		    u64 now_ns)
+{
+	struct ethosn_network_priority prio = {
+		.priority    = priority,
+		.deadline_us = deadline_us,
+	};
+
+	inference->id = id;
+	ethosn_sched_enqueue(queue, &inference->entry, &prio, now_ns);
+}
+
+/* Id of the next inference to run, or -1 if the queue is empty */
+static int dequeue(struct ethosn_sched_queue *queue,
+		   u64 now_ns)
+{
+	struct ethosn_sched_entry *entry = ethosn_sched_dequeue(queue, now_ns);
+
+	if (!entry)
+		return -1;
+
+	return container_of(entry, struct test_inference, entry)->id;
+}
+
+static void test_priority_order(void)
+{
+	struct ethosn_sched_queue queue;
+	struct test_inference inferences[4];
+
+	ethosn_sched_init(&queue, 0);
+
+	enqueue(&queue, &inferences[0], 0, ETHOSN_PRIORITY_LOW, 0, 0);
+	enqueue(&queue, &inferences[1], 1, ETHOSN_PRIORITY_MEDIUM, 0, 1);
+	enqueue(&queue, &inferences[2], 2, ETHOSN_PRIORITY_HIGH, 0, 2);
+	enqueue(&queue, &inferences[3], 3, ETHOSN_PRIORITY_MEDIUM, 0, 3);
+
+	CHECK(queue.num_queued == 4);
+	CHECK(dequeue(&queue, 4) == 2);
+	CHECK(dequeue(&queue, 4) == 1);
+	CHECK(dequeue(&queue, 4) == 3);
+	CHECK(dequeue(&queue, 4) == 0);
+	CHECK(dequeue(&queue, 4) == -1);
+	CHECK(ethosn_sched_empty(&queue));
+}
+
+static void test_earliest_deadline_first(void)
+{
+	struct ethosn_sched_queue queue;
+	struct test_inference inferences[4];
+
+	ethosn_sched_init(&queue, 0);
+
+	enqueue(&queue, &inferences[0], 0, ETHOSN_PRIORITY_MEDIUM, 0, 0);
+	enqueue(&queue, &inferences[1], 1, ETHOSN_PRIORITY_MEDIUM, 300, 0);
+	enqueue(&queue, &inferences[2], 2, ETHOSN_PRIORITY_MEDIUM, 100, 0);
+	enqueue(&queue, &inferences[3], 3, ETHOSN_PRIORITY_MEDIUM, 0, 0);
+
+	/* Deadlines first, then the others in queueing order */
+	CHECK(dequeue(&queue, 0) == 2);
+	CHECK(dequeue(&queue, 0) == 1);
+	CHECK(dequeue(&queue, 0) == 0);
+	CHECK(dequeue(&queue, 0) == 3);
+	CHECK(queue.missed_deadlines == 0);
+}
+
+static void test_missed_deadline(void)
+{
+	struct ethosn_sched_queue queue;
+	struct test_inference inference;
+
+	ethosn_sched_init(&queue, 0);
+
+	enqueue(&queue, &inference, 0, ETHOSN_PRIORITY_HIGH, 1000, 0);
+	CHECK(dequeue(&queue, 1000 * 1000 + 1) == 0);
+	CHECK(queue.missed_deadlines == 1);
+}
+
+static void test_starvation(void)
+{
+	struct ethosn_sched_queue queue;
+	struct test_inference inferences[3];
+	const u64 limit = 10 * NSEC_PER_MSEC;
+
+	ethosn_sched_init(&queue, limit);
+
+	enqueue(&queue, &inferences[0], 0, ETHOSN_PRIORITY_LOW, 0, 0);
+	enqueue(&queue, &inferences[1], 1, ETHOSN_PRIORITY_MEDIUM, 0, 1);
+	enqueue(&queue, &inferences[2], 2, ETHOSN_PRIORITY_HIGH, 0, limit);
+
+	/* Nothing has waited for longer than the limit yet */
+	CHECK(dequeue(&queue, limit) == 2);
+
+	/* Both lower priorities are starving, the oldest goes first */
+	CHECK(dequeue(&queue, limit + 2) == 0);
+	CHECK(dequeue(&queue, limit + 2) == 1);
+}
+
+static void test_remove(void)
+{
+	struct ethosn_sched_queue queue;
+	struct test_inference inferences[2];
+
+	ethosn_sched_init(&queue, 0);
+
+	enqueue(&queue, &inferences[0], 0, ETHOSN_PRIORITY_HIGH, 0, 0);
+	enqueue(&queue, &inferences[1], 1, ETHOSN_PRIORITY_LOW, 0, 0);
+
+	ethosn_sched_remove(&queue, &inferences[0].entry);
+
+	CHECK(queue.num_queued == 1);
+	CHECK(dequeue(&queue, 0) == 1);
+	CHECK(ethosn_sched_empty(&queue));
+}
+
+static void test_remove_deadline(void)
+{
+	struct ethosn_sched_queue queue;
+	struct test_inference inferences[4];
+
+	ethosn_sched_init(&queue, 0);
+
+	enqueue(&queue, &inferences[0], 0, ETHOSN_PRIORITY_LOW, 200, 0);
+	enqueue(&queue, &inferences[1], 1, ETHOSN_PRIORITY_LOW, 100, 0);
+	enqueue(&queue, &inferences[2], 2, ETHOSN_PRIORITY_LOW, 200, 0);
+	enqueue(&queue, &inferences[3], 3, ETHOSN_PRIORITY_LOW, 0, 0);
+
+	ethosn_sched_remove(&queue, &inferences[1].entry);
+
+	/* Peeking and dequeuing agree, equal deadlines in queueing order */
+	CHECK(ethosn_sched_peek(&queue, 0) == &inferences[0].entry);
+	CHECK(dequeue(&queue, 0) == 0);
+	CHECK(ethosn_sched_peek(&queue, 0) == &inferences[2].entry);
+	CHECK(dequeue(&queue, 0) == 2);
+	CHECK(dequeue(&queue, 0) == 3);
+	CHECK(ethosn_sched_empty(&queue));
+}
+
+static void test_queued(void)
+{
+	struct ethosn_sched_queue queue;
+	struct test_inference inferences[3];
+	u32 i;
+
+	ethosn_sched_init(&queue, 0);
+
+	for (i = 0; i < 3; ++i) {
+		ethosn_sched_entry_init(&inferences[i].entry);
+		CHECK(!ethosn_sched_queued(&inferences[i].entry));
+	}
+
+	enqueue(&queue, &inferences[0], 0, ETHOSN_PRIORITY_HIGH, 0, 0);
+	enqueue(&queue, &inferences[1], 1, ETHOSN_PRIORITY_LOW, 100, 0);
+	enqueue(&queue, &inferences[2], 2, ETHOSN_PRIORITY_LOW, 0, 0);
+
+	for (i = 0; i < 3; ++i)
+		CHECK(ethosn_sched_queued(&inferences[i].entry));
+
+	/* Dequeued and removed entries are no longer queued, so an abort
+	 * racing with a core taking the inference does not remove it twice
+	 */
+	CHECK(dequeue(&queue, 0) == 0);
+	CHECK(!ethosn_sched_queued(&inferences[0].entry));
+	ethosn_sched_remove(&queue, &inferences[1].entry);
+	CHECK(!ethosn_sched_queued(&inferences[1].entry));
+	CHECK(ethosn_sched_queued(&inferences[2].entry));
+	CHECK(queue.num_queued == 1);
+}
+
+static void test_check_priority(void)
+{
+	struct ethosn_network_priority prio = { 0 };
+
+	prio.priority = ETHOSN_PRIORITY_HIGH;
+	CHECK(ethosn_sched_check_priority(&prio) == 0);
+
+	prio.priority = ETHOSN_PRIORITY_HIGH + 1;
+	CHECK(ethosn_sched_check_priority(&prio) != 0);
+}
+
+static void test_prefer_core(void)
+{
+	struct ethosn_sched_core idle = { 0 };
+	struct ethosn_sched_core recent = { 0 };
+	struct ethosn_sched_core running = { 0 };
+
+	/* Past load doesn't count, only how long the core has been idle */
+	idle.busy_ns = 1000;
+	idle.idle_ns = 50;
+	recent.idle_ns = 100;
+	running.running = true;
+
+	/* The longest idle core, unless the other one last ran the network */
+	CHECK(ethosn_sched_prefer_core(&idle, 1, &recent, 0, -1));
+	CHECK(!ethosn_sched_prefer_core(&recent, 1, &idle, 0, -1));
+	CHECK(ethosn_sched_prefer_core(&recent, 1, &idle, 0, 1));
+	CHECK(!ethosn_sched_prefer_core(&idle, 1, &recent, 0, 0));
+
+	/* An idle core rather than a running one */
+	CHECK(ethosn_sched_prefer_core(&recent, 1, &running, 0, -1));
+	CHECK(!ethosn_sched_prefer_core(&running, 1, &recent, 0, -1));
+}
+
+static void test_core_busy_time(void)
+{
+	struct ethosn_sched_core core = { 0 };
+
+	ethosn_sched_core_stop(&core, 10);
+	CHECK(core.busy_ns == 0);
+
+	ethosn_sched_core_start(&core, 10);
+	ethosn_sched_core_stop(&core, 25);
+	ethosn_sched_core_stop(&core, 40);
+	CHECK(core.busy_ns == 15);
+	CHECK(core.idle_ns == 25);
+	CHECK(core.num_inferences == 1);
+}
+
+#define SIM_MAX_INFERENCES 1024
+
+/*
+ * A 30 fps detector sharing a single core with a backlog of batch work must
+ * never wait for more than one batch inference.
+ */
+static void test_sim_detector_and_batch(void)
+{
+	static struct sim_inference inferences[SIM_MAX_INFERENCES];
+	struct sim_network networks[2];
+	struct sim sim;
+	const u64 frame_ns = 33 * NSEC_PER_MSEC;
+	const u64 batch_ns = 8 * NSEC_PER_MSEC;
+	const u32 num_frames = 30;
+	const u32 num_batch = 200;
+	u64 max_detector_wait = 0;
+	u32 num = 0;
+	u32 i;
+
+	sim_init(&sim, 1, networks, 2, 0);
+
+	/* The whole batch backlog is queued at once, then frames keep coming */
+	for (i = 0; i < num_batch; ++i, ++num) {
+		inferences[num].network = 0;
+		inferences[num].arrival_ns = 0;
+		inferences[num].duration_ns = batch_ns;
+		inferences[num].prio.priority = ETHOSN_PRIORITY_LOW;
+	}
+
+	for (i = 0; i < num_frames; ++i, ++num) {
+		inferences[num].network = 1;
+		inferences[num].arrival_ns = i * frame_ns;
+		inferences[num].duration_ns = 5 * NSEC_PER_MSEC;
+		inferences[num].prio.priority = ETHOSN_PRIORITY_HIGH;
+		inferences[num].prio.deadline_us = 10 * 1000;
+	}
+
+	sim_run(&sim, inferences, num);
+
+	for (i = 0; i < num; ++i) {
+		u64 wait = inferences[i].start_ns - inferences[i].arrival_ns;
+
+		if ((inferences[i].network == 1) && (wait > max_detector_wait))
+			max_detector_wait = wait;
+	}
+
+	CHECK(max_detector_wait <= batch_ns);
+	CHECK(sim.queue.missed_deadlines == 0);
+	CHECK(ethosn_sched_empty(&sim.queue));
+	CHECK(sim.cores[0].sched.busy_ns == num_batch * batch_ns +
+	      num_frames * 5 * NSEC_PER_MSEC);
+}
+
+/*
+ * Two networks taking turns on a dual-core device each stay on one core, and
+ * the load is spread over both cores.
+ */
+static void test_sim_affinity(void)
+{
+	static struct sim_inference inferences[SIM_MAX_INFERENCES];
+	struct sim_network networks[2];
+	struct sim sim;
+	const u32 num = 100;
+	u32 i;
+
+	sim_init(&sim, 2, networks, 2, 0);
+
+	for (i = 0; i < num; ++i) {
+		inferences[i].network = i % 2;
+		inferences[i].arrival_ns = (i / 2) * 10 * NSEC_PER_MSEC +
+					   (i % 2) * NSEC_PER_MSEC;
+		inferences[i].duration_ns = 4 * NSEC_PER_MSEC;
+		inferences[i].prio.priority = ETHOSN_PRIORITY_MEDIUM;
+	}
+
+	sim_run(&sim, inferences, num);
+
+	for (i = 0; i < 2; ++i) {
+		CHECK(networks[i].num_core_switches == 0);
+		CHECK(sim.cores[i].sched.num_inferences == num / 2);
+	}
+
+	/* Each network only ran on one core */
+	CHECK(networks[0].cores_used != networks[1].cores_used);
+	CHECK((networks[0].cores_used & (networks[0].cores_used - 1)) == 0);
+	CHECK((networks[1].cores_used & (networks[1].cores_used - 1)) == 0);
+}
+
+/* Bursts use both cores, then the network settles back on one of them */
+static void test_sim_burst(void)
+{
+	static struct sim_inference inferences[SIM_MAX_INFERENCES];
+	struct sim_network network;
+	struct sim sim;
+	u32 i;
+
+	sim_init(&sim, 2, &network, 1, 0);
+
+	for (i = 0; i < 10; ++i) {
+		inferences[i].network = 0;
+		inferences[i].arrival_ns = i < 2 ? 0 : i * 10 * NSEC_PER_MSEC;
+		inferences[i].duration_ns = 4 * NSEC_PER_MSEC;
+		inferences[i].prio.priority = ETHOSN_PRIORITY_MEDIUM;
+	}
+
+	sim_run(&sim, inferences, 10);
+
+	CHECK(network.cores_used == 0x3);
+	CHECK(inferences[0].core_id != inferences[1].core_id);
+	CHECK(network.num_core_switches == 1);
+
+	for (i = 3; i < 10; ++i)
+		CHECK(inferences[i].core_id == inferences[2].core_id);
+}
+
+int main(void)
+{
+	test_priority_order();
+	test_earliest_deadline_first();
+	test_missed_deadline();
+	test_starvation();
+	test_remove();
+	test_remove_deadline();
+	test_queued();
+	test_check_priority();
+	test_prefer_core();
+	test_core_busy_time();
+	test_sim_detector_and_batch();
+	test_sim_affinity();
+	test_sim_burst();
+
+	if (failures) {
+		fprintf(stderr, "%d check(s) failed\n", failures);
+
+		return 1;
+	}
+
+	printf("All tests passed\n");
+
+	return 0;
+}
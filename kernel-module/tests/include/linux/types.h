@@ -0,0 +1,40 @@
+/*
+ *
+ * (C) COPYRIGHT 2021 Arm Limited.
+ *
+ * This program is free software and is provided to you under the terms of the
+ * GNU General Public License version 2 as published by the Free Software
+ * Foundation, and any use by you of this program is subject to the terms
+ * of such GNU licence.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you can access it online at
+ * http://www.gnu.org/licenses/gpl-2.0.html.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+/* Userspace replacement of the kernel's <linux/types.h> for the tests */
+
+#ifndef _ETHOSN_TESTS_LINUX_TYPES_H_
+#define _ETHOSN_TESTS_LINUX_TYPES_H_
+
+#include_next <linux/types.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef __u8  u8;
+typedef __u16 u16;
+typedef __u32 u32;
+typedef __u64 u64;
+typedef __s32 s32;
+typedef __s64 s64;
+
+#endif /* _ETHOSN_TESTS_LINUX_TYPES_H_ */
@@ -0,0 +1,216 @@
+/*
+ *
+ * (C) COPYRIGHT 2021 Arm Limited.
+ *
+ * This program is free software and is provided to you under the terms of the
+ * GNU General Public License version 2 as published by the Free Software
+ * Foundation, and any use by you of this program is subject to the terms
+ * of such GNU licence.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you can access it online at
+ * http://www.gnu.org/licenses/gpl-2.0.html.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+/*
+ * Replays an inference trace on the simulated device of sched_sim.c and
+ * reports how the scheduler used the cores.
+ *
+ * Usage: sched_replay [-c num_cores] [-s starvation_ms] [trace]
+ *
+ * The trace, read from stdin if no file is given, has one inference per line,
+ * sorted by arrival time:
+ *
+ *     <arrival_us> <network> <priority> <deadline_us> <duration_us>
+ *
+ * where priority is 0 (low), 1 (medium) or 2 (high). Empty lines and lines
+ * starting with '#' are ignored.
+ */
+
+#include "sched_sim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define MAX_NETWORKS 64
+
+static int read_trace(FILE *file,
+		      struct sim_inference **inferences,
+		      u32 *num_inferences,
+		      u32 *num_networks)
+{
+	char line[256];
+	u32 capacity = 0;
+	u32 line_num = 0;
+
+	*inferences = NULL;
+	*num_inferences = 0;
+	*num_networks = 0;
+
+	while (fgets(line, sizeof(line), file)) {
+		unsigned long long arrival_us, duration_us;
+		unsigned int network, priority, deadline_us;
+		struct sim_inference *inference;
+		char first = '#';
+
+		++line_num;
+
+		if ((sscanf(line, " %c", &first) != 1) || (first == '#'))
+			continue;
+
+		if ((sscanf(line, "%llu %u %u %u %llu", &arrival_us, &network,
+			    &priority, &deadline_us, &duration_us) != 5) ||
+		    (network >= MAX_NETWORKS) ||
+		    (priority > ETHOSN_PRIORITY_HIGH)) {
+			fprintf(stderr, "Invalid trace line %u\n", line_num);
+
+			return -1;
+		}
+
+		if (*num_inferences == capacity) {
+			capacity = capacity ? capacity * 2 : 1024;
+			*inferences = realloc(*inferences,
+					      capacity * sizeof(**inferences));
+			if (!*inferences)
+				return -1;
+		}
+
+		inference = &(*inferences)[(*num_inferences)++];
+		inference->network = network;
+		inference->arrival_ns = arrival_us * 1000;
+		inference->duration_ns = duration_us * 1000;
+		inference->prio.priority = priority;
+		inference->prio.deadline_us = deadline_us;
+
+		if (*num_inferences > 1 &&
+		    (inference->arrival_ns < inference[-1].arrival_ns)) {
+			fprintf(stderr, "Trace line %u is out of order\n",
+				line_num);
+
+			return -1;
+		}
+
+		if (network >= *num_networks)
+			*num_networks = network + 1;
+	}
+
+	return 0;
+}
+
+static void report(const struct sim *sim,
+		   const struct sim_inference *inferences,
+		   u32 num_inferences)
+{
+	u32 i;
+
+	printf("Simulated %u inferences on %u cores in %.3f ms\n",
+	       num_inferences, sim->num_cores, sim->now_ns / 1e6);
+	printf("Missed deadlines: %llu\n",
+	       (unsigned long long)sim->queue.missed_deadlines);
+
+	printf("\ncore  inferences  busy_ms  utilisation\n");
+	for (i = 0; i < sim->num_cores; ++i) {
+		const struct ethosn_sched_core *core = &sim->cores[i].sched;
+
+		printf("%4u  %10llu  %7.3f  %10.1f%%\n", i,
+		       (unsigned long long)core->num_inferences,
+		       core->busy_ns / 1e6,
+		       sim->now_ns ? 100.0 * core->busy_ns / sim->now_ns : 0);
+	}
+
+	printf("\nnetwork  inferences  mean_wait_ms  max_wait_ms  core_switches  cores_used\n");
+	for (i = 0; i < sim->num_networks; ++i) {
+		const struct sim_network *network = &sim->networks[i];
+		u64 total_wait = 0, max_wait = 0;
+		u32 count = 0;
+		u32 j;
+
+		for (j = 0; j < num_inferences; ++j) {
+			u64 wait;
+
+			if (inferences[j].network != i)
+				continue;
+
+			wait = inferences[j].start_ns -
+			       inferences[j].arrival_ns;
+			total_wait += wait;
+			max_wait = wait > max_wait ? wait : max_wait;
+			++count;
+		}
+
+		if (!count)
+			continue;
+
+		printf("%7u  %10u  %12.3f  %11.3f  %13u  %10d\n", i, count,
+		       total_wait / 1e6 / count, max_wait / 1e6,
+		       network->num_core_switches,
+		       __builtin_popcount(network->cores_used));
+	}
+}
+
+int main(int argc,
+	 char **argv)
+{
+	struct sim_network networks[MAX_NETWORKS];
+	struct sim_inference *inferences;
+	u32 num_inferences, num_networks;
+	unsigned int num_cores = 2;
+	unsigned int starvation_ms = 1000;
+	FILE *file = stdin;
+	struct sim sim;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "c:s:")) != -1) {
+		switch (opt) {
+		case 'c':
+			num_cores = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			starvation_ms = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			fprintf(stderr,
+				"Usage: %s [-c num_cores] [-s starvation_ms] [trace]\n",
+				argv[0]);
+
+			return 1;
+		}
+	}
+
+	if ((num_cores == 0) || (num_cores > SIM_MAX_CORES)) {
+		fprintf(stderr, "Between 1 and %d cores are supported\n",
+			SIM_MAX_CORES);
+
+		return 1;
+	}
+
+	if (optind < argc) {
+		file = fopen(argv[optind], "r");
+		if (!file) {
+			perror(argv[optind]);
+
+			return 1;
+		}
+	}
+
+	if (read_trace(file, &inferences, &num_inferences, &num_networks))
+		return 1;
+
+	sim_init(&sim, num_cores, networks, num_networks,
+		 (u64)starvation_ms * 1000000);
+	sim_run(&sim, inferences, num_inferences);
+	report(&sim, inferences, num_inferences);
+
+	free(inferences);
+
+	return 0;
+}
@@ -0,0 +1,166 @@
+/*
+ *
+ * (C) COPYRIGHT 2021 Arm Limited.
+ *
+ * This program is free software and is provided to you under the terms of the
+ * GNU General Public License version 2 as published by the Free Software
+ * Foundation, and any use by you of this program is subject to the terms
+ * of such GNU licence.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you can access it online at
+ * http://www.gnu.org/licenses/gpl-2.0.html.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+#include "sched_sim.h"
+
+#include <string.h>
+
+void sim_init(struct sim *sim,
+	      u32 num_cores,
+	      struct sim_network *networks,
+	      u32 num_networks,
+	      u64 starvation_ns)
+{
+	u32 i;
+
+	memset(sim, 0, sizeof(*sim));
+	ethosn_sched_init(&sim->queue, starvation_ns);
+	sim->num_cores = num_cores;
+	sim->networks = networks;
+	sim->num_networks = num_networks;
+
+	for (i = 0; i < num_networks; ++i) {
+		networks[i].last_core_id = -1;
+		networks[i].cores_used = 0;
+		networks[i].num_core_switches = 0;
+	}
+}
+
+/* schedule_queued_inference() */
+static void start_next(struct sim *sim,
+		       u32 core_id)
+{
+	struct sim_core *core = &sim->cores[core_id];
+	struct ethosn_sched_entry *entry;
+	struct sim_inference *inference;
+	struct sim_network *network;
+
+	entry = ethosn_sched_dequeue(&sim->queue, sim->now_ns);
+	if (!entry)
+		return;
+
+	inference = container_of(entry, struct sim_inference, entry);
+	inference->start_ns = sim->now_ns;
+	inference->core_id = core_id;
+
+	network = &sim->networks[inference->network];
+	if ((network->last_core_id >= 0) &&
+	    (network->last_core_id != (int)core_id))
+		++network->num_core_switches;
+
+	network->last_core_id = core_id;
+	network->cores_used |= 1U << core_id;
+
+	core->current = inference;
+	core->end_ns = sim->now_ns + inference->duration_ns;
+	ethosn_sched_core_start(&core->sched, sim->now_ns);
+}
+
+/* get_free_core() */
+static int get_free_core(struct sim *sim)
+{
+	struct ethosn_sched_entry *entry;
+	int affinity = -1;
+	int best = -1;
+	u32 i;
+
+	entry = ethosn_sched_peek(&sim->queue, sim->now_ns);
+	if (entry) {
+		struct sim_inference *inference =
+			container_of(entry, struct sim_inference, entry);
+
+		affinity = sim->networks[inference->network].last_core_id;
+	}
+
+	for (i = 0; i < sim->num_cores; ++i) {
+		if (sim->cores[i].current)
+			continue;
+
+		if ((best < 0) ||
+		    ethosn_sched_prefer_core(&sim->cores[i].sched, i,
+					     &sim->cores[best].sched, best,
+					     affinity))
+			best = i;
+	}
+
+	return best;
+}
+
+/**
+ * sim_run() - Run inferences until they have all completed
+ * @sim:		Simulated device
+ * @inferences:		Inferences, sorted by arrival time
+ * @num_inferences:	Number of inferences
+ */
+void sim_run(struct sim *sim,
+	     struct sim_inference *inferences,
+	     u32 num_inferences)
+{
+	u32 next_arrival = 0;
+	u32 i;
+
+	for (;;) {
+		u64 next = ~0ULL;
+
+		/* Advance to the next arrival or completion */
+		if (next_arrival < num_inferences)
+			next = inferences[next_arrival].arrival_ns;
+
+		for (i = 0; i < sim->num_cores; ++i)
+			if (sim->cores[i].current &&
+			    (sim->cores[i].end_ns < next))
+				next = sim->cores[i].end_ns;
+
+		if (next == ~0ULL)
+			break;
+
+		if (next > sim->now_ns)
+			sim->now_ns = next;
+
+		/* ethosn_network_poll() */
+		for (i = 0; i < sim->num_cores; ++i) {
+			struct sim_core *core = &sim->cores[i];
+
+			if (!core->current || (core->end_ns > sim->now_ns))
+				continue;
+
+			ethosn_sched_core_stop(&core->sched, sim->now_ns);
+			core->current = NULL;
+			start_next(sim, i);
+		}
+
+		/* ethosn_inference_register() */
+		while ((next_arrival < num_inferences) &&
+		       (inferences[next_arrival].arrival_ns <= sim->now_ns)) {
+			struct sim_inference *inference =
+				&inferences[next_arrival++];
+			int core_id;
+
+			ethosn_sched_enqueue(&sim->queue, &inference->entry,
+					     &inference->prio, sim->now_ns);
+
+			core_id = get_free_core(sim);
+			if (core_id >= 0)
+				start_next(sim, core_id);
+		}
+	}
+}
@@ -0,0 +1,107 @@
+/*
+ *
+ * (C) COPYRIGHT 2021 Arm Limited.
+ *
+ * This program is free software and is provided to you under the terms of the
+ * GNU General Public License version 2 as published by the Free Software
+ * Foundation, and any use by you of this program is subject to the terms
+ * of such GNU licence.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you can access it online at
+ * http://www.gnu.org/licenses/gpl-2.0.html.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+/*
+ * Simulated Ethos-N device for the userspace tests of ethosn_sched.c.
+ *
+ * It follows the same steps as ethosn_network.c: an inference is queued when
+ * it arrives and started on the core chosen by get_free_core() if one is
+ * free, and a core which completes an inference starts the next queued one.
+ * Inferences take a fixed time to run.
+ */
+
+#ifndef _SCHED_SIM_H_
+#define _SCHED_SIM_H_
+
+#include "ethosn_sched.h"
+
+#define SIM_MAX_CORES 8
+
+/**
+ * struct sim_network - Network of the simulated device
+ * @last_core_id:	Core which last ran the network, or -1
+ * @cores_used:		Mask of the cores which ran the network
+ * @num_core_switches:	Number of times it ran on another core than the
+ *			previous time
+ */
+struct sim_network {
+	int last_core_id;
+	u32 cores_used;
+	u32 num_core_switches;
+};
+
+/**
+ * struct sim_inference - Inference of the simulated device
+ * @entry:		Queue entry
+ * @network:		Index of its network
+ * @arrival_ns:		Time at which it is queued
+ * @duration_ns:	Time it takes on a core
+ * @prio:		Scheduling parameters of its network
+ * @start_ns:		Time at which it started, filled in by sim_run()
+ * @core_id:		Core it ran on, filled in by sim_run()
+ */
+struct sim_inference {
+	struct ethosn_sched_entry      entry;
+	u32                            network;
+	u64                            arrival_ns;
+	u64                            duration_ns;
+	struct ethosn_network_priority prio;
+	u64                            start_ns;
+	int                            core_id;
+};
+
+struct sim_core {
+	struct ethosn_sched_core sched;
+	struct sim_inference     *current;
+	u64                      end_ns;
+};
+
+/**
+ * struct sim - Simulated device
+ * @queue:		Inference queue
+ * @num_cores:		Number of cores
+ * @cores:		Cores
+ * @networks:		Networks the inferences refer to
+ * @num_networks:	Number of networks
+ * @now_ns:		Current time, the end of the last inference after
+ *			sim_run()
+ */
+struct sim {
+	struct ethosn_sched_queue queue;
+	u32                       num_cores;
+	struct sim_core           cores[SIM_MAX_CORES];
+	struct sim_network        *networks;
+	u32                       num_networks;
+	u64                       now_ns;
+};
+
+void sim_init(struct sim *sim,
+	      u32 num_cores,
+	      struct sim_network *networks,
+	      u32 num_networks,
+	      u64 starvation_ns);
+
+void sim_run(struct sim *sim,
+	     struct sim_inference *inferences,
+	     u32 num_inferences);
+
+#endif /* _SCHED_SIM_H_ */
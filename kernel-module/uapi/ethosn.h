@@ -133,6 +133,49 @@ struct ethosn_constant_data {
 	const void __user *data;
 };
 
+/**
+ * enum ethosn_priority - Scheduling class of a network's inferences.
+ * @ETHOSN_PRIORITY_LOW:	Run when no other inference is queued.
+ * @ETHOSN_PRIORITY_MEDIUM:	Default priority of the driver library.
+ * @ETHOSN_PRIORITY_HIGH:	Run before any lower priority inference.
+ *
+ * Queued inferences of a higher priority always start before those of a lower
+ * priority, unless the latter have been waiting for longer than the
+ * starvation_ms module parameter.
+ */
+enum ethosn_priority {
+	ETHOSN_PRIORITY_LOW    = 0,
+	ETHOSN_PRIORITY_MEDIUM = 1,
+	ETHOSN_PRIORITY_HIGH   = 2,
+};
+
+/**
+ * struct ethosn_network_priority - Scheduling parameters of a network.
+ * @priority:		Priority of the inferences, see enum ethosn_priority.
+ * @deadline_us:	Optional time, from when an inference is queued, by which
+ *			it should start. Within a priority, the inference with
+ *			the earliest deadline starts first and inferences
+ *			without a deadline start last, in order. 0 for none.
+ */
+struct ethosn_network_priority {
+	__u32 priority;
+	__u32 deadline_us;
+};
+
+/**
+ * struct ethosn_constant_digest - Identifies the contents of constant data.
+ * @hash:	128-bit hash of the data, or all zeros if none is supplied.
+ *
+ * Registered networks whose constant data of the same kind (DMA or control
+ * unit) has the same size and digest share a single read-only copy of it,
+ * which is freed once the last of them is released. The kernel module checks
+ * that the data really is identical before sharing it, so a wrong digest only
+ * prevents sharing. Data without a digest is never shared.
+ */
+struct ethosn_constant_digest {
+	__u64 hash[2];
+};
+
 struct ethosn_network_req {
 	struct ethosn_buffer_infos  dma_buffers;
 	struct ethosn_constant_data dma_data;
@@ -147,6 +190,27 @@ struct ethosn_network_req {
 	struct ethosn_buffer_infos  output_buffers;
 };
 
+/**
+ * struct ethosn_network_req2 - Network description passed to
+ *      ETHOSN_IOCTL_REGISTER_NETWORK2.
+ * @req:	Same as for ETHOSN_IOCTL_REGISTER_NETWORK.
+ * @priority:	Scheduling parameters of the network's inferences, which
+ *		ETHOSN_IOCTL_SET_NETWORK_PRIORITY can change later.
+ * @dma_digest:	Digest of req.dma_data.
+ * @cu_digest:	Digest of req.cu_data.
+ *
+ * ETHOSN_IOCTL_REGISTER_NETWORK is kept for existing user space, and
+ * registers networks with ETHOSN_PRIORITY_MEDIUM, no deadline and no digests.
+ */
+struct ethosn_network_req2 {
+	struct ethosn_network_req      req;
+
+	struct ethosn_network_priority priority;
+
+	struct ethosn_constant_digest  dma_digest;
+	struct ethosn_constant_digest  cu_digest;
+};
+
 struct ethosn_inference_req {
 	__u32            num_inputs;
 	const int __user *input_fds;
@@ -155,11 +219,89 @@ struct ethosn_inference_req {
 	const int __user *output_fds;
 };
 
+/*
+ * ETHOSN_IOCTL_BIND_INFERENCE takes the same struct ethosn_inference_req as
+ * ETHOSN_IOCTL_SCHEDULE_INFERENCE, but returns a bound inference file
+ * descriptor without running it. The buffers are looked up and referenced
+ * once. Each ETHOSN_IOCTL_TRIGGER_INFERENCE on the bound file descriptor then
+ * runs the inference again on the same buffers. poll() and read() behave as
+ * for an inference file descriptor and report on the latest trigger.
+ * Triggering while the previous run is still in progress fails with -EBUSY.
+ */
+
+/* Maximum number of inferences in one ETHOSN_IOCTL_SCHEDULE_INFERENCE_BATCH */
+#define ETHOSN_MAX_INFERENCE_BATCH 256
+
+/**
+ * struct ethosn_inference_batch_req - Schedule several inferences at once.
+ * @num_inferences:	Number of inferences in the batch.
+ * @num_inputs:		Number of input buffers of each inference.
+ * @input_fds:		num_inferences * num_inputs buffer file descriptors,
+ *			inference by inference.
+ * @num_outputs:	Number of output buffers of each inference.
+ * @output_fds:		num_inferences * num_outputs buffer file descriptors,
+ *			inference by inference.
+ * @eventfd:		eventfd incremented once for every inference of the
+ *			batch that finishes, or -1.
+ *
+ * Returns a single batch file descriptor. poll() reports POLLIN once all
+ * inferences of the batch have finished. read() returns one __s32 status per
+ * inference, using the same values as an inference file descriptor.
+ * Closing the batch file descriptor aborts any unfinished inference.
+ */
+struct ethosn_inference_batch_req {
+	__u32            num_inferences;
+
+	__u32            num_inputs;
+	const int __user *input_fds;
+
+	__u32            num_outputs;
+	const int __user *output_fds;
+
+	__s32            eventfd;
+};
+
 struct ethosn_buffer_req {
 	__u32 size;
 	__u32 flags;
 };
 
+/**
+ * enum ethosn_buffer_import_type - Kind of memory wrapped by
+ *      ETHOSN_IOCTL_IMPORT_BUFFER.
+ * @ETHOSN_BUFFER_IMPORT_DMA_BUF:	An existing dma-buf file descriptor.
+ * @ETHOSN_BUFFER_IMPORT_USER_PTR:	Page-aligned user space memory.
+ */
+enum ethosn_buffer_import_type {
+	ETHOSN_BUFFER_IMPORT_DMA_BUF  = 0,
+	ETHOSN_BUFFER_IMPORT_USER_PTR = 1,
+};
+
+/**
+ * struct ethosn_buffer_import_req - Wrap existing memory as an Ethos-N buffer
+ *      without copying it.
+ * @type:	One of enum ethosn_buffer_import_type.
+ * @fd:		dma-buf file descriptor. Only used for
+ *		ETHOSN_BUFFER_IMPORT_DMA_BUF.
+ * @user_ptr:	Page-aligned user space address. Only used for
+ *		ETHOSN_BUFFER_IMPORT_USER_PTR.
+ * @size:	Number of bytes to import.
+ * @flags:	Access mode of the returned file descriptor (MB_RDONLY,
+ *		MB_WRONLY or MB_RDWR). With MB_RDONLY the memory is only
+ *		mapped for the Ethos-N to read, and the buffer is rejected
+ *		with -EACCES if it is used as an inference output.
+ *
+ * The memory is pinned until the returned buffer file descriptor is closed.
+ * The caller may close its dma-buf file descriptor once the import succeeded.
+ */
+struct ethosn_buffer_import_req {
+	__u32 type;
+	__s32 fd;
+	__u64 user_ptr;
+	__u32 size;
+	__u32 flags;
+};
+
 /*****************************************************************************
  * Capabilities
  *****************************************************************************/
@@ -243,6 +385,18 @@ struct ethosn_log_uapi_buffer_req {
 	__u32                    fd;
 } __packed;
 
+/**
+ * struct ethosn_log_uapi_buffer_import_req - Log buffer import request.
+ * @request:		UAPI request.
+ * @handle:		Handle identifier.
+ * @fd:			User space file descriptor.
+ */
+struct ethosn_log_uapi_buffer_import_req {
+	struct ethosn_buffer_import_req request;
+	__u64                           handle;
+	__u32                           fd;
+} __packed;
+
 /**
  * struct ethosn_log_uapi_network_req - Log network request.
  * @request:		UAPI request.
@@ -291,6 +445,87 @@ struct ethosn_profiling_config {
 	enum ethosn_profiling_hw_counter_types hw_counters[6];
 } __packed;
 
+/* Number of values of enum ethosn_profiling_hw_counter_types */
+#define ETHOSN_NUM_HW_COUNTER_TYPES (NCU_MCU_BUS_WRITE_BEATS + 1)
+
+/* Number of the most recent sampled inferences kept in
+ * struct ethosn_hw_counter_summary.
+ */
+#define ETHOSN_HW_COUNTER_RECENT_INFERENCES 16
+
+/**
+ * struct ethosn_hw_counter_inference - Hardware counters of one sampled
+ *      inference.
+ * @completed_ns:	Time the inference completed, from ktime_get_ns().
+ * @values:		Increase of each counter while the inference ran,
+ *			indexed by enum ethosn_profiling_hw_counter_types.
+ *			This is the last sample of the counter minus the first
+ *			one, so it is 0 for counters with fewer than two
+ *			samples.
+ */
+struct ethosn_hw_counter_inference {
+	__u64 completed_ns;
+	__u64 values[ETHOSN_NUM_HW_COUNTER_TYPES];
+};
+
+/**
+ * struct ethosn_hw_counter_summary - Hardware counters of the sampled
+ *      inferences of a network, returned by
+ *      ETHOSN_IOCTL_GET_HW_COUNTER_SUMMARY.
+ * @num_inferences:	Number of inferences whose samples were added.
+ * @num_lost_inferences:	Number of sampled inferences which were skipped
+ *				because the firmware overwrote their samples
+ *				before they could be added.
+ * @num_samples:	Number of samples of each counter, indexed by
+ *			enum ethosn_profiling_hw_counter_types. This is 0 for
+ *			counters which were not enabled.
+ * @totals:		Sum over the inferences of the increase of each
+ *			counter, see ethosn_hw_counter_inference.values.
+ * @max_per_inference:	Largest increase of each counter in a single
+ *			inference.
+ * @recent:		The most recent inferences whose samples were added.
+ *			The i-th of them, counting from 0, is in entry
+ *			i % ETHOSN_HW_COUNTER_RECENT_INFERENCES, so the newest
+ *			is at (num_inferences - 1) %
+ *			ETHOSN_HW_COUNTER_RECENT_INFERENCES.
+ *
+ * The firmware's samples are the running values of the counters, so the
+ * increase during an inference is taken from the first and last samples
+ * written while it ran. Events before the first sample are not counted.
+ *
+ * The statistics cover every sampled inference since the network was
+ * registered, see ETHOSN_IOCTL_SET_HW_COUNTER_SAMPLING_INTERVAL.
+ */
+struct ethosn_hw_counter_summary {
+	__u64 num_inferences;
+	__u64 num_lost_inferences;
+	__u64 num_samples[ETHOSN_NUM_HW_COUNTER_TYPES];
+	__u64 totals[ETHOSN_NUM_HW_COUNTER_TYPES];
+	__u64 max_per_inference[ETHOSN_NUM_HW_COUNTER_TYPES];
+	struct ethosn_hw_counter_inference
+		recent[ETHOSN_HW_COUNTER_RECENT_INFERENCES];
+};
+
+/*
+ * The firmware_profiling debugfs file of each core can be mapped (read-only,
+ * from offset zero, with the size rounded up to a whole number of pages) to
+ * access the firmware's profiling buffer in place. Its first field is the
+ * __u32 index of the entry which the firmware will write next. The entries
+ * (struct ethosn_profiling_entry) start at this offset and fill the rest of
+ * ethosn_profiling_config.firmware_buffer_size, which the firmware writes to
+ * circularly without waiting for the entries to be read.
+ */
+#define ETHOSN_PROFILING_BUFFER_ENTRIES_OFFSET 128
+
+/*
+ * ETHOSN_IOCTL_SET_HW_COUNTER_SAMPLING_INTERVAL takes a __u32 interval. If it
+ * is not 0, one in this many inferences of each network has the hardware
+ * counter samples which the firmware records while running it added to the
+ * network's struct ethosn_hw_counter_summary. This only happens while
+ * profiling is enabled with some hardware counters, see
+ * ETHOSN_IOCTL_CONFIGURE_PROFILING, which leaves the interval unchanged.
+ */
+
 /**
  * enum ethosn_poll_counter_name - All the counters that can be queried using
  *      ETHOSN_IOCTL_GET_COUNTER_VALUE.
@@ -300,6 +535,43 @@ enum ethosn_poll_counter_name {
 	ETHOSN_POLL_COUNTER_NAME_MAILBOX_MESSAGES_RECEIVED,
 };
 
+/* Number of buckets of struct ethosn_latency_histogram */
+#define ETHOSN_LATENCY_HISTOGRAM_BUCKETS 24
+
+/**
+ * struct ethosn_latency_histogram - Distribution of one kind of latency.
+ * @count:	Number of latencies recorded.
+ * @sum_ns:	Sum of the latencies recorded, in nanoseconds.
+ * @max_ns:	Largest latency recorded, in nanoseconds.
+ * @buckets:	Number of latencies recorded in each power of two range of
+ *		microseconds: bucket 0 counts latencies below 2us, bucket i
+ *		those from 2^i us up to 2^(i+1) us, and the last bucket
+ *		everything above.
+ */
+struct ethosn_latency_histogram {
+	__u64 count;
+	__u64 sum_ns;
+	__u64 max_ns;
+	__u64 buckets[ETHOSN_LATENCY_HISTOGRAM_BUCKETS];
+};
+
+/**
+ * struct ethosn_inference_latency_stats - Latencies of all the inferences of
+ *      a network, returned by ETHOSN_IOCTL_GET_INFERENCE_LATENCY_STATS.
+ * @queue_wait:		From being queued to being sent to a core.
+ * @execution:		From being sent to a core to the core reporting that
+ *			it has finished.
+ * @completion_to_wake:	From finishing to user space first reading its
+ *			status.
+ *
+ * The statistics cover every inference since the network was registered.
+ */
+struct ethosn_inference_latency_stats {
+	struct ethosn_latency_histogram queue_wait;
+	struct ethosn_latency_histogram execution;
+	struct ethosn_latency_histogram completion_to_wake;
+};
+
 /**
  * struct ethosn_log_firmware_header - Firmware log header.
  * @inference:		Current running inference handle.
@@ -338,6 +610,24 @@ struct ethosn_log_firmware_header {
 	ETHOSN_IO(0x09)
 #define ETHOSN_IOCTL_GET_VERSION \
 	ETHOSN_IO(0x0a)
+#define ETHOSN_IOCTL_IMPORT_BUFFER \
+	ETHOSN_IOW(0x0b, struct ethosn_buffer_import_req)
+#define ETHOSN_IOCTL_SCHEDULE_INFERENCE_BATCH \
+	ETHOSN_IOW(0x0c, struct ethosn_inference_batch_req)
+#define ETHOSN_IOCTL_BIND_INFERENCE \
+	ETHOSN_IOW(0x0d, struct ethosn_inference_req)
+#define ETHOSN_IOCTL_TRIGGER_INFERENCE \
+	ETHOSN_IO(0x0e)
+#define ETHOSN_IOCTL_SET_NETWORK_PRIORITY \
+	ETHOSN_IOW(0x0f, struct ethosn_network_priority)
+#define ETHOSN_IOCTL_GET_INFERENCE_LATENCY_STATS \
+	ETHOSN_IOR(0x10, struct ethosn_inference_latency_stats)
+#define ETHOSN_IOCTL_GET_HW_COUNTER_SUMMARY \
+	ETHOSN_IOR(0x11, struct ethosn_hw_counter_summary)
+#define ETHOSN_IOCTL_REGISTER_NETWORK2 \
+	ETHOSN_IOW(0x12, struct ethosn_network_req2)
+#define ETHOSN_IOCTL_SET_HW_COUNTER_SAMPLING_INTERVAL \
+	ETHOSN_IOW(0x13, __u32)
 
 /*
  * Results from reading an inference file descriptor.
@@ -355,7 +645,7 @@ struct ethosn_log_firmware_header {
 
 /* Version information */
 #define ETHOSN_KERNEL_MODULE_VERSION_MAJOR 1
-#define ETHOSN_KERNEL_MODULE_VERSION_MINOR 0
+#define ETHOSN_KERNEL_MODULE_VERSION_MINOR 8
 #define ETHOSN_KERNEL_MODULE_VERSION_PATCH 0
 
 /**